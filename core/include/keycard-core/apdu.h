@@ -0,0 +1,79 @@
+#pragma once
+
+#include "bytes.h"
+
+namespace Keycard {
+namespace Core {
+namespace Apdu {
+
+/**
+ * @brief Command APDU fields: [CLA | INS | P1 | P2 | Lc | Data | Le]
+ *
+ * hasData marks that Lc is sent even for empty data, which the GlobalPlatform
+ * commands need on iOS (see APDU::Command::serialize()).
+ */
+struct CommandFields {
+    uint8_t cla = 0;
+    uint8_t ins = 0;
+    uint8_t p1 = 0;
+    uint8_t p2 = 0;
+    ByteView data;
+    bool hasData = false;
+    bool hasLe = false;
+    uint8_t le = 0;
+};
+
+/**
+ * @brief Number of bytes serialize() writes for @p command
+ */
+size_t serializedSize(const CommandFields& command);
+
+/**
+ * @brief Serialize a command into @p out
+ * @param out Buffer of at least serializedSize(command) bytes
+ * @return Bytes written, or 0 if @p out is too small
+ */
+size_t serialize(const CommandFields& command, MutableByteView out);
+
+/**
+ * @brief Serialize a command, appending to @p out
+ */
+void serialize(const CommandFields& command, Bytes& out);
+
+/**
+ * @brief Response APDU split into data and status word: [Data | SW1 | SW2]
+ *
+ * data points into the buffer that was parsed.
+ */
+struct ResponseView {
+    ByteView data;
+    uint16_t sw = 0;
+
+    bool isOK() const { return sw == SW_OK; }
+
+    static constexpr uint16_t SW_OK = 0x9000;
+    static constexpr uint16_t SW_UNKNOWN = 0x6F00;
+};
+
+/**
+ * @brief Split a raw response; fewer than 2 bytes yields SW 0x6F00 and no data
+ */
+ResponseView parseResponse(ByteView raw);
+
+/**
+ * @brief Human-readable message for a status word
+ * @return Static string, or nullptr for status words without a fixed message
+ *         (0x63Cx retry counters and unknown codes)
+ */
+const char* statusMessage(uint16_t sw);
+
+/**
+ * @brief Remaining PIN/PUK attempts for 0x63Cx, -1 otherwise
+ */
+inline int remainingAttempts(uint16_t sw) {
+    return (sw & 0xFFF0) == 0x63C0 ? (sw & 0x000F) : -1;
+}
+
+} // namespace Apdu
+} // namespace Core
+} // namespace Keycard
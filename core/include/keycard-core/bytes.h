@@ -0,0 +1,109 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace Keycard {
+namespace Core {
+
+using Bytes = std::vector<uint8_t>;
+
+/**
+ * @brief Non-owning view of a byte buffer (C++17 stand-in for std::span<const uint8_t>)
+ *
+ * Views never outlive the buffer they were made from. Adapters create them
+ * directly over QByteArray storage, so nothing is copied at the boundary.
+ */
+class ByteView {
+public:
+    constexpr ByteView() = default;
+    constexpr ByteView(const uint8_t* data, size_t size) : m_data(data), m_size(size) {}
+    ByteView(const char* data, size_t size) : m_data(reinterpret_cast<const uint8_t*>(data)), m_size(size) {}
+    ByteView(const Bytes& bytes) : m_data(bytes.data()), m_size(bytes.size()) {}
+    template <size_t N>
+    constexpr ByteView(const std::array<uint8_t, N>& bytes) : m_data(bytes.data()), m_size(N) {}
+
+    constexpr const uint8_t* data() const { return m_data; }
+    constexpr size_t size() const { return m_size; }
+    constexpr bool empty() const { return m_size == 0; }
+    constexpr uint8_t operator[](size_t i) const { return m_data[i]; }
+    constexpr const uint8_t* begin() const { return m_data; }
+    constexpr const uint8_t* end() const { return m_data + m_size; }
+
+    /**
+     * @brief Sub-range, clamped to the view
+     */
+    ByteView sub(size_t offset, size_t count = static_cast<size_t>(-1)) const {
+        if (offset > m_size) {
+            return ByteView();
+        }
+        return ByteView(m_data + offset, count < m_size - offset ? count : m_size - offset);
+    }
+
+    ByteView first(size_t count) const { return sub(0, count); }
+    ByteView last(size_t count) const { return count < m_size ? sub(m_size - count) : *this; }
+
+    Bytes toBytes() const { return Bytes(begin(), end()); }
+
+    bool operator==(const ByteView& other) const {
+        return m_size == other.m_size && (m_size == 0 || std::memcmp(m_data, other.m_data, m_size) == 0);
+    }
+    bool operator!=(const ByteView& other) const { return !(*this == other); }
+
+private:
+    const uint8_t* m_data = nullptr;
+    size_t m_size = 0;
+};
+
+/**
+ * @brief Non-owning writable byte range
+ */
+class MutableByteView {
+public:
+    constexpr MutableByteView() = default;
+    constexpr MutableByteView(uint8_t* data, size_t size) : m_data(data), m_size(size) {}
+    MutableByteView(char* data, size_t size) : m_data(reinterpret_cast<uint8_t*>(data)), m_size(size) {}
+    MutableByteView(Bytes& bytes) : m_data(bytes.data()), m_size(bytes.size()) {}
+
+    constexpr uint8_t* data() const { return m_data; }
+    constexpr size_t size() const { return m_size; }
+    constexpr operator ByteView() const { return ByteView(m_data, m_size); }
+
+private:
+    uint8_t* m_data = nullptr;
+    size_t m_size = 0;
+};
+
+inline void append(Bytes& out, ByteView bytes) {
+    out.insert(out.end(), bytes.begin(), bytes.end());
+}
+
+/**
+ * @brief Lowercase hex encoding
+ */
+std::string toHex(ByteView bytes);
+
+/**
+ * @brief Append ISO/IEC 7816-4 padding (0x80 then 0x00 up to the block size)
+ *
+ * Always adds at least one byte, as SecureChannel and SCP02 expect.
+ */
+void appendPadding(Bytes& out, ByteView data, size_t blockSize);
+
+/**
+ * @brief Length of @p data without ISO/IEC 7816-4 padding
+ * @return Position of the trailing 0x80 marker, or data.size() if there is none
+ */
+size_t unpaddedSize(ByteView data);
+
+/**
+ * @brief Compare in time independent of where the buffers differ (MACs, cryptograms)
+ */
+bool constantTimeEqual(ByteView a, ByteView b);
+
+} // namespace Core
+} // namespace Keycard
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "bytes.h"
+#include <string>
+
+namespace Keycard {
+namespace Core {
+
+/**
+ * @brief BIP32 path in the form DERIVE KEY / EXPORT KEY / SIGN send it
+ */
+struct DerivationPath {
+    enum class Start : uint8_t {
+        Master,     // "m/..."
+        Parent,     // "../..."
+        Current     // "./..." or no prefix
+    };
+
+    static constexpr uint32_t HARDENED = 0x80000000;
+
+    Start start = Start::Current;
+    std::vector<uint32_t> components;
+
+    /**
+     * @brief Parse "m/44'/60'/0'/0/0", "../0/1", "./0" or "0/1"
+     *
+     * Matches CommandSet: "'" and "h" mark hardened steps, surrounding
+     * whitespace is ignored and malformed segments are skipped.
+     */
+    static DerivationPath parse(const std::string& path);
+
+    /**
+     * @brief Append the components as 4-byte big-endian words
+     */
+    void encode(Bytes& out) const;
+};
+
+} // namespace Core
+} // namespace Keycard
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "bytes.h"
+
+namespace Keycard {
+namespace Core {
+
+/**
+ * @brief GlobalPlatform SCP02 primitives (3DES with 16-byte K1||K2 keys)
+ *
+ * All functions return false on invalid key/IV sizes or when built without
+ * OpenSSL. The OpenSSL legacy provider (single DES) is loaded once and kept.
+ */
+namespace Scp02 {
+
+constexpr size_t BLOCK_SIZE = 8;
+constexpr size_t KEY_SIZE = 16;
+
+using Block = std::array<uint8_t, BLOCK_SIZE>;
+
+/**
+ * @brief 3DES-CBC encryption, ISO 9797-1 method 2 padding added
+ */
+bool encrypt(ByteView key, ByteView iv, ByteView data, Bytes& out);
+
+/**
+ * @brief 3DES-CBC decryption, padding removed
+ */
+bool decrypt(ByteView key, ByteView iv, ByteView data, Bytes& out);
+
+/**
+ * @brief Last block of 3DES-CBC over the padded data
+ */
+bool mac3Des(ByteView key, ByteView data, ByteView iv, Block& out);
+
+/**
+ * @brief Retail MAC (ISO 9797-1 algorithm 3): single DES-CBC, 3DES on the last block
+ */
+bool retailMac(ByteView key, ByteView data, ByteView iv, Block& out);
+
+/**
+ * @brief Session key: 3DES-CBC(key, zero IV, purpose || sequence || 0x00 * 12)
+ */
+bool deriveKey(ByteView key, ByteView sequence, ByteView purpose, Bytes& out);
+
+/**
+ * @brief Card cryptogram check: mac3Des(encKey, hostChallenge || cardChallenge)
+ */
+bool verifyCryptogram(ByteView encKey, ByteView hostChallenge, ByteView cardChallenge, ByteView cardCryptogram);
+
+/**
+ * @brief Single DES (first half of the MAC key) over the ICV, for MAC chaining
+ */
+bool encryptIcv(ByteView macKey, ByteView icv, Block& out);
+
+} // namespace Scp02
+} // namespace Core
+} // namespace Keycard
@@ -0,0 +1,112 @@
+#pragma once
+
+#include "apdu.h"
+#include <memory>
+
+namespace Keycard {
+namespace Core {
+
+/**
+ * @brief Keycard secure channel session: AES-256-CBC encryption and MAC
+ *
+ * The transport-free half of SecureChannel. wrap() turns a plain command into
+ * the secure APDU to transmit and advances the IV; unwrap() verifies and
+ * decrypts the card's answer. How the bytes reach the card, ECDH and locking
+ * are left to the caller.
+ *
+ * Cipher contexts are created once per session and re-keyed per operation,
+ * instead of being allocated for every encryption and MAC.
+ *
+ * Requires OpenSSL; without it isAvailable() is false and the crypto
+ * operations fail.
+ */
+class SecureSession {
+public:
+    static constexpr size_t BLOCK_SIZE = 16;
+    static constexpr size_t KEY_SIZE = 32;
+
+    using Block = std::array<uint8_t, BLOCK_SIZE>;
+    using Key = std::array<uint8_t, KEY_SIZE>;
+
+    enum class UnwrapStatus {
+        Ok,             // Decrypted response with its inner status word
+        Plain,          // Not protected (error SW or no data): passed through
+        TooShort,       // Data shorter than the MAC
+        MacMismatch,    // Desynchronized or tampered
+        CryptoError     // Authenticated but not decryptable; the IV still advanced
+    };
+
+    SecureSession();
+    ~SecureSession();
+    SecureSession(const SecureSession&) = delete;
+    SecureSession& operator=(const SecureSession&) = delete;
+
+    static bool isAvailable();
+
+    /**
+     * @brief Start a session
+     *
+     * Keys shorter than 32 bytes are zero-extended; longer inputs are cut.
+     */
+    void open(ByteView iv, ByteView encKey, ByteView macKey);
+    void reset();
+    bool isOpen() const { return m_open; }
+
+    const Block& iv() const { return m_iv; }
+    void setIv(const Block& iv) { m_iv = iv; }
+
+    /**
+     * @brief Build the secure APDU for a command and advance the IV
+     *
+     * Data is encrypted and prefixed with the new IV, which is the MAC over
+     * the header and the ciphertext. If transmitting @p out fails, restore the
+     * IV returned by iv() before the call, or the card and host desync.
+     *
+     * @param command Plain command (its data is encrypted)
+     * @param out Output: serialized secure APDU (cleared first)
+     */
+    bool wrap(const Apdu::CommandFields& command, Bytes& out);
+
+    /**
+     * @brief Verify and decrypt a raw response, advancing the IV
+     * @param raw Response bytes including SW
+     * @param out Output: decrypted response, ending with the card's SW (Ok only)
+     */
+    UnwrapStatus unwrap(ByteView raw, Bytes& out);
+
+    /**
+     * @brief AES-256-CBC with the session key and IV, ISO padding added
+     */
+    bool encrypt(ByteView plaintext, Bytes& out);
+
+    /**
+     * @brief AES-256-CBC decryption with the session key and IV, padding removed
+     */
+    bool decrypt(ByteView ciphertext, Bytes& out);
+
+    /**
+     * @brief Keycard MAC: CBC over the encrypted 16-byte meta block, then the padded data
+     */
+    bool mac(ByteView meta, ByteView data, Block& out);
+
+    /**
+     * @brief One-shot encryption used by INIT: [len | publicKey | iv | AES-CBC(secret, data)]
+     * @param secret ECDH shared secret (32 bytes)
+     * @param publicKey Host ephemeral public key
+     * @param iv Random IV
+     */
+    static bool oneShotEncrypt(ByteView secret, ByteView publicKey, const Block& iv, ByteView data, Bytes& out);
+
+private:
+    struct Ciphers;
+
+    std::unique_ptr<Ciphers> m_ciphers;
+    Key m_encKey{};
+    Key m_macKey{};
+    Block m_iv{};
+    bool m_open = false;
+    Bytes m_scratch;
+};
+
+} // namespace Core
+} // namespace Keycard
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "bytes.h"
+
+namespace Keycard {
+namespace Core {
+namespace Tlv {
+
+/**
+ * @brief Parse a BER-TLV length field
+ * @param data Buffer containing the TLV
+ * @param offset Position of the length field; advanced past it
+ * @param length Output: parsed length
+ * @return false for a truncated or over-long (more than 4 bytes) length field
+ */
+bool parseLength(ByteView data, size_t& offset, uint32_t& length);
+
+/**
+ * @brief Value of the first top-level @p tag in @p data
+ * @return View into @p data, or empty view if the tag is absent or the TLV is
+ *         truncated before it
+ */
+ByteView findTag(ByteView data, uint8_t tag);
+
+/**
+ * @brief Encode a BER-TLV length
+ * @param out At least 5 bytes
+ * @return Bytes written
+ */
+size_t encodeLength(uint32_t length, uint8_t* out);
+
+/**
+ * @brief Append tag, length and value to @p out
+ */
+void append(Bytes& out, uint8_t tag, ByteView value);
+
+} // namespace Tlv
+} // namespace Core
+} // namespace Keycard
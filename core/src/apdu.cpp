@@ -0,0 +1,90 @@
+#include "keycard-core/apdu.h"
+
+namespace Keycard {
+namespace Core {
+namespace Apdu {
+
+size_t serializedSize(const CommandFields& command) {
+    size_t size = 4;
+    if (command.hasData || command.hasLe) {
+        size += command.data.size() <= 255 ? 1 : 3;
+        size += command.data.size();
+        size += command.hasLe ? 1 : 0;
+    }
+    return size;
+}
+
+size_t serialize(const CommandFields& command, MutableByteView out) {
+    const size_t size = serializedSize(command);
+    if (out.size() < size) {
+        return 0;
+    }
+
+    uint8_t* p = out.data();
+    *p++ = command.cla;
+    *p++ = command.ins;
+    *p++ = command.p1;
+    *p++ = command.p2;
+
+    // Lc is written whenever data was set, even if empty (case 3/4),
+    // otherwise the command is header only (case 1)
+    if (command.hasData || command.hasLe) {
+        const size_t lc = command.data.size();
+        if (lc <= 255) {
+            *p++ = static_cast<uint8_t>(lc);
+        } else {
+            *p++ = 0x00;
+            *p++ = static_cast<uint8_t>((lc >> 8) & 0xFF);
+            *p++ = static_cast<uint8_t>(lc & 0xFF);
+        }
+        if (lc > 0) {
+            std::memcpy(p, command.data.data(), lc);
+            p += lc;
+        }
+        if (command.hasLe) {
+            *p++ = command.le;
+        }
+    }
+    return size;
+}
+
+void serialize(const CommandFields& command, Bytes& out) {
+    const size_t offset = out.size();
+    out.resize(offset + serializedSize(command));
+    serialize(command, MutableByteView(out.data() + offset, out.size() - offset));
+}
+
+ResponseView parseResponse(ByteView raw) {
+    ResponseView response;
+    if (raw.size() < 2) {
+        response.sw = ResponseView::SW_UNKNOWN;
+        return response;
+    }
+    const size_t dataLen = raw.size() - 2;
+    response.data = raw.first(dataLen);
+    response.sw = static_cast<uint16_t>((raw[dataLen] << 8) | raw[dataLen + 1]);
+    return response;
+}
+
+const char* statusMessage(uint16_t sw) {
+    switch (sw) {
+    case 0x9000: return "Success";
+    case 0x6982: return "Security condition not satisfied";
+    case 0x6983: return "Authentication method blocked";
+    case 0x6984: return "Data invalid";
+    case 0x6985: return "Conditions not satisfied";
+    case 0x6A80: return "Wrong data";
+    case 0x6A82: return "File not found";
+    case 0x6A84: return "No available pairing slots";
+    case 0x6A86: return "Incorrect P1/P2";
+    case 0x6A88: return "Referenced data not found";
+    case 0x6700: return "Wrong length";
+    case 0x6D00: return "Instruction not supported";
+    case 0x6E00: return "Class not supported";
+    default: return nullptr;
+    }
+}
+
+} // namespace Apdu
+} // namespace Core
+} // namespace Keycard
@@ -0,0 +1,48 @@
+#include "keycard-core/bytes.h"
+
+namespace Keycard {
+namespace Core {
+
+std::string toHex(ByteView bytes) {
+    static const char digits[] = "0123456789abcdef";
+    std::string hex;
+    hex.reserve(bytes.size() * 2);
+    for (uint8_t byte : bytes) {
+        hex.push_back(digits[byte >> 4]);
+        hex.push_back(digits[byte & 0x0F]);
+    }
+    return hex;
+}
+
+void appendPadding(Bytes& out, ByteView data, size_t blockSize) {
+    const size_t padded = (data.size() / blockSize + 1) * blockSize;
+    out.reserve(out.size() + padded);
+    append(out, data);
+    out.push_back(0x80);
+    out.resize(out.size() + (padded - data.size() - 1), 0x00);
+}
+
+size_t unpaddedSize(ByteView data) {
+    size_t i = data.size();
+    while (i > 0 && data[i - 1] == 0x00) {
+        --i;
+    }
+    if (i > 0 && data[i - 1] == 0x80) {
+        return i - 1;
+    }
+    return data.size();
+}
+
+bool constantTimeEqual(ByteView a, ByteView b) {
+    if (a.size() != b.size()) {
+        return false;
+    }
+    uint8_t diff = 0;
+    for (size_t i = 0; i < a.size(); ++i) {
+        diff |= a[i] ^ b[i];
+    }
+    return diff == 0;
+}
+
+} // namespace Core
+} // namespace Keycard
@@ -0,0 +1,101 @@
+#include "keycard-core/derivation_path.h"
+#include <cctype>
+
+namespace Keycard {
+namespace Core {
+
+namespace {
+
+bool parseUInt32(const std::string& text, size_t begin, size_t end, uint32_t& value) {
+    // Same leniency as QString::toUInt(): surrounding whitespace and a leading '+'
+    while (begin < end && std::isspace(static_cast<unsigned char>(text[begin]))) {
+        ++begin;
+    }
+    while (end > begin && std::isspace(static_cast<unsigned char>(text[end - 1]))) {
+        --end;
+    }
+    if (begin < end && text[begin] == '+') {
+        ++begin;
+    }
+    if (begin == end) {
+        return false;
+    }
+
+    uint64_t result = 0;
+    for (size_t i = begin; i < end; ++i) {
+        if (!std::isdigit(static_cast<unsigned char>(text[i]))) {
+            return false;
+        }
+        result = result * 10 + static_cast<uint64_t>(text[i] - '0');
+        if (result > 0xFFFFFFFFull) {
+            return false;
+        }
+    }
+    value = static_cast<uint32_t>(result);
+    return true;
+}
+
+} // namespace
+
+DerivationPath DerivationPath::parse(const std::string& path) {
+    DerivationPath result;
+
+    size_t begin = 0;
+    size_t end = path.size();
+    while (begin < end && std::isspace(static_cast<unsigned char>(path[begin]))) {
+        ++begin;
+    }
+    while (end > begin && std::isspace(static_cast<unsigned char>(path[end - 1]))) {
+        --end;
+    }
+
+    if (path.compare(begin, 2, "m/") == 0) {
+        result.start = Start::Master;
+        begin += 2;
+    } else if (path.compare(begin, 3, "../") == 0) {
+        result.start = Start::Parent;
+        begin += 3;
+    } else if (path.compare(begin, 2, "./") == 0) {
+        result.start = Start::Current;
+        begin += 2;
+    }
+
+    if (begin >= end) {
+        return result;
+    }
+
+    size_t segmentBegin = begin;
+    while (segmentBegin <= end) {
+        size_t segmentEnd = path.find('/', segmentBegin);
+        if (segmentEnd == std::string::npos || segmentEnd > end) {
+            segmentEnd = end;
+        }
+
+        size_t valueEnd = segmentEnd;
+        const bool hardened = valueEnd > segmentBegin
+            && (path[valueEnd - 1] == '\'' || path[valueEnd - 1] == 'h');
+        if (hardened) {
+            --valueEnd;
+        }
+
+        uint32_t value = 0;
+        if (parseUInt32(path, segmentBegin, valueEnd, value)) {
+            result.components.push_back(hardened ? value | HARDENED : value);
+        }
+        segmentBegin = segmentEnd + 1;
+    }
+    return result;
+}
+
+void DerivationPath::encode(Bytes& out) const {
+    out.reserve(out.size() + components.size() * 4);
+    for (uint32_t component : components) {
+        out.push_back(static_cast<uint8_t>(component >> 24));
+        out.push_back(static_cast<uint8_t>(component >> 16));
+        out.push_back(static_cast<uint8_t>(component >> 8));
+        out.push_back(static_cast<uint8_t>(component));
+    }
+}
+
+} // namespace Core
+} // namespace Keycard
@@ -0,0 +1,213 @@
+#include "keycard-core/scp02_crypto.h"
+#include <algorithm>
+#include <mutex>
+
+#ifdef KEYCARD_CORE_HAS_OPENSSL
+#include <openssl/evp.h>
+#include <openssl/opensslv.h>
+#if OPENSSL_VERSION_MAJOR >= 3
+#include <openssl/provider.h>
+#endif
+#endif
+
+namespace Keycard {
+namespace Core {
+namespace Scp02 {
+
+#ifdef KEYCARD_CORE_HAS_OPENSSL
+namespace {
+
+// Single DES lives in the legacy provider on OpenSSL 3; loading it disables
+// the implicit default provider, so both are loaded, once, and kept
+void ensureProviders() {
+#if OPENSSL_VERSION_MAJOR >= 3
+    static std::once_flag once;
+    std::call_once(once, []() {
+        OSSL_PROVIDER_load(nullptr, "legacy");
+        OSSL_PROVIDER_load(nullptr, "default");
+    });
+#endif
+}
+
+bool cbcEncrypt(const EVP_CIPHER* cipher, const uint8_t* key, const uint8_t* iv, ByteView in, uint8_t* out) {
+    if (!cipher || in.size() % BLOCK_SIZE != 0) {
+        return false;
+    }
+    EVP_CIPHER_CTX* ctx = EVP_CIPHER_CTX_new();
+    if (!ctx) {
+        return false;
+    }
+    int len = 0;
+    int finalLen = 0;
+    bool ok = EVP_EncryptInit_ex(ctx, cipher, nullptr, key, iv) == 1;
+    if (ok) {
+        EVP_CIPHER_CTX_set_padding(ctx, 0);
+        ok = (in.empty() || EVP_EncryptUpdate(ctx, out, &len, in.data(), static_cast<int>(in.size())) == 1)
+             && EVP_EncryptFinal_ex(ctx, out + len, &finalLen) == 1;
+    }
+    EVP_CIPHER_CTX_free(ctx);
+    return ok;
+}
+
+// 3DES two-key form: K1 || K2 || K1
+std::array<uint8_t, 24> expandKey(ByteView key) {
+    std::array<uint8_t, 24> key24{};
+    std::copy_n(key.begin(), 16, key24.begin());
+    std::copy_n(key.begin(), 8, key24.begin() + 16);
+    return key24;
+}
+
+bool validKeyAndIv(ByteView key, ByteView iv) {
+    return key.size() == KEY_SIZE && iv.size() == BLOCK_SIZE;
+}
+
+} // namespace
+#endif
+
+bool encrypt(ByteView key, ByteView iv, ByteView data, Bytes& out) {
+    out.clear();
+#ifndef KEYCARD_CORE_HAS_OPENSSL
+    (void)key; (void)iv; (void)data;
+    return false;
+#else
+    if (!validKeyAndIv(key, iv)) {
+        return false;
+    }
+    Bytes padded;
+    appendPadding(padded, data, BLOCK_SIZE);
+    out.resize(padded.size());
+    const auto key24 = expandKey(key);
+    if (!cbcEncrypt(EVP_des_ede3_cbc(), key24.data(), iv.data(), padded, out.data())) {
+        out.clear();
+        return false;
+    }
+    return true;
+#endif
+}
+
+bool decrypt(ByteView key, ByteView iv, ByteView data, Bytes& out) {
+    out.clear();
+#ifndef KEYCARD_CORE_HAS_OPENSSL
+    (void)key; (void)iv; (void)data;
+    return false;
+#else
+    if (!validKeyAndIv(key, iv) || data.size() % BLOCK_SIZE != 0) {
+        return false;
+    }
+    if (data.empty()) {
+        return true;
+    }
+
+    const auto key24 = expandKey(key);
+    EVP_CIPHER_CTX* ctx = EVP_CIPHER_CTX_new();
+    if (!ctx) {
+        return false;
+    }
+    out.resize(data.size());
+    int len = 0;
+    int finalLen = 0;
+    bool ok = EVP_DecryptInit_ex(ctx, EVP_des_ede3_cbc(), nullptr, key24.data(), iv.data()) == 1;
+    if (ok) {
+        EVP_CIPHER_CTX_set_padding(ctx, 0);
+        ok = EVP_DecryptUpdate(ctx, out.data(), &len, data.data(), static_cast<int>(data.size())) == 1
+             && EVP_DecryptFinal_ex(ctx, out.data() + len, &finalLen) == 1;
+    }
+    EVP_CIPHER_CTX_free(ctx);
+    if (!ok) {
+        out.clear();
+        return false;
+    }
+    out.resize(unpaddedSize(out));
+    return true;
+#endif
+}
+
+bool mac3Des(ByteView key, ByteView data, ByteView iv, Block& out) {
+    out.fill(0);
+    Bytes encrypted;
+    if (!encrypt(key, iv, data, encrypted)) {
+        return false;
+    }
+    std::copy_n(encrypted.end() - BLOCK_SIZE, BLOCK_SIZE, out.begin());
+    return true;
+}
+
+bool retailMac(ByteView key, ByteView data, ByteView iv, Block& out) {
+    out.fill(0);
+#ifndef KEYCARD_CORE_HAS_OPENSSL
+    (void)key; (void)data; (void)iv;
+    return false;
+#else
+    if (!validKeyAndIv(key, iv)) {
+        return false;
+    }
+    ensureProviders();
+
+    Bytes padded;
+    appendPadding(padded, data, BLOCK_SIZE);
+
+    // Single DES-CBC over all blocks but the last; its last block chains into 3DES
+    Block chain;
+    std::copy_n(iv.begin(), BLOCK_SIZE, chain.begin());
+    if (padded.size() > BLOCK_SIZE) {
+        const ByteView intermediate = ByteView(padded).first(padded.size() - BLOCK_SIZE);
+        Bytes encrypted(intermediate.size());
+        if (!cbcEncrypt(EVP_des_cbc(), key.data(), chain.data(), intermediate, encrypted.data())) {
+            return false;
+        }
+        std::copy_n(encrypted.end() - BLOCK_SIZE, BLOCK_SIZE, chain.begin());
+    }
+
+    const auto key24 = expandKey(key);
+    return cbcEncrypt(EVP_des_ede3_cbc(), key24.data(), chain.data(),
+                      ByteView(padded).last(BLOCK_SIZE), out.data());
+#endif
+}
+
+bool deriveKey(ByteView key, ByteView sequence, ByteView purpose, Bytes& out) {
+    out.clear();
+    if (key.size() != KEY_SIZE || sequence.size() != 2 || purpose.size() != 2) {
+        return false;
+    }
+    std::array<uint8_t, 16> derivationData{};
+    derivationData[0] = purpose[0];
+    derivationData[1] = purpose[1];
+    derivationData[2] = sequence[0];
+    derivationData[3] = sequence[1];
+
+    const Block zeroIv{};
+    if (!encrypt(key, zeroIv, derivationData, out)) {
+        return false;
+    }
+    out.resize(KEY_SIZE);
+    return true;
+}
+
+bool verifyCryptogram(ByteView encKey, ByteView hostChallenge, ByteView cardChallenge, ByteView cardCryptogram) {
+    Bytes challenges;
+    append(challenges, hostChallenge);
+    append(challenges, cardChallenge);
+
+    const Block zeroIv{};
+    Block calculated;
+    return mac3Des(encKey, challenges, zeroIv, calculated) && constantTimeEqual(calculated, cardCryptogram);
+}
+
+bool encryptIcv(ByteView macKey, ByteView icv, Block& out) {
+    out.fill(0);
+#ifndef KEYCARD_CORE_HAS_OPENSSL
+    (void)macKey; (void)icv;
+    return false;
+#else
+    if (macKey.size() < BLOCK_SIZE || icv.size() != BLOCK_SIZE) {
+        return false;
+    }
+    ensureProviders();
+    const Block zeroIv{};
+    return cbcEncrypt(EVP_des_cbc(), macKey.data(), zeroIv.data(), icv, out.data());
+#endif
+}
+
+} // namespace Scp02
+} // namespace Core
+} // namespace Keycard
@@ -0,0 +1,258 @@
+#include "keycard-core/secure_session.h"
+#include <algorithm>
+
+#ifdef KEYCARD_CORE_HAS_OPENSSL
+#include <openssl/evp.h>
+#endif
+
+namespace Keycard {
+namespace Core {
+
+namespace {
+
+template <size_t N>
+void copyZeroExtended(std::array<uint8_t, N>& out, ByteView in) {
+    out.fill(0);
+    std::copy_n(in.begin(), std::min(in.size(), N), out.begin());
+}
+
+} // namespace
+
+#ifdef KEYCARD_CORE_HAS_OPENSSL
+struct SecureSession::Ciphers {
+    EVP_CIPHER_CTX* encrypt = EVP_CIPHER_CTX_new();
+    EVP_CIPHER_CTX* decrypt = EVP_CIPHER_CTX_new();
+
+    ~Ciphers() {
+        EVP_CIPHER_CTX_free(encrypt);
+        EVP_CIPHER_CTX_free(decrypt);
+    }
+};
+
+namespace {
+
+// AES-256-CBC without padding over whole blocks; the context is re-keyed, not reallocated
+bool aesCbc(EVP_CIPHER_CTX* ctx, bool encrypt, const uint8_t* key, const uint8_t* iv,
+            ByteView in, uint8_t* out) {
+    if (!ctx || in.size() % SecureSession::BLOCK_SIZE != 0) {
+        return false;
+    }
+    if (EVP_CipherInit_ex(ctx, EVP_aes_256_cbc(), nullptr, key, iv, encrypt ? 1 : 0) != 1) {
+        return false;
+    }
+    EVP_CIPHER_CTX_set_padding(ctx, 0);
+    int len = 0;
+    if (!in.empty() && EVP_CipherUpdate(ctx, out, &len, in.data(), static_cast<int>(in.size())) != 1) {
+        return false;
+    }
+    int finalLen = 0;
+    return EVP_CipherFinal_ex(ctx, out + len, &finalLen) == 1;
+}
+
+} // namespace
+#else
+struct SecureSession::Ciphers {};
+#endif
+
+SecureSession::SecureSession()
+    : m_ciphers(new Ciphers)
+{
+}
+
+SecureSession::~SecureSession() {
+    reset();
+}
+
+bool SecureSession::isAvailable() {
+#ifdef KEYCARD_CORE_HAS_OPENSSL
+    return true;
+#else
+    return false;
+#endif
+}
+
+void SecureSession::open(ByteView iv, ByteView encKey, ByteView macKey) {
+    copyZeroExtended(m_iv, iv);
+    copyZeroExtended(m_encKey, encKey);
+    copyZeroExtended(m_macKey, macKey);
+    m_open = true;
+}
+
+void SecureSession::reset() {
+    m_iv.fill(0);
+    m_encKey.fill(0);
+    m_macKey.fill(0);
+    std::fill(m_scratch.begin(), m_scratch.end(), 0);
+    m_open = false;
+}
+
+bool SecureSession::encrypt(ByteView plaintext, Bytes& out) {
+#ifndef KEYCARD_CORE_HAS_OPENSSL
+    (void)plaintext;
+    out.clear();
+    return false;
+#else
+    m_scratch.clear();
+    appendPadding(m_scratch, plaintext, BLOCK_SIZE);
+    out.resize(m_scratch.size());
+    if (!aesCbc(m_ciphers->encrypt, true, m_encKey.data(), m_iv.data(), m_scratch, out.data())) {
+        out.clear();
+        return false;
+    }
+    return true;
+#endif
+}
+
+bool SecureSession::decrypt(ByteView ciphertext, Bytes& out) {
+    out.clear();
+    if (ciphertext.empty()) {
+        return true;
+    }
+#ifndef KEYCARD_CORE_HAS_OPENSSL
+    return false;
+#else
+    out.resize(ciphertext.size());
+    if (!aesCbc(m_ciphers->decrypt, false, m_encKey.data(), m_iv.data(), ciphertext, out.data())) {
+        out.clear();
+        return false;
+    }
+    out.resize(unpaddedSize(out));
+    return true;
+#endif
+}
+
+bool SecureSession::mac(ByteView meta, ByteView data, Block& out) {
+#ifndef KEYCARD_CORE_HAS_OPENSSL
+    (void)meta;
+    (void)data;
+    out.fill(0);
+    return false;
+#else
+    // CBC-MAC over meta || pad(data) with a zero IV; the MAC is the
+    // second-to-last block, which must come from the data (as on the card)
+    m_scratch.clear();
+    append(m_scratch, meta);
+    appendPadding(m_scratch, data, BLOCK_SIZE);
+    if (m_scratch.size() < meta.size() + 2 * BLOCK_SIZE) {
+        out.fill(0);
+        return false;
+    }
+
+    const Block zeroIv{};
+    Bytes encrypted(m_scratch.size());
+    if (!aesCbc(m_ciphers->encrypt, true, m_macKey.data(), zeroIv.data(), m_scratch, encrypted.data())) {
+        out.fill(0);
+        return false;
+    }
+    std::copy_n(encrypted.end() - 2 * BLOCK_SIZE, BLOCK_SIZE, out.begin());
+    return true;
+#endif
+}
+
+bool SecureSession::wrap(const Apdu::CommandFields& command, Bytes& out) {
+    out.clear();
+    if (!m_open) {
+        return false;
+    }
+
+    Bytes encrypted;
+    if (!encrypt(command.data, encrypted)) {
+        return false;
+    }
+
+    // MAC metadata: [CLA, INS, P1, P2, Lc (IV + ciphertext), 0x00 * 11]
+    Block meta{};
+    meta[0] = command.cla;
+    meta[1] = command.ins;
+    meta[2] = command.p1;
+    meta[3] = command.p2;
+    meta[4] = static_cast<uint8_t>(encrypted.size() + BLOCK_SIZE);
+
+    Block newIv;
+    if (!mac(meta, encrypted, newIv)) {
+        return false;
+    }
+    m_iv = newIv;
+
+    // Data: [IV][encrypted data]
+    Bytes data;
+    data.reserve(BLOCK_SIZE + encrypted.size());
+    append(data, m_iv);
+    append(data, encrypted);
+
+    Apdu::CommandFields secure = command;
+    secure.data = data;
+    secure.hasData = true;
+    Apdu::serialize(secure, out);
+    return true;
+}
+
+SecureSession::UnwrapStatus SecureSession::unwrap(ByteView raw, Bytes& out) {
+    out.clear();
+    const Apdu::ResponseView response = Apdu::parseResponse(raw);
+    if (!response.isOK() || response.data.empty()) {
+        return UnwrapStatus::Plain;
+    }
+
+    // Response data: [MAC][encrypted data]
+    if (response.data.size() < BLOCK_SIZE) {
+        return UnwrapStatus::TooShort;
+    }
+    const ByteView responseMac = response.data.first(BLOCK_SIZE);
+    const ByteView encrypted = response.data.sub(BLOCK_SIZE);
+
+    // Metadata: [total response data size including the MAC, 0x00 * 15]
+    Block meta{};
+    meta[0] = static_cast<uint8_t>(response.data.size());
+
+    // A MAC that cannot be computed (no ciphertext) cannot match either
+    Block calculated;
+    if (!mac(meta, encrypted, calculated) || !constantTimeEqual(calculated, responseMac)) {
+        return UnwrapStatus::MacMismatch;
+    }
+
+    // Decrypt with the current IV, then advance it as the card did
+    const bool decrypted = decrypt(encrypted, out);
+    m_iv = calculated;
+    return decrypted ? UnwrapStatus::Ok : UnwrapStatus::CryptoError;
+}
+
+bool SecureSession::oneShotEncrypt(ByteView secret, ByteView publicKey, const Block& iv, ByteView data, Bytes& out) {
+    out.clear();
+#ifndef KEYCARD_CORE_HAS_OPENSSL
+    (void)secret;
+    (void)publicKey;
+    (void)iv;
+    (void)data;
+    return false;
+#else
+    if (secret.empty() || publicKey.size() > 255) {
+        return false;
+    }
+
+    Key key;
+    copyZeroExtended(key, secret);
+    Bytes padded;
+    appendPadding(padded, data, BLOCK_SIZE);
+
+    // [pubkey_len][pubkey][IV][ciphertext]
+    out.reserve(1 + publicKey.size() + BLOCK_SIZE + padded.size());
+    out.push_back(static_cast<uint8_t>(publicKey.size()));
+    append(out, publicKey);
+    append(out, iv);
+    const size_t offset = out.size();
+    out.resize(offset + padded.size());
+
+    EVP_CIPHER_CTX* ctx = EVP_CIPHER_CTX_new();
+    const bool ok = aesCbc(ctx, true, key.data(), iv.data(), padded, out.data() + offset);
+    EVP_CIPHER_CTX_free(ctx);
+    key.fill(0);
+    if (!ok) {
+        out.clear();
+    }
+    return ok;
+#endif
+}
+
+} // namespace Core
+} // namespace Keycard
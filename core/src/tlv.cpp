@@ -0,0 +1,74 @@
+#include "keycard-core/tlv.h"
+
+namespace Keycard {
+namespace Core {
+namespace Tlv {
+
+bool parseLength(ByteView data, size_t& offset, uint32_t& length) {
+    length = 0;
+    if (offset >= data.size()) {
+        return false;
+    }
+
+    const uint8_t first = data[offset++];
+    if ((first & 0x80) == 0) {
+        // Short form: length is in the lower 7 bits
+        length = first;
+        return true;
+    }
+
+    // Long form: lower 7 bits give the number of length bytes
+    const size_t count = first & 0x7F;
+    if (count > 4 || offset + count > data.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < count; ++i) {
+        length = (length << 8) | data[offset++];
+    }
+    return true;
+}
+
+ByteView findTag(ByteView data, uint8_t tag) {
+    size_t offset = 0;
+    while (offset < data.size()) {
+        const uint8_t current = data[offset++];
+        uint32_t length = 0;
+        if (!parseLength(data, offset, length) || length > data.size() - offset) {
+            break;
+        }
+        if (current == tag) {
+            return data.sub(offset, length);
+        }
+        offset += length;
+    }
+    return ByteView();
+}
+
+size_t encodeLength(uint32_t length, uint8_t* out) {
+    if (length < 128) {
+        out[0] = static_cast<uint8_t>(length);
+        return 1;
+    }
+    size_t count = 0;
+    for (uint32_t temp = length; temp > 0; temp >>= 8) {
+        ++count;
+    }
+    out[0] = static_cast<uint8_t>(0x80 | count);
+    for (size_t i = 0; i < count; ++i) {
+        out[1 + i] = static_cast<uint8_t>(length >> ((count - 1 - i) * 8));
+    }
+    return 1 + count;
+}
+
+void append(Bytes& out, uint8_t tag, ByteView value) {
+    uint8_t length[5];
+    const size_t lengthSize = encodeLength(static_cast<uint32_t>(value.size()), length);
+    out.reserve(out.size() + 1 + lengthSize + value.size());
+    out.push_back(tag);
+    out.insert(out.end(), length, length + lengthSize);
+    Core::append(out, value);
+}
+
+} // namespace Tlv
+} // namespace Core
+} // namespace Keycard
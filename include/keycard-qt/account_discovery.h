@@ -0,0 +1,177 @@
+#pragma once
+
+#include "bip32.h"
+#include <QMetaType>
+#include <QObject>
+#include <QStringList>
+#include <QUuid>
+#include <QVector>
+#include <atomic>
+#include <future>
+#include <memory>
+#include <vector>
+
+namespace Keycard {
+
+class CommunicationManager;
+
+/**
+ * @brief Tells whether addresses have on-chain activity
+ *
+ * Typically backed by an indexer or a node. isUsed() is called from
+ * discovery worker threads, several calls at a time, and must be thread-safe.
+ */
+class AddressUsageOracle {
+public:
+    virtual ~AddressUsageOracle() = default;
+
+    /**
+     * @brief Look up a batch of addresses
+     * @param addresses Ethereum addresses ("0x" + lowercase hex)
+     * @return One flag per address, or empty vector on failure
+     */
+    virtual QVector<bool> isUsed(const QStringList& addresses) = 0;
+};
+
+/**
+ * @brief Address with activity found by AccountDiscovery
+ */
+struct DiscoveredAddress {
+    int account = 0;
+    int change = 0;         // 0 = receive chain, 1 = change chain
+    int index = 0;
+    QString path;           // e.g. "m/44'/60'/0'/0/5"
+    QString address;
+    QByteArray publicKey;   // 65 bytes, uncompressed
+};
+
+/**
+ * @brief Outcome of an account discovery run
+ */
+struct DiscoveryResult {
+    bool success = false;
+    QString error;
+    QVector<DiscoveredAddress> used;    // Ordered by account, chain and index
+    int accountsScanned = 0;
+    int addressesChecked = 0;
+    bool moreAccounts = false;          // Last scanned account is used: scan with more accounts
+
+    /**
+     * @brief Accounts up to and including the last one with activity
+     */
+    int usedAccounts() const;
+};
+
+/**
+ * @brief Gap-limit wallet discovery with a single card session
+ *
+ * Only the account keys (m/44'/60'/n', all hardened steps) need the card:
+ * start() exports them with one ExportExtendedPublicKeysCommand. The
+ * receive and change chains below are then derived on the host, one worker
+ * thread per chain. Each worker queries the oracle in batches and derives
+ * the next batch while the previous one is being looked up. A chain ends
+ * once gapLimit consecutive addresses after its last used one are unused.
+ *
+ * Used addresses are reported through addressFound() as soon as the oracle
+ * confirms them; finished() follows when every chain is done. All signals
+ * are emitted on the thread AccountDiscovery lives in.
+ *
+ * All exported accounts are scanned in parallel. If the last one has
+ * activity, DiscoveryResult::moreAccounts is set and a new run with more
+ * accounts continues the BIP44 account scan.
+ *
+ * Host-side derivation needs OpenSSL (see BIP32::isAvailable()).
+ */
+class AccountDiscovery : public QObject {
+    Q_OBJECT
+
+public:
+    struct Options {
+        QString basePath = "m/44'/60'";  // Accounts are basePath/n'
+        int accounts = 1;               // Account keys exported from the card
+        int gapLimit = 20;              // Unused addresses that end a chain
+        int batchSize = 0;              // Addresses per oracle call (0 = gapLimit)
+        bool scanChange = true;         // Also scan chain 1
+    };
+
+    explicit AccountDiscovery(std::shared_ptr<AddressUsageOracle> oracle, QObject* parent = nullptr);
+    AccountDiscovery(std::shared_ptr<AddressUsageOracle> oracle, const Options& options, QObject* parent = nullptr);
+    ~AccountDiscovery() override;
+
+    /**
+     * @brief Account key paths exported by start()
+     */
+    QStringList accountPaths() const;
+
+    /**
+     * @brief Export the account keys from the card, then discover
+     * @return Token of the export command, or null QUuid if already running
+     *
+     * The export is queued like any other command and runs when a card is
+     * ready. Failures are reported through finished().
+     */
+    QUuid start(CommunicationManager* manager);
+
+    /**
+     * @brief Discover from already exported account keys (no card needed)
+     * @param accountKeys Keys for accounts 0..n-1, in order
+     * @return false if a discovery is running or a key is invalid
+     */
+    bool discover(const QVector<BIP32::ExtendedPublicKey>& accountKeys);
+
+    /**
+     * @brief Stop the running discovery; finished() reports an error
+     *
+     * Workers exit after their current batch.
+     */
+    void cancel();
+
+    bool isRunning() const { return m_running; }
+
+    /**
+     * @brief Block until workers have exited (for shutdown and tests)
+     */
+    void waitForWorkers();
+
+signals:
+    /**
+     * @brief A used address was found (incremental result)
+     */
+    void addressFound(const Keycard::DiscoveredAddress& address);
+
+    /**
+     * @brief A chain reached its gap limit
+     * @param checked Addresses looked up on the chain
+     */
+    void chainFinished(int account, int change, int checked);
+
+    /**
+     * @brief Discovery completed, failed or was cancelled
+     */
+    void finished(const Keycard::DiscoveryResult& result);
+
+private:
+    struct ChainTask;
+
+    void scanChain(const ChainTask& task);
+    void onChainFinished(quint64 generation, int account, int change, int checked, const QString& error);
+    void finish(const QString& error);
+
+    std::shared_ptr<AddressUsageOracle> m_oracle;
+    Options m_options;
+
+    bool m_running = false;
+    quint64 m_generation = 0;
+    std::shared_ptr<std::atomic<bool>> m_cancelled;
+    std::vector<std::future<void>> m_workers;
+    QMetaObject::Connection m_exportConnection;
+
+    int m_pendingChains = 0;
+    int m_accounts = 0;
+    DiscoveryResult m_result;
+};
+
+} // namespace Keycard
+
+Q_DECLARE_METATYPE(Keycard::DiscoveredAddress)
+Q_DECLARE_METATYPE(Keycard::DiscoveryResult)
@@ -124,6 +124,17 @@ public:
      */
     virtual QByteArray transmit(const QByteArray& apdu) = 0;
 
+    /**
+     * @brief Set how long the following transmit() calls may wait for a response
+     * @param timeoutMs Timeout in milliseconds
+     * @return true if the backend enforces it, false if it cannot
+     *
+     * Called by KeycardChannel before each exchange with the timeout from its
+     * TransportTimeoutPolicy. An enforced timeout makes transmit() throw
+     * std::runtime_error once it expires. The default ignores it.
+     */
+    virtual bool setTransmitTimeout(int timeoutMs) { Q_UNUSED(timeoutMs); return false; }
+
     /**
      * @brief Get backend name for logging/debugging
      * @return Human-readable backend name (e.g., "PC/SC", "Qt NFC")
@@ -171,7 +182,33 @@ public:
      */
     virtual void forceScan() = 0;
 
+    /**
+     * @brief Whether detection signals are emitted from a backend-owned thread
+     * @return true if targetDetected()/error() never need the owner's event loop
+     * 
+     * When true, a thread blocked in KeycardChannel::waitForTarget() is woken
+     * directly by the backend. Backends that emit from their own thread's
+     * event loop (e.g. Qt NFC) keep the default.
+     */
+    virtual bool detectsOffThread() const { return false; }
+
+    /**
+     * @brief Whether the backend has finished its startup work
+     * @return true once ready() has been emitted (or if it never needed to)
+     * 
+     * A backend that starts in the background (e.g. PC/SC context setup off
+     * the main thread) returns false until then. Thread-safe.
+     */
+    virtual bool isReady() const { return true; }
+
 signals:
+    /**
+     * @brief Emitted, possibly from a backend thread, when background startup completes
+     * 
+     * Only emitted by backends whose isReady() returned false.
+     */
+    void ready();
+
     /**
      * @brief Emitted when reader availability changes (PC/SC only)
      * @param available true if at least one reader is present, false if no readers
@@ -8,12 +8,14 @@
 #include <QString>
 #include <QStringList>
 #include <QAtomicInt>
-#include <QMutex>
+#include "keycard-qt/instrumented_mutex.h"
+#include <memory>
 
 namespace Keycard {
 
 // Forward declarations to hide PC/SC types from MOC
 struct PcscState;
+struct PcscStartup;
 
 /**
  * @brief PC/SC backend for desktop smart card readers
@@ -36,7 +38,13 @@ class KeycardChannelPcsc : public KeycardChannelBackend
     Q_OBJECT
 
 public:
-    explicit KeycardChannelPcsc(QObject* parent = nullptr);
+    /**
+     * @param parent QObject parent
+     * @param backgroundStartup Establish the PC/SC context and list readers on
+     *        the detection thread instead of in the constructor; ready() is
+     *        emitted once the context exists
+     */
+    explicit KeycardChannelPcsc(QObject* parent = nullptr, bool backgroundStartup = false);
     ~KeycardChannelPcsc() override;
 
     // KeycardChannelBackend interface
@@ -55,6 +63,11 @@ public:
      */
     void forceScan() override;
 
+    // Detection runs on m_detectionThread
+    bool detectsOffThread() const override { return true; }
+
+    bool isReady() const override { return m_ready.loadAcquire() != 0; }
+
 private:
     /**
      * @brief Establish PC/SC context for communication
@@ -90,6 +103,11 @@ private:
      */
     QByteArray getATR();
     
+    /**
+     * @brief Start the detection thread, which establishes the context itself
+     */
+    void startDetectionInBackground();
+
     /**
      * @brief Event-driven detection loop (runs in separate thread)
      * Matches status-keycard-go's waitForCard pattern
@@ -111,6 +129,8 @@ private:
     QThread* m_detectionThread;
     QAtomicInt m_stopDetection;
     QAtomicInt m_forceScan;  // Trigger for force scan (matches status-keycard-go)
+    QAtomicInt m_ready;      // 0 while a background startup is establishing the context
+    std::shared_ptr<PcscStartup> m_startup;  // Set by startDetectionInBackground()
     QString m_lastDetectedReader;
     QString m_lastDetectedUid;  // Track to prevent duplicate events
     QByteArray m_lastATR;
@@ -118,7 +138,7 @@ private:
     bool m_firstReaderCheck;     // Track if we've done initial reader check
     
     // Thread safety - protects transmit() to prevent APDU corruption
-    mutable QMutex m_transmitMutex;
+    mutable InstrumentedMutex m_transmitMutex{"KeycardChannelPcsc::m_transmitMutex"};
     
     // Channel state (state-driven architecture)
     ChannelState m_state = ChannelState::Idle;
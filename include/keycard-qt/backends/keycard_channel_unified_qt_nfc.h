@@ -7,7 +7,8 @@
 #include <QNearFieldManager>
 #include <QNearFieldTarget>
 #include <QMetaObject>
-#include <QMutex>
+#include "keycard-qt/instrumented_mutex.h"
+#include <atomic>
 
 namespace Keycard {
 
@@ -31,6 +32,7 @@ public:
     void disconnect() override;
     bool isConnected() const override;
     QByteArray transmit(const QByteArray& apdu) override;
+    bool setTransmitTimeout(int timeoutMs) override;
     QString backendName() const override { return "Qt NFC (Unified)"; }
     void setState(ChannelState state) override;
     ChannelState state() const override { return m_state; }
@@ -65,8 +67,11 @@ private:
     // Helper to update and emit channel state
     void emitChannelState(ChannelOperationalState newState);
     
+    // waitForRequestCompleted() timeout, set by KeycardChannel before each exchange
+    std::atomic_int m_transmitTimeoutMs{120000};
+    
     // Thread safety
-    mutable QMutex m_transmitMutex;
+    mutable InstrumentedMutex m_transmitMutex{"KeycardChannelUnifiedQtNfc::m_transmitMutex"};
 };
 
 } // namespace Keycard
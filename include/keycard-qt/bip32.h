@@ -0,0 +1,61 @@
+#pragma once
+
+#include <QByteArray>
+#include <QString>
+#include <cstdint>
+
+namespace Keycard {
+namespace BIP32 {
+
+constexpr uint32_t HARDENED = 0x80000000;
+
+/**
+ * @brief Public key and chain code of a BIP32 node
+ *
+ * The public key is kept uncompressed (65 bytes), the format the card
+ * exports.
+ */
+struct ExtendedPublicKey {
+    QByteArray publicKey;   ///< 0x04 || X || Y
+    QByteArray chainCode;   ///< 32 bytes
+
+    bool isValid() const { return publicKey.size() == 65 && chainCode.size() == 32; }
+};
+
+/**
+ * @brief Whether host-side derivation is available (requires OpenSSL)
+ */
+bool isAvailable();
+
+/**
+ * @brief Parse the response of EXPORT KEY with P2ExportKeyExtendedPublic
+ * @param keyData Keypair template (tag 0xA1) from CommandSet::exportKeyExtended()
+ * @return Key, or invalid key if the public key or chain code is missing
+ */
+ExtendedPublicKey fromExportedKey(const QByteArray& keyData);
+
+/**
+ * @brief Public child key derivation (CKDpub)
+ *
+ * Only non-hardened indexes can be derived from a public key: hardened
+ * steps have to be done by the card.
+ *
+ * @return Child key, or invalid key for a hardened index, an invalid parent,
+ *         or the (negligibly rare) index BIP32 says to skip
+ */
+ExtendedPublicKey deriveChild(const ExtendedPublicKey& parent, uint32_t index);
+
+/**
+ * @brief 33-byte SEC1 compressed form of a 65-byte public key
+ * @return Compressed key, or empty QByteArray on invalid input
+ */
+QByteArray compressPublicKey(const QByteArray& publicKey);
+
+/**
+ * @brief Ethereum address of a 65-byte public key
+ * @return "0x" followed by 40 lowercase hex digits, or empty string on invalid input
+ */
+QString ethereumAddress(const QByteArray& publicKey);
+
+} // namespace BIP32
+} // namespace Keycard
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <QByteArray>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+namespace Keycard {
+namespace BIP39 {
+
+/**
+ * @brief Embedded BIP39 wordlists
+ */
+enum class Language {
+    English
+};
+
+constexpr int WORDLIST_SIZE = 2048;
+constexpr int SEED_SIZE = 64;           // LOAD KEY (seed) expects 64 bytes
+constexpr int SEED_ITERATIONS = 2048;   // PBKDF2 rounds defined by BIP39
+
+/**
+ * @brief The 2048-word list for a language
+ */
+const QStringList& wordlist(Language language = Language::English);
+
+/**
+ * @brief Words for mnemonic indexes (e.g. CommandSet::generateMnemonic())
+ * @return Words in order, or empty list if an index is out of range
+ */
+QStringList indexesToWords(const QVector<int>& indexes, Language language = Language::English);
+
+/**
+ * @brief Space-separated mnemonic for mnemonic indexes
+ * @return Mnemonic, or empty string if an index is out of range
+ */
+QString indexesToMnemonic(const QVector<int>& indexes, Language language = Language::English);
+
+/**
+ * @brief Wordlist indexes of a whitespace-separated mnemonic
+ * @return Indexes, or empty vector if a word is not in the list
+ */
+QVector<int> mnemonicToIndexes(const QString& mnemonic, Language language = Language::English);
+
+/**
+ * @brief Recover the entropy of a mnemonic, verifying its checksum
+ * @param mnemonic 12, 15, 18, 21 or 24 words
+ * @param errorMsg Output: error message if the mnemonic is invalid
+ * @return 16-32 bytes of entropy, or empty QByteArray on error
+ */
+QByteArray mnemonicToEntropy(const QString& mnemonic, QString& errorMsg,
+                             Language language = Language::English);
+
+/**
+ * @brief Check word count, words and checksum of a mnemonic
+ * @param errorMsg Output: error message if the mnemonic is invalid
+ */
+bool validateMnemonic(const QString& mnemonic, QString& errorMsg,
+                      Language language = Language::English);
+
+/**
+ * @brief Derive the 64-byte BIP39 seed (for CommandSet::loadSeed())
+ *
+ * PBKDF2-HMAC-SHA512 over the NFKD-normalised mnemonic with salt
+ * "mnemonic" + NFKD(passphrase), 2048 iterations. Like the reference
+ * implementation, the mnemonic is neither validated nor re-spaced.
+ */
+QByteArray mnemonicToSeed(const QString& mnemonic, const QString& passphrase = QString());
+
+/**
+ * @brief PBKDF2-HMAC-SHA512 (RFC 2898)
+ *
+ * The HMAC pad blocks are compressed once up front, so each iteration
+ * costs two SHA-512 compressions.
+ */
+QByteArray pbkdf2HmacSha512(const QByteArray& password, const QByteArray& salt,
+                            int iterations, int keyLength);
+
+} // namespace BIP39
+} // namespace Keycard
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <QtGlobal>
+#include <cstddef>
+#include <new>
+
+namespace Keycard {
+
+/**
+ * @brief Size-class pool for small, short-lived objects (commands, sync waiters)
+ *
+ * Blocks of 64, 128, 256 and 512 bytes are carved from slabs of 32 and kept
+ * on a free list per size class once released, so a steady stream of
+ * commands reuses the same few blocks instead of going to malloc. Larger
+ * requests go straight to ::operator new. Slabs are kept for the life of the
+ * process: the pool only grows to the peak number of live objects.
+ *
+ * Thread-safe: blocks may be released on another thread than the one that
+ * allocated them (commands are created by callers and destroyed on the
+ * communication thread). Not for over-aligned types.
+ */
+class BlockPool {
+public:
+    /**
+     * @brief Largest request served from the pool
+     */
+    static constexpr std::size_t MAX_BLOCK_SIZE = 512;
+
+    /**
+     * @brief Allocate at least @p size bytes
+     * @throws std::bad_alloc
+     */
+    static void* allocate(std::size_t size);
+
+    /**
+     * @brief Release a block from allocate() with the same @p size
+     */
+    static void deallocate(void* block, std::size_t size) noexcept;
+
+    struct Stats {
+        quint64 allocations = 0;  ///< Pooled allocations
+        quint64 reused = 0;       ///< ... served from a free list
+        quint64 slabs = 0;        ///< Slabs allocated
+    };
+
+    /**
+     * @brief Counters since process start
+     */
+    static Stats stats();
+};
+
+/**
+ * @brief Standard allocator on BlockPool, e.g. for std::allocate_shared()
+ */
+template <typename T>
+struct PoolAllocator {
+    using value_type = T;
+
+    PoolAllocator() noexcept = default;
+    template <typename U>
+    PoolAllocator(const PoolAllocator<U>&) noexcept {}
+
+    T* allocate(std::size_t n) { return static_cast<T*>(BlockPool::allocate(n * sizeof(T))); }
+    void deallocate(T* p, std::size_t n) noexcept { BlockPool::deallocate(p, n * sizeof(T)); }
+
+    template <typename U>
+    bool operator==(const PoolAllocator<U>&) const noexcept { return true; }
+    template <typename U>
+    bool operator!=(const PoolAllocator<U>&) const noexcept { return false; }
+};
+
+} // namespace Keycard
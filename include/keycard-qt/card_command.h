@@ -1,8 +1,11 @@
 #pragma once
 
+#include "block_pool.h"
 #include <QObject>
+#include <QStringList>
 #include <QUuid>
 #include <QVariant>
+#include <future>
 #include <memory>
 
 namespace Keycard {
@@ -59,21 +62,96 @@ public:
      */
     virtual bool canRunDuringInit() const { return false; }
     
+    /**
+     * @brief Does this command need the Keycard session (SELECT, pairing, secure channel)?
+     * 
+     * Commands returning false (the cash applet commands) bring their own
+     * applet selection. When only such commands are pending as a card is
+     * tapped, CommunicationManager skips the initialization sequence.
+     */
+    virtual bool needsCardInitialization() const { return true; }
+    
+    /**
+     * @brief Key under which a successful result may be reused
+     * 
+     * Only side-effect-free reads return a non-empty key. CommunicationManager
+     * uses it to answer repeated (or prefetched) requests for the same card
+     * without touching the card.
+     */
+    virtual QString resultCacheKey() const { return QString(); }
+    
+    /**
+     * @brief BIP32 path this command derives on the card
+     * 
+     * Empty when the command uses the current key or no key at all.
+     * Used by SessionPlanner to order path-based commands within a tap.
+     */
+    virtual QString derivationPath() const { return QString(); }
+    
+    /**
+     * @brief Does the command leave its derived key as the card's current key?
+     */
+    virtual bool changesCurrentPath() const { return false; }
+    
+    /**
+     * @brief Can the card derive this command's key from the current key?
+     * 
+     * True for DERIVE KEY and EXPORT KEY, whose P1 selects the derivation
+     * source. SIGN always derives from the master key.
+     */
+    virtual bool canDeriveFromCurrent() const { return false; }
+    
+    /**
+     * @brief Pin this command's position in the queue
+     * 
+     * SessionPlanner never moves a pinned command, nor any command across it.
+     * Use it when a later command depends on an earlier one's side effects.
+     */
+    void setKeepOrder(bool keepOrder) { m_keepOrder = keepOrder; }
+    bool keepOrder() const { return m_keepOrder; }
+    
+    /**
+     * @brief Process-unique command id, increasing in creation order
+     * 
+     * Taken from an atomic counter, so creating a command draws no entropy.
+     */
+    quint64 id() const { return m_id; }
+    
     /**
      * @brief Get unique token for this command
+     * 
+     * QUuid view of id() (see tokenFromId()) for the QUuid-based API.
+     */
+    QUuid token() const { return tokenFromId(m_id); }
+    
+    /**
+     * @brief QUuid form of a command id (RFC 9562 version 8 layout)
+     */
+    static QUuid tokenFromId(quint64 id);
+    
+    /**
+     * @brief Command id of a token from tokenFromId()
+     * @return 0 if the token is not a command token
      */
-    QUuid token() const { return m_token; }
+    static quint64 idFromToken(const QUuid& token);
     
     /**
      * @brief Get command name for debugging
      */
     virtual QString name() const = 0;
     
+    // Commands are short-lived and created at a high rate: reuse BlockPool blocks
+    static void* operator new(std::size_t size) { return BlockPool::allocate(size); }
+    static void operator delete(void* block, std::size_t size) noexcept { BlockPool::deallocate(block, size); }
+    
 protected:
-    CardCommand() : m_token(QUuid::createUuid()) {}
+    CardCommand() : m_id(nextId()) {}
     
 private:
-    QUuid m_token;
+    static quint64 nextId();
+    
+    quint64 m_id;
+    bool m_keepOrder = false;
 };
 
 // Concrete command declarations
@@ -81,7 +159,7 @@ class SelectCommand : public CardCommand {
 public:
     explicit SelectCommand(bool force = false) : m_force(force) {}
     CommandResult execute(CommandSet* cmdSet) override;
-    QString name() const override { return "SELECT"; }
+    QString name() const override { return QStringLiteral("SELECT"); }
     bool canRunDuringInit() const override { return true; }
 private:
     bool m_force;
@@ -91,7 +169,7 @@ class VerifyPINCommand : public CardCommand {
 public:
     explicit VerifyPINCommand(const QString& pin) : m_pin(pin) {}
     CommandResult execute(CommandSet* cmdSet) override;
-    QString name() const override { return "VERIFY_PIN"; }
+    QString name() const override { return QStringLiteral("VERIFY_PIN"); }
 private:
     QString m_pin;
 };
@@ -100,7 +178,7 @@ class GetStatusCommand : public CardCommand {
 public:
     explicit GetStatusCommand(uint8_t info = 0) : m_info(info) {}
     CommandResult execute(CommandSet* cmdSet) override;
-    QString name() const override { return "GET_STATUS"; }
+    QString name() const override { return QStringLiteral("GET_STATUS"); }
     bool canRunDuringInit() const override { return true; }
 private:
     uint8_t m_info;
@@ -111,7 +189,7 @@ public:
     InitCommand(const QString& pin, const QString& puk, const QString& pairingPassword)
         : m_pin(pin), m_puk(puk), m_pairingPassword(pairingPassword) {}
     CommandResult execute(CommandSet* cmdSet) override;
-    QString name() const override { return "INIT"; }
+    QString name() const override { return QStringLiteral("INIT"); }
     int timeoutMs() const override { return 60000; }  // Init can take longer
 private:
     QString m_pin;
@@ -123,7 +201,7 @@ class ChangePINCommand : public CardCommand {
 public:
     explicit ChangePINCommand(const QString& newPIN) : m_newPIN(newPIN) {}
     CommandResult execute(CommandSet* cmdSet) override;
-    QString name() const override { return "CHANGE_PIN"; }
+    QString name() const override { return QStringLiteral("CHANGE_PIN"); }
 private:
     QString m_newPIN;
 };
@@ -132,7 +210,7 @@ class ChangePUKCommand : public CardCommand {
 public:
     explicit ChangePUKCommand(const QString& newPUK) : m_newPUK(newPUK) {}
     CommandResult execute(CommandSet* cmdSet) override;
-    QString name() const override { return "CHANGE_PUK"; }
+    QString name() const override { return QStringLiteral("CHANGE_PUK"); }
 private:
     QString m_newPUK;
 };
@@ -142,7 +220,7 @@ public:
     UnblockPINCommand(const QString& puk, const QString& newPIN)
         : m_puk(puk), m_newPIN(newPIN) {}
     CommandResult execute(CommandSet* cmdSet) override;
-    QString name() const override { return "UNBLOCK_PIN"; }
+    QString name() const override { return QStringLiteral("UNBLOCK_PIN"); }
 private:
     QString m_puk;
     QString m_newPIN;
@@ -152,7 +230,7 @@ class GenerateMnemonicCommand : public CardCommand {
 public:
     explicit GenerateMnemonicCommand(int checksumSize) : m_checksumSize(checksumSize) {}
     CommandResult execute(CommandSet* cmdSet) override;
-    QString name() const override { return "GENERATE_MNEMONIC"; }
+    QString name() const override { return QStringLiteral("GENERATE_MNEMONIC"); }
 private:
     int m_checksumSize;
 };
@@ -161,17 +239,38 @@ class LoadSeedCommand : public CardCommand {
 public:
     explicit LoadSeedCommand(const QByteArray& seed) : m_seed(seed) {}
     CommandResult execute(CommandSet* cmdSet) override;
-    QString name() const override { return "LOAD_SEED"; }
+    QString name() const override { return QStringLiteral("LOAD_SEED"); }
     int timeoutMs() const override { return 60000; }  // Seed loading can take time
 private:
     QByteArray m_seed;
 };
 
+/**
+ * @brief LOAD KEY from a BIP39 mnemonic
+ *
+ * The checksum check and 2048-round seed derivation start on a worker thread
+ * as soon as the command is created, so they overlap with queueing and card
+ * session setup; execute() only waits for what is left of it.
+ */
+class LoadMnemonicCommand : public CardCommand {
+public:
+    explicit LoadMnemonicCommand(const QString& mnemonic, const QString& passphrase = QString());
+    CommandResult execute(CommandSet* cmdSet) override;
+    QString name() const override { return QStringLiteral("LOAD_MNEMONIC"); }
+    int timeoutMs() const override { return 60000; }  // Seed loading can take time
+private:
+    struct DerivedSeed {
+        QByteArray seed;
+        QString error;
+    };
+    std::shared_future<DerivedSeed> m_seed;  // Shared: execute() may run again after a retry
+};
+
 class FactoryResetCommand : public CardCommand {
 public:
     FactoryResetCommand() = default;
     CommandResult execute(CommandSet* cmdSet) override;
-    QString name() const override { return "FACTORY_RESET"; }
+    QString name() const override { return QStringLiteral("FACTORY_RESET"); }
     int timeoutMs() const override { return 60000; }
 };
 
@@ -180,7 +279,10 @@ public:
     ExportKeyCommand(bool derive, bool makeCurrent, const QString& path, uint8_t exportType = 0x00)
         : m_derive(derive), m_makeCurrent(makeCurrent), m_path(path), m_exportType(exportType) {}
     CommandResult execute(CommandSet* cmdSet) override;
-    QString name() const override { return "EXPORT_KEY"; }
+    QString name() const override { return QStringLiteral("EXPORT_KEY"); }
+    QString derivationPath() const override { return m_derive ? m_path : QString(); }
+    bool changesCurrentPath() const override { return m_derive && m_makeCurrent; }
+    bool canDeriveFromCurrent() const override { return true; }
 private:
     bool m_derive;
     bool m_makeCurrent;
@@ -193,18 +295,55 @@ public:
     ExportKeyExtendedCommand(bool derive, bool makeCurrent, const QString& path)
         : m_derive(derive), m_makeCurrent(makeCurrent), m_path(path) {}
     CommandResult execute(CommandSet* cmdSet) override;
-    QString name() const override { return "EXPORT_KEY_EXTENDED"; }
+    QString name() const override { return QStringLiteral("EXPORT_KEY_EXTENDED"); }
+    QString resultCacheKey() const override {
+        // makeCurrent changes the card's current path, and relative paths depend on it,
+        // so only pure derivations from the master key are reusable
+        return m_derive && !m_makeCurrent && m_path.startsWith("m/") ? name() + ":" + m_path : QString();
+    }
+    QString derivationPath() const override { return m_derive ? m_path : QString(); }
+    bool changesCurrentPath() const override { return m_derive && m_makeCurrent; }
+    bool canDeriveFromCurrent() const override { return true; }
 private:
     bool m_derive;
     bool m_makeCurrent;
     QString m_path;
 };
 
+/**
+ * @brief Export extended public keys for several paths in one card session
+ *
+ * Used by AccountDiscovery to fetch account-level keys: the hardened steps
+ * are done by the card, everything below is derived on the host. Fails if
+ * any export fails. The card's current key is not changed.
+ */
+class ExportExtendedPublicKeysCommand : public CardCommand {
+public:
+    explicit ExportExtendedPublicKeysCommand(const QStringList& paths) : m_paths(paths) {}
+    CommandResult execute(CommandSet* cmdSet) override;
+    QString name() const override { return QStringLiteral("EXPORT_EXTENDED_PUBLIC_KEYS"); }
+private:
+    QStringList m_paths;
+};
+
+class DeriveKeyCommand : public CardCommand {
+public:
+    explicit DeriveKeyCommand(const QString& path) : m_path(path) {}
+    CommandResult execute(CommandSet* cmdSet) override;
+    QString name() const override { return QStringLiteral("DERIVE_KEY"); }
+    QString derivationPath() const override { return m_path; }
+    bool changesCurrentPath() const override { return true; }
+    bool canDeriveFromCurrent() const override { return true; }
+private:
+    QString m_path;
+};
+
 class GetMetadataCommand : public CardCommand {
 public:
     GetMetadataCommand() = default;
     CommandResult execute(CommandSet* cmdSet) override;
-    QString name() const override { return "GET_METADATA"; }
+    QString name() const override { return QStringLiteral("GET_METADATA"); }
+    QString resultCacheKey() const override { return name(); }
 };
 
 class StoreMetadataCommand : public CardCommand {
@@ -212,7 +351,7 @@ public:
     StoreMetadataCommand(const QString& name, const QStringList& paths)
         : m_name(name), m_paths(paths) {}
     CommandResult execute(CommandSet* cmdSet) override;
-    QString name() const override { return "STORE_METADATA"; }
+    QString name() const override { return QStringLiteral("STORE_METADATA"); }
 private:
     QString m_name;
     QStringList m_paths;
@@ -223,18 +362,50 @@ public:
     SignCommand(const QByteArray& data, const QString& path = QString(), bool makeCurrent = false)
         : m_data(data), m_path(path), m_makeCurrent(makeCurrent) {}
     CommandResult execute(CommandSet* cmdSet) override;
-    QString name() const override { return "SIGN"; }
+    QString name() const override { return QStringLiteral("SIGN"); }
+    QString derivationPath() const override { return m_path; }
+    bool changesCurrentPath() const override { return !m_path.isEmpty() && m_makeCurrent; }
 private:
     QByteArray m_data;
     QString m_path;
     bool m_makeCurrent;
 };
 
+/**
+ * @brief SELECT the cash applet
+ *
+ * Result: installed, publicKey, publicData, appVersion, appVersionMinor.
+ */
+class CashSelectCommand : public CardCommand {
+public:
+    CashSelectCommand() = default;
+    CommandResult execute(CommandSet* cmdSet) override;
+    QString name() const override { return QStringLiteral("CASH_SELECT"); }
+    bool needsCardInitialization() const override { return false; }
+};
+
+/**
+ * @brief Pinless payment: SELECT the cash applet and SIGN a hash with its key
+ *
+ * Two APDUs, no pairing, PIN or secure channel. Result: publicKey and
+ * tlvResponse (as for SignCommand with a path).
+ */
+class CashSignCommand : public CardCommand {
+public:
+    explicit CashSignCommand(const QByteArray& hash) : m_hash(hash) {}
+    CommandResult execute(CommandSet* cmdSet) override;
+    QString name() const override { return QStringLiteral("CASH_SIGN"); }
+    int timeoutMs() const override { return 10000; }
+    bool needsCardInitialization() const override { return false; }
+private:
+    QByteArray m_hash;
+};
+
 class ChangePairingCommand : public CardCommand {
 public:
     explicit ChangePairingCommand(const QString& newPairing) : m_newPairing(newPairing) {}
     CommandResult execute(CommandSet* cmdSet) override;
-    QString name() const override { return "CHANGE_PAIRING"; }
+    QString name() const override { return QStringLiteral("CHANGE_PAIRING"); }
 private:
     QString m_newPairing;
 };
@@ -0,0 +1,117 @@
+#pragma once
+
+#include "types.h"
+#include <QByteArray>
+#include <QHash>
+#include <QMutex>
+#include <QString>
+
+namespace Keycard {
+
+/**
+ * @brief Read-through cache for card metadata and ApplicationInfo
+ *
+ * Wallet metadata only changes through our own STORE DATA, so there is no need
+ * to fetch it with a secure GET DATA round trip on every app start. Entries are
+ * keyed by the card's instance UID and tagged with the key UID they were read
+ * for: metadata is only served while both match the card in the reader.
+ *
+ * Freshness is checked whenever the card is selected again: a cheap hash of the
+ * raw SELECT response is compared against the one recorded with the entry, and
+ * any difference (new keys, re-initialisation, different applet version) drops
+ * the cached metadata.
+ *
+ * When constructed with a file path, every mutation is written through to disk
+ * in a compact binary format and the file is loaded on construction.
+ *
+ * Thread-safe: all methods can be called from any thread.
+ */
+class CardInfoCache {
+public:
+    /**
+     * @brief Create a cache
+     * @param filePath Persistence file (empty = in-memory only)
+     */
+    explicit CardInfoCache(const QString& filePath = QString());
+
+    /**
+     * @brief Stable 64-bit FNV-1a hash of a card response
+     *
+     * Unlike qHash() this is not seeded per process, so it can be persisted.
+     */
+    static quint64 responseHash(const QByteArray& response);
+
+    /**
+     * @brief Record ApplicationInfo from a fresh SELECT
+     * @param info Parsed SELECT response
+     * @param selectHash responseHash() of the raw SELECT response
+     * @return true if a cached entry existed and is still valid for this response
+     */
+    bool updateApplicationInfo(const ApplicationInfo& info, quint64 selectHash);
+
+    /**
+     * @brief Get cached ApplicationInfo without touching the card
+     * @param instanceUID Card instance UID (raw bytes)
+     * @return Cached info, or default ApplicationInfo if unknown
+     */
+    ApplicationInfo applicationInfo(const QByteArray& instanceUID) const;
+
+    /**
+     * @brief Get cached metadata
+     * @param instanceUID Card instance UID (raw bytes)
+     * @param keyUID Key UID currently on the card
+     * @param metadata Output: encoded metadata as returned by GET DATA
+     * @return true on cache hit
+     */
+    bool metadata(const QByteArray& instanceUID, const QByteArray& keyUID, QByteArray& metadata) const;
+
+    /**
+     * @brief Store metadata (read-through fill or write-through after STORE DATA)
+     * @param instanceUID Card instance UID (raw bytes)
+     * @param keyUID Key UID currently on the card
+     * @param metadata Encoded metadata
+     */
+    void storeMetadata(const QByteArray& instanceUID, const QByteArray& keyUID, const QByteArray& metadata);
+
+    /**
+     * @brief Drop everything cached for a card
+     *
+     * Called after operations that change keys or wipe the card
+     * (factory reset, load seed, remove key).
+     *
+     * @param instanceUID Card instance UID (raw bytes)
+     */
+    void invalidate(const QByteArray& instanceUID);
+
+    /**
+     * @brief Drop all entries
+     */
+    void clear();
+
+    /**
+     * @brief Number of cached cards
+     */
+    int size() const;
+
+    /**
+     * @brief Persistence file (empty if in-memory only)
+     */
+    QString filePath() const { return m_filePath; }
+
+private:
+    struct Entry {
+        ApplicationInfo appInfo;
+        quint64 selectHash = 0;
+        QByteArray metadata;
+        bool hasMetadata = false;
+    };
+
+    bool load();
+    bool saveLocked() const;
+
+    QString m_filePath;
+    QHash<QByteArray, Entry> m_entries;  // Keyed by instance UID
+    mutable QMutex m_mutex;
+};
+
+} // namespace Keycard
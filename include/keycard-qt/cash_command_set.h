@@ -0,0 +1,68 @@
+#pragma once
+
+#include "types.h"
+#include "apdu/command.h"
+#include "apdu/response.h"
+#include "channel_interface.h"
+#include <QString>
+
+namespace Keycard {
+
+/**
+ * @brief Command set for the Keycard Cash applet
+ *
+ * The cash applet holds its own key and signs without pairing, PIN or
+ * secure channel, so a payment is one SELECT and one SIGN. Selecting it
+ * deselects the Keycard applet: a Keycard secure channel open on the same
+ * card is gone afterwards.
+ *
+ * Usage:
+ * 1. Create with channel
+ * 2. select() - Select cash applet, read its public key and data
+ * 3. sign() - Sign a 32-byte hash
+ */
+class CashCommandSet {
+public:
+    /**
+     * @brief Create command set with channel
+     * @param channel Communication channel (must outlive this object)
+     */
+    explicit CashCommandSet(IChannel* channel);
+
+    /**
+     * @brief Select the cash applet
+     * @return CashApplicationInfo (installed == false on failure)
+     */
+    CashApplicationInfo select();
+
+    /**
+     * @brief Sign a hash with the cash applet's key
+     * @param hash Data to sign (32 bytes)
+     * @return Signature template (tag 0xA0: public key 0x80, DER signature 0x30),
+     *         empty on failure
+     *
+     * Like CommandSet::signWithPathFullResponse(), the caller parses the
+     * template and recovers V from the public key.
+     */
+    QByteArray sign(const QByteArray& hash);
+
+    /**
+     * @brief Info from the last successful select()
+     */
+    CashApplicationInfo applicationInfo() const { return m_appInfo; }
+
+    /**
+     * @brief Get last error message
+     */
+    QString lastError() const { return m_lastError; }
+
+private:
+    APDU::Response send(const APDU::Command& cmd);
+    bool checkOK(const APDU::Response& response);
+
+    IChannel* m_channel;
+    CashApplicationInfo m_appInfo;
+    QString m_lastError;
+};
+
+} // namespace Keycard
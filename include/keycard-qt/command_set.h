@@ -4,6 +4,8 @@
 #include "types_parser.h"
 #include "secure_channel.h"
 #include "pairing_storage.h"
+#include "card_info_cache.h"
+#include "ecdh_secret_cache.h"
 #include "apdu/command.h"
 #include "apdu/response.h"
 #include "keycard_channel.h"
@@ -118,6 +120,10 @@ public:
     // Status and verification
     /**
      * @brief Get application status
+     * 
+     * Always sends GET STATUS. A successful application status read also
+     * refreshes the cached status (see applicationStatus()).
+     * 
      * @param info Status info type (P1 parameter)
      * @return ApplicationStatus on success
      */
@@ -126,7 +132,7 @@ public:
     /**
      * @brief Verify PIN
      * ⚠️ WARNING: 3 wrong attempts will BLOCK the PIN! Use with extreme caution!
-     * Always call getStatus() first to check remaining attempts.
+     * Check applicationStatus() first to see remaining attempts.
      * @param pin 6-digit PIN
      * @return true on success, false if wrong PIN (check remaining attempts)
      */
@@ -257,7 +263,7 @@ public:
     /**
      * @brief Identify the card
      * @param challenge Optional 32-byte challenge
-     * @return Card identification
+     * @return Card identification; see IdentityCertificate and IdentityVerifier
      */
     QByteArray identify(const QByteArray& challenge = QByteArray());
     
@@ -301,10 +307,10 @@ public:
     int remainingPINAttempts() const { return m_cachedStatus.pinRetryCount; }
     
     /**
-     * @brief Get cached application status
+     * @brief Get cached application status without touching the card
      * 
-     * Returns cached status fetched after opening secure channel or PIN verification.
-     * This avoids blocking getStatus() calls.
+     * The value may be stale (see isStatusStale()); retry counters are still
+     * kept current from VERIFY PIN / UNBLOCK PIN status words.
      * 
      * @return Cached ApplicationStatus, or default if not available
      */
@@ -312,13 +318,62 @@ public:
     
     /**
      * @brief Check if cached status is valid
-     * @return true if status has been cached (secure channel was opened)
+     * @return true if status has been read from the card at least once
      */
     bool hasCachedStatus() const { return m_hasCachedStatus; }
     
+    /**
+     * @brief Get application status, sending GET STATUS only when stale
+     * 
+     * Status is not re-read after every secure channel open or wrong PIN:
+     * retry counters are updated from status words (0x63Cx). SELECT (i.e.
+     * every new tap), a successful VERIFY PIN / UNBLOCK PIN and commands
+     * that change card state (key load/removal, derivation with makeCurrent,
+     * factory reset) mark it stale. The next call after that issues a single
+     * GET STATUS.
+     * 
+     * @return Application status (last known value if the refresh failed)
+     */
+    ApplicationStatus applicationStatus();
+    
+    /**
+     * @brief Check whether applicationStatus() would send GET STATUS
+     */
+    bool isStatusStale() const { return m_statusStale || !m_hasCachedStatus; }
+    
+    /**
+     * @brief Is the card's current key path known in this session?
+     * 
+     * Set by successful makeCurrent derivations; cleared by SELECT, card swap
+     * and key changes. While known and setDeriveFromCurrent() is on, absolute
+     * paths below it are derived from the current key instead of from master.
+     */
+    bool isCurrentKeyPathKnown() const { return m_currentKeyPathKnown; }
+    
+    /**
+     * @brief Derive absolute paths below the known current key from that key
+     * 
+     * Sends only the remaining path segments, so the APDU is only right while
+     * the tracked current key path matches the card. Enabled by
+     * CommunicationManager::setSessionPlanningEnabled(), whose plans rely on it.
+     * 
+     * @param enabled Default false: every absolute path is derived from master
+     */
+    void setDeriveFromCurrent(bool enabled) { m_deriveFromCurrent = enabled; }
+    bool deriveFromCurrent() const { return m_deriveFromCurrent; }
+    
+    /**
+     * @brief Card's current key path, 4-byte big-endian components (empty = master)
+     */
+    QByteArray currentKeyPath() const { return m_currentKeyPath; }
+    
     /**
      * @brief Wait for card to be present
      * Checks if card is connected, enables card detection if needed, and waits for card
+     * 
+     * Blocks on KeycardChannel::waitForTarget() without running an event loop.
+     * Falls back to a nested event loop when the backend delivers detection
+     * through this thread's event loop (see KeycardChannel::canWaitForTarget()).
      * @param timeoutMs Timeout in milliseconds (default: uses defaultWaitTimeout)
      * @return true if card detected, false on timeout or error
      */
@@ -351,10 +406,46 @@ public:
      */
     bool ensureSecureChannel();
     
+    /**
+     * @brief Attach a metadata/ApplicationInfo cache
+     *
+     * When set, getData(P1StoreDataPublic) is served from the cache while the
+     * card's SELECT response is unchanged, storeData() writes through, and key
+     * changing operations invalidate the card's entry.
+     *
+     * @param cache Cache instance (null = no caching)
+     */
+    void setCardInfoCache(std::shared_ptr<CardInfoCache> cache) { m_cardInfoCache = cache; }
+    
+    /**
+     * @brief Replace the cache of ECDH secrets prepared for returning cards
+     *
+     * Each CommandSet starts with its own; share one between instances that
+     * talk to the same cards.
+     *
+     * @param cache Cache instance (null = derive the secret after every SELECT)
+     */
+    void setEcdhSecretCache(std::shared_ptr<EcdhSecretCache> cache) { m_ecdhSecretCache = cache; }
+    
+    /**
+     * @brief Start deriving the ECDH secret in the background right after SELECT
+     *
+     * select() leaves the ECDH exchange to the first openSecureChannel() or
+     * init(), so flows without a secure channel never do EC work. With
+     * precompute enabled the secret is derived on the global thread pool while
+     * the caller continues, and the secure flow picks it up from the ECDH
+     * cache. Needs an EcdhSecretCache (the default).
+     *
+     * @param enabled Default false
+     */
+    void setEcdhPrecompute(bool enabled) { m_ecdhPrecompute = enabled; }
+    
     // Accessors
     ApplicationInfo applicationInfo() const { return m_appInfo; }
     PairingInfo pairingInfo() const { return m_pairingInfo; }
     std::shared_ptr<IPairingStorage> pairingStorage() const { return m_pairingStorage; }
+    std::shared_ptr<CardInfoCache> cardInfoCache() const { return m_cardInfoCache; }
+    std::shared_ptr<EcdhSecretCache> ecdhSecretCache() const { return m_ecdhSecretCache; }
     
     // Test helpers (for unit testing only - bypasses crypto validation)
     #ifdef KEYCARD_ENABLE_TEST_HELPERS
@@ -376,6 +467,16 @@ public:
         m_pairingInfo = pairingInfo;
         m_secureChannel->init(iv, encKey, macKey);
     }
+    
+    /**
+     * @brief Directly inject a fresh cached status for testing
+     * @param status Status to report until it is invalidated
+     */
+    void testInjectCachedStatus(const ApplicationStatus& status) {
+        m_cachedStatus = status;
+        m_hasCachedStatus = true;
+        m_statusStale = false;
+    }
     #endif
     
     // ========== Channel Management API  ==========
@@ -491,11 +592,54 @@ private:
      * - Ensures pairing exists (loads or creates)
      * - Ensures secure channel is open (if secure=true)
      * - Transmits the command via appropriate channel
+     * - Recovers a desynchronized secure channel in place (see resyncSecureChannel())
      */
     APDU::Response send(const APDU::Command& cmd, bool secure = true);
     
     /**
-     * @brief Internal implementation of waitForCard (must be called from correct thread)
+     * @brief Recover from a secure channel desync without a new card tap
+     * 
+     * Called by send() after a response MAC mismatch or SW 0x6985 (the card
+     * no longer has the session). Resets the session, re-opens it with the
+     * cached pairing and re-verifies the cached PIN. Counted in the
+     * "secure_channel.resync" / "secure_channel.resync_failed" metrics.
+     * @return true if the secure channel is open again
+     */
+    bool resyncSecureChannel();
+    
+    /**
+     * @brief send() after a desync: resync, then replay @p cmd if idempotent
+     * @param macMismatch The response failed MAC verification (rethrown if the resync fails)
+     * @return The replayed command's response, or SW 0x6985 if it was not replayed
+     */
+    APDU::Response resyncAndReplay(const APDU::Command& cmd, bool macMismatch);
+    
+    /**
+     * @brief KeycardChannel session probe: did the card keep the secure channel?
+     * 
+     * Sends GET STATUS through the open session; a card that lost power in
+     * a flap has dropped it and cannot answer.
+     */
+    bool probeSession();
+    
+    /**
+     * @brief Derive (or take from the cache) the ECDH secret for the selected card
+     * @return false if the card has no secure channel key or derivation failed
+     * 
+     * Once per SELECT; called by openSecureChannel() and init().
+     */
+    bool ensureEcdhSecret();
+    
+    /**
+     * @brief EcdhSecretCache key of the selected card: its instance UID, or its
+     *        public key while it is pre-initialized
+     */
+    QByteArray ecdhCacheId() const;
+    
+    /**
+     * @brief waitForCard() using a nested event loop
+     * 
+     * Used when the presence latch cannot be woken from this thread.
      * @param timeoutMs Timeout in milliseconds
      * @return true if card detected, false on timeout
      */
@@ -521,11 +665,36 @@ private:
     bool factoryResetFallback();
 
     void setCardReady(bool ready);
+    
+    /**
+     * @brief Drop cached metadata/ApplicationInfo for the current card
+     */
+    void invalidateCardInfoCache();
+    
+    /**
+     * @brief Mark cached status stale after a state-changing command
+     */
+    void invalidateStatus();
+    
+    /**
+     * @brief Encode a derivation path, relative to the current key when it is a prefix
+     * @param path BIP32 path ("m/...", "../..." or "./...")
+     * @param startingPoint Set to the P1 derivation source to use
+     */
+    QByteArray encodeDerivationPath(const QString& path, uint8_t& startingPoint) const;
+    
+    /**
+     * @brief Track the current key path after a successful makeCurrent derivation
+     */
+    void setCurrentKeyPath(const QString& path);
+    void forgetCurrentKeyPath();
 
     
     std::shared_ptr<Keycard::KeycardChannel> m_channel;
     std::shared_ptr<IPairingStorage> m_pairingStorage;  // Injected (can be null)
     PairingPasswordProvider m_passwordProvider;  // Injected (can be null)
+    std::shared_ptr<CardInfoCache> m_cardInfoCache;  // Optional (can be null)
+    std::shared_ptr<EcdhSecretCache> m_ecdhSecretCache;  // Optional (can be null)
     
     QSharedPointer<SecureChannel> m_secureChannel;
     ApplicationInfo m_appInfo;
@@ -537,16 +706,27 @@ private:
     // Status caching (matching status-keycard-go behavior)
     ApplicationStatus m_cachedStatus;  // Cached status from last getStatus() call
     bool m_hasCachedStatus = false;    // True if m_cachedStatus is valid
+    bool m_statusStale = true;         // Card state changed since m_cachedStatus was read
+    
+    // Current key path (see isCurrentKeyPathKnown())
+    QByteArray m_currentKeyPath;
+    bool m_currentKeyPathKnown = false;
     
     // iOS: Authentication state tracking for secure channel recovery
     bool m_wasAuthenticated = false;  // True if verifyPIN succeeded in this flow
     QString m_cachedPIN;              // Cached PIN for auto-reauth after NFC session loss
     bool m_needsSecureChannelReestablishment = false;  // Flag: secure channel must be re-opened before next command
+    bool m_resyncing = false;         // resyncSecureChannel() running: no nested recovery
+    
+    // Lazy ECDH (see ensureEcdhSecret())
+    bool m_ecdhSecretReady = false;   // m_secureChannel holds the secret for the selected card
+    bool m_ecdhPrecompute = false;
     
     // Default timeout for waitForCard operations (can be configured for tests)
     int m_defaultWaitTimeout = 60000;  // 60 seconds default
 
     std::atomic_bool m_cardReady = false;
+    std::atomic_bool m_deriveFromCurrent = false;  // Set from the manager's thread
 };
 
 } // namespace Keycard
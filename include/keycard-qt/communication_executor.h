@@ -0,0 +1,115 @@
+#pragma once
+
+#include <QMutex>
+#include <QString>
+#include <QThread>
+#include <vector>
+
+namespace Keycard {
+
+/**
+ * @brief Provides the thread a CommunicationManager runs its queue on
+ *
+ * A manager needs a thread with a running Qt event loop: init() acquires one
+ * and moves the manager there, stop() moves it back and releases the thread.
+ * One executor can be shared by any number of managers.
+ *
+ * Implementations must be thread-safe.
+ */
+class CommunicationExecutor {
+public:
+    virtual ~CommunicationExecutor() = default;
+
+    /**
+     * @brief Thread for a manager that is being initialized
+     * @return Thread whose event loop is running (or will run) until release()
+     */
+    virtual QThread* acquire() = 0;
+
+    /**
+     * @brief The manager no longer uses @p thread
+     * @param thread Thread returned by acquire()
+     * @param idle false if the manager's last slot did not finish in time
+     */
+    virtual void release(QThread* thread, bool idle) = 0;
+
+    /**
+     * @brief Name for logging ("dedicated", "shared", "event-loop")
+     */
+    virtual QString name() const = 0;
+};
+
+/**
+ * @brief One thread per manager, started by init() and joined by stop()
+ *
+ * The default executor.
+ */
+class DedicatedThreadExecutor : public CommunicationExecutor {
+public:
+    QThread* acquire() override;
+    void release(QThread* thread, bool idle) override;
+    QString name() const override { return "dedicated"; }
+};
+
+/**
+ * @brief Fixed set of event-loop threads shared by many managers
+ *
+ * Each acquire() returns the thread with the fewest managers. Threads are
+ * started on first use and joined by the destructor, so all managers must be
+ * stopped before the executor is destroyed.
+ *
+ * Managers on the same thread run their commands one after another, which
+ * suits processes that drive many readers with little concurrent I/O.
+ */
+class SharedThreadExecutor : public CommunicationExecutor {
+public:
+    /**
+     * @param threadCount Number of threads (at least 1)
+     */
+    explicit SharedThreadExecutor(int threadCount = 1);
+    ~SharedThreadExecutor() override;
+
+    QThread* acquire() override;
+    void release(QThread* thread, bool idle) override;
+    QString name() const override { return "shared"; }
+
+    int threadCount() const;
+
+    /**
+     * @brief Number of managers currently running on the executor
+     */
+    int managerCount() const;
+
+private:
+    struct Worker {
+        QThread* thread = nullptr;
+        int managers = 0;
+    };
+
+    mutable QMutex m_mutex;
+    std::vector<Worker> m_workers;
+};
+
+/**
+ * @brief Runs managers on an existing thread, typically the host application's
+ *
+ * No thread is created: the manager's slots run in that thread's event loop.
+ * executeCommandSync() on the same thread keeps processing events while it
+ * waits, so the host's GUI thread can be used.
+ */
+class EventLoopExecutor : public CommunicationExecutor {
+public:
+    /**
+     * @param thread Thread to run on (nullptr = the application's main thread)
+     */
+    explicit EventLoopExecutor(QThread* thread = nullptr);
+
+    QThread* acquire() override;
+    void release(QThread*, bool) override {}
+    QString name() const override { return "event-loop"; }
+
+private:
+    QThread* m_thread;
+};
+
+} // namespace Keycard
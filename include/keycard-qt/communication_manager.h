@@ -4,16 +4,23 @@
 #include "card_command.h"
 #include "command_set.h"
 #include "keycard_channel.h"
+#include "compact_types.h"
+#include "seqlock.h"
+#include "session_planner.h"
+#include "communication_executor.h"
+#include "instrumented_mutex.h"
 #include <QObject>
 #include <QThread>
 #include <QMutex>
 #include <QWaitCondition>
 #include <QHash>
+#include <QSet>
+#include <QStringList>
 #include <QElapsedTimer>
 #include <QCoreApplication>
 #include <QEventLoop>
 #include <memory>
-#include <queue>
+#include <deque>
 
 namespace Keycard {
 
@@ -32,7 +39,7 @@ namespace Keycard {
  * Thread Safety:
  * - All public methods are thread-safe
  * - Commands can be enqueued from any thread
- * - Execution happens on dedicated communication thread
+ * - Execution happens on the communication thread (dedicated by default, see setExecutor())
  * - Results delivered via signals (async) or return values (sync)
  * 
  * Inherits from ICommunicationManager interface for testability.
@@ -52,6 +59,32 @@ public:
     };
     Q_ENUM(State)
     
+    /**
+     * @brief Wallet data to fetch speculatively while the card is idle
+     * 
+     * When enabled, gaps between user commands (card initialized, queue empty)
+     * are used to run GetMetadataCommand and ExportKeyExtendedCommand for the
+     * listed paths. Prefetch runs one command at a time, so a user command
+     * waits for at most one prefetch round trip. Results are kept for the
+     * current card and key and are returned by enqueueCommand() /
+     * executeCommandSync() without touching the card.
+     */
+    struct PrefetchPolicy {
+        bool metadata = false;    ///< Prefetch public metadata (GET DATA)
+        QStringList exportPaths;  ///< Paths to export extended public keys for
+        
+        bool isEnabled() const { return metadata || !exportPaths.isEmpty(); }
+    };
+    
+    /**
+     * @brief Which thread the CommandSet and its channel live on
+     */
+    enum class ThreadOwnership {
+        SplitThreads,    // CommandSet/channel stay on their creating (main) thread
+        SingleIoThread   // CommandSet, channel and manager all live on the communication thread
+    };
+    Q_ENUM(ThreadOwnership)
+    
     explicit CommunicationManager(QObject* parent = nullptr);
     ~CommunicationManager() override;
     
@@ -68,12 +101,55 @@ public:
      * - Proper encapsulation (channel ownership)
      * - Thread-safe (CommandSet on main thread, manager on comm thread)
      * 
-     * This creates the communication thread and connects to CommandSet
-     * signals (cardReady, cardLost), but does NOT start card detection.
+     * This acquires the communication thread from the executor (see
+     * setExecutor()) and connects to CommandSet signals (cardReady,
+     * cardLost), but does NOT start card detection.
      * Call startDetection() to begin monitoring for cards.
      */
     bool init(std::shared_ptr<CommandSet> commandSet);
     
+    /**
+     * @brief Initialize with an explicit thread ownership mode
+     * @param commandSet CommandSet instance that owns the channel
+     * @param ownership Thread the CommandSet and channel should live on
+     * @return true on success
+     * 
+     * With ThreadOwnership::SingleIoThread the CommandSet, its channel and
+     * backend are moved to the communication thread, so detection signals,
+     * start/stop detection and APDU exchange no longer hop through the main
+     * thread (e.g. the Qt NFC backend sends directly instead of through a
+     * BlockingQueuedConnection). The main thread only receives results via
+     * signals. Objects are moved back to their original thread by stop().
+     * 
+     * Must be called on the thread the CommandSet lives on, and the
+     * CommandSet and channel must not have QObject parents; otherwise the
+     * manager falls back to SplitThreads. Backends whose platform API is
+     * bound to the main thread (e.g. iOS CoreNFC sessions) should use
+     * SplitThreads.
+     */
+    bool init(std::shared_ptr<CommandSet> commandSet, ThreadOwnership ownership);
+    
+    /**
+     * @brief Thread ownership mode in effect (after init())
+     */
+    ThreadOwnership threadOwnership() const { return m_ownership; }
+    
+    /**
+     * @brief Choose where the manager's queue runs (before init())
+     * @param executor Executor to acquire the communication thread from
+     * 
+     * Defaults to a DedicatedThreadExecutor (one thread per manager). Use a
+     * SharedThreadExecutor to run many managers on a few threads, or an
+     * EventLoopExecutor to run on the host application's event loop.
+     * Ignored while running.
+     */
+    void setExecutor(std::shared_ptr<CommunicationExecutor> executor);
+    
+    /**
+     * @brief Executor used by init()
+     */
+    std::shared_ptr<CommunicationExecutor> executor() const { return m_executor; }
+    
     
     /**
      * @brief Start card detection
@@ -162,14 +238,33 @@ public:
     
     /**
      * @brief Get current card info (only valid when Ready)
+     * 
+     * Lock-free: reads the snapshot published after initialization and
+     * after every command.
      */
     ApplicationInfo applicationInfo() const override;
     
     /**
      * @brief Get current card status (only valid when Ready)
+     * 
+     * Lock-free: reads the snapshot published after initialization and
+     * after every command.
      */
     ApplicationStatus applicationStatus() const override;
     
+    /**
+     * @brief Get current card info without heap allocation
+     * 
+     * Same data as applicationInfo() in trivially copyable form; suitable for
+     * polling from the UI thread.
+     */
+    CompactApplicationInfo compactApplicationInfo() const { return m_cardSnapshot.load().appInfo; }
+    
+    /**
+     * @brief Get current card status without heap allocation
+     */
+    CompactApplicationStatus compactApplicationStatus() const { return m_cardSnapshot.load().appStatus; }
+    
     /**
      * @brief Get raw data from card (for metadata operations)
      * @param type Data type (e.g., 0x00 for public data)
@@ -179,6 +274,9 @@ public:
     
     /**
      * @brief Store raw data to card (for metadata operations)
+     * 
+     * Storing to the public data slot drops a cached GET_METADATA result.
+     * 
      * @param type Data type (e.g., 0x00 for public data)
      * @param data Data to store
      * @return true on success
@@ -187,10 +285,86 @@ public:
 
     std::shared_ptr<CommandSet> commandSet() const override { return m_commandSet; }
     
+    /**
+     * @brief Set speculative prefetch policy (disabled by default)
+     * 
+     * Thread-safe. Takes effect at the next idle gap.
+     */
+    void setPrefetchPolicy(const PrefetchPolicy& policy);
+    
+    /**
+     * @brief Get current prefetch policy
+     */
+    PrefetchPolicy prefetchPolicy() const;
+    
+    /**
+     * @brief Enable tap session planning (disabled by default)
+     * 
+     * When several path-based commands are pending, the queue is reordered
+     * by SessionPlanner before the next command runs, so commands sharing a
+     * parent key derive from it instead of from master. Also switches
+     * CommandSet::setDeriveFromCurrent(), which those plans rely on. Thread-safe.
+     * 
+     * @param enabled Plan the queue before running commands
+     * @param options Planner options (e.g. allowing a different final current key)
+     */
+    void setSessionPlanningEnabled(bool enabled, const SessionPlanner::Options& options = SessionPlanner::Options());
+    
+    /**
+     * @brief Is tap session planning enabled?
+     */
+    bool isSessionPlanningEnabled() const;
+    
+    /**
+     * @brief Most recent plan, with expected FIFO and planned on-card cost
+     */
+    SessionPlan lastSessionPlan() const;
+    
+    /**
+     * @brief Check whether a result is cached for CardCommand::resultCacheKey()
+     */
+    bool hasPrefetchedResult(const QString& cacheKey) const;
+    
+    /**
+     * @brief Drop all cached command results
+     */
+    void clearPrefetchCache();
+    
+    // Test helpers (for unit testing only)
+    #ifdef KEYCARD_ENABLE_TEST_HELPERS
+    /**
+     * @brief Directly insert a cached result for testing
+     */
+    void testInjectPrefetchedResult(const QString& cacheKey, const CommandResult& result) {
+        QMutexLocker locker(&m_prefetchMutex);
+        m_prefetchCache.insert(cacheKey, result);
+    }
+
+    /**
+     * @brief Number of executeCommandSync() calls still registered
+     *
+     * Zero whenever no sync call is in flight; anything else is a leak.
+     */
+    int testPendingSyncCount() {
+        QMutexLocker locker(&m_syncMutex);
+        return static_cast<int>(m_pendingSync.size());
+    }
+
+    /**
+     * @brief Run one processQueue() step on the calling thread
+     *
+     * The caller must be the communication thread (e.g. the test thread
+     * with EventLoopExecutor).
+     */
+    void testProcessQueue() {
+        processQueue();
+    }
+    #endif
+    
 signals:
     /**
      * @brief Emitted when a command completes
-     * @param token Command token
+     * @param token Command token (CardCommand::token(); CardCommand::idFromToken() gives its id)
      * @param result Command result
      */
     void commandCompleted(QUuid token, CommandResult result);
@@ -240,20 +414,6 @@ private slots:
     void processQueue();
     
 private:
-    /**
-     * @brief Communication thread worker
-     * 
-     * This thread runs the Qt event loop and processes all card operations.
-     * Similar to Go's cardCommunicationRoutine with runtime.LockOSThread().
-     */
-    class CommunicationThread : public QThread {
-    public:
-        explicit CommunicationThread(CommunicationManager* /*manager*/) {}
-        
-    protected:
-        void run() override;
-    };
-    
     /**
      * @brief Initialize card sequence (runs on communication thread)
      * 
@@ -270,15 +430,106 @@ private:
      */
     CardInitializationResult initializeCardSequence();
     
+    /**
+     * @brief Run initializeCardSequence() and publish its result (communication thread)
+     * 
+     * Sets Ready and emits cardInitialized().
+     * @return false if the sequence threw (card lost mid-sequence)
+     */
+    bool runCardInitialization();
+    
+    /**
+     * @brief Are commands pending, none of them needing the Keycard session?
+     * 
+     * Then a tap skips initializeCardSequence(): a cash payment is its own
+     * SELECT and SIGN. The sequence runs later, before the first command that
+     * needs it.
+     */
+    bool canSkipCardInitialization() const;
+    
     /**
      * @brief Set state and emit signal
      */
     void setState(State newState);
     
+    /**
+     * @brief Publish CommandSet's current info/status for lock-free readers
+     */
+    void publishCardSnapshot();
+    
+    /**
+     * @brief Emit commandCompleted() and wake the sync waiter, if any
+     * @param id CardCommand::id() of the completed command
+     */
+    void notifyCompletion(quint64 id, const CommandResult& result);
+    
+    /**
+     * @brief Look up a reusable result for cmd (only while card is Ready)
+     */
+    bool findCachedResult(const CardCommand& cmd, CommandResult& result) const;
+    
+    /**
+     * @brief Record a command's outcome in the result cache
+     * 
+     * Successful reads are cached; any other command starts a new idle gap
+     * and drops metadata, which it may have rewritten.
+     */
+    void updateResultCache(const CardCommand& cmd, const CommandResult& result);
+    
+    /**
+     * @brief Drop cached results if the card or its key changed
+     */
+    void checkResultCacheOwner();
+    
+    /**
+     * @brief Next prefetch command not yet cached or attempted in this gap
+     * @param markAttempted Record the returned command as attempted
+     */
+    std::unique_ptr<CardCommand> nextPrefetchCommand(bool markAttempted);
+    
+    /**
+     * @brief Execute one prefetch command (communication thread)
+     */
+    void runPrefetchStep();
+    
+    /**
+     * @brief Reorder m_queue with SessionPlanner (m_queueMutex held, communication thread)
+     */
+    void planQueue();
+    
+    /**
+     * @brief Move CommandSet, channel and backend to @p target (called on their current thread)
+     */
+    void moveCardObjects(QThread* target);
+    
+    /**
+     * @brief Leave the communication thread once its current slot has returned
+     * 
+     * Hands the card objects back (single-thread mode) and moves the manager
+     * to the thread init() was called on.
+     * @return false if the thread stayed busy past the stop timeout
+     */
+    bool leaveIoThread();
+    
+    /**
+     * @brief Connection type for calls into the CommandSet
+     * 
+     * Queued in split mode; direct when already on the I/O thread in single-thread mode.
+     */
+    Qt::ConnectionType commandSetConnection() const;
+    
     // Thread and queue management
-    CommunicationThread* m_commThread;
-    std::queue<std::unique_ptr<CardCommand>> m_queue;  // std::queue supports move-only types
-    mutable QMutex m_queueMutex;
+    std::shared_ptr<CommunicationExecutor> m_executor;
+    QThread* m_ioThread = nullptr;    // Acquired from m_executor by init()
+    QThread* m_homeThread = nullptr;  // Where stop() returns the manager
+    SessionPlanner::CommandQueue m_queue;  // std::deque supports move-only types
+    mutable InstrumentedMutex m_queueMutex{"CommunicationManager::m_queueMutex"};
+    
+    // Tap session planning (guarded by m_queueMutex)
+    bool m_planningEnabled = false;
+    bool m_queueChanged = false;  // Commands added since the last plan
+    SessionPlanner m_planner;
+    SessionPlan m_lastPlan;
     QWaitCondition m_queueNotEmpty;
     
     // Synchronous execution support
@@ -291,29 +542,44 @@ private:
     // Use shared_ptr to prevent dangling pointers
     // When executeCommandSync() returns, the PendingSync object remains valid
     // until the communication thread finishes accessing it
-    QHash<QUuid, std::shared_ptr<PendingSync>> m_pendingSync;
-    QMutex m_syncMutex;
+    // Keyed by CardCommand::id()
+    QHash<quint64, std::shared_ptr<PendingSync>> m_pendingSync;
+    InstrumentedMutex m_syncMutex{"CommunicationManager::m_syncMutex"};
+    QWaitCondition m_syncDrained;  // An entry was removed from m_pendingSync
     
     // State
     State m_state;
-    mutable QMutex m_stateMutex;
+    mutable InstrumentedMutex m_stateMutex{"CommunicationManager::m_stateMutex"};
     QString m_currentCardUID;
+    bool m_cardSequenceDone = false;  // initializeCardSequence() ran for the selected Keycard applet (communication thread)
     
     // Card components (accessed only from communication thread)
     // CommandSet owns channel, pairing storage, and password provider
     std::shared_ptr<CommandSet> m_commandSet;
-    
-    // Cached card info
-    ApplicationInfo m_appInfo;
-    ApplicationStatus m_appStatus;
-    mutable QMutex m_infoMutex;
+    ThreadOwnership m_ownership = ThreadOwnership::SplitThreads;
+    QThread* m_cardObjectsHomeThread = nullptr;  // Where stop() returns the card objects
+    
+    // Cached card info, published by the communication thread and read
+    // lock-free from any thread
+    struct CardSnapshot {
+        CompactApplicationInfo appInfo;
+        CompactApplicationStatus appStatus;
+    };
+    SeqLock<CardSnapshot> m_cardSnapshot;
     
     // Running flag
     bool m_running;
     
     // Batch operations flag - when true, don't stop detection on empty queue
     bool m_batchOperations;
-    QMutex m_batchMutex;
+    InstrumentedMutex m_batchMutex{"CommunicationManager::m_batchMutex"};
+    
+    // Speculative prefetch and reusable command results
+    PrefetchPolicy m_prefetchPolicy;
+    QHash<QString, CommandResult> m_prefetchCache;  // Keyed by CardCommand::resultCacheKey()
+    QSet<QString> m_prefetchAttempted;              // Tried during the current idle gap
+    QByteArray m_prefetchOwner;                     // instanceUID + keyUID the cache belongs to
+    mutable InstrumentedMutex m_prefetchMutex{"CommunicationManager::m_prefetchMutex"};
 };
 
 } // namespace Keycard
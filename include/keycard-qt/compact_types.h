@@ -0,0 +1,121 @@
+#pragma once
+
+#include "types.h"
+#include <QByteArray>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace Keycard {
+
+/**
+ * @brief Fixed-capacity inline byte buffer
+ *
+ * Trivially copyable replacement for short QByteArray fields: no heap
+ * allocation, no reference counting, and safe to publish through SeqLock.
+ *
+ * @tparam Capacity Maximum number of bytes (1..255)
+ */
+template <int Capacity>
+struct InlineBytes {
+    static_assert(Capacity > 0 && Capacity <= 255, "InlineBytes capacity must fit in uint8_t");
+
+    uint8_t bytes[Capacity] = {};
+    uint8_t length = 0;
+
+    static constexpr int capacity() { return Capacity; }
+    int size() const { return length; }
+    bool isEmpty() const { return length == 0; }
+
+    /**
+     * @brief Copy data into the buffer
+     * @return false if data was longer than Capacity (it is truncated)
+     */
+    bool assign(const QByteArray& data) {
+        int count = data.size() < Capacity ? data.size() : Capacity;
+        std::memcpy(bytes, data.constData(), static_cast<size_t>(count));
+        std::memset(bytes + count, 0, static_cast<size_t>(Capacity - count));
+        length = static_cast<uint8_t>(count);
+        return count == data.size();
+    }
+
+    /**
+     * @brief Deep copy as QByteArray
+     */
+    QByteArray toByteArray() const {
+        return QByteArray(reinterpret_cast<const char*>(bytes), length);
+    }
+
+    /**
+     * @brief Non-owning QByteArray view (valid while this object lives)
+     */
+    QByteArray view() const {
+        return QByteArray::fromRawData(reinterpret_cast<const char*>(bytes), length);
+    }
+
+    bool operator==(const InlineBytes& other) const {
+        return length == other.length && std::memcmp(bytes, other.bytes, length) == 0;
+    }
+    bool operator!=(const InlineBytes& other) const { return !(*this == other); }
+};
+
+/**
+ * @brief Trivially copyable layout of ApplicationInfo
+ *
+ * Field sizes match what the applet returns: 16-byte instance UID,
+ * 65-byte uncompressed secp256k1 public key and 32-byte key UID.
+ */
+struct CompactApplicationInfo {
+    InlineBytes<16> instanceUID;
+    InlineBytes<65> secureChannelPublicKey;
+    InlineBytes<32> keyUID;
+    uint8_t appVersion = 0;
+    uint8_t appVersionMinor = 0;
+    uint8_t availableSlots = 0;
+    uint8_t capabilities = static_cast<uint8_t>(Capability::All);
+    bool installed = false;
+    bool initialized = false;
+
+    static CompactApplicationInfo fromApplicationInfo(const ApplicationInfo& info);
+    ApplicationInfo toApplicationInfo() const;
+
+    bool hasCapability(Capability cap) const {
+        return (capabilities & static_cast<uint8_t>(cap)) != 0;
+    }
+};
+
+/**
+ * @brief Trivially copyable layout of ApplicationStatus
+ *
+ * currentPath holds up to 10 big-endian uint32 path components, the
+ * maximum derivation depth supported by the applet.
+ */
+struct CompactApplicationStatus {
+    InlineBytes<40> currentPath;
+    uint8_t pinRetryCount = 0;
+    uint8_t pukRetryCount = 0;
+    bool keyInitialized = false;
+    bool valid = false;
+
+    static CompactApplicationStatus fromApplicationStatus(const ApplicationStatus& status);
+    ApplicationStatus toApplicationStatus() const;
+};
+
+/**
+ * @brief Trivially copyable layout of PairingInfo
+ */
+struct CompactPairingInfo {
+    InlineBytes<32> key;
+    int32_t index = -1;
+
+    static CompactPairingInfo fromPairingInfo(const PairingInfo& pairing);
+    PairingInfo toPairingInfo() const;
+
+    bool isValid() const { return !key.isEmpty() && index >= 0; }
+};
+
+static_assert(std::is_trivially_copyable<CompactApplicationInfo>::value, "CompactApplicationInfo must be trivially copyable");
+static_assert(std::is_trivially_copyable<CompactApplicationStatus>::value, "CompactApplicationStatus must be trivially copyable");
+static_assert(std::is_trivially_copyable<CompactPairingInfo>::value, "CompactPairingInfo must be trivially copyable");
+
+} // namespace Keycard
@@ -0,0 +1,100 @@
+#pragma once
+
+#include "secure_channel.h"
+#include <QByteArray>
+#include <QHash>
+#include <QMutex>
+#include <QWaitCondition>
+#include <memory>
+
+namespace Keycard {
+
+/**
+ * @brief ECDH secrets derived ahead of time for recently seen cards
+ *
+ * A card's secure channel public key is stable for its applet instance, so
+ * the ephemeral key pair and shared secret for its next session can be
+ * computed before it is tapped again. CommandSet::select() takes the prepared
+ * secret when the card returns and starts deriving the following one in the
+ * background, keeping the EC scalar multiplications off the tap path.
+ *
+ * Entries are keyed by instance UID. Each prepared secret is handed out once,
+ * so no ephemeral key is used for two sessions. An entry whose card public
+ * key differs from the one the card now reports (re-installed applet) is
+ * dropped. At most capacity() cards are kept, least recently used first out.
+ *
+ * Pre-initialized cards have no instance UID yet; CommandSet files them under
+ * their public key, which is just as unique.
+ *
+ * Thread-safe. prepare() needs the cache to be owned by a std::shared_ptr.
+ */
+class EcdhSecretCache : public std::enable_shared_from_this<EcdhSecretCache> {
+public:
+    /**
+     * @param capacity Maximum number of cards kept
+     */
+    explicit EcdhSecretCache(int capacity = 8);
+
+    /**
+     * @brief Take the prepared secret for a card
+     * @param instanceUID Card instance UID (raw bytes)
+     * @param cardPublicKey Secure channel public key from the current SELECT
+     * @param secret Output: the prepared secret, now removed from the cache
+     * @param waitMs How long to wait for a derivation already in progress
+     * @return true on hit; false if unknown, still being derived or the key changed
+     */
+    bool take(const QByteArray& instanceUID, const QByteArray& cardPublicKey,
+              SecureChannel::EcdhSecret& secret, int waitMs = 0);
+
+    /**
+     * @brief Derive a secret for the card's next session on the global thread pool
+     * @param instanceUID Card instance UID (raw bytes)
+     * @param cardPublicKey Card's secure channel public key
+     *
+     * Does nothing if one is already prepared or being derived for this key.
+     */
+    void prepare(const QByteArray& instanceUID, const QByteArray& cardPublicKey);
+
+    /**
+     * @brief Is a secret ready to be taken for this card and key?
+     */
+    bool isPrepared(const QByteArray& instanceUID, const QByteArray& cardPublicKey) const;
+
+    /**
+     * @brief Drop the entry of a card
+     * @param instanceUID Card instance UID (raw bytes)
+     */
+    void invalidate(const QByteArray& instanceUID);
+
+    /**
+     * @brief Drop all entries
+     */
+    void clear();
+
+    /**
+     * @brief Number of cards with an entry (prepared or being derived)
+     */
+    int size() const;
+
+    int capacity() const { return m_capacity; }
+
+private:
+    struct Entry {
+        QByteArray cardPublicKey;
+        SecureChannel::EcdhSecret secret;  // Invalid while being derived or once taken
+        bool deriving = false;
+        quint64 lastUsed = 0;
+    };
+
+    void storeDerived(const QByteArray& instanceUID, const QByteArray& cardPublicKey,
+                      const SecureChannel::EcdhSecret& secret);
+    void evictLocked();
+
+    const int m_capacity;
+    QHash<QByteArray, Entry> m_entries;  // Keyed by instance UID
+    quint64 m_clock = 0;                 // Recency stamp for eviction
+    mutable QMutex m_mutex;
+    QWaitCondition m_derived;            // Woken when a derivation finishes
+};
+
+} // namespace Keycard
@@ -71,6 +71,16 @@ inline QByteArray KEYCARD_INSTANCE_AID(int instance = DEFAULT_INSTANCE_INDEX) {
     return aid;
 }
 
+// Cash Applet AID: A0 00 00 08 04 00 01 03 (8 bytes)
+inline QByteArray CASH_AID() {
+    return QByteArray::fromHex("A000000804000103");
+}
+
+// Cash Instance AID: A0 00 00 08 04 00 01 03 01 (9 bytes)
+inline QByteArray CASH_INSTANCE_AID() {
+    return QByteArray::fromHex("A00000080400010301");
+}
+
 // ISD (Issuer Security Domain / Card Manager) AID
 // Standard GlobalPlatform ISD AID used by most cards
 inline QByteArray ISD_AID() {
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QVector>
+#include <memory>
+#include <vector>
+
+namespace Keycard {
+
+/**
+ * @brief Contents of an IDENTIFY response
+ *
+ * Response layout: A0 { 8A certificate, 30 signature }. The 98-byte
+ * certificate is the card's compressed identity public key (33 bytes)
+ * followed by the CA signature over SHA-256 of that key (r || s || recovery
+ * id). The signature is a DER ECDSA signature by the identity key over the
+ * 32-byte challenge, used as the digest.
+ */
+struct IdentityCertificate {
+    QByteArray certificate;     ///< Raw 98-byte certificate
+    QByteArray cardPublicKey;   ///< 33 bytes, compressed
+    QByteArray caSignature;     ///< r || s (64 bytes), recovery id dropped
+    QByteArray signature;       ///< DER ECDSA signature over the challenge
+
+    bool isValid() const { return cardPublicKey.size() == 33 && caSignature.size() == 64 && !signature.isEmpty(); }
+
+    /**
+     * @brief Parse the data returned by CommandSet::identify()
+     * @return Parsed response, or invalid certificate on malformed input
+     */
+    static IdentityCertificate parse(const QByteArray& response);
+};
+
+/**
+ * @brief Verifies IDENTIFY responses against a set of trusted CA keys
+ *
+ * CA keys are parsed once when added. A card whose certificate was verified
+ * is remembered by instance UID: when it identifies again with the same
+ * certificate, only the challenge signature is checked. The signature over
+ * the fresh challenge is always verified, since that is what proves the card
+ * holds the identity key.
+ *
+ * verify() and verifyBatch() can be called from any thread. Adding CA keys
+ * is not synchronised with running verifications: configure them first.
+ *
+ * Requires OpenSSL; without it every verification returns Unavailable.
+ */
+class IdentityVerifier {
+public:
+    enum class Status {
+        Verified,
+        Malformed,              // Not an IDENTIFY response, or challenge is not 32 bytes
+        UntrustedCertificate,   // Certificate not signed by any configured CA
+        InvalidSignature,       // Challenge signature does not match the card key
+        Unavailable             // Built without OpenSSL
+    };
+
+    /**
+     * @brief One identification to verify
+     */
+    struct Request {
+        QByteArray instanceUID;     // From SELECT (ApplicationInfo::instanceUID), cache key
+        QByteArray challenge;       // 32 bytes sent with IDENTIFY
+        QByteArray response;        // CommandSet::identify() result
+    };
+
+    struct Result {
+        Status status = Status::Malformed;
+        QByteArray cardPublicKey;   // 33 bytes, compressed (Verified only)
+        int caIndex = -1;           // Index of the CA that signed the certificate
+        bool cached = false;        // Certificate check skipped: card seen before
+
+        bool isVerified() const { return status == Status::Verified; }
+    };
+
+    /**
+     * @brief Create a verifier
+     * @param caPublicKeys Trusted CA keys, 33 (compressed) or 65 bytes each
+     */
+    explicit IdentityVerifier(const QList<QByteArray>& caPublicKeys = QList<QByteArray>());
+    ~IdentityVerifier();
+
+    IdentityVerifier(const IdentityVerifier&) = delete;
+    IdentityVerifier& operator=(const IdentityVerifier&) = delete;
+
+    static bool isAvailable();
+
+    /**
+     * @brief Trust another CA key
+     * @return false if the key is not a valid secp256k1 point
+     */
+    bool addCaPublicKey(const QByteArray& publicKey);
+    int caKeyCount() const;
+
+    Result verify(const Request& request);
+
+    /**
+     * @brief Verify many identifications in parallel
+     * @param requests Identifications, typically from several cards
+     * @param threads Worker threads (0 = one per core)
+     * @return One result per request, in order
+     */
+    QVector<Result> verifyBatch(const QVector<Request>& requests, int threads = 0);
+
+    /**
+     * @brief Number of cards whose certificate is remembered
+     */
+    int cachedCount() const;
+    void clearCache();
+
+private:
+    struct CaKey;
+    struct CachedCard {
+        QByteArray certificate;
+        int caIndex = -1;
+    };
+
+    std::vector<std::unique_ptr<CaKey>> m_caKeys;
+    mutable QMutex m_cacheMutex;
+    QHash<QByteArray, CachedCard> m_cache;
+};
+
+} // namespace Keycard
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "keycard-qt/metrics.h"
+#include <QDeadlineTimer>
+#include <QMutex>
+#include <QWaitCondition>
+
+namespace Keycard {
+
+/**
+ * @brief Named mutex that reports contention through Metrics
+ *
+ * A drop-in for QMutex with QMutexLocker. In a build with
+ * KEYCARD_LOCK_METRICS=ON every acquisition records its wait time (when it
+ * had to wait), its hold time and whether it waited on the main thread,
+ * summed per lock name in Metrics::lockStats(). Otherwise lock() and unlock()
+ * are plain QMutex calls.
+ *
+ * Wait on a QWaitCondition through wait(), so the time spent waiting is not
+ * counted as holding the lock.
+ *
+ * @code
+ * InstrumentedMutex m_queueMutex{"CommunicationManager::queue"};
+ * QMutexLocker locker(&m_queueMutex);
+ * @endcode
+ */
+class InstrumentedMutex {
+public:
+    /**
+     * @param name Lock name in reports; must outlive the process (a literal)
+     */
+    explicit InstrumentedMutex(const char* name);
+
+    InstrumentedMutex(const InstrumentedMutex&) = delete;
+    InstrumentedMutex& operator=(const InstrumentedMutex&) = delete;
+
+    void lock() noexcept {
+#ifdef KEYCARD_QT_LOCK_METRICS
+        lockInstrumented();
+#else
+        m_mutex.lock();
+#endif
+    }
+
+    bool tryLock() noexcept {
+#ifdef KEYCARD_QT_LOCK_METRICS
+        if (!m_mutex.tryLock()) {
+            return false;
+        }
+        acquired(0, false);
+        return true;
+#else
+        return m_mutex.tryLock();
+#endif
+    }
+
+    void unlock() noexcept {
+#ifdef KEYCARD_QT_LOCK_METRICS
+        unlockInstrumented();
+#else
+        m_mutex.unlock();
+#endif
+    }
+
+    /**
+     * @brief QWaitCondition::wait() on this mutex, which must be locked
+     */
+    bool wait(QWaitCondition& condition, QDeadlineTimer deadline = QDeadlineTimer(QDeadlineTimer::Forever));
+
+    const char* name() const { return m_name; }
+
+private:
+    void lockInstrumented() noexcept;
+    void unlockInstrumented() noexcept;
+    void acquired(qint64 waitNs, bool contended) noexcept;
+
+    QMutex m_mutex;
+    const char* m_name;
+    Metrics::LockCounters* m_counters = nullptr;  // Instrumented builds only
+    qint64 m_lockedAtNs = 0;                      // Written by the holder
+};
+
+} // namespace Keycard
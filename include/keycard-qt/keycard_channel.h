@@ -2,9 +2,17 @@
 
 #include "channel_interface.h"
 #include "backends/keycard_channel_backend.h"  // For ChannelState enum
+#include "transport_timeout_policy.h"
 #include <QObject>
 #include <QString>
 #include <QByteArray>
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QTimer>
+#include <QWaitCondition>
+#include <atomic>
+#include <functional>
+#include <memory>
 
 namespace Keycard {
 
@@ -71,6 +79,38 @@ public:
      */
     explicit KeycardChannel(KeycardChannelBackend* backend, QObject* parent = nullptr);
     
+    /**
+     * @brief When the default platform backend is created
+     */
+    enum class BackendStartup {
+        Immediate,  ///< In the constructor, including PC/SC context setup and reader listing
+        Deferred    ///< On the first event loop pass; PC/SC then sets up on its detection thread
+    };
+    
+    /**
+     * @brief Create KeycardChannel with the default platform backend, possibly deferred
+     * @param startup BackendStartup::Deferred keeps backend startup off the
+     *        application's startup path
+     * @param parent QObject parent
+     * 
+     * Until backendReady() the channel records startDetection()/setState()
+     * calls and applies them to the backend once it exists; no card is
+     * detected, so CommunicationManager keeps submitted commands queued.
+     */
+    explicit KeycardChannel(BackendStartup startup, QObject* parent = nullptr);
+    
+    /**
+     * @brief Backend factory for deferred creation (takes ownership of the result)
+     */
+    using BackendFactory = std::function<KeycardChannelBackend*()>;
+    
+    /**
+     * @brief Create KeycardChannel whose backend is made by @p factory on the first event loop pass
+     * @param factory Called once, on the channel's thread
+     * @param parent QObject parent
+     */
+    explicit KeycardChannel(BackendFactory factory, QObject* parent = nullptr);
+    
     ~KeycardChannel() override;
     
     /**
@@ -130,6 +170,13 @@ public:
      */
     KeycardChannelBackend* backend() const { return m_backend; }
     
+    /**
+     * @brief Whether the backend exists and has finished its startup
+     * 
+     * Thread-safe. backendReady() is emitted when this becomes true.
+     */
+    bool isBackendReady() const { return m_backendReady.load(); }
+    
     /**
      * @brief Set the channel state for lifecycle management
      * @param state The desired channel state
@@ -151,9 +198,11 @@ public:
      * @param apdu APDU command bytes
      * @return APDU response bytes
      * @throws std::runtime_error if not connected or transmission fails
+     * @throws TransportTimeoutError if the exchange ran past its timeout
      * 
-     * This is a blocking call that waits for the card's response.
-     * Timeout is backend-specific (typically 5 seconds).
+     * This is a blocking call that waits for the card's response. The timeout
+     * comes from the timeout policy (see setTimeoutPolicy()); backends that
+     * cannot enforce it (PC/SC) rely on the reader driver's own timeout.
      */
     QByteArray transmit(const QByteArray& apdu) override;
     
@@ -163,6 +212,110 @@ public:
      */
     bool isConnected() const override;
 
+    /**
+     * @brief Snapshot of the presence latch counters
+     * 
+     * Taken before requesting detection so that waitForTarget() only
+     * accepts events that happened afterwards.
+     */
+    struct PresenceMark {
+        quint64 detections = 0;
+        quint64 errors = 0;
+    };
+
+    enum class WaitResult {
+        Detected,   // targetDetected() was emitted (or the card is connected)
+        Error,      // error() was emitted
+        Timeout
+    };
+
+    /**
+     * @brief Current presence latch counters
+     * 
+     * Thread-safe.
+     */
+    PresenceMark presenceMark() const;
+
+    /**
+     * @brief Whether a card is present according to the latch
+     * 
+     * Set after targetDetected() and cleared after targetLost(). Thread-safe.
+     */
+    bool isTargetPresent() const;
+
+    /**
+     * @brief Block until a card is detected, an error occurs or @p timeoutMs elapses
+     * @param since Mark taken before detection was requested
+     * @param timeoutMs Timeout in milliseconds
+     * @return Which event ended the wait
+     * 
+     * Does not run an event loop. When called on the channel's own thread,
+     * only the channel's queued backend events are delivered while waiting,
+     * so targetDetected() is still emitted on this thread before returning.
+     * That requires the backend to signal from another thread; check
+     * canWaitForTarget() first.
+     */
+    WaitResult waitForTarget(const PresenceMark& since, int timeoutMs);
+
+    /**
+     * @brief Whether waitForTarget() can be woken from the calling thread
+     * @return true off the channel's thread, or if the backend detects off-thread
+     */
+    bool canWaitForTarget() const;
+
+    /**
+     * @brief Presence debouncing for flapping contacts and NFC links
+     * 
+     * Marginal coupling produces bursts of removals and detections a few
+     * milliseconds apart, each of which would reset the secure channel and
+     * re-initialize the card. With all delays at 0 (the default) backend
+     * events are passed through unchanged.
+     */
+    struct DebounceConfig {
+        int lossGraceMs = 0;      ///< Hold targetLost() this long; cancelled if the same card returns
+        int settleMs = 0;         ///< Same card back soon after a loss: report it once present this long
+        int flapWindowMs = 1000;  ///< How soon after a loss a return of the same card is a flap
+    };
+
+    /**
+     * @brief Check on the card whether its session survived a flap
+     * @return true if the card still holds the session (no re-initialization needed)
+     */
+    using SessionProbe = std::function<bool()>;
+
+    void setDebounceConfig(const DebounceConfig& config);
+    DebounceConfig debounceConfig() const { return m_debounce; }
+
+    /**
+     * @brief Set the probe used when the same card returns within the loss grace period
+     * 
+     * Called on the channel's thread. If it returns true the flap is not
+     * reported at all (counted in the "presence.reinit_suppressed" metric);
+     * otherwise, or without a probe, it is reported as a single
+     * targetLost()/targetDetected() pair. CommandSet installs one.
+     */
+    void setSessionProbe(SessionProbe probe);
+
+    /**
+     * @brief Replace the per-instruction transport timeout policy
+     * 
+     * Each channel starts with its own in-memory policy; pass one constructed
+     * with a file path to keep what was learned across runs, or share one
+     * between channels. Thread-safe.
+     * 
+     * @param policy Policy instance (null = the backend's own timeout, no learning)
+     */
+    void setTimeoutPolicy(std::shared_ptr<TransportTimeoutPolicy> policy);
+    std::shared_ptr<TransportTimeoutPolicy> timeoutPolicy() const;
+
+    /**
+     * @brief Set the model of the card in the reader, keying learned latencies
+     * 
+     * Called by CommandSet::select(); reset to
+     * TransportTimeoutPolicy::UNKNOWN_MODEL when the card is lost.
+     */
+    void setCardModel(quint8 appVersion, quint8 appVersionMinor);
+
     
 signals:
     /**
@@ -175,6 +328,14 @@ signals:
      */
     void readerAvailabilityChanged(bool available);
 
+    /**
+     * @brief Emitted once the backend is created and has finished its startup
+     * 
+     * May already have happened in the constructor (BackendStartup::Immediate
+     * or an injected backend): check isBackendReady() after connecting.
+     */
+    void backendReady();
+
     /**
      * @brief Emitted when a Keycard is detected and ready for communication
      * @param uid Unique identifier of the detected card (hex string)
@@ -215,9 +376,40 @@ private:
      * @return Newly created backend instance
      * 
      * Factory method that creates the appropriate backend based on platform.
-     * Called by the default constructor.
+     * @param backgroundStartup Let the backend do its slow startup on its own
+     *        thread (PC/SC); others ignore it
+     */
+    KeycardChannelBackend* createDefaultBackend(bool backgroundStartup = false);
+
+    /**
+     * @brief Create the backend with m_backendFactory (deferred construction)
+     * 
+     * Queued by the deferring constructors; runs earlier if waitForTarget()
+     * blocks the channel's thread first.
+     */
+    void createPendingBackend();
+
+    /**
+     * @brief Connect backend signals, the presence latch and readiness
      */
-    KeycardChannelBackend* createDefaultBackend();
+    void connectBackend();
+
+    void onBackendReady();
+
+    /**
+     * @brief Connect the presence latch and the debouncer timers
+     */
+    void connectPresenceLatch();
+
+    // Backend presence events, filtered by the debouncer (see DebounceConfig)
+    void onBackendTargetDetected(const QString& uid);
+    void onBackendCardRemoved();
+    void onSettled();
+
+    // Report presence changes: emit the signal, then update the latch
+    void commitTargetDetected(const QString& uid);
+    void commitTargetLost();
+    void latchDetection();
     
     /**
      * @brief Backend instance selected at compile time or injected
@@ -231,6 +423,35 @@ private:
     
     QString m_targetUid;  // Cached UID for quick access
     bool m_ownsBackend;    // true if we created the backend, false if injected
+
+    // Deferred backend construction (see BackendStartup)
+    BackendFactory m_backendFactory;  // Set until the backend is created
+    std::atomic_bool m_backendReady{false};
+    bool m_detectionRequested = false;          // startDetection() before the backend existed
+    bool m_stateRequested = false;              // setState() before the backend existed
+    ChannelState m_requestedState = ChannelState::Idle;
+
+    // Presence latch (see waitForTarget())
+    mutable QMutex m_presenceMutex;
+    QWaitCondition m_presenceChanged;
+    bool m_targetPresent = false;
+    quint64 m_detections = 0;     // targetDetected() emitted
+    quint64 m_errors = 0;         // error() emitted
+    quint64 m_backendEvents = 0;  // Raw backend signals, from any thread
+
+    // Presence debouncer (channel thread only)
+    DebounceConfig m_debounce;
+    SessionProbe m_sessionProbe;
+    QTimer m_lossTimer;           // Running: loss reported by the backend, not yet by us
+    QTimer m_settleTimer;         // Running: m_settlingUid is back, not yet reported
+    QString m_settlingUid;
+    QString m_lastLostUid;
+    QElapsedTimer m_sinceLoss;    // Since the last reported loss
+
+    // Transport timeouts (see setTimeoutPolicy())
+    mutable QMutex m_timeoutPolicyMutex;
+    std::shared_ptr<TransportTimeoutPolicy> m_timeoutPolicy = std::make_shared<TransportTimeoutPolicy>();
+    std::atomic<quint16> m_cardModel{TransportTimeoutPolicy::UNKNOWN_MODEL};
 };
 
 } // namespace Keycard
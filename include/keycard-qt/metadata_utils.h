@@ -1,9 +1,14 @@
 #pragma once
 
 #include <QByteArray>
+#include <QMetaType>
 #include <QString>
 #include <QStringList>
+#include <QVector>
 #include <cstdint>
+#include <iterator>
+
+#include "types.h"
 
 namespace Keycard {
 namespace MetadataEncoding {
@@ -38,9 +43,241 @@ void writeLEB128(QByteArray& buffer, uint32_t value);
  */
 uint32_t readLEB128(const QByteArray& data, int& offset);
 
+/**
+ * @brief Run of consecutive wallet path indexes
+ *
+ * Mirrors one LEB128 start/count pair of the wire format: the range covers
+ * start..start+count (inclusive), so a single path is encoded with count 0.
+ */
+struct PathRange {
+    uint32_t start = 0;  ///< First path index in the range
+    uint32_t count = 0;  ///< Number of consecutive indexes after start
+
+    /** @brief Last path index covered by the range */
+    uint64_t last() const { return static_cast<uint64_t>(start) + count; }
+    /** @brief Check whether the range covers an index */
+    bool contains(uint32_t index) const { return index >= start && index <= last(); }
+
+    bool operator==(const PathRange& other) const {
+        return start == other.start && count == other.count;
+    }
+    bool operator!=(const PathRange& other) const { return !(*this == other); }
+};
+
+/**
+ * @brief Lazy view over the LEB128-encoded wallet path ranges of a metadata blob
+ *
+ * Nothing is expanded up front: ranges are decoded on demand while iterating,
+ * and iterating the view itself yields individual path indexes (the last
+ * component of "m/44'/60'/0'/0/<index>") in on-card order.
+ *
+ * The view only holds an implicitly shared copy of the encoded bytes, so it is
+ * cheap to copy and to keep around.
+ */
+class WalletPaths {
+public:
+    /**
+     * @brief Forward iterator over the start/count pairs
+     *
+     * Shares the view's encoded bytes, so it stays valid after the view it
+     * came from is gone. Iterators compare equal when they point into the
+     * same bytes at the same pair, or are both at the end.
+     */
+    class RangeIterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = PathRange;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const PathRange*;
+        using reference = const PathRange&;
+
+        RangeIterator() = default;
+        RangeIterator(const QByteArray& data, int offset);
+
+        reference operator*() const { return m_current; }
+        pointer operator->() const { return &m_current; }
+        RangeIterator& operator++();
+        RangeIterator operator++(int) { RangeIterator tmp = *this; ++*this; return tmp; }
+
+        bool operator==(const RangeIterator& other) const {
+            return m_offset == other.m_offset && m_data.constData() == other.m_data.constData();
+        }
+        bool operator!=(const RangeIterator& other) const { return !(*this == other); }
+
+    private:
+        void load();
+
+        QByteArray m_data;       ///< Shared with the view, released at end
+        int m_offset = -1;       ///< Offset of the current pair, -1 at end
+        int m_next = -1;         ///< Offset of the following pair
+        PathRange m_current;
+    };
+
+    /**
+     * @brief Forward iterator over individual path indexes
+     */
+    class const_iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = uint32_t;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const uint32_t*;
+        using reference = uint32_t;
+
+        const_iterator() = default;
+        explicit const_iterator(RangeIterator range);
+
+        uint32_t operator*() const { return m_range->start + m_step; }
+        const_iterator& operator++();
+        const_iterator operator++(int) { const_iterator tmp = *this; ++*this; return tmp; }
+
+        bool operator==(const const_iterator& other) const {
+            return m_range == other.m_range && m_step == other.m_step;
+        }
+        bool operator!=(const const_iterator& other) const { return !(*this == other); }
+
+    private:
+        RangeIterator m_range;
+        uint32_t m_step = 0;
+    };
+
+    /** A view with no paths */
+    WalletPaths() = default;
+
+    /**
+     * @brief Wrap already validated LEB128 start/count pairs
+     * @param encodedRanges Bytes following the name in the metadata blob
+     */
+    explicit WalletPaths(const QByteArray& encodedRanges);
+
+    const_iterator begin() const;
+    const_iterator end() const;
+
+    /** @brief Iterate over start/count pairs instead of single indexes */
+    RangeIterator rangesBegin() const;
+    RangeIterator rangesEnd() const;
+
+    /** @brief True when no path is stored */
+    bool isEmpty() const { return m_data.isEmpty(); }
+
+    /**
+     * @brief Number of path indexes (O(ranges), no expansion)
+     */
+    uint64_t size() const;
+
+    /**
+     * @brief Number of start/count pairs
+     */
+    int rangeCount() const;
+
+    /**
+     * @brief Check whether an index is stored (O(ranges), no expansion)
+     */
+    bool contains(uint32_t index) const;
+
+    /**
+     * @brief Decode all ranges into a vector
+     */
+    QVector<PathRange> ranges() const;
+
+    /**
+     * @brief Expand into full derivation path strings ("m/44'/60'/0'/0/<index>")
+     *
+     * This materialises every path; prefer iterating the view when possible.
+     */
+    QStringList toStringList() const;
+
+    /**
+     * @brief Raw LEB128 start/count pairs
+     */
+    QByteArray encoded() const { return m_data; }
+
+private:
+    QByteArray m_data;
+};
+
+/**
+ * @brief Typed result of decoding a metadata blob
+ */
+struct WalletMetadata {
+    uint8_t version = 1;   ///< Format version (top 3 bits of the header byte)
+    QString name;          ///< Card name
+    WalletPaths paths;     ///< Lazy view over stored wallet paths
+
+    /**
+     * @brief Expand into the legacy Metadata structure (materialises every path)
+     */
+    Metadata toMetadata() const;
+};
+
+/**
+ * @brief Decode metadata as returned by GET DATA
+ *
+ * Validates the header, name length and every LEB128 pair in a single pass,
+ * but does not expand path ranges.
+ *
+ * @param data Encoded metadata
+ * @param result Output: decoded metadata
+ * @param errorMsg Output: error message if decoding fails
+ * @return true on success
+ */
+bool decode(const QByteArray& data, WalletMetadata& result, QString& errorMsg);
+
+/**
+ * @brief Encode metadata from already grouped ranges
+ *
+ * Ranges must be sorted and non-overlapping (as produced by decode/addPaths/removePaths).
+ *
+ * @param name Card name (max 20 bytes)
+ * @param ranges Start/count pairs
+ * @param errorMsg Output: error message if encoding fails
+ * @return Encoded metadata, or empty QByteArray on error
+ */
+QByteArray encodeRanges(const QString& name, const QVector<PathRange>& ranges, QString& errorMsg);
+
+/**
+ * @brief Add wallet paths to an encoded metadata blob
+ *
+ * New indexes are grouped into ranges and merged with the stored ones in a
+ * single linear pass over both range lists; stored ranges are never expanded.
+ * Indexes that are already present are ignored.
+ *
+ * @param metadata Encoded metadata (empty blob = no name, no paths)
+ * @param paths Wallet paths to add (must start with "m/44'/60'/0'/0/")
+ * @param errorMsg Output: error message on failure
+ * @return Re-encoded metadata, or empty QByteArray on error
+ */
+QByteArray addPaths(const QByteArray& metadata, const QStringList& paths, QString& errorMsg);
+
+/**
+ * @brief Remove wallet paths from an encoded metadata blob
+ *
+ * Ranges are split where needed; indexes that are not present are ignored.
+ *
+ * @param metadata Encoded metadata
+ * @param paths Wallet paths to remove (must start with "m/44'/60'/0'/0/")
+ * @param errorMsg Output: error message on failure
+ * @return Re-encoded metadata, or empty QByteArray on error
+ */
+QByteArray removePaths(const QByteArray& metadata, const QStringList& paths, QString& errorMsg);
+
+/**
+ * @brief Merge two sorted, non-overlapping range lists
+ * @return Sorted union with adjacent ranges coalesced
+ */
+QVector<PathRange> mergeRanges(const QVector<PathRange>& a, const QVector<PathRange>& b);
+
+/**
+ * @brief Subtract one sorted range list from another
+ * @return Sorted ranges covering indexes in @p from that are not in @p remove
+ */
+QVector<PathRange> subtractRanges(const QVector<PathRange>& from, const QVector<PathRange>& remove);
+
 } // namespace MetadataEncoding
 } // namespace Keycard
 
+Q_DECLARE_METATYPE(Keycard::MetadataEncoding::WalletMetadata)
+
 
 
 
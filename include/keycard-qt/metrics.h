@@ -0,0 +1,86 @@
+#pragma once
+
+#include <QMap>
+#include <QString>
+#include <QVector>
+#include <QtGlobal>
+#include <atomic>
+
+namespace Keycard {
+
+/**
+ * @brief Process-wide diagnostics: event counters and lock statistics
+ *
+ * Counters are cheap named totals for rare events (recoveries, suppressed
+ * reconnects...), always available. Lock statistics are collected by
+ * InstrumentedMutex only when the library is built with
+ * KEYCARD_LOCK_METRICS=ON; otherwise lockStats() is empty.
+ *
+ * All functions are thread-safe.
+ */
+class Metrics {
+public:
+    /**
+     * @brief Statistics of one named lock, summed over all its instances
+     */
+    struct LockStats {
+        QString name;
+        quint64 acquisitions = 0;
+        quint64 contended = 0;          ///< Acquisitions that had to wait
+        qint64 totalWaitNs = 0;
+        qint64 maxWaitNs = 0;
+        qint64 totalHoldNs = 0;
+        qint64 maxHoldNs = 0;
+        quint64 mainThreadContended = 0;  ///< Waits on the application's main (UI) thread
+        qint64 mainThreadWaitNs = 0;
+    };
+
+    /**
+     * @brief Add to a named counter
+     */
+    static void increment(const QString& name, quint64 amount = 1);
+
+    /**
+     * @brief Current value of a counter (0 if never incremented)
+     */
+    static quint64 counter(const QString& name);
+
+    static QMap<QString, quint64> counters();
+
+    /**
+     * @brief Was the library built with lock instrumentation?
+     */
+    static bool lockMetricsEnabled();
+
+    /**
+     * @brief Statistics of every instrumented lock, most total wait first
+     */
+    static QVector<LockStats> lockStats();
+
+    /**
+     * @brief Zero all counters and lock statistics
+     */
+    static void reset();
+
+    /**
+     * @brief Live statistics of one lock name (used by InstrumentedMutex)
+     */
+    struct LockCounters {
+        const char* name = nullptr;
+        std::atomic<quint64> acquisitions{0};
+        std::atomic<quint64> contended{0};
+        std::atomic<qint64> totalWaitNs{0};
+        std::atomic<qint64> maxWaitNs{0};
+        std::atomic<qint64> totalHoldNs{0};
+        std::atomic<qint64> maxHoldNs{0};
+        std::atomic<quint64> mainThreadContended{0};
+        std::atomic<qint64> mainThreadWaitNs{0};
+    };
+
+    /**
+     * @brief Counters for a lock name; the pointer stays valid for the process lifetime
+     */
+    static LockCounters* lockCounters(const char* name);
+};
+
+} // namespace Keycard
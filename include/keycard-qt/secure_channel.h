@@ -5,11 +5,23 @@
 #include "apdu/response.h"
 #include <QByteArray>
 #include <QSharedPointer>
-#include <QMutex>
+#include "instrumented_mutex.h"
+#include <stdexcept>
 
 
 namespace Keycard {
 
+/**
+ * @brief Thrown by SecureChannel::send() when a response fails MAC verification
+ *
+ * The card processed the command but host and card no longer agree on the
+ * session IV: the channel must be re-opened before it can be used again.
+ */
+class SecureChannelMacError : public std::runtime_error {
+public:
+    SecureChannelMacError() : std::runtime_error("Response MAC verification failed") {}
+};
+
 /**
  * @brief Secure channel for encrypted communication with keycard
  * 
@@ -29,6 +41,20 @@ public:
     
     ~SecureChannel();
     
+    /**
+     * @brief Result of one ECDH exchange with a card key
+     * 
+     * Only the shared secret and our ephemeral public key are needed to open
+     * the channel; the ephemeral private key is discarded after derivation.
+     */
+    struct EcdhSecret {
+        QByteArray cardPublicKey;  ///< Card key the secret was derived with
+        QByteArray publicKey;      ///< Our ephemeral public key (65 bytes, uncompressed)
+        QByteArray secret;         ///< ECDH shared secret
+        
+        bool isValid() const { return !secret.isEmpty(); }
+    };
+    
     /**
      * @brief Generate ephemeral ECDH key pair and compute shared secret
      * @param cardPublicKey Card's public key (65 bytes, uncompressed)
@@ -36,6 +62,21 @@ public:
      */
     bool generateSecret(const QByteArray& cardPublicKey);
     
+    /**
+     * @brief Generate an ephemeral key pair and derive the secret without touching any channel
+     * @param cardPublicKey Card's public key (65 bytes, uncompressed)
+     * @return The exchange, invalid on failure
+     * 
+     * Thread-safe: lets the EC work run ahead of time (see EcdhSecretCache).
+     */
+    static EcdhSecret deriveSecret(const QByteArray& cardPublicKey);
+    
+    /**
+     * @brief Use a secret from deriveSecret() as if generateSecret() had computed it
+     * @param secret A valid exchange; each one must be used for one session only
+     */
+    void adoptSecret(const EcdhSecret& secret);
+    
     /**
      * @brief Initialize session keys
      * @param iv Initialization vector
@@ -64,9 +105,12 @@ public:
     /**
      * @brief Send a command through the secure channel
      * @param command APDU command (will be encrypted)
+     * @param plain Optional output: true if the card answered outside the
+     *        secure channel (a bare status word, not encrypted), as it does
+     *        after dropping its session
      * @return APDU response (decrypted)
      */
-    APDU::Response send(const APDU::Command& command);
+    APDU::Response send(const APDU::Command& command, bool* plain = nullptr);
     
     /**
      * @brief Encrypt data using AES-CBC
@@ -103,7 +147,7 @@ private:
     // Critical because IV is updated after each send() and multiple threads
     // may call CommandSet methods simultaneously (e.g. getStatus from UI thread
     // while authorize runs on worker thread)
-    mutable QMutex m_secureMutex;
+    mutable InstrumentedMutex m_secureMutex{"SecureChannel::m_secureMutex"};
     
     // Helper methods
     QByteArray calculateMAC(const QByteArray& meta, const QByteArray& data);
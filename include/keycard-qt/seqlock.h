@@ -0,0 +1,103 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace Keycard {
+
+/**
+ * @brief Sequence lock for publishing small trivially copyable snapshots
+ *
+ * Readers never block and never allocate: they copy the value and retry if a
+ * write raced with the copy. Writers are serialized among themselves through
+ * the sequence counter, so store() may be called from any thread, but the
+ * design assumes writes are rare compared to reads (e.g. once per card command
+ * vs. every UI repaint).
+ *
+ * The payload is kept in relaxed atomic words rather than a plain T so that
+ * concurrent reads and writes are well defined under the C++ memory model.
+ *
+ * @tparam T Trivially copyable, default constructible value type
+ */
+template <typename T>
+class SeqLock {
+    static_assert(std::is_trivially_copyable<T>::value, "SeqLock requires a trivially copyable type");
+    static_assert(std::is_default_constructible<T>::value, "SeqLock requires a default constructible type");
+
+public:
+    SeqLock() { writeWords(T()); }
+    explicit SeqLock(const T& value) { writeWords(value); }
+
+    SeqLock(const SeqLock&) = delete;
+    SeqLock& operator=(const SeqLock&) = delete;
+
+    /**
+     * @brief Publish a new value
+     */
+    void store(const T& value) {
+        // Take the writer slot: move the sequence from even to odd
+        uint64_t seq = m_sequence.load(std::memory_order_relaxed);
+        for (;;) {
+            if (seq & 1) {
+                seq = m_sequence.load(std::memory_order_relaxed);
+                continue;
+            }
+            if (m_sequence.compare_exchange_weak(seq, seq + 1,
+                                                 std::memory_order_acquire,
+                                                 std::memory_order_relaxed)) {
+                break;
+            }
+        }
+        std::atomic_thread_fence(std::memory_order_release);
+
+        writeWords(value);
+
+        m_sequence.store(seq + 2, std::memory_order_release);
+    }
+
+    /**
+     * @brief Read a consistent copy of the latest value (lock-free)
+     */
+    T load() const {
+        Words words;
+        uint64_t before;
+        uint64_t after;
+        do {
+            before = m_sequence.load(std::memory_order_acquire);
+            for (size_t i = 0; i < WordCount; ++i) {
+                words[i] = m_words[i].load(std::memory_order_relaxed);
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            after = m_sequence.load(std::memory_order_relaxed);
+        } while ((before & 1) || before != after);
+
+        T value;
+        std::memcpy(static_cast<void*>(&value), words.data(), sizeof(T));
+        return value;
+    }
+
+    /**
+     * @brief Number of completed store() calls (useful to detect changes cheaply)
+     */
+    uint64_t version() const { return m_sequence.load(std::memory_order_acquire) / 2; }
+
+private:
+    static constexpr size_t WordCount = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+    using Words = std::array<uint64_t, WordCount>;
+
+    void writeWords(const T& value) {
+        Words words{};
+        std::memcpy(words.data(), &value, sizeof(T));
+        for (size_t i = 0; i < WordCount; ++i) {
+            m_words[i].store(words[i], std::memory_order_relaxed);
+        }
+    }
+
+    std::atomic<uint64_t> m_sequence{0};
+    std::array<std::atomic<uint64_t>, WordCount> m_words{};
+};
+
+} // namespace Keycard
@@ -0,0 +1,116 @@
+#pragma once
+
+#include "card_command.h"
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+#include <deque>
+#include <memory>
+#include <vector>
+
+namespace Keycard {
+
+/**
+ * @brief On-card BIP32 derivation work for a sequence of commands
+ */
+struct DerivationCost {
+    int derivations = 0;     // Commands that derive a key
+    int hardenedSteps = 0;   // Hardened child derivations
+    int normalSteps = 0;     // Non-hardened child derivations
+
+    int steps() const { return hardenedSteps + normalSteps; }
+};
+
+/**
+ * @brief Outcome of planning the pending commands of a tap session
+ */
+struct SessionPlan {
+    int commandCount = 0;           // Commands in the queue after planning
+    int movedCommands = 0;          // Commands no longer at their FIFO position
+    int insertedDerivations = 0;    // DERIVE KEY commands added by the planner
+    DerivationCost fifoCost;        // Expected cost in submission order
+    DerivationCost plannedCost;     // Expected cost of the planned order
+
+    bool isChanged() const { return movedCommands > 0 || insertedDerivations > 0; }
+};
+
+/**
+ * @brief Reorders pending path-based commands to minimise on-card derivations
+ *
+ * The card derives every absolute path from the master key unless the current
+ * key is a prefix of it (CommandSet then sends only the remaining segments).
+ * Within one tap the planner:
+ * - groups commands sharing a parent so the walk over the BIP32 tree is
+ *   depth-first,
+ * - places free commands after the makeCurrent command whose key they
+ *   extend,
+ * - optionally inserts a DERIVE KEY to a shared parent so its children are
+ *   derived with one step each.
+ *
+ * Only runs of commands with absolute paths are reordered. Commands that use
+ * the current key, relative paths, pathless commands and commands pinned with
+ * CardCommand::setKeepOrder() are barriers: nothing moves across them.
+ * makeCurrent commands keep their relative order, so the card's current key
+ * after each run is the same as in FIFO order. A parent derivation is only
+ * inserted after the last makeCurrent command of a run when
+ * Options::allowCurrentPathChange is set.
+ *
+ * A plan that is not cheaper than FIFO order is discarded.
+ */
+class SessionPlanner {
+public:
+    using KeyPath = QVector<uint32_t>;
+    using CommandQueue = std::deque<std::unique_ptr<CardCommand>>;
+
+    struct Options {
+        // Allow leaving the card on a different current key than FIFO order would
+        bool allowCurrentPathChange = false;
+    };
+
+    SessionPlanner();
+    explicit SessionPlanner(const Options& options);
+
+    /**
+     * @brief Reorder @p queue in place
+     * @param queue Pending commands, front runs first
+     * @param currentPath Card's current key path at the front of the queue
+     * @param currentPathKnown False if the current key path is unknown
+     * @return Plan summary including FIFO and planned cost
+     */
+    SessionPlan plan(CommandQueue& queue, const KeyPath& currentPath, bool currentPathKnown) const;
+
+    /**
+     * @brief Expected derivation cost of running @p queue in its current order
+     *
+     * Mirrors CommandSet: the current key is tracked through makeCurrent
+     * commands and becomes unknown after any barrier.
+     */
+    static DerivationCost estimate(const CommandQueue& queue, const KeyPath& currentPath, bool currentPathKnown);
+
+    /**
+     * @brief Parse an absolute path ("m/44'/60'/0'/0/0")
+     * @return false for relative or malformed paths
+     */
+    static bool parsePath(const QString& path, KeyPath& out);
+
+    /**
+     * @brief Format a path as "m/44'/60'/0'/0"
+     */
+    static QString formatPath(const KeyPath& path);
+
+    /**
+     * @brief Decode 4-byte big-endian path components (CommandSet::currentKeyPath())
+     */
+    static KeyPath decodePath(const QByteArray& encoded);
+
+private:
+    struct Item;
+
+    void planRun(std::vector<Item>& run, const KeyPath& startPath, bool startKnown,
+                 std::vector<CardCommand*>& out,
+                 std::vector<std::unique_ptr<CardCommand>>& inserted) const;
+
+    Options m_options;
+};
+
+} // namespace Keycard
@@ -0,0 +1,164 @@
+#pragma once
+
+#include <QHash>
+#include <QMutex>
+#include <QString>
+#include <array>
+#include <stdexcept>
+
+namespace Keycard {
+
+/**
+ * @brief Thrown by KeycardChannel::transmit() when an exchange ran past its timeout
+ *
+ * Unlike other transport failures, the card may have executed the command.
+ * SecureChannel closes its session, and CommandSet rethrows it (so
+ * CommunicationManager re-queues the command and restarts detection) only
+ * for commands that are safe to run twice; others fail with SW 0x6985.
+ */
+class TransportTimeoutError : public std::runtime_error {
+public:
+    using std::runtime_error::runtime_error;
+};
+
+/**
+ * @brief Per-instruction transport timeouts learned from observed latency
+ *
+ * KeycardChannel reports how long every APDU exchange took, keyed by card
+ * model (applet version from SELECT) and INS byte. Once an instruction has
+ * enough samples, its timeout is a high percentile of the recorded latencies
+ * times a safety margin, so a hung exchange is abandoned after a few times
+ * the card's usual response time rather than after minutes.
+ *
+ * Until then the cold timeout applies. Slow operations (INIT, LOAD KEY, key
+ * generation, factory reset) never go below their floor however fast the
+ * card was before. Each timeout doubles the next one for that instruction,
+ * up to the maximum, until an exchange succeeds again.
+ *
+ * Latencies are kept in log-scale histograms (25% per bucket) that are halved
+ * once they hold AGING_SAMPLES samples, so older observations fade out.
+ *
+ * When constructed with a file path, the histograms are loaded on
+ * construction and written back by save(), which KeycardChannel calls when
+ * a card is lost, and on destruction. record() never touches the file.
+ *
+ * Thread-safe: all methods can be called from any thread.
+ */
+class TransportTimeoutPolicy {
+public:
+    /**
+     * @brief Card model used before SELECT has identified the card
+     */
+    static constexpr quint16 UNKNOWN_MODEL = 0;
+
+    static constexpr int BUCKET_COUNT = 56;     ///< 1 ms to ~3.5 min, 25% apart
+    static constexpr quint32 AGING_SAMPLES = 1024;
+
+    /**
+     * @brief Floors for the Keycard instructions that do heavy work on the card
+     */
+    static QHash<quint8, int> defaultFloors();
+
+    struct Options {
+        double percentile = 0.99;     ///< Latency percentile the timeout is based on
+        double margin = 3.0;          ///< Multiplier applied to the percentile
+        quint32 minSamples = 16;      ///< Samples needed before the learned value is used
+        int coldTimeoutMs = 30000;    ///< Timeout while an instruction has too few samples
+        int minimumMs = 1000;         ///< Lower bound for every instruction
+        int maximumMs = 120000;       ///< Upper bound, including after repeated timeouts
+        QHash<quint8, int> floorsMs = defaultFloors();  ///< Per-INS lower bounds
+    };
+
+    /**
+     * @brief Card model key for an applet version
+     */
+    static quint16 cardModel(quint8 appVersion, quint8 appVersionMinor) {
+        return static_cast<quint16>((appVersion << 8) | appVersionMinor);
+    }
+
+    /**
+     * @brief Create a policy
+     * @param filePath Persistence file (empty = in-memory only)
+     */
+    explicit TransportTimeoutPolicy(const QString& filePath = QString());
+    explicit TransportTimeoutPolicy(const Options& options, const QString& filePath = QString());
+    ~TransportTimeoutPolicy();
+
+    TransportTimeoutPolicy(const TransportTimeoutPolicy&) = delete;
+    TransportTimeoutPolicy& operator=(const TransportTimeoutPolicy&) = delete;
+
+    /**
+     * @brief Timeout for the next exchange of an instruction
+     * @param model cardModel() of the card, or UNKNOWN_MODEL
+     * @param ins INS byte of the command APDU
+     * @return Timeout in milliseconds
+     */
+    int timeoutFor(quint16 model, quint8 ins) const;
+
+    /**
+     * @brief Record a completed exchange
+     * @param model cardModel() of the card, or UNKNOWN_MODEL
+     * @param ins INS byte of the command APDU
+     * @param elapsedMs Time from sending the command to receiving the response
+     */
+    void record(quint16 model, quint8 ins, qint64 elapsedMs);
+
+    /**
+     * @brief Record an exchange abandoned at its timeout
+     *
+     * Doubles the instruction's next timeout (up to the maximum) and counts
+     * the "transport.timeouts" metric.
+     */
+    void recordTimeout(quint16 model, quint8 ins);
+
+    /**
+     * @brief Number of samples currently held for an instruction (after aging)
+     */
+    quint32 sampleCount(quint16 model, quint8 ins) const;
+
+    /**
+     * @brief Drop all learned latencies
+     */
+    void clear();
+
+    /**
+     * @brief Write the histograms to the persistence file if samples were recorded since the last write
+     *
+     * The file is written outside the lock record() takes.
+     *
+     * @return true on success or if in-memory only
+     */
+    bool save();
+
+    Options options() const;
+    void setOptions(const Options& options);
+
+    /**
+     * @brief Persistence file (empty if in-memory only)
+     */
+    QString filePath() const { return m_filePath; }
+
+private:
+    struct Histogram {
+        std::array<quint32, BUCKET_COUNT> counts{};
+        quint32 total = 0;
+        int consecutiveTimeouts = 0;  // Not persisted
+    };
+
+    static quint32 key(quint16 model, quint8 ins) { return (quint32(model) << 8) | ins; }
+    static int bucketOf(qint64 elapsedMs);
+    static int bucketUpperBoundMs(int bucket);
+
+    int percentileMsLocked(const Histogram& histogram) const;
+    bool load();
+    QByteArray serializeLocked() const;
+
+    QString m_filePath;
+    Options m_options;
+    QHash<quint32, Histogram> m_histograms;  // Keyed by key(model, ins)
+    bool m_dirty = false;                    // Changed since the last save()
+    mutable QMutex m_mutex;
+    QMutex m_saveMutex;                      // Serializes writers of the file
+};
+
+} // namespace Keycard
@@ -58,6 +58,23 @@ struct ApplicationInfo {
     }
 };
 
+/**
+ * @brief Cash applet information returned by SELECT command
+ */
+struct CashApplicationInfo {
+    QByteArray publicKey;     ///< Key the cash applet signs with
+    QByteArray publicData;    ///< Data stored with STORE DATA (P1StoreDataCash)
+    uint8_t appVersion;       ///< Application version
+    uint8_t appVersionMinor;  ///< Application minor version
+    bool installed;           ///< True if cash applet is installed
+    
+    CashApplicationInfo()
+        : appVersion(0)
+        , appVersionMinor(0)
+        , installed(false)
+    {}
+};
+
 /**
  * @brief Application status information
  */
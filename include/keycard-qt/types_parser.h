@@ -12,6 +12,13 @@ namespace Keycard {
  */
 ApplicationInfo parseApplicationInfo(const QByteArray& data);
 
+/**
+ * @brief Parse CashApplicationInfo from the cash applet's SELECT response
+ * @param data Response data
+ * @return Parsed CashApplicationInfo
+ */
+CashApplicationInfo parseCashApplicationInfo(const QByteArray& data);
+
 /**
  * @brief Parse ApplicationStatus from GET STATUS response
  * @param data Response data
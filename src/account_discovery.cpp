@@ -0,0 +1,300 @@
+#include "keycard-qt/account_discovery.h"
+#include "keycard-qt/card_command.h"
+#include "keycard-qt/communication_manager.h"
+#include <QDebug>
+#include <algorithm>
+#include <functional>
+#include <tuple>
+
+namespace Keycard {
+
+namespace {
+
+struct AddressBatch {
+    int firstIndex = 0;
+    QStringList addresses;              // Empty string for an index BIP32 skips
+    QVector<QByteArray> publicKeys;
+};
+
+AddressBatch deriveBatch(const BIP32::ExtendedPublicKey& chainKey, int firstIndex, int count) {
+    AddressBatch batch;
+    batch.firstIndex = firstIndex;
+    batch.addresses.reserve(count);
+    batch.publicKeys.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        BIP32::ExtendedPublicKey child = BIP32::deriveChild(chainKey, static_cast<uint32_t>(firstIndex + i));
+        batch.addresses.append(BIP32::ethereumAddress(child.publicKey));
+        batch.publicKeys.append(child.publicKey);
+    }
+    return batch;
+}
+
+} // namespace
+
+int DiscoveryResult::usedAccounts() const {
+    int count = 0;
+    for (const DiscoveredAddress& address : used) {
+        count = std::max(count, address.account + 1);
+    }
+    return count;
+}
+
+struct AccountDiscovery::ChainTask {
+    quint64 generation = 0;
+    int account = 0;
+    int change = 0;
+    QString chainPath;
+    BIP32::ExtendedPublicKey accountKey;
+    int gapLimit = 0;
+    int batchSize = 0;
+    std::shared_ptr<AddressUsageOracle> oracle;
+    std::shared_ptr<std::atomic<bool>> cancelled;
+};
+
+AccountDiscovery::AccountDiscovery(std::shared_ptr<AddressUsageOracle> oracle, QObject* parent)
+    : AccountDiscovery(std::move(oracle), Options(), parent)
+{
+}
+
+AccountDiscovery::AccountDiscovery(std::shared_ptr<AddressUsageOracle> oracle, const Options& options, QObject* parent)
+    : QObject(parent)
+    , m_oracle(std::move(oracle))
+    , m_options(options)
+{
+    qRegisterMetaType<Keycard::DiscoveredAddress>();
+    qRegisterMetaType<Keycard::DiscoveryResult>();
+
+    m_options.accounts = std::max(1, m_options.accounts);
+    m_options.gapLimit = std::max(1, m_options.gapLimit);
+    if (m_options.batchSize <= 0) {
+        m_options.batchSize = m_options.gapLimit;
+    }
+}
+
+AccountDiscovery::~AccountDiscovery() {
+    if (m_cancelled) {
+        m_cancelled->store(true);
+    }
+    QObject::disconnect(m_exportConnection);
+    waitForWorkers();
+}
+
+QStringList AccountDiscovery::accountPaths() const {
+    QStringList paths;
+    for (int account = 0; account < m_options.accounts; ++account) {
+        paths << QString("%1/%2'").arg(m_options.basePath).arg(account);
+    }
+    return paths;
+}
+
+QUuid AccountDiscovery::start(CommunicationManager* manager) {
+    if (m_running || !manager) {
+        return QUuid();
+    }
+
+    auto command = std::make_unique<ExportExtendedPublicKeysCommand>(accountPaths());
+    const QUuid token = command->token();
+    const quint64 generation = ++m_generation;
+    m_running = true;
+    m_result = DiscoveryResult();
+    m_accounts = 0;
+
+    // Connect before enqueueing: the command can complete on the
+    // communication thread before enqueueCommand() returns
+    QObject::disconnect(m_exportConnection);
+    m_exportConnection = connect(manager, &CommunicationManager::commandCompleted, this,
+        [this, token, generation](QUuid completed, CommandResult result) {
+            if (completed != token) {
+                return;
+            }
+            QObject::disconnect(m_exportConnection);
+            if (generation != m_generation) {
+                return;  // Cancelled while the card was busy
+            }
+            if (!result.success) {
+                finish(QString("Exporting account keys failed: %1").arg(result.error));
+                return;
+            }
+
+            QVector<BIP32::ExtendedPublicKey> accountKeys;
+            const QVariantList keys = result.data.toMap().value("keys").toList();
+            for (const QVariant& keyData : keys) {
+                accountKeys.append(BIP32::fromExportedKey(keyData.toByteArray()));
+            }
+            m_running = false;
+            if (!discover(accountKeys)) {
+                m_running = true;
+                finish("Card returned invalid account keys");
+            }
+        }, Qt::QueuedConnection);
+
+    manager->enqueueCommand(std::move(command));
+    return token;
+}
+
+bool AccountDiscovery::discover(const QVector<BIP32::ExtendedPublicKey>& accountKeys) {
+    if (m_running || accountKeys.isEmpty() || !m_oracle) {
+        return false;
+    }
+    for (const BIP32::ExtendedPublicKey& key : accountKeys) {
+        if (!key.isValid()) {
+            return false;
+        }
+    }
+
+    // Workers of a cancelled run exit after their current batch
+    waitForWorkers();
+
+    const quint64 generation = ++m_generation;
+    m_cancelled = std::make_shared<std::atomic<bool>>(false);
+    m_running = true;
+    m_result = DiscoveryResult();
+    m_accounts = accountKeys.size();
+
+    if (!BIP32::isAvailable()) {
+        finish("Host key derivation not available (built without OpenSSL)");
+        return true;
+    }
+
+    const int chains = m_options.scanChange ? 2 : 1;
+    m_pendingChains = m_accounts * chains;
+    qDebug() << "AccountDiscovery::discover(): accounts:" << m_accounts << "chains:" << m_pendingChains
+             << "gap limit:" << m_options.gapLimit;
+
+    for (int account = 0; account < m_accounts; ++account) {
+        for (int change = 0; change < chains; ++change) {
+            ChainTask task;
+            task.generation = generation;
+            task.account = account;
+            task.change = change;
+            task.chainPath = QString("%1/%2'/%3").arg(m_options.basePath).arg(account).arg(change);
+            task.accountKey = accountKeys[account];
+            task.gapLimit = m_options.gapLimit;
+            task.batchSize = m_options.batchSize;
+            task.oracle = m_oracle;
+            task.cancelled = m_cancelled;
+            m_workers.push_back(std::async(std::launch::async, [this, task]() { scanChain(task); }));
+        }
+    }
+    return true;
+}
+
+void AccountDiscovery::scanChain(const ChainTask& task) {
+    // Runs on a worker thread: only touches the task and posts results back
+    auto post = [this](std::function<void()> fn) {
+        QMetaObject::invokeMethod(this, std::move(fn), Qt::QueuedConnection);
+    };
+    const quint64 generation = task.generation;
+    const int account = task.account;
+    const int change = task.change;
+
+    const BIP32::ExtendedPublicKey chainKey = BIP32::deriveChild(task.accountKey, static_cast<uint32_t>(change));
+    if (!chainKey.isValid()) {
+        post([=]() { onChainFinished(generation, account, change, 0, "Chain key derivation failed"); });
+        return;
+    }
+
+    int checked = 0;
+    int lastUsed = -1;
+    AddressBatch current = deriveBatch(chainKey, 0, task.batchSize);
+
+    while (!task.cancelled->load()) {
+        // Look up this batch while the next one is derived
+        std::future<QVector<bool>> usage = std::async(std::launch::async,
+            [oracle = task.oracle, addresses = current.addresses]() { return oracle->isUsed(addresses); });
+        AddressBatch following = deriveBatch(chainKey, current.firstIndex + task.batchSize, task.batchSize);
+        const QVector<bool> used = usage.get();
+
+        if (used.size() != current.addresses.size()) {
+            post([=]() { onChainFinished(generation, account, change, checked, "Address usage lookup failed"); });
+            return;
+        }
+
+        for (int i = 0; i < used.size(); ++i) {
+            if (!used[i] || current.addresses[i].isEmpty()) {
+                continue;
+            }
+            DiscoveredAddress found;
+            found.account = account;
+            found.change = change;
+            found.index = current.firstIndex + i;
+            found.path = QString("%1/%2").arg(task.chainPath).arg(found.index);
+            found.address = current.addresses[i];
+            found.publicKey = current.publicKeys[i];
+            lastUsed = found.index;
+
+            post([this, generation, found]() {
+                if (generation != m_generation) {
+                    return;
+                }
+                m_result.used.append(found);
+                emit addressFound(found);
+            });
+        }
+        checked += used.size();
+
+        if (checked - 1 - lastUsed >= task.gapLimit) {
+            break;
+        }
+        current = std::move(following);
+    }
+
+    const QString error = task.cancelled->load() ? QString("Discovery cancelled") : QString();
+    post([=]() { onChainFinished(generation, account, change, checked, error); });
+}
+
+void AccountDiscovery::onChainFinished(quint64 generation, int account, int change, int checked, const QString& error) {
+    if (generation != m_generation || !m_running) {
+        return;
+    }
+
+    if (!error.isEmpty()) {
+        m_cancelled->store(true);
+        finish(QString("Account %1 chain %2: %3").arg(account).arg(change).arg(error));
+        return;
+    }
+
+    m_result.addressesChecked += checked;
+    emit chainFinished(account, change, checked);
+
+    if (--m_pendingChains == 0) {
+        finish(QString());
+    }
+}
+
+void AccountDiscovery::finish(const QString& error) {
+    DiscoveryResult result = m_result;
+    result.success = error.isEmpty();
+    result.error = error;
+    result.accountsScanned = m_accounts;
+    result.moreAccounts = result.success && result.usedAccounts() == m_accounts;
+    std::sort(result.used.begin(), result.used.end(), [](const DiscoveredAddress& a, const DiscoveredAddress& b) {
+        return std::tie(a.account, a.change, a.index) < std::tie(b.account, b.change, b.index);
+    });
+
+    m_running = false;
+    ++m_generation;  // Drop results still queued by workers
+    qDebug() << "AccountDiscovery::finish(): used:" << result.used.size()
+             << "checked:" << result.addressesChecked << "error:" << error;
+    emit finished(result);
+}
+
+void AccountDiscovery::cancel() {
+    if (!m_running) {
+        return;
+    }
+    if (m_cancelled) {
+        m_cancelled->store(true);
+    }
+    QObject::disconnect(m_exportConnection);
+    finish("Discovery cancelled");
+}
+
+void AccountDiscovery::waitForWorkers() {
+    for (std::future<void>& worker : m_workers) {
+        worker.wait();
+    }
+    m_workers.clear();
+}
+
+} // namespace Keycard
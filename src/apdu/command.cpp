@@ -1,4 +1,5 @@
 #include "keycard-qt/apdu/command.h"
+#include "keycard-core/apdu.h"
 
 namespace Keycard {
 namespace APDU {
@@ -28,43 +29,20 @@ void Command::setLe(uint8_t le)
 
 QByteArray Command::serialize() const
 {
-    QByteArray result;
-    
-    // Header: CLA | INS | P1 | P2
-    result.append(static_cast<char>(m_cla));
-    result.append(static_cast<char>(m_ins));
-    result.append(static_cast<char>(m_p1));
-    result.append(static_cast<char>(m_p2));
-    
-    // Determine APDU case based on whether setData/setLe were called
-    // Match Java behavior: always output Lc if setData was called, even with empty data
-    if (m_hasData || m_hasLe) {
-        // Case 3 or 4: Output Lc (even if 0)
-        // This is critical for iOS CoreNFC compatibility with GlobalPlatform
-        // Java always writes data.length, even when data array is empty
-        
-        if (m_data.size() <= 255) {
-            // Short form Lc
-            result.append(static_cast<char>(m_data.size()));
-        } else {
-            // Extended form (not commonly used with keycards)
-            result.append(static_cast<char>(0));
-            result.append(static_cast<char>((m_data.size() >> 8) & 0xFF));
-            result.append(static_cast<char>(m_data.size() & 0xFF));
-        }
-        
-        // Data (if any)
-        if (!m_data.isEmpty()) {
-            result.append(m_data);
-        }
-        
-        // Le (expected response length) - Case 4
-        if (m_hasLe) {
-            result.append(static_cast<char>(m_le));
-        }
-    }
-    // else: Case 1 (header only) - neither setData nor setLe called
-    
+    // Lc is written whenever setData() was called, even with empty data:
+    // Java does the same, and iOS CoreNFC needs it for GlobalPlatform
+    Core::Apdu::CommandFields fields;
+    fields.cla = m_cla;
+    fields.ins = m_ins;
+    fields.p1 = m_p1;
+    fields.p2 = m_p2;
+    fields.data = Core::ByteView(m_data.constData(), static_cast<size_t>(m_data.size()));
+    fields.hasData = m_hasData;
+    fields.hasLe = m_hasLe;
+    fields.le = m_le;
+
+    QByteArray result(static_cast<int>(Core::Apdu::serializedSize(fields)), Qt::Uninitialized);
+    Core::Apdu::serialize(fields, Core::MutableByteView(result.data(), static_cast<size_t>(result.size())));
     return result;
 }
 
@@ -1,4 +1,5 @@
 #include "keycard-qt/apdu/utils.h"
+#include "keycard-core/bytes.h"
 #include <QDebug>
 
 namespace Keycard {
@@ -111,35 +112,18 @@ QByteArray Utils::encodeLength(int length)
 QByteArray Utils::pad(const QByteArray& data, int blockSize)
 {
     // ISO/IEC 7816-4 padding: add 0x80 followed by 0x00s
-    QByteArray padded = data;
-    padded.append(static_cast<char>(0x80));
-    
-    while (padded.size() % blockSize != 0) {
-        padded.append(static_cast<char>(0x00));
-    }
-    
-    return padded;
+    Core::Bytes padded;
+    Core::appendPadding(padded, Core::ByteView(data.constData(), static_cast<size_t>(data.size())),
+                        static_cast<size_t>(blockSize));
+    return QByteArray(reinterpret_cast<const char*>(padded.data()), static_cast<int>(padded.size()));
 }
 
 QByteArray Utils::unpad(const QByteArray& paddedData)
 {
-    if (paddedData.isEmpty()) {
-        return paddedData;
-    }
-    
-    // Find the 0x80 byte from the end
-    int i = paddedData.size() - 1;
-    while (i >= 0 && static_cast<uint8_t>(paddedData[i]) == 0x00) {
-        i--;
-    }
-        
-    if (i >= 0 && static_cast<uint8_t>(paddedData[i]) == 0x80) {
-        QByteArray result = paddedData.left(i);
-        return result;
-    }
-    
-    // No valid padding found, return as-is
-    return paddedData;
+    // No valid padding: returned as-is
+    const size_t size = Core::unpaddedSize(
+        Core::ByteView(paddedData.constData(), static_cast<size_t>(paddedData.size())));
+    return paddedData.left(static_cast<int>(size));
 }
 
 QByteArray Utils::uint32ToBytes(uint32_t value)
@@ -0,0 +1,101 @@
+#include "keycard-qt/block_pool.h"
+#include <QMutex>
+#include <atomic>
+
+namespace Keycard {
+
+namespace {
+
+constexpr std::size_t MIN_BLOCK_SIZE = 64;
+constexpr int SIZE_CLASSES = 4;  // 64, 128, 256, 512
+constexpr int BLOCKS_PER_SLAB = 32;
+
+struct FreeBlock {
+    FreeBlock* next;
+};
+
+struct SizeClass {
+    QBasicMutex mutex;
+    FreeBlock* freeList = nullptr;
+};
+
+// Constant-initialized: usable from static constructors and destructors
+SizeClass g_sizeClasses[SIZE_CLASSES];
+std::atomic<quint64> g_allocations{0};
+std::atomic<quint64> g_reused{0};
+std::atomic<quint64> g_slabs{0};
+
+// Index of the smallest class holding size, SIZE_CLASSES if none does
+int sizeClassOf(std::size_t size) {
+    int index = 0;
+    for (std::size_t blockSize = MIN_BLOCK_SIZE; blockSize < size && index < SIZE_CLASSES; blockSize <<= 1) {
+        ++index;
+    }
+    return index;
+}
+
+} // namespace
+
+void* BlockPool::allocate(std::size_t size) {
+    const int index = sizeClassOf(size);
+    if (index == SIZE_CLASSES) {
+        return ::operator new(size);
+    }
+
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    SizeClass& sizeClass = g_sizeClasses[index];
+    {
+        QMutexLocker locker(&sizeClass.mutex);
+        if (FreeBlock* block = sizeClass.freeList) {
+            sizeClass.freeList = block->next;
+            g_reused.fetch_add(1, std::memory_order_relaxed);
+            return block;
+        }
+    }
+
+    // New slab, threaded outside the lock: the first block is returned,
+    // the rest go on the free list
+    const std::size_t blockSize = MIN_BLOCK_SIZE << index;
+    char* slab = static_cast<char*>(::operator new(blockSize * BLOCKS_PER_SLAB));
+    FreeBlock* tail = reinterpret_cast<FreeBlock*>(slab + (BLOCKS_PER_SLAB - 1) * blockSize);
+    FreeBlock* head = nullptr;
+    for (int i = BLOCKS_PER_SLAB - 1; i >= 1; --i) {
+        FreeBlock* block = reinterpret_cast<FreeBlock*>(slab + i * blockSize);
+        block->next = head;
+        head = block;
+    }
+    g_slabs.fetch_add(1, std::memory_order_relaxed);
+
+    QMutexLocker locker(&sizeClass.mutex);
+    tail->next = sizeClass.freeList;
+    sizeClass.freeList = head;
+    return slab;
+}
+
+void BlockPool::deallocate(void* block, std::size_t size) noexcept {
+    if (!block) {
+        return;
+    }
+
+    const int index = sizeClassOf(size);
+    if (index == SIZE_CLASSES) {
+        ::operator delete(block);
+        return;
+    }
+
+    SizeClass& sizeClass = g_sizeClasses[index];
+    FreeBlock* freed = static_cast<FreeBlock*>(block);
+    QMutexLocker locker(&sizeClass.mutex);
+    freed->next = sizeClass.freeList;
+    sizeClass.freeList = freed;
+}
+
+BlockPool::Stats BlockPool::stats() {
+    Stats stats;
+    stats.allocations = g_allocations.load(std::memory_order_relaxed);
+    stats.reused = g_reused.load(std::memory_order_relaxed);
+    stats.slabs = g_slabs.load(std::memory_order_relaxed);
+    return stats;
+}
+
+} // namespace Keycard
@@ -1,12 +1,50 @@
 #include "keycard-qt/card_command.h"
 #include "keycard-qt/command_set.h"
+#include "keycard-qt/cash_command_set.h"
 #include "keycard-qt/types.h"
 #include "keycard-qt/metadata_utils.h"
+#include "keycard-qt/bip39.h"
 #include <QDebug>
 #include <QVariantList>
+#include <algorithm>
+#include <atomic>
 
 namespace Keycard {
 
+namespace {
+
+std::atomic<quint64> g_nextCommandId{1};
+
+// Trailing bytes of every command token: tells them apart from random UUIDs
+constexpr uchar TOKEN_MARKER[7] = {'k', 'e', 'y', 'c', 'a', 'r', 'd'};
+
+} // anonymous namespace
+
+quint64 CardCommand::nextId() {
+    return g_nextCommandId.fetch_add(1, std::memory_order_relaxed);
+}
+
+QUuid CardCommand::tokenFromId(quint64 id) {
+    // 32 + 16 + 12 + 4 id bits around the version (8) and variant (10) fields
+    return QUuid(static_cast<uint>(id >> 32),
+                 static_cast<ushort>(id >> 16),
+                 static_cast<ushort>(0x8000 | ((id >> 4) & 0x0FFF)),
+                 static_cast<uchar>(0x80 | (id & 0x0F)),
+                 TOKEN_MARKER[0], TOKEN_MARKER[1], TOKEN_MARKER[2], TOKEN_MARKER[3],
+                 TOKEN_MARKER[4], TOKEN_MARKER[5], TOKEN_MARKER[6]);
+}
+
+quint64 CardCommand::idFromToken(const QUuid& token) {
+    if ((token.data3 & 0xF000) != 0x8000 || (token.data4[0] & 0xF0) != 0x80
+        || !std::equal(TOKEN_MARKER, TOKEN_MARKER + 7, token.data4 + 1)) {
+        return 0;
+    }
+    return (static_cast<quint64>(token.data1) << 32)
+         | (static_cast<quint64>(token.data2) << 16)
+         | (static_cast<quint64>(token.data3 & 0x0FFF) << 4)
+         | static_cast<quint64>(token.data4[0] & 0x0F);
+}
+
 CommandResult SelectCommand::execute(CommandSet* cmdSet) {
     qDebug() << "SelectCommand::execute() force:" << m_force;
     
@@ -141,6 +179,36 @@ CommandResult LoadSeedCommand::execute(CommandSet* cmdSet) {
     return CommandResult::fromSuccess(map);
 }
 
+LoadMnemonicCommand::LoadMnemonicCommand(const QString& mnemonic, const QString& passphrase) {
+    m_seed = std::async(std::launch::async, [mnemonic, passphrase]() {
+        DerivedSeed derived;
+        if (BIP39::validateMnemonic(mnemonic, derived.error)) {
+            derived.seed = BIP39::mnemonicToSeed(mnemonic, passphrase);
+        }
+        return derived;
+    }).share();
+}
+
+CommandResult LoadMnemonicCommand::execute(CommandSet* cmdSet) {
+    qDebug() << "LoadMnemonicCommand::execute() seed ready:"
+             << (m_seed.wait_for(std::chrono::seconds(0)) == std::future_status::ready);
+    
+    const DerivedSeed& derived = m_seed.get();
+    if (derived.seed.isEmpty()) {
+        return CommandResult::fromError(derived.error);
+    }
+    
+    QByteArray keyUID = cmdSet->loadSeed(derived.seed);
+    if (keyUID.isEmpty()) {
+        return CommandResult::fromError(cmdSet->lastError());
+    }
+    
+    QVariantMap map;
+    map["keyUID"] = keyUID.toHex();
+    
+    return CommandResult::fromSuccess(map);
+}
+
 CommandResult FactoryResetCommand::execute(CommandSet* cmdSet) {
     qDebug() << "FactoryResetCommand::execute()";
     
@@ -190,6 +258,38 @@ CommandResult ExportKeyExtendedCommand::execute(CommandSet* cmdSet) {
     return CommandResult::fromSuccess(map);
 }
 
+CommandResult ExportExtendedPublicKeysCommand::execute(CommandSet* cmdSet) {
+    qDebug() << "ExportExtendedPublicKeysCommand::execute() paths:" << m_paths;
+    
+    QVariantList keys;
+    for (const QString& path : m_paths) {
+        QByteArray keyData = cmdSet->exportKeyExtended(true, false, path, APDU::P2ExportKeyExtendedPublic);
+        if (keyData.isEmpty()) {
+            return CommandResult::fromError(cmdSet->lastError());
+        }
+        keys.append(keyData);
+    }
+    
+    QVariantMap map;
+    map["paths"] = m_paths;
+    map["keys"] = keys;
+    
+    return CommandResult::fromSuccess(map);
+}
+
+CommandResult DeriveKeyCommand::execute(CommandSet* cmdSet) {
+    qDebug() << "DeriveKeyCommand::execute() path:" << m_path;
+    
+    if (!cmdSet->deriveKey(m_path)) {
+        return CommandResult::fromError(cmdSet->lastError());
+    }
+    
+    QVariantMap map;
+    map["path"] = m_path;
+    
+    return CommandResult::fromSuccess(map);
+}
+
 CommandResult GetMetadataCommand::execute(CommandSet* cmdSet) {
     qDebug() << "GetMetadataCommand::execute()";
     
@@ -202,7 +302,18 @@ CommandResult GetMetadataCommand::execute(CommandSet* cmdSet) {
     }
     
     QVariantMap map;
-    map["tlvData"] = tlvData;
+    map["tlvData"] = tlvData;  // Raw blob, kept for existing callers
+    
+    Keycard::MetadataEncoding::WalletMetadata metadata;
+    QString errorMsg;
+    if (Keycard::MetadataEncoding::decode(tlvData, metadata, errorMsg)) {
+        map["metadata"] = QVariant::fromValue(metadata);
+        map["version"] = static_cast<int>(metadata.version);
+        map["name"] = metadata.name;
+        map["paths"] = metadata.paths.toStringList();
+    } else {
+        qWarning() << "GetMetadataCommand: Failed to decode metadata:" << errorMsg;
+    }
     
     return CommandResult::fromSuccess(map);
 }
@@ -210,9 +321,13 @@ CommandResult GetMetadataCommand::execute(CommandSet* cmdSet) {
 CommandResult StoreMetadataCommand::execute(CommandSet* cmdSet) {
     qDebug() << "StoreMetadataCommand::execute() name:" << m_name << "paths:" << m_paths.size();
     
-    // Encode metadata in keycard format (matching Go's types/metadata.go)
+    // Encode metadata in keycard format (matching Go's types/metadata.go):
+    // the name alone, then the paths grouped into ranges in a single pass
     QString errorMsg;
-    QByteArray metadata = Keycard::MetadataEncoding::encode(m_name, m_paths, errorMsg);
+    QByteArray metadata = Keycard::MetadataEncoding::encodeRanges(m_name, {}, errorMsg);
+    if (!metadata.isEmpty()) {
+        metadata = Keycard::MetadataEncoding::addPaths(metadata, m_paths, errorMsg);
+    }
     
     if (metadata.isEmpty()) {
         QString error = QString("Failed to encode metadata: %1").arg(errorMsg);
@@ -264,6 +379,56 @@ CommandResult SignCommand::execute(CommandSet* cmdSet) {
     return CommandResult::fromSuccess(map);
 }
 
+CommandResult CashSelectCommand::execute(CommandSet* cmdSet) {
+    qDebug() << "CashSelectCommand::execute()";
+    
+    // The Keycard applet is deselected: its secure channel must be reopened
+    cmdSet->resetSecureChannel();
+    
+    CashCommandSet cash(cmdSet->channel().get());
+    CashApplicationInfo info = cash.select();
+    if (!info.installed) {
+        return CommandResult::fromError(cash.lastError());
+    }
+    
+    QVariantMap map;
+    map["installed"] = info.installed;
+    map["publicKey"] = info.publicKey;
+    map["publicData"] = info.publicData;
+    map["appVersion"] = info.appVersion;
+    map["appVersionMinor"] = info.appVersionMinor;
+    return CommandResult::fromSuccess(map);
+}
+
+CommandResult CashSignCommand::execute(CommandSet* cmdSet) {
+    qDebug() << "CashSignCommand::execute() dataSize:" << m_hash.size();
+    
+    // Checked before SELECT so a bad request costs no APDU
+    if (m_hash.size() != 32) {
+        return CommandResult::fromError("Data must be 32 bytes (hash)");
+    }
+    
+    // The Keycard applet is deselected: its secure channel must be reopened
+    cmdSet->resetSecureChannel();
+    
+    CashCommandSet cash(cmdSet->channel().get());
+    CashApplicationInfo info = cash.select();
+    if (!info.installed) {
+        return CommandResult::fromError(cash.lastError());
+    }
+    
+    QByteArray result = cash.sign(m_hash);
+    if (result.isEmpty()) {
+        return CommandResult::fromError(cash.lastError());
+    }
+    
+    QVariantMap map;
+    map["publicKey"] = info.publicKey;
+    map["tlvResponse"] = result;
+    map["tlvResponseHex"] = result.toHex();
+    return CommandResult::fromSuccess(map);
+}
+
 CommandResult ChangePairingCommand::execute(CommandSet* cmdSet) {
     qDebug() << "ChangePairingCommand::execute()";
     
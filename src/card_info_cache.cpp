@@ -0,0 +1,228 @@
+#include "keycard-qt/card_info_cache.h"
+#include <QDataStream>
+#include <QDebug>
+#include <QFile>
+#include <QSaveFile>
+
+namespace Keycard {
+
+// File format: magic, version, entry count, then one record per card
+static constexpr quint32 CACHE_FILE_MAGIC = 0x4B434943;  // "KCIC"
+static constexpr quint8 CACHE_FILE_VERSION = 1;
+
+// ApplicationInfo flags packed into one byte
+static constexpr quint8 FLAG_INSTALLED = 0x01;
+static constexpr quint8 FLAG_INITIALIZED = 0x02;
+static constexpr quint8 FLAG_HAS_METADATA = 0x04;
+
+CardInfoCache::CardInfoCache(const QString& filePath)
+    : m_filePath(filePath)
+{
+    if (!m_filePath.isEmpty()) {
+        load();
+    }
+}
+
+quint64 CardInfoCache::responseHash(const QByteArray& response)
+{
+    quint64 hash = 0xcbf29ce484222325ULL;  // FNV-1a offset basis
+    for (char c : response) {
+        hash ^= static_cast<quint8>(c);
+        hash *= 0x100000001b3ULL;  // FNV-1a prime
+    }
+    return hash;
+}
+
+bool CardInfoCache::updateApplicationInfo(const ApplicationInfo& info, quint64 selectHash)
+{
+    if (info.instanceUID.isEmpty()) {
+        // Pre-initialized card: nothing stable to key on
+        return false;
+    }
+
+    QMutexLocker locker(&m_mutex);
+
+    auto it = m_entries.find(info.instanceUID);
+    bool fresh = it != m_entries.end()
+                 && it->selectHash == selectHash
+                 && it->appInfo.keyUID == info.keyUID;
+    if (fresh) {
+        return true;
+    }
+
+    if (it != m_entries.end()) {
+        qDebug() << "CardInfoCache: SELECT response changed for" << info.instanceUID.toHex()
+                 << "- dropping cached metadata";
+    }
+
+    Entry& entry = m_entries[info.instanceUID];
+    entry.appInfo = info;
+    entry.selectHash = selectHash;
+    entry.metadata.clear();
+    entry.hasMetadata = false;
+
+    saveLocked();
+    return false;
+}
+
+ApplicationInfo CardInfoCache::applicationInfo(const QByteArray& instanceUID) const
+{
+    QMutexLocker locker(&m_mutex);
+    auto it = m_entries.constFind(instanceUID);
+    return it != m_entries.constEnd() ? it->appInfo : ApplicationInfo();
+}
+
+bool CardInfoCache::metadata(const QByteArray& instanceUID, const QByteArray& keyUID, QByteArray& metadata) const
+{
+    QMutexLocker locker(&m_mutex);
+    auto it = m_entries.constFind(instanceUID);
+    if (it == m_entries.constEnd() || !it->hasMetadata || it->appInfo.keyUID != keyUID) {
+        return false;
+    }
+    metadata = it->metadata;
+    return true;
+}
+
+void CardInfoCache::storeMetadata(const QByteArray& instanceUID, const QByteArray& keyUID, const QByteArray& metadata)
+{
+    if (instanceUID.isEmpty()) {
+        return;
+    }
+
+    QMutexLocker locker(&m_mutex);
+    auto it = m_entries.find(instanceUID);
+    if (it == m_entries.end() || it->appInfo.keyUID != keyUID) {
+        // Only cache metadata for a card whose SELECT response we have recorded,
+        // otherwise there is nothing to validate it against later
+        return;
+    }
+
+    if (it->hasMetadata && it->metadata == metadata) {
+        return;
+    }
+
+    it->metadata = metadata;
+    it->hasMetadata = true;
+    saveLocked();
+}
+
+void CardInfoCache::invalidate(const QByteArray& instanceUID)
+{
+    QMutexLocker locker(&m_mutex);
+    if (m_entries.remove(instanceUID) > 0) {
+        qDebug() << "CardInfoCache: Invalidated" << instanceUID.toHex();
+        saveLocked();
+    }
+}
+
+void CardInfoCache::clear()
+{
+    QMutexLocker locker(&m_mutex);
+    m_entries.clear();
+    saveLocked();
+}
+
+int CardInfoCache::size() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_entries.size();
+}
+
+bool CardInfoCache::load()
+{
+    QFile file(m_filePath);
+    if (!file.exists()) {
+        return true;
+    }
+    if (!file.open(QIODevice::ReadOnly)) {
+        qWarning() << "CardInfoCache: Failed to open" << m_filePath << ":" << file.errorString();
+        return false;
+    }
+
+    QDataStream stream(&file);
+    stream.setByteOrder(QDataStream::BigEndian);
+
+    quint32 magic = 0;
+    quint8 version = 0;
+    quint32 count = 0;
+    stream >> magic >> version >> count;
+    if (magic != CACHE_FILE_MAGIC || version != CACHE_FILE_VERSION) {
+        qWarning() << "CardInfoCache: Ignoring cache file with unknown format:" << m_filePath;
+        return false;
+    }
+
+    QHash<QByteArray, Entry> entries;
+    for (quint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i) {
+        Entry entry;
+        quint8 flags = 0;
+        stream >> entry.appInfo.instanceUID
+               >> entry.appInfo.keyUID
+               >> entry.appInfo.secureChannelPublicKey
+               >> entry.appInfo.appVersion
+               >> entry.appInfo.appVersionMinor
+               >> entry.appInfo.availableSlots
+               >> entry.appInfo.capabilities
+               >> flags
+               >> entry.selectHash;
+        entry.appInfo.installed = flags & FLAG_INSTALLED;
+        entry.appInfo.initialized = flags & FLAG_INITIALIZED;
+        entry.hasMetadata = flags & FLAG_HAS_METADATA;
+        if (entry.hasMetadata) {
+            stream >> entry.metadata;
+        }
+        entries.insert(entry.appInfo.instanceUID, entry);
+    }
+
+    if (stream.status() != QDataStream::Ok) {
+        qWarning() << "CardInfoCache: Truncated cache file, ignoring:" << m_filePath;
+        return false;
+    }
+
+    QMutexLocker locker(&m_mutex);
+    m_entries = entries;
+    qDebug() << "CardInfoCache: Loaded" << m_entries.size() << "entries from" << m_filePath;
+    return true;
+}
+
+bool CardInfoCache::saveLocked() const
+{
+    if (m_filePath.isEmpty()) {
+        return true;
+    }
+
+    QSaveFile file(m_filePath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "CardInfoCache: Failed to write" << m_filePath << ":" << file.errorString();
+        return false;
+    }
+
+    QDataStream stream(&file);
+    stream.setByteOrder(QDataStream::BigEndian);
+    stream << CACHE_FILE_MAGIC << CACHE_FILE_VERSION << static_cast<quint32>(m_entries.size());
+
+    for (const Entry& entry : m_entries) {
+        quint8 flags = (entry.appInfo.installed ? FLAG_INSTALLED : 0)
+                     | (entry.appInfo.initialized ? FLAG_INITIALIZED : 0)
+                     | (entry.hasMetadata ? FLAG_HAS_METADATA : 0);
+        stream << entry.appInfo.instanceUID
+               << entry.appInfo.keyUID
+               << entry.appInfo.secureChannelPublicKey
+               << entry.appInfo.appVersion
+               << entry.appInfo.appVersionMinor
+               << entry.appInfo.availableSlots
+               << entry.appInfo.capabilities
+               << flags
+               << entry.selectHash;
+        if (entry.hasMetadata) {
+            stream << entry.metadata;
+        }
+    }
+
+    if (!file.commit()) {
+        qWarning() << "CardInfoCache: Failed to commit" << m_filePath << ":" << file.errorString();
+        return false;
+    }
+    return true;
+}
+
+} // namespace Keycard
@@ -0,0 +1,81 @@
+#include "keycard-qt/cash_command_set.h"
+#include "keycard-qt/types_parser.h"
+#include "keycard-qt/globalplatform/gp_constants.h"
+#include <QDebug>
+
+namespace Keycard {
+
+CashCommandSet::CashCommandSet(IChannel* channel)
+    : m_channel(channel)
+{
+    if (!m_channel) {
+        qWarning() << "CashCommandSet: Null channel provided";
+    }
+}
+
+CashApplicationInfo CashCommandSet::select()
+{
+    qDebug() << "CashCommandSet::select()";
+
+    APDU::Command cmd(APDU::CLA_ISO7816, APDU::INS_SELECT, 0x04, 0x00);
+    cmd.setData(GlobalPlatform::CASH_INSTANCE_AID());
+    cmd.setLe(0);
+
+    APDU::Response response = send(cmd);
+    if (!checkOK(response)) {
+        return CashApplicationInfo();
+    }
+
+    CashApplicationInfo info = parseCashApplicationInfo(response.data());
+    if (!info.installed) {
+        m_lastError = "Invalid cash applet SELECT response";
+        qWarning() << "CashCommandSet:" << m_lastError;
+        return info;
+    }
+
+    m_appInfo = info;
+    return m_appInfo;
+}
+
+QByteArray CashCommandSet::sign(const QByteArray& hash)
+{
+    qDebug() << "CashCommandSet::sign()";
+
+    if (hash.size() != 32) {
+        m_lastError = "Data must be 32 bytes (hash)";
+        qWarning() << m_lastError;
+        return QByteArray();
+    }
+
+    APDU::Command cmd(APDU::CLA, APDU::INS_SIGN, APDU::P1SignCurrentKey, 0x00);
+    cmd.setData(hash);
+
+    APDU::Response response = send(cmd);
+    if (!checkOK(response)) {
+        return QByteArray();
+    }
+
+    return response.data();
+}
+
+APDU::Response CashCommandSet::send(const APDU::Command& cmd)
+{
+    if (!m_channel) {
+        return APDU::Response(QByteArray::fromHex("6985"));
+    }
+
+    return APDU::Response(m_channel->transmit(cmd.serialize()));
+}
+
+bool CashCommandSet::checkOK(const APDU::Response& response)
+{
+    if (!response.isOK()) {
+        m_lastError = QString("APDU error: SW=%1").arg(response.sw(), 4, 16, QChar('0'));
+        qWarning() << "CashCommandSet:" << m_lastError;
+        return false;
+    }
+    m_lastError.clear();
+    return true;
+}
+
+} // namespace Keycard
@@ -37,18 +37,31 @@ struct PcscState {
     bool contextEstablished = false;
 };
 
-KeycardChannelPcsc::KeycardChannelPcsc(QObject* parent)
+// Shared with the background startup thread, which may outlive the backend
+// when stopDetection() gives up on a pcscd that does not answer
+struct PcscStartup {
+    QMutex mutex;
+    bool abandoned = false;  // The thread must not touch the backend any more
+};
+
+KeycardChannelPcsc::KeycardChannelPcsc(QObject* parent, bool backgroundStartup)
     : KeycardChannelBackend(parent)
     , m_pcscState(new PcscState())
     , m_connected(false)
     , m_detectionThread(nullptr)
     , m_stopDetection(0)
     , m_forceScan(0)
+    , m_ready(backgroundStartup ? 0 : 1)
     , m_lastReaderAvailable(false)
     , m_firstReaderCheck(true)
 {
-    qDebug() << "KeycardChannelPcsc: Initialized with event-driven detection (Desktop smart card reader)";
-    startDetection();
+    qDebug() << "KeycardChannelPcsc: Initialized with event-driven detection (Desktop smart card reader)"
+             << (backgroundStartup ? "- starting in background" : "");
+    if (backgroundStartup) {
+        startDetectionInBackground();
+    } else {
+        startDetection();
+    }
 }
 
 KeycardChannelPcsc::~KeycardChannelPcsc()
@@ -265,10 +278,61 @@ QByteArray KeycardChannelPcsc::getATR()
     return QByteArray();
 }
 
+void KeycardChannelPcsc::startDetectionInBackground()
+{
+    // Context setup talks to pcscd (a round trip per call): keep it, and the
+    // first reader listing, off the constructing thread
+    m_stopDetection = 0;
+    m_startup = std::make_shared<PcscStartup>();
+    m_detectionThread = QThread::create([this, startup = m_startup]() {
+        SCARDCONTEXT context = 0;
+        const LONG rv = SCardEstablishContext(SCARD_SCOPE_SYSTEM, NULL, NULL, &context);
+        {
+            QMutexLocker locker(&startup->mutex);
+            if (startup->abandoned) {
+                // stopDetection() stopped waiting: the backend may be gone
+                if (rv == SCARD_S_SUCCESS) {
+                    SCardReleaseContext(context);
+                }
+                return;
+            }
+            if (rv == SCARD_S_SUCCESS) {
+                m_pcscState->context = context;
+                m_pcscState->contextEstablished = true;
+            }
+            m_ready.storeRelease(1);
+        }
+        
+        if (rv != SCARD_S_SUCCESS) {
+            QString msg = QString("Failed to establish PC/SC context: 0x%1").arg(rv, 0, 16);
+            qWarning() << "KeycardChannelPcsc:" << msg;
+            emit error(msg);
+            m_lastReaderAvailable = false;
+            m_firstReaderCheck = false;
+            emit readerAvailabilityChanged(false);
+            emit ready();
+            return;
+        }
+        
+        qDebug() << "KeycardChannelPcsc: PC/SC context established";
+        emit ready();
+        // Reports the initial reader availability on its first pass
+        detectionLoop();
+    });
+    
+    m_detectionThread->start();
+    qDebug() << "KeycardChannelPcsc: Detection thread started (background startup)";
+}
+
 void KeycardChannelPcsc::startDetection()
 {
     qDebug() << "KeycardChannelPcsc: Starting event-driven card detection";
     
+    if (!isReady()) {
+        qDebug() << "KeycardChannelPcsc: Background startup in progress, detection starts with it";
+        return;
+    }
+    
     establishContext();
     
     if (!m_pcscState->contextEstablished) {
@@ -308,7 +372,9 @@ void KeycardChannelPcsc::startDetection()
     // Reset stop flag
     m_stopDetection = 0;
     
-    // Start detection thread (matches status-keycard-go pattern)
+    // Start detection thread (matches status-keycard-go pattern). A previous
+    // one may have finished on its own after a failed background startup
+    delete m_detectionThread;
     m_detectionThread = QThread::create([this]() {
         detectionLoop();
     });
@@ -329,11 +395,32 @@ void KeycardChannelPcsc::stopDetection()
     m_stopDetection = 1;
     
     // Cancel any blocking SCardGetStatusChange() by establishing a new context
-    // This will cause SCARD_E_CANCELLED
-    if (m_pcscState->contextEstablished) {
+    // This will cause SCARD_E_CANCELLED. During a background startup the
+    // thread sees the stop flag before its first blocking call
+    if (isReady() && m_pcscState->contextEstablished) {
         SCardCancel(m_pcscState->context);
     }
     
+    // A background startup blocked in SCardEstablishContext() can be neither
+    // cancelled nor terminated (that would leave isReady() false for good).
+    // Give pcscd the usual time, then leave the thread to finish on its own:
+    // it releases whatever context it gets without touching the backend
+    if (!isReady() && !m_detectionThread->wait(2000)) {
+        QMutexLocker locker(&m_startup->mutex);
+        if (!isReady()) {
+            qWarning() << "KeycardChannelPcsc: PC/SC context setup did not finish in time, abandoning it";
+            m_startup->abandoned = true;
+            QThread* startupThread = m_detectionThread;
+            connect(startupThread, &QThread::finished, startupThread, &QObject::deleteLater);
+            m_detectionThread = nullptr;
+            // No startup is running any more: startDetection() sets up the context itself
+            m_ready.storeRelease(1);
+            locker.unlock();
+            emit ready();
+            return;
+        }
+    }
+    
     // Wait for thread to finish (with timeout)
     if (!m_detectionThread->wait(2000)) {
         qWarning() << "KeycardChannelPcsc: Detection thread did not stop in time, forcing termination";
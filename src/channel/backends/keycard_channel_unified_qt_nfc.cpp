@@ -332,10 +332,10 @@ QByteArray KeycardChannelUnifiedQtNfc::transmit(const QByteArray& apdu)
             }
         }
         
-        // Wait for completion with 120-second timeout
-        // Returns false if tag is lost
-        // The timeout is huge, but the goal is not to timeout here, but to wait for the command to complete or the nfc tag to disconnect.
-        success = target->waitForRequestCompleted(requestId, 120000);
+        // Wait for completion, or for the tag to disconnect (returns false)
+        // The timeout comes from KeycardChannel's TransportTimeoutPolicy: a few
+        // times the card's usual latency for this instruction
+        success = target->waitForRequestCompleted(requestId, m_transmitTimeoutMs.load());
         
         if (!success) {
             qWarning() << "KeycardChannelUnifiedQtNfc::transmit() - request failed (tag lost or timeout)";
@@ -374,6 +374,12 @@ QByteArray KeycardChannelUnifiedQtNfc::transmit(const QByteArray& apdu)
     return response;
 }
 
+bool KeycardChannelUnifiedQtNfc::setTransmitTimeout(int timeoutMs)
+{
+    m_transmitTimeoutMs.store(timeoutMs);
+    return true;
+}
+
 void KeycardChannelUnifiedQtNfc::emitChannelState(ChannelOperationalState newState)
 {
     qDebug() << "KeycardChannelUnifiedQtNfc::emitChannelState() called with state:" << static_cast<int>(newState);
@@ -4,6 +4,10 @@
 #include "keycard-qt/keycard_channel.h"
 #include "keycard-qt/backends/keycard_channel_backend.h"
 #include "keycard-qt/globalplatform/gp_constants.h"
+#include "keycard-qt/metrics.h"
+#include <QCoreApplication>
+#include <QDeadlineTimer>
+#include <QThread>
 #include <QDebug>
 
 #if defined(Q_OS_IOS) || defined(Q_OS_ANDROID)
@@ -16,6 +20,11 @@ namespace Keycard {
 
 // Default constructor - creates platform-specific backend
 KeycardChannel::KeycardChannel(QObject* parent)
+    : KeycardChannel(BackendStartup::Immediate, parent)
+{
+}
+
+KeycardChannel::KeycardChannel(BackendStartup startup, QObject* parent)
     : QObject(parent)
     , m_backend(nullptr)
     , m_ownsBackend(true)
@@ -23,6 +32,14 @@ KeycardChannel::KeycardChannel(QObject* parent)
     qDebug() << "========================================";
     qDebug() << "KeycardChannel: Initializing with default platform backend";
     
+    if (startup == BackendStartup::Deferred) {
+        qDebug() << "KeycardChannel: Backend creation deferred";
+        qDebug() << "========================================";
+        m_backendFactory = [this]() { return createDefaultBackend(true); };
+        QMetaObject::invokeMethod(this, &KeycardChannel::createPendingBackend, Qt::QueuedConnection);
+        return;
+    }
+    
     m_backend = createDefaultBackend();
     
     if (!m_backend) {
@@ -33,27 +50,7 @@ KeycardChannel::KeycardChannel(QObject* parent)
     qDebug() << "KeycardChannel: Backend:" << m_backend->backendName();
     qDebug() << "========================================";
     
-    // Connect backend signals to our signals (pass-through)
-    connect(m_backend, &KeycardChannelBackend::readerAvailabilityChanged,
-            this, &KeycardChannel::readerAvailabilityChanged);
-    
-    connect(m_backend, &KeycardChannelBackend::targetDetected,
-            this, [this](const QString& uid) {
-        m_targetUid = uid;
-        emit targetDetected(uid);
-    });
-    
-    connect(m_backend, &KeycardChannelBackend::cardRemoved,
-            this, [this]() {
-        m_targetUid.clear();
-        emit targetLost();
-    });
-    
-    connect(m_backend, &KeycardChannelBackend::error,
-            this, &KeycardChannel::error);
-    
-    connect(m_backend, &KeycardChannelBackend::channelStateChanged,
-            this, &KeycardChannel::channelStateChanged);
+    connectBackend();
 }
 
 // DI constructor - accepts injected backend
@@ -79,41 +76,255 @@ KeycardChannel::KeycardChannel(KeycardChannelBackend* backend, QObject* parent)
     qDebug() << "KeycardChannel: Backend:" << m_backend->backendName();
     qDebug() << "========================================";
     
+    connectBackend();
+}
+
+// Deferred DI constructor - the factory runs on the first event loop pass
+KeycardChannel::KeycardChannel(BackendFactory factory, QObject* parent)
+    : QObject(parent)
+    , m_backend(nullptr)
+    , m_ownsBackend(true)
+    , m_backendFactory(std::move(factory))
+{
+    qDebug() << "KeycardChannel: Initializing with deferred backend factory";
+    QMetaObject::invokeMethod(this, &KeycardChannel::createPendingBackend, Qt::QueuedConnection);
+}
+
+void KeycardChannel::createPendingBackend()
+{
+    if (m_backend || !m_backendFactory) {
+        return;  // Already created by waitForTarget()
+    }
+    
+    BackendFactory factory = std::move(m_backendFactory);
+    m_backendFactory = nullptr;
+    m_backend = factory();
+    
+    if (!m_backend) {
+        qCritical() << "KeycardChannel: Failed to create backend!";
+        emit error("No backend available");
+        return;
+    }
+    if (!m_backend->parent()) {
+        m_backend->setParent(this);
+    }
+    qDebug() << "KeycardChannel: Deferred backend created:" << m_backend->backendName();
+    
+    connectBackend();
+    
+    // Calls made while the backend did not exist yet
+    if (m_stateRequested) {
+        m_backend->setState(m_requestedState);
+    }
+    if (m_detectionRequested) {
+        m_backend->startDetection();
+    }
+}
+
+void KeycardChannel::connectBackend()
+{
     // Connect backend signals to our signals (pass-through)
     connect(m_backend, &KeycardChannelBackend::readerAvailabilityChanged,
             this, &KeycardChannel::readerAvailabilityChanged);
     
     connect(m_backend, &KeycardChannelBackend::targetDetected,
-            this, [this](const QString& uid) {
-        m_targetUid = uid;
-        emit targetDetected(uid);
-    });
+            this, &KeycardChannel::onBackendTargetDetected);
     
     connect(m_backend, &KeycardChannelBackend::cardRemoved,
-            this, [this]() {
-        m_targetUid.clear();
-        emit targetLost();
-    });
+            this, &KeycardChannel::onBackendCardRemoved);
     
     connect(m_backend, &KeycardChannelBackend::error,
             this, &KeycardChannel::error);
     
     connect(m_backend, &KeycardChannelBackend::channelStateChanged,
             this, &KeycardChannel::channelStateChanged);
+    
+    connectPresenceLatch();
+    
+    // ready() may come from a backend thread, possibly before the check below
+    connect(m_backend, &KeycardChannelBackend::ready,
+            this, &KeycardChannel::onBackendReady);
+    if (m_backend->isReady()) {
+        onBackendReady();
+    }
+}
+
+void KeycardChannel::onBackendReady()
+{
+    if (!m_backendReady.exchange(true)) {
+        qDebug() << "KeycardChannel: Backend ready";
+        emit backendReady();
+    }
 }
 
-KeycardChannelBackend* KeycardChannel::createDefaultBackend()
+KeycardChannelBackend* KeycardChannel::createDefaultBackend(bool backgroundStartup)
 {
     // Factory: Create appropriate backend based on platform
 #if defined(Q_OS_IOS) || defined(Q_OS_ANDROID)
+    Q_UNUSED(backgroundStartup);
     qDebug() << "KeycardChannel: Creating unified Qt NFC backend (All platforms)";
     return new KeycardChannelUnifiedQtNfc(this);
 #else
     qDebug() << "KeycardChannel: Creating PC/SC backend (Desktop)";
-    return new KeycardChannelPcsc(this);
+    return new KeycardChannelPcsc(this, backgroundStartup);
 #endif
 }
 
+void KeycardChannel::connectPresenceLatch()
+{
+    m_lossTimer.setSingleShot(true);
+    connect(&m_lossTimer, &QTimer::timeout, this, &KeycardChannel::commitTargetLost);
+    m_settleTimer.setSingleShot(true);
+    connect(&m_settleTimer, &QTimer::timeout, this, &KeycardChannel::onSettled);
+    
+    // Detection and removal update the latch in commitTargetDetected() and
+    // commitTargetLost(), after the signal has been delivered
+    connect(m_backend, &KeycardChannelBackend::error,
+            this, [this]() {
+        QMutexLocker locker(&m_presenceMutex);
+        m_errors++;
+        m_presenceChanged.wakeAll();
+    });
+    
+    // Raw wake-up on the emitting thread: a waiter blocked on our own thread
+    // delivers the queued events above itself (see waitForTarget())
+    auto onBackendEvent = [this]() {
+        QMutexLocker locker(&m_presenceMutex);
+        m_backendEvents++;
+        m_presenceChanged.wakeAll();
+    };
+    connect(m_backend, &KeycardChannelBackend::targetDetected,
+            this, onBackendEvent, Qt::DirectConnection);
+    connect(m_backend, &KeycardChannelBackend::error,
+            this, onBackendEvent, Qt::DirectConnection);
+}
+
+void KeycardChannel::onBackendTargetDetected(const QString& uid)
+{
+    if (m_lossTimer.isActive()) {
+        m_lossTimer.stop();
+        if (uid == m_targetUid) {
+            Metrics::increment(QStringLiteral("presence.flaps"));
+            if (m_sessionProbe && m_sessionProbe()) {
+                qDebug() << "KeycardChannel: Card" << uid << "returned within the grace period, session intact";
+                Metrics::increment(QStringLiteral("presence.reinit_suppressed"));
+                latchDetection();
+                return;
+            }
+            // One lost/detected pair for the whole burst
+            commitTargetLost();
+            commitTargetDetected(uid);
+            return;
+        }
+        commitTargetLost();  // Another card: the loss was real
+    }
+    
+    if (m_debounce.settleMs > 0 && uid == m_lastLostUid
+        && m_sinceLoss.isValid() && m_sinceLoss.elapsed() < m_debounce.flapWindowMs) {
+        qDebug() << "KeycardChannel: Card" << uid << "back right after a loss, settling";
+        Metrics::increment(QStringLiteral("presence.flaps"));
+        m_settlingUid = uid;
+        m_settleTimer.start(m_debounce.settleMs);
+        return;
+    }
+    
+    commitTargetDetected(uid);
+}
+
+void KeycardChannel::onBackendCardRemoved()
+{
+    if (m_settleTimer.isActive()) {
+        // Gone again before it settled: neither event is reported
+        qDebug() << "KeycardChannel: Card" << m_settlingUid << "lost again while settling";
+        Metrics::increment(QStringLiteral("presence.detection_suppressed"));
+        m_settleTimer.stop();
+        m_settlingUid.clear();
+        m_sinceLoss.start();
+        return;
+    }
+    
+    if (m_debounce.lossGraceMs > 0 && !m_targetUid.isEmpty()) {
+        if (!m_lossTimer.isActive()) {
+            m_lossTimer.start(m_debounce.lossGraceMs);
+        }
+        return;
+    }
+    
+    commitTargetLost();
+}
+
+void KeycardChannel::onSettled()
+{
+    const QString uid = m_settlingUid;
+    m_settlingUid.clear();
+    commitTargetDetected(uid);
+}
+
+void KeycardChannel::commitTargetDetected(const QString& uid)
+{
+    m_targetUid = uid;
+    emit targetDetected(uid);
+    latchDetection();
+}
+
+void KeycardChannel::commitTargetLost()
+{
+    m_lossTimer.stop();
+    if (!m_targetUid.isEmpty()) {
+        m_lastLostUid = m_targetUid;
+    }
+    m_sinceLoss.start();
+    m_targetUid.clear();
+    m_cardModel.store(TransportTimeoutPolicy::UNKNOWN_MODEL);
+    emit targetLost();
+    
+    {
+        QMutexLocker locker(&m_presenceMutex);
+        m_targetPresent = false;
+        m_presenceChanged.wakeAll();
+    }
+    
+    // Persist what the session taught the policy while no exchange runs
+    if (const std::shared_ptr<TransportTimeoutPolicy> policy = timeoutPolicy()) {
+        policy->save();
+    }
+}
+
+void KeycardChannel::latchDetection()
+{
+    QMutexLocker locker(&m_presenceMutex);
+    m_targetPresent = true;
+    m_detections++;
+    m_presenceChanged.wakeAll();
+}
+
+void KeycardChannel::setDebounceConfig(const DebounceConfig& config)
+{
+    m_debounce = config;
+}
+
+void KeycardChannel::setSessionProbe(SessionProbe probe)
+{
+    m_sessionProbe = std::move(probe);
+}
+
+void KeycardChannel::setTimeoutPolicy(std::shared_ptr<TransportTimeoutPolicy> policy)
+{
+    QMutexLocker locker(&m_timeoutPolicyMutex);
+    m_timeoutPolicy = std::move(policy);
+}
+
+std::shared_ptr<TransportTimeoutPolicy> KeycardChannel::timeoutPolicy() const
+{
+    QMutexLocker locker(&m_timeoutPolicyMutex);
+    return m_timeoutPolicy;
+}
+
+void KeycardChannel::setCardModel(quint8 appVersion, quint8 appVersionMinor)
+{
+    m_cardModel.store(TransportTimeoutPolicy::cardModel(appVersion, appVersionMinor));
+}
+
 KeycardChannel::~KeycardChannel()
 {
     qDebug() << "KeycardChannel: Destructor";
@@ -124,6 +335,8 @@ void KeycardChannel::startDetection()
 {
     if (m_backend) {
         m_backend->startDetection();
+    } else if (m_backendFactory) {
+        m_detectionRequested = true;
     } else {
         qWarning() << "KeycardChannel: No backend available!";
         emit error("No backend available");
@@ -134,6 +347,8 @@ void KeycardChannel::stopDetection()
 {
     if (m_backend) {
         m_backend->stopDetection();
+    } else if (m_backendFactory) {
+        m_detectionRequested = false;
     } else {
         qWarning() << "KeycardChannel: No backend available!";
     }
@@ -151,6 +366,10 @@ void KeycardChannel::disconnect()
 {
     if (m_backend) {
         m_backend->disconnect();
+        // An explicit disconnect is not a flap
+        if (m_lossTimer.isActive()) {
+            commitTargetLost();
+        }
     } else {
         qWarning() << "KeycardChannel: No backend available!";
     }
@@ -173,6 +392,9 @@ void KeycardChannel::setState(ChannelState state)
 {
     if (m_backend) {
         m_backend->setState(state);
+    } else {
+        m_stateRequested = true;
+        m_requestedState = state;
     }
 }
 
@@ -181,16 +403,45 @@ ChannelState KeycardChannel::state() const
     if (m_backend) {
         return m_backend->state();
     }
-    return ChannelState::Idle;
+    return m_requestedState;
 }
 
 QByteArray KeycardChannel::transmit(const QByteArray& apdu)
 {
-    if (!m_backend) {
+    if (!m_backendReady.load()) {
         throw std::runtime_error("No backend available");
     }
     
-    QByteArray response = m_backend->transmit(apdu);
+    // Time the exchange against the timeout learned for this instruction
+    const std::shared_ptr<TransportTimeoutPolicy> policy = timeoutPolicy();
+    const quint16 model = m_cardModel.load();
+    const quint8 ins = apdu.size() >= 2 ? static_cast<quint8>(apdu[1]) : 0;
+    int timeoutMs = 0;
+    bool enforced = false;
+    if (policy) {
+        timeoutMs = policy->timeoutFor(model, ins);
+        enforced = m_backend->setTransmitTimeout(timeoutMs);
+    }
+    
+    QElapsedTimer elapsed;
+    elapsed.start();
+    QByteArray response;
+    try {
+        response = m_backend->transmit(apdu);
+    } catch (const std::runtime_error& e) {
+        // An enforced timeout expiring, rather than the card going away
+        // (the backend's wait may end a few ms short of the deadline)
+        if (enforced && elapsed.elapsed() + 20 >= timeoutMs) {
+            qWarning() << "KeycardChannel::transmit(): INS" << QString("0x%1").arg(ins, 2, 16, QChar('0'))
+                       << "timed out after" << timeoutMs << "ms";
+            policy->recordTimeout(model, ins);
+            throw TransportTimeoutError(e.what());
+        }
+        throw;
+    }
+    if (policy) {
+        policy->record(model, ins, elapsed.elapsed());
+    }
     
     // Handle incomplete response (T=0 protocol, ISO 7816-4)
     // SW1 = 0x61 means "response bytes still available", SW2 = bytes remaining
@@ -230,10 +481,91 @@ QByteArray KeycardChannel::transmit(const QByteArray& apdu)
 
 bool KeycardChannel::isConnected() const
 {
-    if (m_backend) {
+    // Called from the communication thread too: m_backend is only read once
+    // the (deferred) backend has been published through m_backendReady
+    if (m_backendReady.load()) {
         return m_backend->isConnected();
     }
     return false;
 }
 
+KeycardChannel::PresenceMark KeycardChannel::presenceMark() const
+{
+    QMutexLocker locker(&m_presenceMutex);
+    PresenceMark mark;
+    mark.detections = m_detections;
+    mark.errors = m_errors;
+    return mark;
+}
+
+bool KeycardChannel::isTargetPresent() const
+{
+    QMutexLocker locker(&m_presenceMutex);
+    return m_targetPresent;
+}
+
+bool KeycardChannel::canWaitForTarget() const
+{
+    if (QThread::currentThread() != thread()) {
+        return true;
+    }
+    return m_backend && m_backend->detectsOffThread();
+}
+
+KeycardChannel::WaitResult KeycardChannel::waitForTarget(const PresenceMark& since, int timeoutMs)
+{
+    const bool ownThread = QThread::currentThread() == thread();
+    if (ownThread && !m_backend) {
+        // The queued creation cannot run while this thread waits
+        createPendingBackend();
+    }
+    
+    if (isConnected()) {
+        return WaitResult::Detected;
+    }
+    
+    QDeadlineTimer deadline(timeoutMs);
+    
+    QMutexLocker locker(&m_presenceMutex);
+    quint64 seenBackendEvents = m_backendEvents;
+    
+    while (true) {
+        if (m_detections > since.detections) {
+            return WaitResult::Detected;
+        }
+        if (m_errors > since.errors) {
+            return WaitResult::Error;
+        }
+        
+        if (ownThread && m_backendEvents != seenBackendEvents) {
+            // The backend's signal is queued to us but this thread is blocked
+            // here: deliver our own events only, no nested event loop
+            seenBackendEvents = m_backendEvents;
+            locker.unlock();
+            QCoreApplication::sendPostedEvents(this, QEvent::MetaCall);
+            locker.relock();
+            continue;
+        }
+        
+        QDeadlineTimer wakeAt = deadline;
+        if (ownThread && m_settleTimer.isActive()) {
+            // Timers do not fire while this thread is blocked here
+            const int settleLeftMs = m_settleTimer.remainingTime();
+            if (settleLeftMs <= 0) {
+                locker.unlock();
+                m_settleTimer.stop();
+                onSettled();
+                locker.relock();
+                continue;
+            }
+            wakeAt = qMin(deadline, QDeadlineTimer(settleLeftMs));
+        }
+        
+        if (deadline.hasExpired()) {
+            return WaitResult::Timeout;
+        }
+        m_presenceChanged.wait(&m_presenceMutex, wakeAt);
+    }
+}
+
 } // namespace Keycard
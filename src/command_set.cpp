@@ -1,14 +1,16 @@
 #include "keycard-qt/command_set.h"
 #include "keycard-qt/keycard_channel.h"
+#include "keycard-qt/metrics.h"
+#include "keycard-qt/transport_timeout_policy.h"
 #include "keycard-qt/backends/keycard_channel_backend.h"
 #include "keycard-qt/pairing_storage.h"
 #include "keycard-qt/globalplatform/gp_command_set.h"
 #include "keycard-qt/globalplatform/gp_constants.h"
+#include "keycard-core/derivation_path.h"
 #include <QDebug>
 #include <QCryptographicHash>
 #include <QMessageAuthenticationCode>
 #include <QRandomGenerator>
-#include <QIODevice>
 #include <QThread>
 #include <QEventLoop>
 #include <QTimer>
@@ -24,6 +26,36 @@ namespace Keycard {
 static const QByteArray KEYCARD_DEFAULT_INSTANCE_AID =
     QByteArray::fromHex("A00000080400010101");
 
+// How long openSecureChannel()/init() wait for a background ECDH derivation
+// that is already running before doing the work themselves
+static constexpr int PREPARED_SECRET_WAIT_MS = 500;
+
+// Commands that may be sent twice with the same outcome: the card reads
+// state, or derives from the master key and signs/exports without changing
+// its current key. Only these are replayed after a secure channel resync (the
+// first attempt may have been executed by the card). Derivations from the
+// parent or current key, and those that make the result current, would
+// derive twice.
+static bool isIdempotentCommand(const APDU::Command& cmd)
+{
+    const uint8_t deriveSource = cmd.p1() & (APDU::P1DeriveKeyFromParent | APDU::P1DeriveKeyFromCurrent);
+    const uint8_t mode = cmd.p1() & ~(APDU::P1DeriveKeyFromParent | APDU::P1DeriveKeyFromCurrent);
+
+    switch (cmd.ins()) {
+    case APDU::INS_GET_STATUS:
+    case APDU::INS_GET_DATA:
+        return true;
+    case APDU::INS_EXPORT_KEY:
+        return deriveSource == APDU::P1DeriveKeyFromMaster
+            && (mode == APDU::P1ExportKeyCurrent || mode == APDU::P1ExportKeyDerive);
+    case APDU::INS_SIGN:
+        return deriveSource == APDU::P1DeriveKeyFromMaster
+            && (mode == APDU::P1SignCurrentKey || mode == APDU::P1SignDerive || mode == APDU::P1SignPinless);
+    default:
+        return false;
+    }
+}
+
 // Helper: PBKDF2-HMAC-SHA256 for pairing password derivation
 static QByteArray derivePairingToken(const QString& password)
 {
@@ -76,6 +108,7 @@ CommandSet::CommandSet(std::shared_ptr<Keycard::KeycardChannel> channel,
     , m_channel(channel)
     , m_pairingStorage(pairingStorage)
     , m_passwordProvider(passwordProvider)
+    , m_ecdhSecretCache(std::make_shared<EcdhSecretCache>())
     , m_secureChannel(new SecureChannel(channel.get()))
 {   
     if (!m_channel) {
@@ -101,10 +134,16 @@ CommandSet::CommandSet(std::shared_ptr<Keycard::KeycardChannel> channel,
             this, &CommandSet::onTargetLost,
             Qt::DirectConnection);
     
+    // Lets the channel skip re-initialization when a flapping card kept its session
+    m_channel->setSessionProbe([this]() { return probeSession(); });
+    
     qDebug() << "CommandSet: Initialized with direct channel connections";
 }
 
 CommandSet::~CommandSet() {
+    if (m_channel) {
+        m_channel->setSessionProbe(nullptr);
+    }
 };
 
 bool CommandSet::checkOK(const APDU::Response& response)
@@ -149,6 +188,20 @@ ApplicationInfo CommandSet::select(bool force)
     
     // Parse application info
     m_appInfo = parseApplicationInfo(response.data());
+    forgetCurrentKeyPath();
+    // A new tap or SELECT: the card may have been used elsewhere since the
+    // status was read
+    invalidateStatus();
+    if (m_appInfo.installed) {
+        m_channel->setCardModel(m_appInfo.appVersion, m_appInfo.appVersionMinor);
+    }
+    
+    // Validate cached metadata against the fresh SELECT response
+    if (m_cardInfoCache) {
+        bool fresh = m_cardInfoCache->updateApplicationInfo(
+            m_appInfo, CardInfoCache::responseHash(response.data()));
+        qDebug() << "CommandSet: Card info cache" << (fresh ? "fresh" : "refreshed");
+    }
     
     // Update card instance UID for pairing management
     // Only initialized cards have instance UIDs and need pairing
@@ -161,9 +214,11 @@ ApplicationInfo CommandSet::select(bool force)
     }
     qDebug() << "CommandSet: Card selected, UID:" << m_cardInstanceUID;
     
-    // Generate ECDH secret if card supports secure channel
-    if (!m_appInfo.secureChannelPublicKey.isEmpty()) {
-        m_secureChannel->generateSecret(m_appInfo.secureChannelPublicKey);
+    // The ECDH secret waits for the first openSecureChannel()/init(), so
+    // identify(), factory reset and other plain flows skip the EC work
+    m_ecdhSecretReady = false;
+    if (m_ecdhPrecompute && m_ecdhSecretCache && !m_appInfo.secureChannelPublicKey.isEmpty()) {
+        m_ecdhSecretCache->prepare(ecdhCacheId(), m_appInfo.secureChannelPublicKey);
     }
     
     return m_appInfo;
@@ -288,7 +343,7 @@ bool CommandSet::openSecureChannel(const PairingInfo& pairingInfo)
     
     // Build OPEN_SECURE_CHANNEL command
     // P1 = pairing index, data = our ephemeral public key
-    QByteArray data = m_secureChannel->rawPublicKey();
+    QByteArray data = ensureEcdhSecret() ? m_secureChannel->rawPublicKey() : QByteArray();
     
     if (data.isEmpty()) {
         m_lastError = "No public key available - secure channel not initialized";
@@ -340,21 +395,44 @@ bool CommandSet::openSecureChannel(const PairingInfo& pairingInfo)
 
     m_needsSecureChannelReestablishment = false;
     
-    // Cache status after opening secure channel (matching status-keycard-go)
-    // This avoids blocking getStatus() calls later
-    try {
-        m_cachedStatus = getStatus();
-        m_hasCachedStatus = true;
-        qDebug() << "CommandSet: Cached status - PIN retries:" << m_cachedStatus.pinRetryCount
-                 << "PUK retries:" << m_cachedStatus.pukRetryCount;
-    } catch (...) {
-        qWarning() << "CommandSet: Failed to cache status after opening secure channel";
-        m_hasCachedStatus = false;
-    }
+    // Status is fetched lazily by applicationStatus(); re-opening the channel
+    // to the same card does not change it
+    return true;
+}
 
+bool CommandSet::ensureEcdhSecret()
+{
+    if (m_ecdhSecretReady) {
+        return true;
+    }
+    const QByteArray cardPublicKey = m_appInfo.secureChannelPublicKey;
+    if (cardPublicKey.isEmpty()) {
+        return false;
+    }
+    
+    // A returning card's secret was derived in the background after its
+    // previous session, or after this SELECT with precompute enabled
+    SecureChannel::EcdhSecret prepared;
+    if (m_ecdhSecretCache
+        && m_ecdhSecretCache->take(ecdhCacheId(), cardPublicKey, prepared, PREPARED_SECRET_WAIT_MS)) {
+        m_secureChannel->adoptSecret(prepared);
+    } else if (!m_secureChannel->generateSecret(cardPublicKey)) {
+        return false;
+    }
+    m_ecdhSecretReady = true;
+    
+    // Prepared secrets are single-use: derive the next session's now
+    if (m_ecdhSecretCache && !m_appInfo.instanceUID.isEmpty()) {
+        m_ecdhSecretCache->prepare(m_appInfo.instanceUID, cardPublicKey);
+    }
     return true;
 }
 
+QByteArray CommandSet::ecdhCacheId() const
+{
+    return m_appInfo.instanceUID.isEmpty() ? m_appInfo.secureChannelPublicKey : m_appInfo.instanceUID;
+}
+
 bool CommandSet::mutualAuthenticate()
 {
     // Generate random 32-byte challenge
@@ -412,8 +490,8 @@ bool CommandSet::init(const Secrets& secrets)
     
     qDebug() << "CommandSet: Pairing token derived:" << pairingToken.left(16).toHex() << "...";
     
-    // Encrypt with one-shot encryption (using shared secret from SELECT)
-    QByteArray encryptedData = m_secureChannel->oneShotEncrypt(plainData);
+    // Encrypt with one-shot encryption (using the shared secret with the card's SELECT key)
+    QByteArray encryptedData = ensureEcdhSecret() ? m_secureChannel->oneShotEncrypt(plainData) : QByteArray();
     
     if (encryptedData.isEmpty()) {
         m_lastError = "Failed to encrypt INIT data";
@@ -435,14 +513,10 @@ bool CommandSet::init(const Secrets& secrets)
     m_cachedPIN = secrets.pin.toUtf8();
     resetSecureChannel();
     
-    try {
-        m_cachedStatus = getStatus();
-        m_hasCachedStatus = true;
-        qDebug() << "CommandSet: Updated cached status after PIN verification - PIN retries:" 
-                    << m_cachedStatus.pinRetryCount << "PUK retries:" << m_cachedStatus.pukRetryCount;
-    } catch (...) {
-        qWarning() << "CommandSet: Failed to update cached status after PIN verification";
-    }
+    // Retry limits depend on how the applet was built: read them back lazily
+    m_cachedStatus = ApplicationStatus();
+    m_hasCachedStatus = false;
+    invalidateStatus();
     
     return true;
 }
@@ -468,7 +542,32 @@ ApplicationStatus CommandSet::getStatus(uint8_t info)
         return ApplicationStatus();
     }
     
-    return parseApplicationStatus(resp.data());
+    ApplicationStatus status = parseApplicationStatus(resp.data());
+    if (info == APDU::P1GetStatusApplication && status.valid) {
+        m_cachedStatus = status;
+        m_hasCachedStatus = true;
+        m_statusStale = false;
+        qDebug() << "CommandSet: Cached status - PIN retries:" << m_cachedStatus.pinRetryCount
+                 << "PUK retries:" << m_cachedStatus.pukRetryCount;
+    }
+    
+    return status;
+}
+
+ApplicationStatus CommandSet::applicationStatus()
+{
+    if (!isStatusStale()) {
+        return m_cachedStatus;
+    }
+    
+    qDebug() << "CommandSet::applicationStatus(): Cached status is stale, sending GET STATUS";
+    try {
+        getStatus(APDU::P1GetStatusApplication);
+    } catch (const std::runtime_error& e) {
+        qWarning() << "CommandSet: Failed to refresh status:" << e.what();
+    }
+    
+    return m_cachedStatus;
 }
 
 bool CommandSet::verifyPIN(const QString& pin)
@@ -480,14 +579,10 @@ bool CommandSet::verifyPIN(const QString& pin)
 
     // Check for wrong PIN (SW1=0x63, SW2=0xCX where X = remaining attempts)
     if ((resp.sw() & 0x63C0) == 0x63C0) {
+        // The status word already carries the retry count, no GET STATUS needed
         m_cachedStatus.pinRetryCount = resp.sw() & 0x000F;
         m_lastError = QString("Wrong PIN. Remaining attempts: %1").arg(m_cachedStatus.pinRetryCount);
         qWarning() << m_lastError;
-        
-        // Update cached status with remaining attempts from error response
-        m_cachedStatus.pinRetryCount = m_cachedStatus.pinRetryCount;
-        m_hasCachedStatus = true;  // Even with error, we have current retry count
-        
         return false;
     }
     
@@ -497,16 +592,9 @@ bool CommandSet::verifyPIN(const QString& pin)
         m_wasAuthenticated = true;
         m_cachedPIN = pin;
     }
-
-    // Update cached status after PIN verification (matching status-keycard-go)
-    try {
-        m_cachedStatus = getStatus();
-        m_hasCachedStatus = true;
-        qDebug() << "CommandSet: Updated cached status after PIN verification - PIN retries:" 
-                    << m_cachedStatus.pinRetryCount << "PUK retries:" << m_cachedStatus.pukRetryCount;
-    } catch (...) {
-        qWarning() << "CommandSet: Failed to update cached status after PIN verification";
-    }
+    // The applet resets the PIN counter to a limit only GET STATUS reports
+    invalidateStatus();
+    
     return result;
 }
 
@@ -514,42 +602,63 @@ bool CommandSet::verifyPIN(const QString& pin)
 static QByteArray parseDerivationPath(const QString& path, uint8_t& startingPoint)
 {
     // Parse path like "m/44'/60'/0'/0/0" or "../0/0"
-    QByteArray result;
-    QDataStream stream(&result, QIODevice::WriteOnly);
-    stream.setByteOrder(QDataStream::BigEndian);
-    
-    QString cleanPath = path.trimmed();
-    
-    if (cleanPath.startsWith("m/")) {
+    const Core::DerivationPath parsed = Core::DerivationPath::parse(path.toStdString());
+    switch (parsed.start) {
+    case Core::DerivationPath::Start::Master:
         startingPoint = APDU::P1DeriveKeyFromMaster;
-        cleanPath = cleanPath.mid(2);  // Remove "m/"
-    } else if (cleanPath.startsWith("../")) {
+        break;
+    case Core::DerivationPath::Start::Parent:
         startingPoint = APDU::P1DeriveKeyFromParent;
-        cleanPath = cleanPath.mid(3);  // Remove "../"
-    } else if (cleanPath.startsWith("./")) {
-        startingPoint = APDU::P1DeriveKeyFromCurrent;
-        cleanPath = cleanPath.mid(2);  // Remove "./"
-    } else {
+        break;
+    case Core::DerivationPath::Start::Current:
         startingPoint = APDU::P1DeriveKeyFromCurrent;
+        break;
     }
     
-    if (cleanPath.isEmpty()) {
-        return result;
-    }
+    Core::Bytes encoded;
+    parsed.encode(encoded);
+    return QByteArray(reinterpret_cast<const char*>(encoded.data()), static_cast<int>(encoded.size()));
+}
+
+QByteArray CommandSet::encodeDerivationPath(const QString& path, uint8_t& startingPoint) const
+{
+    QByteArray pathData = parseDerivationPath(path, startingPoint);
     
-    QStringList segments = cleanPath.split('/');
-    for (const QString& segment : segments) {
-        bool ok;
-        uint32_t value = segment.endsWith("'") || segment.endsWith("h")
-            ? segment.left(segment.length() - 1).toUInt(&ok) | 0x80000000
-            : segment.toUInt(&ok);
-        
-        if (ok) {
-            stream << value;
-        }
+    // Below the current key: only derive the remaining segments on the card
+    if (m_deriveFromCurrent && startingPoint == APDU::P1DeriveKeyFromMaster && m_currentKeyPathKnown
+        && !m_currentKeyPath.isEmpty() && pathData.size() > m_currentKeyPath.size()
+        && pathData.startsWith(m_currentKeyPath)) {
+        startingPoint = APDU::P1DeriveKeyFromCurrent;
+        return pathData.mid(m_currentKeyPath.size());
     }
     
-    return result;
+    return pathData;
+}
+
+void CommandSet::setCurrentKeyPath(const QString& path)
+{
+    uint8_t startingPoint = APDU::P1DeriveKeyFromMaster;
+    QByteArray pathData = parseDerivationPath(path, startingPoint);
+    
+    if (startingPoint == APDU::P1DeriveKeyFromMaster) {
+        m_currentKeyPath = pathData;
+        m_currentKeyPathKnown = true;
+    } else if (!m_currentKeyPathKnown) {
+        return;
+    } else if (startingPoint == APDU::P1DeriveKeyFromCurrent) {
+        m_currentKeyPath.append(pathData);
+    } else if (m_currentKeyPath.size() >= 4) {
+        m_currentKeyPath.chop(4);
+        m_currentKeyPath.append(pathData);
+    } else {
+        forgetCurrentKeyPath();
+    }
+}
+
+void CommandSet::forgetCurrentKeyPath()
+{
+    m_currentKeyPath.clear();
+    m_currentKeyPathKnown = false;
 }
 
 // Security operations
@@ -591,6 +700,8 @@ bool CommandSet::unblockPIN(const QString& puk, const QString& newPIN)
         return false;
     }
     
+    // Both counters are reset by a successful unblock, to limits only GET STATUS reports
+    invalidateStatus();
     return checkOK(resp);
 }
 
@@ -618,7 +729,13 @@ QByteArray CommandSet::generateKey()
         return QByteArray();
     }
     
-    // Response is the key UID (32 bytes)
+    invalidateCardInfoCache();
+    invalidateStatus();
+    forgetCurrentKeyPath();
+    
+    // Response is the key UID (32 bytes), which SELECT would now report:
+    // results cached for the previous key must not match it
+    m_appInfo.keyUID = resp.data();
     return resp.data();
 }
 
@@ -662,7 +779,13 @@ QByteArray CommandSet::loadSeed(const QByteArray& seed)
         return QByteArray();
     }
     
-    // Response is the key UID (32 bytes)
+    // Key UID changed - metadata cached for the old key is no longer valid
+    invalidateCardInfoCache();
+    invalidateStatus();
+    forgetCurrentKeyPath();
+    
+    // Response is the key UID (32 bytes), which SELECT would now report
+    m_appInfo.keyUID = resp.data();
     return resp.data();
 }
 
@@ -673,7 +796,15 @@ bool CommandSet::removeKey()
     APDU::Command cmd = buildCommand(APDU::INS_REMOVE_KEY, 0, 0);
     APDU::Response resp = send(cmd, true);
     
-    return checkOK(resp);
+    if (!checkOK(resp)) {
+        return false;
+    }
+    
+    invalidateCardInfoCache();
+    invalidateStatus();
+    forgetCurrentKeyPath();
+    m_appInfo.keyUID.clear();
+    return true;
 }
 
 bool CommandSet::deriveKey(const QString& path)
@@ -681,12 +812,19 @@ bool CommandSet::deriveKey(const QString& path)
     qDebug() << "CommandSet::deriveKey() path:" << path;
     
     uint8_t startingPoint = APDU::P1DeriveKeyFromMaster;
-    QByteArray pathData = parseDerivationPath(path, startingPoint);
+    QByteArray pathData = encodeDerivationPath(path, startingPoint);
     
     APDU::Command cmd = buildCommand(APDU::INS_DERIVE_KEY, startingPoint, 0, pathData);
     APDU::Response resp = send(cmd, true);
     
-    return checkOK(resp);
+    if (!checkOK(resp)) {
+        return false;
+    }
+    
+    // Current path changed
+    setCurrentKeyPath(path);
+    invalidateStatus();
+    return true;
 }
 
 // Signing
@@ -744,6 +882,11 @@ QByteArray CommandSet::signWithPath(const QByteArray& data, const QString& path,
         return QByteArray();
     }
     
+    if (makeCurrent) {
+        setCurrentKeyPath(path);
+        invalidateStatus();
+    }
+    
     // Skip public key, return signature
     QByteArray fullResp = resp.data();
     if (fullResp.size() > 65) {
@@ -778,6 +921,11 @@ QByteArray CommandSet::signWithPathFullResponse(const QByteArray& data, const QS
         return QByteArray();
     }
     
+    if (makeCurrent) {
+        setCurrentKeyPath(path);
+        invalidateStatus();
+    }
+    
     // Return the full TLV response (includes public key and signature)
     return resp.data();
 }
@@ -837,13 +985,32 @@ bool CommandSet::storeData(uint8_t type, const QByteArray& data)
     APDU::Command cmd = buildCommand(APDU::INS_STORE_DATA, type, 0, data);
     APDU::Response resp = send(cmd, true);
     
-    return checkOK(resp);
+    if (!checkOK(resp)) {
+        return false;
+    }
+    
+    // Write-through: the card now holds exactly what we sent
+    if (m_cardInfoCache && type == APDU::P1StoreDataPublic) {
+        m_cardInfoCache->storeMetadata(m_appInfo.instanceUID, m_appInfo.keyUID, data);
+    }
+    
+    return true;
 }
 
 QByteArray CommandSet::getData(uint8_t type)
 {
     qDebug() << "CommandSet::getData() type:" << type;
     
+    // Read-through: public data only changes via storeData(), serve it from cache
+    if (m_cardInfoCache && type == APDU::P1StoreDataPublic) {
+        QByteArray cached;
+        if (m_cardInfoCache->metadata(m_appInfo.instanceUID, m_appInfo.keyUID, cached)) {
+            qDebug() << "CommandSet::getData(): Served from card info cache";
+            m_lastError.clear();
+            return cached;
+        }
+    }
+    
     APDU::Command cmd = buildCommand(APDU::INS_GET_DATA, type, 0);
     APDU::Response resp = send(cmd, true);
     
@@ -851,6 +1018,10 @@ QByteArray CommandSet::getData(uint8_t type)
         return QByteArray();
     }
     
+    if (m_cardInfoCache && type == APDU::P1StoreDataPublic) {
+        m_cardInfoCache->storeMetadata(m_appInfo.instanceUID, m_appInfo.keyUID, resp.data());
+    }
+    
     return resp.data();
 }
 
@@ -889,7 +1060,7 @@ QByteArray CommandSet::exportKey(bool derive, bool makeCurrent, const QString& p
 
     if (derive) {
         uint8_t startingPoint = APDU::P1DeriveKeyFromMaster;
-        pathData = parseDerivationPath(path, startingPoint);
+        pathData = encodeDerivationPath(path, startingPoint);
         p1 = makeCurrent ? APDU::P1ExportKeyDeriveAndMakeCurrent : APDU::P1ExportKeyDerive;
         p1 |= startingPoint;
     }
@@ -903,6 +1074,11 @@ QByteArray CommandSet::exportKey(bool derive, bool makeCurrent, const QString& p
         m_lastError = QString("EXPORT_KEY failed with SW: 0x%1").arg(resp.sw(), 4, 16, QChar('0'));
         return QByteArray();
     }
+    
+    if (derive && makeCurrent) {
+        setCurrentKeyPath(path);
+        invalidateStatus();
+    }
 
     return resp.data();
 }
@@ -914,7 +1090,7 @@ QByteArray CommandSet::exportKeyExtended(bool derive, bool makeCurrent, const QS
     
     if (derive) {
         uint8_t startingPoint = APDU::P1DeriveKeyFromMaster;
-        pathData = parseDerivationPath(path, startingPoint);
+        pathData = encodeDerivationPath(path, startingPoint);
         p1 = makeCurrent ? APDU::P1ExportKeyDeriveAndMakeCurrent : APDU::P1ExportKeyDerive;
         p1 |= startingPoint;
     }
@@ -929,6 +1105,11 @@ QByteArray CommandSet::exportKeyExtended(bool derive, bool makeCurrent, const QS
         return QByteArray();
     }
     
+    if (derive && makeCurrent) {
+        setCurrentKeyPath(path);
+        invalidateStatus();
+    }
+    
     return resp.data();
 }
 
@@ -939,14 +1120,18 @@ void CommandSet::factoryResetCleanup()
         qDebug() << "CommandSet::factoryReset(): Removing pairing from storage";
         m_pairingStorage->remove(m_appInfo.instanceUID.toHex());
     }
+    invalidateCardInfoCache();
     // Clean up local state after successful factory reset
     m_secureChannel->reset();
     m_appInfo = ApplicationInfo();
+    m_ecdhSecretReady = false;
     m_pairingInfo = PairingInfo();
     m_cardInstanceUID.clear();
     m_wasAuthenticated = false;
     m_cachedPIN.clear();
     m_cachedStatus = Keycard::ApplicationStatus();
+    invalidateStatus();
+    forgetCurrentKeyPath();
     select(true);
 }
 
@@ -1064,6 +1249,18 @@ bool CommandSet::factoryResetFallback()
     return true;
 }
 
+void CommandSet::invalidateCardInfoCache()
+{
+    if (m_cardInfoCache && !m_appInfo.instanceUID.isEmpty()) {
+        m_cardInfoCache->invalidate(m_appInfo.instanceUID);
+    }
+}
+
+void CommandSet::invalidateStatus()
+{
+    m_statusStale = true;
+}
+
 void CommandSet::resetSecureChannel()
 {
     qDebug() << "CommandSet::resetSecureChannel() called - secure channel crypto state will be reset";
@@ -1127,6 +1324,74 @@ bool CommandSet::reestablishSecureChannel()
     return true;
 }
 
+APDU::Response CommandSet::resyncAndReplay(const APDU::Command& cmd, bool macMismatch)
+{
+    // The card is still present: recover in place instead of failing over to
+    // a new detection and card initialization
+    qWarning() << "CommandSet::send(): Secure channel desync"
+               << (macMismatch ? "(response MAC mismatch)" : "(SW 6985)") << "- resynchronizing";
+    if (!resyncSecureChannel()) {
+        if (macMismatch) {
+            throw SecureChannelMacError();
+        }
+        return APDU::Response(QByteArray::fromHex("6985"));
+    }
+
+    if (!isIdempotentCommand(cmd)) {
+        // The card may already have executed it: let the caller decide. A
+        // derivation may have moved the current key
+        forgetCurrentKeyPath();
+        m_lastError = "Secure channel resynchronized, command not replayed";
+        qWarning() << "CommandSet::send():" << m_lastError;
+        return APDU::Response(QByteArray::fromHex("6985"));
+    }
+
+    qDebug() << "CommandSet::send(): Replaying command after resync";
+    Metrics::increment(QStringLiteral("secure_channel.resync_replayed"));
+    m_resyncing = true;
+    try {
+        APDU::Response resp = m_secureChannel->send(cmd);
+        m_resyncing = false;
+        return resp;
+    } catch (...) {
+        m_resyncing = false;
+        throw;
+    }
+}
+
+bool CommandSet::resyncSecureChannel()
+{
+    qDebug() << "CommandSet::resyncSecureChannel()";
+
+    if (m_resyncing) {
+        return false;
+    }
+
+    // verifyPIN() inside reestablishSecureChannel() sends through the secure
+    // channel: a failure there must not start another recovery
+    m_resyncing = true;
+    bool reopened = false;
+    try {
+        resetSecureChannel();
+        reopened = m_channel && m_channel->isConnected() && reestablishSecureChannel();
+    } catch (...) {
+        // Card lost during the recovery
+        m_resyncing = false;
+        Metrics::increment(QStringLiteral("secure_channel.resync_failed"));
+        throw;
+    }
+    m_resyncing = false;
+
+    if (!reopened) {
+        qWarning() << "CommandSet::resyncSecureChannel(): Failed:" << m_lastError;
+        Metrics::increment(QStringLiteral("secure_channel.resync_failed"));
+        return false;
+    }
+
+    Metrics::increment(QStringLiteral("secure_channel.resync"));
+    return true;
+}
+
 bool CommandSet::ensurePairing()
 {
     qDebug() << "CommandSet::ensurePairing() for card:" << m_cardInstanceUID;
@@ -1249,13 +1514,16 @@ void CommandSet::handleCardSwap()
     
     // Clear cached status (invalidate on card swap)
     m_hasCachedStatus = false;
+    m_statusStale = true;
     m_cachedStatus = ApplicationStatus();
+    forgetCurrentKeyPath();
     
     // Clear pairing info (old card's pairing)
     m_pairingInfo = PairingInfo();
     
     // Clear app info (old card's metadata)
     m_appInfo = ApplicationInfo();
+    m_ecdhSecretReady = false;
     
     qWarning() << "CommandSet: All state cleared - flow must restart with new card";
 }
@@ -1280,6 +1548,46 @@ bool CommandSet::waitForCard(int timeoutMs)
         return true;
     }
     
+    if (!m_channel || !m_channel->canWaitForTarget()) {
+        // Detection needs this thread's event loop
+        return waitForCardInternal(timeoutMs);
+    }
+    
+    // Only events after this point count
+    const KeycardChannel::PresenceMark mark = m_channel->presenceMark();
+    
+    bool success = QMetaObject::invokeMethod(
+        m_channel.get(),
+        [this]() {
+            m_channel->setState(Keycard::ChannelState::WaitingForCard);
+        }
+    );
+    
+    if (!success) {
+        qWarning() << "CommandSet::waitForCard(): Failed to set channel state to WaitingForCard";
+        return false;
+    }
+    
+    // Block on the channel's presence latch: no nested event loop, woken
+    // as soon as the backend reports a card or an error
+    switch (m_channel->waitForTarget(mark, timeoutMs)) {
+    case KeycardChannel::WaitResult::Detected:
+        qDebug() << "CommandSet::waitForCard(): Card successfully detected";
+        return true;
+    case KeycardChannel::WaitResult::Timeout:
+        qDebug() << "CommandSet::waitForCard(): Timeout waiting for card";
+        m_lastError = "Card detection timeout";
+        return false;
+    case KeycardChannel::WaitResult::Error:
+        break;
+    }
+    qWarning() << "CommandSet::waitForCard(): Card detection failed (error or lost)";
+    m_lastError = "Card detection failed";
+    return false;
+}
+
+bool CommandSet::waitForCardInternal(int timeoutMs)
+{
     QEventLoop loop;
     bool cardDetected = false;
     
@@ -1381,14 +1689,44 @@ APDU::Response CommandSet::send(const APDU::Command& cmd, bool secure)
         }
 
         qDebug() << "CommandSet::send(): Sending via secure channel";
+        bool macMismatch = false;
         try {
-            return m_secureChannel->send(cmd);
+            bool plain = false;
+            APDU::Response resp = m_secureChannel->send(cmd, &plain);
+            // A bare SW 0x6985 means the card dropped its session (it rejects
+            // secure commands until OPEN SECURE CHANNEL). An encrypted 0x6985
+            // is the applet's own refusal (PIN not verified, no key loaded...)
+            if (m_resyncing || !plain || resp.sw() != APDU::SW_CONDITIONS_NOT_SATISFIED) {
+                return resp;
+            }
+        }
+        catch (const SecureChannelMacError& e) {
+            qWarning() << "CommandSet::send(): Failed to send via secure channel:" << e.what();
+            if (m_resyncing) {
+                throw;
+            }
+            macMismatch = true;
+        }
+        catch (const TransportTimeoutError& e) {
+            qWarning() << "CommandSet::send(): Secure channel exchange timed out:" << e.what();
+            // The card may have run the command: the session is re-opened
+            // before the next one
+            resetSecureChannel();
+            if (m_resyncing || isIdempotentCommand(cmd)) {
+                throw;  // Safe to run again (CommunicationManager re-queues it)
+            }
+            forgetCurrentKeyPath();
+            invalidateStatus();
+            Metrics::increment(QStringLiteral("secure_channel.timeout_not_replayed"));
+            m_lastError = "Transport timed out, command not replayed";
+            return APDU::Response(QByteArray::fromHex("6985"));
         }
         catch (const std::runtime_error& e) {
             qWarning() << "CommandSet::send(): Failed to send via secure channel:" << e.what();
             // Return error response
             throw std::runtime_error(e.what());
         }
+        return resyncAndReplay(cmd, macMismatch);
     } else {
     // 3. Send directly via channel (no secure channel)
         qDebug() << "CommandSet::send(): Sending directly (no secure channel)";
@@ -1418,7 +1756,7 @@ void CommandSet::startDetection() {
         return;
     }
     
-    // This runs on main thread, so it's safe to call directly
+    // Runs on the CommandSet's own thread (main, or the I/O thread in single-thread mode)
     m_channel->setState(ChannelState::WaitingForCard);
     emit channelStateChanged(ChannelState::WaitingForCard);
 }
@@ -1435,7 +1773,7 @@ void CommandSet::stopDetection() {
     // This ensures that when detection restarts, the secure channel will be properly re-established
     resetSecureChannel();
     
-    // This runs on main thread, so it's safe to call directly
+    // Runs on the CommandSet's own thread (main, or the I/O thread in single-thread mode)
     m_channel->setState(ChannelState::Idle);
     emit channelStateChanged(ChannelState::Idle);
 }
@@ -1459,6 +1797,21 @@ void CommandSet::onTargetDetected(const QString& uid) {
     emit cardReady(uid);
 }
 
+bool CommandSet::probeSession() {
+    if (!m_secureChannel || !m_secureChannel->isOpen()) {
+        return false;
+    }
+    
+    try {
+        APDU::Response resp = m_secureChannel->send(buildCommand(APDU::INS_GET_STATUS, APDU::P1GetStatusApplication));
+        qDebug() << "CommandSet::probeSession(): SW" << QString::number(resp.sw(), 16);
+        return resp.isOK();
+    } catch (const std::runtime_error& e) {
+        qDebug() << "CommandSet::probeSession(): Session lost:" << e.what();
+        return false;
+    }
+}
+
 void CommandSet::onTargetLost() {
     qDebug() << "CommandSet::onTargetLost"
              << "(thread:" << QThread::currentThreadId() << ")";
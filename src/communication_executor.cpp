@@ -0,0 +1,129 @@
+#include "keycard-qt/communication_executor.h"
+#include <QCoreApplication>
+#include <QDebug>
+#include <algorithm>
+
+namespace Keycard {
+
+namespace {
+
+// Joining an idle thread only takes the time to leave its event loop
+constexpr int kJoinTimeoutMs = 5000;
+
+QThread* startEventLoopThread(const QString& name) {
+    // QThread::run() runs exec(): all card operations are processed
+    // through queued calls on this thread
+    QThread* thread = new QThread();
+    thread->setObjectName(name);
+    thread->start();
+    return thread;
+}
+
+void joinEventLoopThread(QThread* thread, bool idle) {
+    thread->quit();
+    if (!thread->wait(idle ? kJoinTimeoutMs : 0)) {
+        qWarning() << "CommunicationExecutor: Thread did not stop gracefully, forcing termination";
+        thread->terminate();
+        thread->wait(1000);
+    }
+    delete thread;
+}
+
+} // namespace
+
+// ============================================================================
+// DedicatedThreadExecutor
+// ============================================================================
+
+QThread* DedicatedThreadExecutor::acquire() {
+    return startEventLoopThread("CommunicationThread");
+}
+
+void DedicatedThreadExecutor::release(QThread* thread, bool idle) {
+    if (thread) {
+        joinEventLoopThread(thread, idle);
+    }
+}
+
+// ============================================================================
+// SharedThreadExecutor
+// ============================================================================
+
+SharedThreadExecutor::SharedThreadExecutor(int threadCount)
+    : m_workers(static_cast<size_t>(std::max(1, threadCount)))
+{
+}
+
+SharedThreadExecutor::~SharedThreadExecutor() {
+    QMutexLocker locker(&m_mutex);
+    for (Worker& worker : m_workers) {
+        if (!worker.thread) {
+            continue;
+        }
+        if (worker.managers > 0) {
+            qWarning() << "SharedThreadExecutor: Destroyed with" << worker.managers << "managers still running";
+        }
+        joinEventLoopThread(worker.thread, true);
+        worker.thread = nullptr;
+    }
+}
+
+QThread* SharedThreadExecutor::acquire() {
+    QMutexLocker locker(&m_mutex);
+    auto least = std::min_element(m_workers.begin(), m_workers.end(),
+        [](const Worker& a, const Worker& b) { return a.managers < b.managers; });
+
+    if (!least->thread) {
+        int index = static_cast<int>(least - m_workers.begin());
+        least->thread = startEventLoopThread(QString("CommunicationThread-%1").arg(index));
+    }
+    least->managers++;
+    return least->thread;
+}
+
+void SharedThreadExecutor::release(QThread* thread, bool idle) {
+    QMutexLocker locker(&m_mutex);
+    for (Worker& worker : m_workers) {
+        if (worker.thread == thread && worker.managers > 0) {
+            worker.managers--;
+            if (!idle) {
+                // Other managers depend on this thread: it cannot be terminated
+                qWarning() << "SharedThreadExecutor: Manager released a busy thread:" << thread;
+            }
+            return;
+        }
+    }
+    qWarning() << "SharedThreadExecutor: Released unknown thread:" << thread;
+}
+
+int SharedThreadExecutor::threadCount() const {
+    QMutexLocker locker(&m_mutex);
+    return static_cast<int>(m_workers.size());
+}
+
+int SharedThreadExecutor::managerCount() const {
+    QMutexLocker locker(&m_mutex);
+    int count = 0;
+    for (const Worker& worker : m_workers) {
+        count += worker.managers;
+    }
+    return count;
+}
+
+// ============================================================================
+// EventLoopExecutor
+// ============================================================================
+
+EventLoopExecutor::EventLoopExecutor(QThread* thread)
+    : m_thread(thread)
+{
+}
+
+QThread* EventLoopExecutor::acquire() {
+    if (m_thread) {
+        return m_thread;
+    }
+    return QCoreApplication::instance() ? QCoreApplication::instance()->thread() : QThread::currentThread();
+}
+
+} // namespace Keycard
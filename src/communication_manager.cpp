@@ -2,29 +2,20 @@
 #include <QDebug>
 #include <QTimer>
 #include <QCoreApplication>
+#include <QDeadlineTimer>
+#include <algorithm>
 
 namespace Keycard {
 
-// ============================================================================
-// CommunicationThread Implementation
-// ============================================================================
+namespace {
 
-void CommunicationManager::CommunicationThread::run() {
-    qDebug() << "CommunicationThread: Starting on thread:" << QThread::currentThread();
-    
-    // CRITICAL: Lock thread for PC/SC operations (like Go's runtime.LockOSThread())
-    // PC/SC requires operations to happen on the same thread that established context
-#if defined(Q_OS_WIN) || defined(Q_OS_MAC) || defined(Q_OS_LINUX)
-    // Platform-specific thread locking happens in PC/SC backend
-    qDebug() << "CommunicationThread: Running on platform requiring thread affinity";
-#endif
-    
-    // Run Qt event loop
-    // All card operations will be processed through queued signals/slots
-    exec();
-    
-    qDebug() << "CommunicationThread: Stopped";
-}
+// Woken sync callers only need to re-acquire m_syncMutex to unregister
+constexpr int kSyncDrainTimeoutMs = 1000;
+
+// Longest stop() waits for the command in progress on the communication thread
+constexpr int kStopTimeoutMs = 5000;
+
+} // namespace
 
 // ============================================================================
 // CommunicationManager Implementation
@@ -32,7 +23,7 @@ void CommunicationManager::CommunicationThread::run() {
 
 CommunicationManager::CommunicationManager(QObject* parent)
     : ICommunicationManager(parent)
-    , m_commThread(nullptr)
+    , m_executor(std::make_shared<DedicatedThreadExecutor>())
     , m_state(State::Idle)
     , m_running(false)
     , m_batchOperations(false)
@@ -45,6 +36,10 @@ CommunicationManager::~CommunicationManager() {
 }
 
 bool CommunicationManager::init(std::shared_ptr<CommandSet> commandSet) {
+    return init(commandSet, ThreadOwnership::SplitThreads);
+}
+
+bool CommunicationManager::init(std::shared_ptr<CommandSet> commandSet, ThreadOwnership ownership) {
     if (m_running) {
         qWarning() << "CommunicationManager: Already initialized";
         return false;
@@ -58,33 +53,56 @@ bool CommunicationManager::init(std::shared_ptr<CommandSet> commandSet) {
     qDebug() << "CommunicationManager: Initializing with CommandSet...";
     
     m_commandSet = commandSet;
+    {
+        QMutexLocker locker(&m_queueMutex);
+        m_commandSet->setDeriveFromCurrent(m_planningEnabled);
+    }
     
-    // Create and start communication thread
-    m_commThread = new CommunicationThread(this);
+    // Acquire the communication thread and move the manager there so all
+    // slots run on it
+    m_homeThread = thread();
+    m_ioThread = m_executor->acquire();
+    moveToThread(m_ioThread);
+    
+    m_ownership = ThreadOwnership::SplitThreads;
+    if (ownership == ThreadOwnership::SingleIoThread) {
+        auto channel = m_commandSet->channel();
+        if (m_commandSet->thread() != QThread::currentThread()) {
+            qWarning() << "CommunicationManager: init() not called on the CommandSet's thread, using split threads";
+        } else if (m_commandSet->parent() || (channel && channel->parent())) {
+            qWarning() << "CommunicationManager: CommandSet or channel has a parent, using split threads";
+        } else {
+            m_cardObjectsHomeThread = m_commandSet->thread();
+            moveCardObjects(m_ioThread);
+            m_ownership = ThreadOwnership::SingleIoThread;
+        }
+    }
     
-    // Move manager to communication thread so all slots run there
-    moveToThread(m_commThread);
+    // Connect to CommandSet signals
+    // Split threads: CommandSet lives on main thread, manager on communication thread
+    // Single I/O thread: both live on the communication thread. Still queued:
+    // cardReady() can be emitted from inside a command's waitForCard(), and
+    // onCardReady() must not run nested in that command
+    const Qt::ConnectionType signalConnection = Qt::QueuedConnection;
     
-    // Connect to CommandSet signals (queued - cross-thread)
-    // CommandSet lives on main thread, manager on communication thread
     connect(m_commandSet.get(), &CommandSet::cardReady,
             this, &CommunicationManager::onCardReady,
-            Qt::QueuedConnection);
+            signalConnection);
     
     connect(m_commandSet.get(), &CommandSet::cardLost,
             this, &CommunicationManager::onCardLost,
-            Qt::QueuedConnection);
+            signalConnection);
     
     connect(m_commandSet.get(), &CommandSet::channelStateChanged,
             this, &CommunicationManager::onChannelStateChanged,
-            Qt::QueuedConnection);
-    
-    m_commThread->start();
+            signalConnection);
     
     m_running = true;
+    publishCardSnapshot();
     setState(State::Idle);
     
-    qDebug() << "CommunicationManager: Initialized successfully with CommandSet";
+    qDebug() << "CommunicationManager: Initialized successfully with CommandSet, ownership:" << m_ownership
+             << "executor:" << m_executor->name();
     qDebug() << "CommunicationManager: CommandSet owns channel - no race conditions!";
     return true;
 }
@@ -100,7 +118,7 @@ bool CommunicationManager::startDetection() {
     
     QMetaObject::invokeMethod(m_commandSet.get(),
                                &CommandSet::startDetection,
-                               Qt::QueuedConnection);
+                               commandSetConnection());
     
     qDebug() << "CommunicationManager: Card detection started via CommandSet";
     return true;
@@ -115,7 +133,7 @@ void CommunicationManager::stopDetection() {
     
     QMetaObject::invokeMethod(m_commandSet.get(),
                                &CommandSet::stopDetection,
-                               Qt::QueuedConnection);
+                               commandSetConnection());
     
     qDebug() << "CommunicationManager: Card detection stopped via CommandSet";
 }
@@ -149,72 +167,133 @@ void CommunicationManager::stop() {
         }
     }
     
-    // Step 5: Wait for all pending sync operations to actually complete
-    // Give threads time to wake up and exit their wait loops
-    qDebug() << "CommunicationManager: Waiting for pending sync operations to complete...";
-    const int maxWaitIterations = 100;  // 100 * 10ms = 1 second max
-    int pendingCount = 0;
-    for (int i = 0; i < maxWaitIterations; ++i) {
-        {
-            QMutexLocker locker(&m_syncMutex);
-            pendingCount = m_pendingSync.size();
-            if (pendingCount == 0) {
-                qDebug() << "CommunicationManager: All sync operations completed";
-                break;
-            }
+    // Step 5: Wait until the woken sync callers have unregistered
+    {
+        QMutexLocker locker(&m_syncMutex);
+        QDeadlineTimer deadline(kSyncDrainTimeoutMs);
+        while (!m_pendingSync.isEmpty() && m_syncMutex.wait(m_syncDrained, deadline)) {
+        }
+        if (!m_pendingSync.isEmpty()) {
+            qWarning() << "CommunicationManager: Still" << m_pendingSync.size() << "pending sync operations after wait";
         }
-        QThread::msleep(10);
-    }
-    
-    if (pendingCount > 0) {
-        qWarning() << "CommunicationManager: Still" << pendingCount << "pending sync operations after wait";
     }
     
     // Step 6: Clear the queue and wake any threads waiting on it
     {
         QMutexLocker locker(&m_queueMutex);
-        std::queue<std::unique_ptr<CardCommand>>().swap(m_queue);
+        m_queue.clear();
         m_queueNotEmpty.wakeAll();
     }
     
-    // Step 7: Stop the communication thread
-    // Note: We check m_running before posting processQueue() events (see executeCommand)
-    // This prevents new events from being posted after stop() begins
-    if (m_commThread) {
-        // CRITICAL: Remove all pending QueuedConnection events for this object
-        // After waking sync threads, processQueue() events may still be in the event queue
-        // We must clear them BEFORE calling quit() to prevent use-after-free
-        QCoreApplication::removePostedEvents(this);
-        
-        qDebug() << "CommunicationManager: Stopping communication thread...";
-        m_commThread->quit();
-        
-        // Wait for thread to finish with a reasonable timeout
-        if (!m_commThread->wait(5000)) {
-            qWarning() << "CommunicationManager: Thread did not stop gracefully, forcing termination";
-            m_commThread->terminate();
-            m_commThread->wait(1000);
-        }
-        
-        delete m_commThread;
-        m_commThread = nullptr;
-        qDebug() << "CommunicationManager: Communication thread stopped";
+    // Step 7: Stop receiving CommandSet signals (init() reconnects)
+    if (m_commandSet) {
+        QObject::disconnect(m_commandSet.get(), nullptr, this, nullptr);
     }
     
-    // Step 8: Final cleanup of any remaining sync operations
+    // Step 8: Leave the communication thread once the slot in progress returns,
+    // then drop whatever was still queued for us
+    // Note: We check m_running before posting processQueue() events (see executeCommand)
+    bool idle = leaveIoThread();
+    QCoreApplication::removePostedEvents(this);
+    
+    // Step 9: Hand the thread back to the executor
+    qDebug() << "CommunicationManager: Releasing communication thread to" << m_executor->name() << "executor";
+    m_executor->release(m_ioThread, idle);
+    m_ioThread = nullptr;
+    
+    // Step 10: Final cleanup of any remaining sync operations
     {
         QMutexLocker locker(&m_syncMutex);
         m_pendingSync.clear();
     }
     
-    // Step 9: Give one final moment for any last cleanup
-    QThread::msleep(50);
-    
     setState(State::Idle);
     
     qDebug() << "CommunicationManager: Stopped";
 }
 
+bool CommunicationManager::leaveIoThread() {
+    QThread* home = m_homeThread;
+    QThread* cardObjectsHome = m_ownership == ThreadOwnership::SingleIoThread ? m_cardObjectsHomeThread : nullptr;
+    auto leave = [this, home, cardObjectsHome]() {
+        if (cardObjectsHome) {
+            moveCardObjects(cardObjectsHome);
+        }
+        moveToThread(home);
+    };
+    
+    bool idle = true;
+    if (QThread::currentThread() == thread()) {
+        leave();
+    } else {
+        // Queued behind the slot in progress and the stopDetection() above.
+        // Abandoned on timeout so it cannot run after stop() has returned.
+        struct Fence {
+            QMutex mutex;
+            QWaitCondition done;
+            bool finished = false;
+            bool abandoned = false;
+        };
+        auto fence = std::make_shared<Fence>();
+        
+        QMetaObject::invokeMethod(this, [fence, leave]() {
+            QMutexLocker locker(&fence->mutex);
+            if (fence->abandoned) {
+                return;
+            }
+            leave();
+            fence->finished = true;
+            fence->done.wakeAll();
+        }, Qt::QueuedConnection);
+        
+        QMutexLocker locker(&fence->mutex);
+        QDeadlineTimer deadline(kStopTimeoutMs);
+        while (!fence->finished && fence->done.wait(&fence->mutex, deadline)) {
+        }
+        if (!fence->finished) {
+            fence->abandoned = true;
+            idle = false;
+            qWarning() << "CommunicationManager: Communication thread still busy after" << kStopTimeoutMs << "ms";
+        }
+    }
+    
+    m_ownership = ThreadOwnership::SplitThreads;
+    m_cardObjectsHomeThread = nullptr;
+    return idle;
+}
+
+void CommunicationManager::setExecutor(std::shared_ptr<CommunicationExecutor> executor) {
+    if (m_running) {
+        qWarning() << "CommunicationManager: Cannot change executor while running";
+        return;
+    }
+    if (!executor) {
+        executor = std::make_shared<DedicatedThreadExecutor>();
+    }
+    m_executor = std::move(executor);
+}
+
+void CommunicationManager::moveCardObjects(QThread* target) {
+    // QObject::moveToThread() must run on the objects' current thread.
+    // Backends created by KeycardChannel are its children and move with it.
+    auto channel = m_commandSet->channel();
+    KeycardChannelBackend* backend = channel ? channel->backend() : nullptr;
+    
+    m_commandSet->moveToThread(target);
+    if (channel) {
+        channel->moveToThread(target);
+    }
+    if (backend && !backend->parent()) {
+        backend->moveToThread(target);
+    }
+    
+    qDebug() << "CommunicationManager: Card objects moved to thread:" << target;
+}
+
+Qt::ConnectionType CommunicationManager::commandSetConnection() const {
+    return m_ownership == ThreadOwnership::SingleIoThread ? Qt::AutoConnection : Qt::QueuedConnection;
+}
+
 void CommunicationManager::startBatchOperations() {
     QMutexLocker locker(&m_batchMutex);
     if (!m_batchOperations) {
@@ -250,14 +329,25 @@ QUuid CommunicationManager::enqueueCommand(std::unique_ptr<CardCommand> cmd) {
         return QUuid();
     }
     
-    QUuid token = cmd->token();
+    const quint64 id = cmd->id();
     QString cmdName = cmd->name();
     
-    qDebug() << "CommunicationManager: Enqueueing command" << cmdName << "token:" << token;
+    CommandResult cached;
+    if (findCachedResult(*cmd, cached)) {
+        qDebug() << "CommunicationManager: Serving" << cmdName << "from result cache, id:" << id;
+        // Deliver asynchronously so the caller can match the returned token
+        QMetaObject::invokeMethod(this, [this, id, cached]() {
+            notifyCompletion(id, cached);
+        }, Qt::QueuedConnection);
+        return CardCommand::tokenFromId(id);
+    }
+    
+    qDebug() << "CommunicationManager: Enqueueing command" << cmdName << "id:" << id;
     
     {
         QMutexLocker locker(&m_queueMutex);
-        m_queue.push(std::move(cmd));
+        m_queue.push_back(std::move(cmd));
+        m_queueChanged = true;
         m_queueNotEmpty.wakeAll();
     }
 
@@ -269,7 +359,7 @@ QUuid CommunicationManager::enqueueCommand(std::unique_ptr<CardCommand> cmd) {
         startDetection();
     }
     
-    return token;
+    return CardCommand::tokenFromId(id);
 }
 
 CommandResult CommunicationManager::executeCommandSync(std::unique_ptr<CardCommand> cmd, int timeoutMs) {
@@ -282,24 +372,32 @@ CommandResult CommunicationManager::executeCommandSync(std::unique_ptr<CardComma
         return CommandResult::fromError("Null command");
     }
     
-    QUuid token = cmd->token();
+    const quint64 id = cmd->id();
     QString cmdName = cmd->name();
     
     if (timeoutMs < 0) {
         timeoutMs = cmd->timeoutMs();
     }
     
+    // Prefetched or previously read: answer without a thread hop or card I/O
+    CommandResult cached;
+    if (findCachedResult(*cmd, cached)) {
+        qDebug() << "CommunicationManager: Served" << cmdName << "from result cache";
+        return cached;
+    }
+    
     // Note: Reduced logging here to avoid qDebug race conditions with multiple threads
     qDebug() << "CommunicationManager: Executing command synchronously:" << cmdName << "timeout:" << timeoutMs;
     
     // Create sync tracker on HEAP to prevent dangling pointer
     // Use shared_ptr so it stays valid even after this function returns
-    auto sync = std::make_shared<PendingSync>();
+    // Pooled: sync calls are as frequent as the commands they wait for
+    auto sync = std::allocate_shared<PendingSync>(PoolAllocator<PendingSync>());
     sync->completed = false;
     
     {
         QMutexLocker locker(&m_syncMutex);
-        m_pendingSync[token] = sync;
+        m_pendingSync.insert(id, sync);
     }
     
     // Enqueue command (this will set channel state)
@@ -332,7 +430,7 @@ CommandResult CommunicationManager::executeCommandSync(std::unique_ptr<CardComma
             locker.relock();
             
             if (!sync->completed) {
-                sync->condition.wait(&m_syncMutex, 100);
+                m_syncMutex.wait(sync->condition, QDeadlineTimer(100));
             }
         }
     } else {
@@ -342,7 +440,7 @@ CommandResult CommunicationManager::executeCommandSync(std::unique_ptr<CardComma
         QMutexLocker locker(&m_syncMutex);
         
         if (!sync->completed) {
-            bool success = sync->condition.wait(&m_syncMutex, timeoutMs);
+            bool success = m_syncMutex.wait(sync->condition, QDeadlineTimer(timeoutMs));
             if (!success) {
                 qWarning() << "CommunicationManager: Sync command timed out:" << cmdName;
                 sync->result = CommandResult::fromError("Command timeout");
@@ -362,7 +460,8 @@ CommandResult CommunicationManager::executeCommandSync(std::unique_ptr<CardComma
         }
         
         // Remove from map - shared_ptr will keep it alive if comm thread still has reference
-        m_pendingSync.remove(token);
+        m_pendingSync.remove(id);
+        m_syncDrained.wakeAll();
     }
     
     return finalResult;
@@ -374,19 +473,228 @@ CommunicationManager::State CommunicationManager::state() const {
 }
 
 ApplicationInfo CommunicationManager::applicationInfo() const {
-    QMutexLocker locker(&m_infoMutex);
-    if (m_commandSet) {
-        return m_commandSet->applicationInfo();
-    }
-    return ApplicationInfo();
+    return m_cardSnapshot.load().appInfo.toApplicationInfo();
 }
 
 ApplicationStatus CommunicationManager::applicationStatus() const {
-    QMutexLocker locker(&m_infoMutex);
+    return m_cardSnapshot.load().appStatus.toApplicationStatus();
+}
+
+void CommunicationManager::publishCardSnapshot() {
+    if (!m_commandSet) {
+        return;
+    }
+    
+    CardSnapshot snapshot;
+    snapshot.appInfo = CompactApplicationInfo::fromApplicationInfo(m_commandSet->applicationInfo());
+    snapshot.appStatus = CompactApplicationStatus::fromApplicationStatus(m_commandSet->cachedApplicationStatus());
+    m_cardSnapshot.store(snapshot);
+}
+
+void CommunicationManager::notifyCompletion(quint64 id, const CommandResult& result) {
+    emit commandCompleted(CardCommand::tokenFromId(id), result);
+    
+    // Wake sync waiter if any
+    QMutexLocker syncLocker(&m_syncMutex);
+    auto it = m_pendingSync.constFind(id);
+    if (it != m_pendingSync.constEnd()) {
+        auto sync = it.value();  // shared_ptr copy keeps it alive
+        sync->result = result;
+        sync->completed = true;
+        sync->condition.wakeAll();
+    }
+}
+
+// ============================================================================
+// Result Cache and Speculative Prefetch
+// ============================================================================
+
+void CommunicationManager::setPrefetchPolicy(const PrefetchPolicy& policy) {
+    {
+        QMutexLocker locker(&m_prefetchMutex);
+        m_prefetchPolicy = policy;
+        m_prefetchAttempted.clear();
+    }
+    
+    qDebug() << "CommunicationManager: Prefetch" << (policy.isEnabled() ? "enabled" : "disabled")
+             << "metadata:" << policy.metadata << "export paths:" << policy.exportPaths.size();
+    
+    // Use the current idle gap right away
+    if (m_running && policy.isEnabled() && state() == State::Ready) {
+        QMetaObject::invokeMethod(this, &CommunicationManager::processQueue,
+                                   Qt::QueuedConnection);
+    }
+}
+
+CommunicationManager::PrefetchPolicy CommunicationManager::prefetchPolicy() const {
+    QMutexLocker locker(&m_prefetchMutex);
+    return m_prefetchPolicy;
+}
+
+void CommunicationManager::setSessionPlanningEnabled(bool enabled, const SessionPlanner::Options& options) {
+    QMutexLocker locker(&m_queueMutex);
+    m_planningEnabled = enabled;
+    m_planner = SessionPlanner(options);
+    m_queueChanged = true;
     if (m_commandSet) {
-        return m_commandSet->cachedApplicationStatus();
+        m_commandSet->setDeriveFromCurrent(enabled);
+    }
+    
+    qDebug() << "CommunicationManager: Session planning" << (enabled ? "enabled" : "disabled")
+             << "allowCurrentPathChange:" << options.allowCurrentPathChange;
+}
+
+bool CommunicationManager::isSessionPlanningEnabled() const {
+    QMutexLocker locker(&m_queueMutex);
+    return m_planningEnabled;
+}
+
+SessionPlan CommunicationManager::lastSessionPlan() const {
+    QMutexLocker locker(&m_queueMutex);
+    return m_lastPlan;
+}
+
+void CommunicationManager::planQueue() {
+    SessionPlanner::KeyPath currentPath = SessionPlanner::decodePath(m_commandSet->currentKeyPath());
+    m_lastPlan = m_planner.plan(m_queue, currentPath, m_commandSet->isCurrentKeyPathKnown());
+    m_queueChanged = false;
+    
+    qDebug() << "CommunicationManager: Planned" << m_lastPlan.commandCount << "commands,"
+             << "moved:" << m_lastPlan.movedCommands
+             << "inserted derivations:" << m_lastPlan.insertedDerivations
+             << "derivation steps:" << m_lastPlan.fifoCost.steps() << "->" << m_lastPlan.plannedCost.steps()
+             << "(hardened:" << m_lastPlan.fifoCost.hardenedSteps << "->" << m_lastPlan.plannedCost.hardenedSteps << ")";
+}
+
+bool CommunicationManager::hasPrefetchedResult(const QString& cacheKey) const {
+    QMutexLocker locker(&m_prefetchMutex);
+    return m_prefetchCache.contains(cacheKey);
+}
+
+void CommunicationManager::clearPrefetchCache() {
+    QMutexLocker locker(&m_prefetchMutex);
+    m_prefetchCache.clear();
+    m_prefetchAttempted.clear();
+}
+
+bool CommunicationManager::findCachedResult(const CardCommand& cmd, CommandResult& result) const {
+    QString key = cmd.resultCacheKey();
+    if (key.isEmpty() || state() != State::Ready) {
+        return false;
+    }
+    
+    QMutexLocker locker(&m_prefetchMutex);
+    auto it = m_prefetchCache.constFind(key);
+    if (it == m_prefetchCache.constEnd()) {
+        return false;
+    }
+    result = it.value();
+    return true;
+}
+
+void CommunicationManager::updateResultCache(const CardCommand& cmd, const CommandResult& result) {
+    QMutexLocker locker(&m_prefetchMutex);
+    
+    QString key = cmd.resultCacheKey();
+    if (!key.isEmpty()) {
+        // Empty results (e.g. no metadata stored) are cheap to re-read and
+        // indistinguishable from failures, so only data is kept
+        if (result.success && result.data.isValid()) {
+            m_prefetchCache.insert(key, result);
+        }
+        return;
+    }
+    
+    // State-changing command: a new idle gap starts and metadata may have been rewritten.
+    // Exported keys only depend on the key UID, checked by checkResultCacheOwner()
+    // (CommandSet updates it when a key is loaded, generated or removed).
+    m_prefetchAttempted.clear();
+    m_prefetchCache.remove(GetMetadataCommand().resultCacheKey());
+}
+
+void CommunicationManager::checkResultCacheOwner() {
+    if (!m_commandSet) {
+        return;
+    }
+    
+    ApplicationInfo info = m_commandSet->applicationInfo();
+    QByteArray owner = info.instanceUID + info.keyUID;
+    
+    QMutexLocker locker(&m_prefetchMutex);
+    if (owner != m_prefetchOwner) {
+        if (!m_prefetchCache.isEmpty()) {
+            qDebug() << "CommunicationManager: Card or key changed, dropping" << m_prefetchCache.size() << "cached results";
+        }
+        m_prefetchCache.clear();
+        m_prefetchAttempted.clear();
+        m_prefetchOwner = owner;
+    }
+}
+
+std::unique_ptr<CardCommand> CommunicationManager::nextPrefetchCommand(bool markAttempted) {
+    QMutexLocker locker(&m_prefetchMutex);
+    
+    if (!m_prefetchPolicy.isEnabled() || !m_commandSet || !m_commandSet->applicationInfo().initialized) {
+        return nullptr;
+    }
+    
+    auto pick = [&](std::unique_ptr<CardCommand> cmd) -> std::unique_ptr<CardCommand> {
+        QString key = cmd->resultCacheKey();
+        if (m_prefetchCache.contains(key) || m_prefetchAttempted.contains(key)) {
+            return nullptr;
+        }
+        if (markAttempted) {
+            m_prefetchAttempted.insert(key);
+        }
+        return cmd;
+    };
+    
+    if (m_prefetchPolicy.metadata) {
+        if (auto cmd = pick(std::make_unique<GetMetadataCommand>())) {
+            return cmd;
+        }
+    }
+    for (const QString& path : m_prefetchPolicy.exportPaths) {
+        if (auto cmd = pick(std::make_unique<ExportKeyExtendedCommand>(true, false, path))) {
+            return cmd;
+        }
+    }
+    return nullptr;
+}
+
+void CommunicationManager::runPrefetchStep() {
+    // Runs on the communication thread with an empty queue. One command per
+    // step: processQueue() runs again afterwards, so user commands enqueued
+    // meanwhile go first.
+    std::unique_ptr<CardCommand> cmd = nextPrefetchCommand(true);
+    if (!cmd) {
+        return;
+    }
+    
+    qDebug() << "CommunicationManager: Prefetching" << cmd->resultCacheKey() << "during idle gap";
+    
+    setState(State::Processing);
+    
+    CommandResult result;
+    try {
+        result = cmd->execute(m_commandSet.get());
+    } catch (const std::runtime_error& e) {
+        qWarning() << "CommunicationManager: Prefetch threw exception:" << e.what();
+        startDetection();
+        return;
+    } catch (...) {
+        qWarning() << "CommunicationManager: Prefetch threw unknown exception";
+        result = CommandResult::fromError("Unknown exception");
+    }
+    
+    updateResultCache(*cmd, result);
+    
+    setState(State::Ready);
+    
+    if (m_running) {
+        QMetaObject::invokeMethod(this, &CommunicationManager::processQueue,
+                                   Qt::QueuedConnection);
     }
-    return ApplicationStatus();
 }
 
 QByteArray CommunicationManager::getDataFromCard(uint8_t type) {
@@ -400,7 +708,28 @@ bool CommunicationManager::storeDataToCard(uint8_t type, const QByteArray& data)
     if (!m_commandSet) {
         return false;
     }
-    return m_commandSet->storeData(type, data);
+    
+    // Bypasses the queue and so updateResultCache(): a write to the public
+    // slot, even a failed or interrupted one, makes a cached GET_METADATA stale
+    auto dropCachedMetadata = [this, type]() {
+        if (type != APDU::P1StoreDataPublic) {
+            return;
+        }
+        const QString key = GetMetadataCommand().resultCacheKey();
+        QMutexLocker locker(&m_prefetchMutex);
+        m_prefetchCache.remove(key);
+        m_prefetchAttempted.remove(key);
+    };
+    
+    bool stored = false;
+    try {
+        stored = m_commandSet->storeData(type, data);
+    } catch (...) {
+        dropCachedMetadata();
+        throw;
+    }
+    dropCachedMetadata();
+    return stored;
 }
 
 void CommunicationManager::setState(State newState) {
@@ -430,9 +759,44 @@ void CommunicationManager::onCardReady(const QString& uid) {
     qDebug() << "========================================";
     
     m_currentCardUID = uid;
-    setState(State::Initializing);
-    
+    m_cardSequenceDone = false;
+    
+    if (canSkipCardInitialization()) {
+        // Payment tap: the pending commands select their own applet, so the
+        // Keycard session would only add APDUs to the tap
+        qDebug() << "CommunicationManager: Only commands without Keycard session pending, skipping initialization sequence";
+        // Without a SELECT the card is unknown (possibly swapped): nothing
+        // read from the previous card may be published or served from cache
+        m_cardSnapshot.store(CardSnapshot());
+        {
+            QMutexLocker prefetchLocker(&m_prefetchMutex);
+            m_prefetchCache.clear();
+            m_prefetchAttempted.clear();
+            m_prefetchOwner.clear();
+        }
+        setState(State::Ready);
+        processQueue();
+        return;
+    }
     
+    setState(State::Initializing);
+    if (runCardInitialization()) {
+        // Now process any queued commands
+        processQueue();
+    }
+}
+
+bool CommunicationManager::canSkipCardInitialization() const {
+    QMutexLocker locker(&m_queueMutex);
+    if (m_queue.empty()) {
+        return false;
+    }
+    return std::none_of(m_queue.begin(), m_queue.end(), [](const std::unique_ptr<CardCommand>& cmd) {
+        return cmd->needsCardInitialization();
+    });
+}
+
+bool CommunicationManager::runCardInitialization() {
     qDebug() << "CommunicationManager: Starting card initialization sequence...";
     try {
         CardInitializationResult result = initializeCardSequence();
@@ -440,24 +804,25 @@ void CommunicationManager::onCardReady(const QString& uid) {
         qDebug() << "CommunicationManager: Card initialization SUCCESS";
         
         // Update cached info
+        publishCardSnapshot();
+        checkResultCacheOwner();
         {
-            QMutexLocker locker(&m_infoMutex);
-            m_appInfo = result.appInfo;
-            m_appStatus = result.appStatus;
+            // New session: give failed prefetches another chance
+            QMutexLocker prefetchLocker(&m_prefetchMutex);
+            m_prefetchAttempted.clear();
         }
         
+        m_cardSequenceDone = true;
         setState(State::Ready);
         emit cardInitialized(result);
-        
-        // Now process any queued commands
-        processQueue();
+        return true;
     } catch (const std::runtime_error& e) {
         qWarning() << "CommunicationManager: Card initialization sequence threw exception:" << e.what();
         startDetection();
-        return;
     } catch (...) {
         qWarning() << "CommunicationManager: Card initialization sequence threw unknown exception";
     }
+    return false;
 }
 
 void CommunicationManager::onCardLost() {
@@ -557,9 +922,9 @@ CardInitializationResult CommunicationManager::initializeCardSequence() {
     
     // STEP 4: Get status
     qDebug() << "   [4/5] Get application status...";
-    ApplicationStatus appStatus = m_commandSet->cachedApplicationStatus();
+    ApplicationStatus appStatus = m_commandSet->applicationStatus();
     
-    if (!m_commandSet->hasCachedStatus()) {
+    if (m_commandSet->isStatusStale()) {
         qWarning() << "   Failed to get application status, but continuing...";
     }
     
@@ -596,6 +961,13 @@ void CommunicationManager::processQueue() {
     }
 
     if (m_queue.empty()) {
+        // Idle gap with the card present: use it for speculative prefetch
+        if (currentState == State::Ready && m_cardSequenceDone && nextPrefetchCommand(false)) {
+            locker.unlock();
+            runPrefetchStep();
+            return;
+        }
+        
         // Check if we're in batch operations mode
         bool inBatchMode = false;
         {
@@ -630,46 +1002,58 @@ void CommunicationManager::processQueue() {
         return;
     }
     
+    // Several commands pending: reorder them for fewer on-card derivations
+    if (m_planningEnabled && m_queueChanged && currentState == State::Ready && m_queue.size() > 1) {
+        planQueue();
+    }
+    
     // Get next command
     auto cmd = std::move(m_queue.front());
-    m_queue.pop();
-    QUuid token = cmd->token();
+    m_queue.pop_front();
+    const quint64 id = cmd->id();
     QString cmdName = cmd->name();
     
     // Check if command can run in current state
     if (currentState == State::Initializing && !cmd->canRunDuringInit()) {
         qDebug() << "CommunicationManager: Command" << cmdName << "cannot run during init, re-queuing";
-        // Re-queue at front (note: this changes FIFO order but ensures command runs after init)
-        // For proper FIFO with re-queuing, we'd need a deque, but this is simpler
-        m_queue.push(std::move(cmd));
+        // Re-queue at front: it runs first once init is done
+        m_queue.push_front(std::move(cmd));
         return;
     }
     
     if (currentState != State::Ready && currentState != State::Initializing) {
         qWarning() << "CommunicationManager: Cannot process command in state:" << currentState;
         CommandResult result = CommandResult::fromError("Card not ready");
-        
-        // Notify completion
-        emit commandCompleted(token, result);
-        
-        // Wake sync waiter if any
-        {
-            QMutexLocker syncLocker(&m_syncMutex);
-            if (m_pendingSync.contains(token)) {
-                auto sync = m_pendingSync[token];  // shared_ptr copy keeps it alive
-                sync->result = result;
-                sync->completed = true;
-                sync->condition.wakeAll();
-            }
-        }
-        
+        notifyCompletion(id, result);
         return;
     }
     
     locker.unlock();
     
+    // Result prefetched (or read) since the command was queued
+    CommandResult cached;
+    if (findCachedResult(*cmd, cached)) {
+        qDebug() << "CommunicationManager: Served" << cmdName << "from result cache";
+        notifyCompletion(id, cached);
+        if (m_running) {
+            QMetaObject::invokeMethod(this, &CommunicationManager::processQueue,
+                                       Qt::QueuedConnection);
+        }
+        return;
+    }
+    
+    // Keycard command after a payment tap: run the sequence that was skipped
+    if (cmd->needsCardInitialization() && !m_cardSequenceDone) {
+        setState(State::Initializing);
+        if (!runCardInitialization()) {
+            QMutexLocker requeueLocker(&m_queueMutex);
+            m_queue.push_front(std::move(cmd));
+            return;
+        }
+    }
+    
     // Execute command
-    qDebug() << "CommunicationManager: Executing command:" << cmdName << "token:" << token;
+    qDebug() << "CommunicationManager: Executing command:" << cmdName << "id:" << id;
     
     setState(State::Processing);
     
@@ -678,8 +1062,11 @@ void CommunicationManager::processQueue() {
         result = cmd->execute(m_commandSet.get());
     } catch (const std::runtime_error& e) {
         qWarning() << "CommunicationManager: Command threw exception:" << e.what();
-        // Re-queue at front
-        m_queue.push(std::move(cmd));
+        // Re-queue at front: it runs first on the next card
+        {
+            QMutexLocker requeueLocker(&m_queueMutex);
+            m_queue.push_front(std::move(cmd));
+        }
         startDetection();
         return;
     } catch (...) {
@@ -687,24 +1074,25 @@ void CommunicationManager::processQueue() {
         result = CommandResult::fromError("Unknown exception");
     }
     
+    // The cash applet is now selected: the next Keycard command needs a new session
+    if (!cmd->needsCardInitialization()) {
+        m_cardSequenceDone = false;
+    }
+    
+    // Commands may change info/status (init, PIN verification, factory reset...).
+    // Outside a Keycard session CommandSet still holds the previous card's info
+    if (m_cardSequenceDone) {
+        publishCardSnapshot();
+        checkResultCacheOwner();
+    }
+    updateResultCache(*cmd, result);
+    
     setState(State::Ready);
     
     qDebug() << "CommunicationManager: Command completed:" << cmdName
              << "success:" << result.success;
     
-    // Notify completion
-    emit commandCompleted(token, result);
-    
-    // Wake sync waiter if any
-    {
-        QMutexLocker syncLocker(&m_syncMutex);
-        if (m_pendingSync.contains(token)) {
-            auto sync = m_pendingSync[token];  // shared_ptr copy keeps it alive
-            sync->result = result;
-            sync->completed = true;
-            sync->condition.wakeAll();
-        }
-    }
+    notifyCompletion(id, result);
     
     // Process next command if any
     // If queue is empty, processQueue() will handle stopDetection()
@@ -0,0 +1,144 @@
+#include "keycard-qt/bip32.h"
+#include "keycard-qt/tlv_utils.h"
+#include <QCryptographicHash>
+#include <QDebug>
+#include <QMessageAuthenticationCode>
+
+#ifdef KEYCARD_QT_HAS_OPENSSL
+#include <openssl/bn.h>
+#include <openssl/ec.h>
+#include <openssl/obj_mac.h>
+#endif
+
+namespace Keycard {
+namespace BIP32 {
+
+namespace {
+
+constexpr uint8_t TAG_KEYPAIR_TEMPLATE = 0xA1;
+constexpr uint8_t TAG_PUBLIC_KEY = 0x80;
+constexpr uint8_t TAG_CHAIN_CODE = 0x82;
+
+#ifdef KEYCARD_QT_HAS_OPENSSL
+// The curve and a scratch context are reused for every derivation on a
+// thread; discovery derives thousands of keys from a few worker threads
+struct EcContext {
+    EC_GROUP* group = EC_GROUP_new_by_curve_name(NID_secp256k1);
+    BN_CTX* bn = BN_CTX_new();
+
+    ~EcContext() {
+        BN_CTX_free(bn);
+        EC_GROUP_free(group);
+    }
+};
+
+EcContext& ecContext() {
+    thread_local EcContext context;
+    return context;
+}
+
+QByteArray encodePoint(const EcContext& ec, const EC_POINT* point) {
+    QByteArray out(65, 0);
+    size_t len = EC_POINT_point2oct(ec.group, point, POINT_CONVERSION_UNCOMPRESSED,
+                                    reinterpret_cast<unsigned char*>(out.data()), out.size(), ec.bn);
+    return len == 65 ? out : QByteArray();
+}
+#endif
+
+} // namespace
+
+bool isAvailable() {
+#ifdef KEYCARD_QT_HAS_OPENSSL
+    return true;
+#else
+    return false;
+#endif
+}
+
+ExtendedPublicKey fromExportedKey(const QByteArray& keyData) {
+    QByteArray keypair = TLV::findTag(keyData, TAG_KEYPAIR_TEMPLATE);
+    if (keypair.isEmpty()) {
+        keypair = keyData;
+    }
+
+    ExtendedPublicKey key;
+    key.publicKey = TLV::findTag(keypair, TAG_PUBLIC_KEY);
+    key.chainCode = TLV::findTag(keypair, TAG_CHAIN_CODE);
+    if (!key.isValid() || static_cast<uint8_t>(key.publicKey[0]) != 0x04) {
+        qWarning() << "BIP32::fromExportedKey: Missing public key or chain code";
+        return ExtendedPublicKey();
+    }
+    return key;
+}
+
+QByteArray compressPublicKey(const QByteArray& publicKey) {
+    if (publicKey.size() != 65 || static_cast<uint8_t>(publicKey[0]) != 0x04) {
+        return QByteArray();
+    }
+    QByteArray compressed = publicKey.mid(0, 33);
+    compressed[0] = static_cast<char>((static_cast<uint8_t>(publicKey[64]) & 1) ? 0x03 : 0x02);
+    return compressed;
+}
+
+ExtendedPublicKey deriveChild(const ExtendedPublicKey& parent, uint32_t index) {
+#ifndef KEYCARD_QT_HAS_OPENSSL
+    Q_UNUSED(parent);
+    Q_UNUSED(index);
+    qWarning() << "BIP32: OpenSSL not available, cannot derive public keys";
+    return ExtendedPublicKey();
+#else
+    if ((index & HARDENED) || !parent.isValid()) {
+        return ExtendedPublicKey();
+    }
+
+    // I = HMAC-SHA512(c_par, serP(K_par) || ser32(i))
+    QByteArray data = compressPublicKey(parent.publicKey);
+    if (data.isEmpty()) {
+        return ExtendedPublicKey();
+    }
+    data.append(static_cast<char>(index >> 24));
+    data.append(static_cast<char>(index >> 16));
+    data.append(static_cast<char>(index >> 8));
+    data.append(static_cast<char>(index));
+    const QByteArray I = QMessageAuthenticationCode::hash(data, parent.chainCode, QCryptographicHash::Sha512);
+
+    EcContext& ec = ecContext();
+    if (!ec.group || !ec.bn) {
+        return ExtendedPublicKey();
+    }
+
+    ExtendedPublicKey child;
+    BIGNUM* tweak = BN_bin2bn(reinterpret_cast<const unsigned char*>(I.constData()), 32, nullptr);
+    EC_POINT* parentPoint = EC_POINT_new(ec.group);
+    EC_POINT* childPoint = EC_POINT_new(ec.group);
+
+    // K_i = parse256(I_L) * G + K_par; invalid if I_L >= n or K_i is infinity
+    if (tweak && parentPoint && childPoint
+        && BN_cmp(tweak, EC_GROUP_get0_order(ec.group)) < 0
+        && EC_POINT_oct2point(ec.group, parentPoint,
+                              reinterpret_cast<const unsigned char*>(parent.publicKey.constData()),
+                              parent.publicKey.size(), ec.bn) == 1
+        && EC_POINT_mul(ec.group, childPoint, tweak, nullptr, nullptr, ec.bn) == 1
+        && EC_POINT_add(ec.group, childPoint, childPoint, parentPoint, ec.bn) == 1
+        && !EC_POINT_is_at_infinity(ec.group, childPoint)) {
+        child.publicKey = encodePoint(ec, childPoint);
+        child.chainCode = I.mid(32);
+    }
+
+    EC_POINT_free(childPoint);
+    EC_POINT_free(parentPoint);
+    BN_free(tweak);
+    return child.isValid() ? child : ExtendedPublicKey();
+#endif
+}
+
+QString ethereumAddress(const QByteArray& publicKey) {
+    if (publicKey.size() != 65 || static_cast<uint8_t>(publicKey[0]) != 0x04) {
+        return QString();
+    }
+    const QByteArray hash = QCryptographicHash::hash(publicKey.mid(1), QCryptographicHash::Keccak_256);
+    return "0x" + QString::fromLatin1(hash.right(20).toHex());
+}
+
+} // namespace BIP32
+} // namespace Keycard
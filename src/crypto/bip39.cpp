@@ -0,0 +1,494 @@
+#include "keycard-qt/bip39.h"
+#include <QCryptographicHash>
+#include <QRegularExpression>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace Keycard {
+namespace BIP39 {
+
+namespace {
+
+// BIP39 English wordlist (english.txt, SHA-256
+// 2f5eed53a4727b4bf8880d8f3f199efc90e58503646d9ff8eff3a2ed3b24dbda)
+const char kEnglishWords[] =
+    "abandon ability able about above absent absorb abstract absurd abuse access accident "
+    "account accuse achieve acid acoustic acquire across act action actor actress actual "
+    "adapt add addict address adjust admit adult advance advice aerobic affair afford afraid "
+    "again age agent agree ahead aim air airport aisle alarm album alcohol alert alien all "
+    "alley allow almost alone alpha already also alter always amateur amazing among amount "
+    "amused analyst anchor ancient anger angle angry animal ankle announce annual another "
+    "answer antenna antique anxiety any apart apology appear apple approve april arch arctic "
+    "area arena argue arm armed armor army around arrange arrest arrive arrow art artefact "
+    "artist artwork ask aspect assault asset assist assume asthma athlete atom attack attend "
+    "attitude attract auction audit august aunt author auto autumn average avocado avoid "
+    "awake aware away awesome awful awkward axis baby bachelor bacon badge bag balance "
+    "balcony ball bamboo banana banner bar barely bargain barrel base basic basket battle "
+    "beach bean beauty because become beef before begin behave behind believe below belt "
+    "bench benefit best betray better between beyond bicycle bid bike bind biology bird "
+    "birth bitter black blade blame blanket blast bleak bless blind blood blossom blouse "
+    "blue blur blush board boat body boil bomb bone bonus book boost border boring borrow "
+    "boss bottom bounce box boy bracket brain brand brass brave bread breeze brick bridge "
+    "brief bright bring brisk broccoli broken bronze broom brother brown brush bubble buddy "
+    "budget buffalo build bulb bulk bullet bundle bunker burden burger burst bus business "
+    "busy butter buyer buzz cabbage cabin cable cactus cage cake call calm camera camp can "
+    "canal cancel candy cannon canoe canvas canyon capable capital captain car carbon card "
+    "cargo carpet carry cart case cash casino castle casual cat catalog catch category "
+    "cattle caught cause caution cave ceiling celery cement census century cereal certain "
+    "chair chalk champion change chaos chapter charge chase chat cheap check cheese chef "
+    "cherry chest chicken chief child chimney choice choose chronic chuckle chunk churn "
+    "cigar cinnamon circle citizen city civil claim clap clarify claw clay clean clerk "
+    "clever click client cliff climb clinic clip clock clog close cloth cloud clown club "
+    "clump cluster clutch coach coast coconut code coffee coil coin collect color column "
+    "combine come comfort comic common company concert conduct confirm congress connect "
+    "consider control convince cook cool copper copy coral core corn correct cost cotton "
+    "couch country couple course cousin cover coyote crack cradle craft cram crane crash "
+    "crater crawl crazy cream credit creek crew cricket crime crisp critic crop cross crouch "
+    "crowd crucial cruel cruise crumble crunch crush cry crystal cube culture cup cupboard "
+    "curious current curtain curve cushion custom cute cycle dad damage damp dance danger "
+    "daring dash daughter dawn day deal debate debris decade december decide decline "
+    "decorate decrease deer defense define defy degree delay deliver demand demise denial "
+    "dentist deny depart depend deposit depth deputy derive describe desert design desk "
+    "despair destroy detail detect develop device devote diagram dial diamond diary dice "
+    "diesel diet differ digital dignity dilemma dinner dinosaur direct dirt disagree "
+    "discover disease dish dismiss disorder display distance divert divide divorce dizzy "
+    "doctor document dog doll dolphin domain donate donkey donor door dose double dove draft "
+    "dragon drama drastic draw dream dress drift drill drink drip drive drop drum dry duck "
+    "dumb dune during dust dutch duty dwarf dynamic eager eagle early earn earth easily east "
+    "easy echo ecology economy edge edit educate effort egg eight either elbow elder "
+    "electric elegant element elephant elevator elite else embark embody embrace emerge "
+    "emotion employ empower empty enable enact end endless endorse enemy energy enforce "
+    "engage engine enhance enjoy enlist enough enrich enroll ensure enter entire entry "
+    "envelope episode equal equip era erase erode erosion error erupt escape essay essence "
+    "estate eternal ethics evidence evil evoke evolve exact example excess exchange excite "
+    "exclude excuse execute exercise exhaust exhibit exile exist exit exotic expand expect "
+    "expire explain expose express extend extra eye eyebrow fabric face faculty fade faint "
+    "faith fall false fame family famous fan fancy fantasy farm fashion fat fatal father "
+    "fatigue fault favorite feature february federal fee feed feel female fence festival "
+    "fetch fever few fiber fiction field figure file film filter final find fine finger "
+    "finish fire firm first fiscal fish fit fitness fix flag flame flash flat flavor flee "
+    "flight flip float flock floor flower fluid flush fly foam focus fog foil fold follow "
+    "food foot force forest forget fork fortune forum forward fossil foster found fox "
+    "fragile frame frequent fresh friend fringe frog front frost frown frozen fruit fuel fun "
+    "funny furnace fury future gadget gain galaxy gallery game gap garage garbage garden "
+    "garlic garment gas gasp gate gather gauge gaze general genius genre gentle genuine "
+    "gesture ghost giant gift giggle ginger giraffe girl give glad glance glare glass glide "
+    "glimpse globe gloom glory glove glow glue goat goddess gold good goose gorilla gospel "
+    "gossip govern gown grab grace grain grant grape grass gravity great green grid grief "
+    "grit grocery group grow grunt guard guess guide guilt guitar gun gym habit hair half "
+    "hammer hamster hand happy harbor hard harsh harvest hat have hawk hazard head health "
+    "heart heavy hedgehog height hello helmet help hen hero hidden high hill hint hip hire "
+    "history hobby hockey hold hole holiday hollow home honey hood hope horn horror horse "
+    "hospital host hotel hour hover hub huge human humble humor hundred hungry hunt hurdle "
+    "hurry hurt husband hybrid ice icon idea identify idle ignore ill illegal illness image "
+    "imitate immense immune impact impose improve impulse inch include income increase index "
+    "indicate indoor industry infant inflict inform inhale inherit initial inject injury "
+    "inmate inner innocent input inquiry insane insect inside inspire install intact "
+    "interest into invest invite involve iron island isolate issue item ivory jacket jaguar "
+    "jar jazz jealous jeans jelly jewel job join joke journey joy judge juice jump jungle "
+    "junior junk just kangaroo keen keep ketchup key kick kid kidney kind kingdom kiss kit "
+    "kitchen kite kitten kiwi knee knife knock know lab label labor ladder lady lake lamp "
+    "language laptop large later latin laugh laundry lava law lawn lawsuit layer lazy leader "
+    "leaf learn leave lecture left leg legal legend leisure lemon lend length lens leopard "
+    "lesson letter level liar liberty library license life lift light like limb limit link "
+    "lion liquid list little live lizard load loan lobster local lock logic lonely long loop "
+    "lottery loud lounge love loyal lucky luggage lumber lunar lunch luxury lyrics machine "
+    "mad magic magnet maid mail main major make mammal man manage mandate mango mansion "
+    "manual maple marble march margin marine market marriage mask mass master match material "
+    "math matrix matter maximum maze meadow mean measure meat mechanic medal media melody "
+    "melt member memory mention menu mercy merge merit merry mesh message metal method "
+    "middle midnight milk million mimic mind minimum minor minute miracle mirror misery miss "
+    "mistake mix mixed mixture mobile model modify mom moment monitor monkey monster month "
+    "moon moral more morning mosquito mother motion motor mountain mouse move movie much "
+    "muffin mule multiply muscle museum mushroom music must mutual myself mystery myth naive "
+    "name napkin narrow nasty nation nature near neck need negative neglect neither nephew "
+    "nerve nest net network neutral never news next nice night noble noise nominee noodle "
+    "normal north nose notable note nothing notice novel now nuclear number nurse nut oak "
+    "obey object oblige obscure observe obtain obvious occur ocean october odor off offer "
+    "office often oil okay old olive olympic omit once one onion online only open opera "
+    "opinion oppose option orange orbit orchard order ordinary organ orient original orphan "
+    "ostrich other outdoor outer output outside oval oven over own owner oxygen oyster ozone "
+    "pact paddle page pair palace palm panda panel panic panther paper parade parent park "
+    "parrot party pass patch path patient patrol pattern pause pave payment peace peanut "
+    "pear peasant pelican pen penalty pencil people pepper perfect permit person pet phone "
+    "photo phrase physical piano picnic picture piece pig pigeon pill pilot pink pioneer "
+    "pipe pistol pitch pizza place planet plastic plate play please pledge pluck plug plunge "
+    "poem poet point polar pole police pond pony pool popular portion position possible post "
+    "potato pottery poverty powder power practice praise predict prefer prepare present "
+    "pretty prevent price pride primary print priority prison private prize problem process "
+    "produce profit program project promote proof property prosper protect proud provide "
+    "public pudding pull pulp pulse pumpkin punch pupil puppy purchase purity purpose purse "
+    "push put puzzle pyramid quality quantum quarter question quick quit quiz quote rabbit "
+    "raccoon race rack radar radio rail rain raise rally ramp ranch random range rapid rare "
+    "rate rather raven raw razor ready real reason rebel rebuild recall receive recipe "
+    "record recycle reduce reflect reform refuse region regret regular reject relax release "
+    "relief rely remain remember remind remove render renew rent reopen repair repeat "
+    "replace report require rescue resemble resist resource response result retire retreat "
+    "return reunion reveal review reward rhythm rib ribbon rice rich ride ridge rifle right "
+    "rigid ring riot ripple risk ritual rival river road roast robot robust rocket romance "
+    "roof rookie room rose rotate rough round route royal rubber rude rug rule run runway "
+    "rural sad saddle sadness safe sail salad salmon salon salt salute same sample sand "
+    "satisfy satoshi sauce sausage save say scale scan scare scatter scene scheme school "
+    "science scissors scorpion scout scrap screen script scrub sea search season seat second "
+    "secret section security seed seek segment select sell seminar senior sense sentence "
+    "series service session settle setup seven shadow shaft shallow share shed shell sheriff "
+    "shield shift shine ship shiver shock shoe shoot shop short shoulder shove shrimp shrug "
+    "shuffle shy sibling sick side siege sight sign silent silk silly silver similar simple "
+    "since sing siren sister situate six size skate sketch ski skill skin skirt skull slab "
+    "slam sleep slender slice slide slight slim slogan slot slow slush small smart smile "
+    "smoke smooth snack snake snap sniff snow soap soccer social sock soda soft solar "
+    "soldier solid solution solve someone song soon sorry sort soul sound soup source south "
+    "space spare spatial spawn speak special speed spell spend sphere spice spider spike "
+    "spin spirit split spoil sponsor spoon sport spot spray spread spring spy square squeeze "
+    "squirrel stable stadium staff stage stairs stamp stand start state stay steak steel "
+    "stem step stereo stick still sting stock stomach stone stool story stove strategy "
+    "street strike strong struggle student stuff stumble style subject submit subway success "
+    "such sudden suffer sugar suggest suit summer sun sunny sunset super supply supreme sure "
+    "surface surge surprise surround survey suspect sustain swallow swamp swap swarm swear "
+    "sweet swift swim swing switch sword symbol symptom syrup system table tackle tag tail "
+    "talent talk tank tape target task taste tattoo taxi teach team tell ten tenant tennis "
+    "tent term test text thank that theme then theory there they thing this thought three "
+    "thrive throw thumb thunder ticket tide tiger tilt timber time tiny tip tired tissue "
+    "title toast tobacco today toddler toe together toilet token tomato tomorrow tone tongue "
+    "tonight tool tooth top topic topple torch tornado tortoise toss total tourist toward "
+    "tower town toy track trade traffic tragic train transfer trap trash travel tray treat "
+    "tree trend trial tribe trick trigger trim trip trophy trouble truck true truly trumpet "
+    "trust truth try tube tuition tumble tuna tunnel turkey turn turtle twelve twenty twice "
+    "twin twist two type typical ugly umbrella unable unaware uncle uncover under undo "
+    "unfair unfold unhappy uniform unique unit universe unknown unlock until unusual unveil "
+    "update upgrade uphold upon upper upset urban urge usage use used useful useless usual "
+    "utility vacant vacuum vague valid valley valve van vanish vapor various vast vault "
+    "vehicle velvet vendor venture venue verb verify version very vessel veteran viable "
+    "vibrant vicious victory video view village vintage violin virtual virus visa visit "
+    "visual vital vivid vocal voice void volcano volume vote voyage wage wagon wait walk "
+    "wall walnut want warfare warm warrior wash wasp waste water wave way wealth weapon wear "
+    "weasel weather web wedding weekend weird welcome west wet whale what wheat wheel when "
+    "where whip whisper wide width wife wild will win window wine wing wink winner winter "
+    "wire wisdom wise wish witness wolf woman wonder wood wool word work world worry worth "
+    "wrap wreck wrestle wrist write wrong yard year yellow you young youth zebra zero zone "
+    "zoo";
+
+// ---------------------------------------------------------------------------
+// SHA-512 and PBKDF2-HMAC-SHA512 (FIPS 180-4, RFC 2898)
+// ---------------------------------------------------------------------------
+
+constexpr uint64_t kSha512Init[8] = {
+    0x6a09e667f3bcc908ULL, 0xbb67ae8584caa73bULL, 0x3c6ef372fe94f82bULL, 0xa54ff53a5f1d36f1ULL,
+    0x510e527fade682d1ULL, 0x9b05688c2b3e6c1fULL, 0x1f83d9abfb41bd6bULL, 0x5be0cd19137e2179ULL
+};
+
+constexpr uint64_t kSha512K[80] = {
+    0x428a2f98d728ae22ULL, 0x7137449123ef65cdULL, 0xb5c0fbcfec4d3b2fULL, 0xe9b5dba58189dbbcULL,
+    0x3956c25bf348b538ULL, 0x59f111f1b605d019ULL, 0x923f82a4af194f9bULL, 0xab1c5ed5da6d8118ULL,
+    0xd807aa98a3030242ULL, 0x12835b0145706fbeULL, 0x243185be4ee4b28cULL, 0x550c7dc3d5ffb4e2ULL,
+    0x72be5d74f27b896fULL, 0x80deb1fe3b1696b1ULL, 0x9bdc06a725c71235ULL, 0xc19bf174cf692694ULL,
+    0xe49b69c19ef14ad2ULL, 0xefbe4786384f25e3ULL, 0x0fc19dc68b8cd5b5ULL, 0x240ca1cc77ac9c65ULL,
+    0x2de92c6f592b0275ULL, 0x4a7484aa6ea6e483ULL, 0x5cb0a9dcbd41fbd4ULL, 0x76f988da831153b5ULL,
+    0x983e5152ee66dfabULL, 0xa831c66d2db43210ULL, 0xb00327c898fb213fULL, 0xbf597fc7beef0ee4ULL,
+    0xc6e00bf33da88fc2ULL, 0xd5a79147930aa725ULL, 0x06ca6351e003826fULL, 0x142929670a0e6e70ULL,
+    0x27b70a8546d22ffcULL, 0x2e1b21385c26c926ULL, 0x4d2c6dfc5ac42aedULL, 0x53380d139d95b3dfULL,
+    0x650a73548baf63deULL, 0x766a0abb3c77b2a8ULL, 0x81c2c92e47edaee6ULL, 0x92722c851482353bULL,
+    0xa2bfe8a14cf10364ULL, 0xa81a664bbc423001ULL, 0xc24b8b70d0f89791ULL, 0xc76c51a30654be30ULL,
+    0xd192e819d6ef5218ULL, 0xd69906245565a910ULL, 0xf40e35855771202aULL, 0x106aa07032bbd1b8ULL,
+    0x19a4c116b8d2d0c8ULL, 0x1e376c085141ab53ULL, 0x2748774cdf8eeb99ULL, 0x34b0bcb5e19b48a8ULL,
+    0x391c0cb3c5c95a63ULL, 0x4ed8aa4ae3418acbULL, 0x5b9cca4f7763e373ULL, 0x682e6ff3d6b2b8a3ULL,
+    0x748f82ee5defb2fcULL, 0x78a5636f43172f60ULL, 0x84c87814a1f0ab72ULL, 0x8cc702081a6439ecULL,
+    0x90befffa23631e28ULL, 0xa4506cebde82bde9ULL, 0xbef9a3f7b2c67915ULL, 0xc67178f2e372532bULL,
+    0xca273eceea26619cULL, 0xd186b8c721c0c207ULL, 0xeada7dd6cde0eb1eULL, 0xf57d4f7fee6ed178ULL,
+    0x06f067aa72176fbaULL, 0x0a637dc5a2c898a6ULL, 0x113f9804bef90daeULL, 0x1b710b35131c471bULL,
+    0x28db77f523047d84ULL, 0x32caab7b40c72493ULL, 0x3c9ebe0a15c9bebcULL, 0x431d67c49c100d4cULL,
+    0x4cc5d4becb3e42b6ULL, 0x597f299cfc657e2aULL, 0x5fcb6fab3ad6faecULL, 0x6c44198c4a475817ULL
+};
+
+inline uint64_t rotr(uint64_t x, int n) { return (x >> n) | (x << (64 - n)); }
+
+// One compression round over a block given as 16 big-endian message words
+void sha512Compress(uint64_t state[8], const uint64_t block[16])
+{
+    uint64_t w[80];
+    for (int i = 0; i < 16; ++i) {
+        w[i] = block[i];
+    }
+    for (int i = 16; i < 80; ++i) {
+        uint64_t s0 = rotr(w[i - 15], 1) ^ rotr(w[i - 15], 8) ^ (w[i - 15] >> 7);
+        uint64_t s1 = rotr(w[i - 2], 19) ^ rotr(w[i - 2], 61) ^ (w[i - 2] >> 6);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    uint64_t a = state[0], b = state[1], c = state[2], d = state[3];
+    uint64_t e = state[4], f = state[5], g = state[6], h = state[7];
+    for (int i = 0; i < 80; ++i) {
+        uint64_t t1 = h + (rotr(e, 14) ^ rotr(e, 18) ^ rotr(e, 41)) + ((e & f) ^ (~e & g)) + kSha512K[i] + w[i];
+        uint64_t t2 = (rotr(a, 28) ^ rotr(a, 34) ^ rotr(a, 39)) + ((a & b) ^ (a & c) ^ (b & c));
+        h = g; g = f; f = e; e = d + t1;
+        d = c; c = b; b = a; a = t1 + t2;
+    }
+    state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+    state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+}
+
+void loadBlock(uint64_t block[16], const uint8_t* bytes)
+{
+    for (int i = 0; i < 16; ++i) {
+        uint64_t word = 0;
+        for (int j = 0; j < 8; ++j) {
+            word = (word << 8) | bytes[i * 8 + j];
+        }
+        block[i] = word;
+    }
+}
+
+/**
+ * Finish a SHA-512 whose first @p prefixBytes (a multiple of 128) are
+ * already absorbed in @p state
+ */
+void sha512Finish(uint64_t state[8], uint64_t prefixBytes, const uint8_t* data, size_t size, uint64_t digest[8])
+{
+    uint64_t block[16];
+    size_t offset = 0;
+    for (; size - offset >= 128; offset += 128) {
+        loadBlock(block, data + offset);
+        sha512Compress(state, block);
+    }
+
+    uint8_t tail[256] = {};
+    size_t rest = size - offset;
+    std::memcpy(tail, data + offset, rest);
+    tail[rest] = 0x80;
+    size_t tailSize = rest + 17 <= 128 ? 128 : 256;
+    uint64_t bits = (prefixBytes + size) * 8;
+    for (int i = 0; i < 8; ++i) {
+        tail[tailSize - 1 - i] = static_cast<uint8_t>(bits >> (8 * i));
+    }
+    for (size_t i = 0; i < tailSize; i += 128) {
+        loadBlock(block, tail + i);
+        sha512Compress(state, block);
+    }
+    std::memcpy(digest, state, 64);
+}
+
+void pbkdf2HmacSha512Kernel(const uint8_t* password, size_t passwordSize,
+                            const uint8_t* salt, size_t saltSize,
+                            int iterations, uint8_t* out, size_t outSize)
+{
+    // HMAC key block: keys longer than the block are hashed first
+    uint8_t key[128] = {};
+    if (passwordSize > 128) {
+        uint64_t state[8];
+        uint64_t digest[8];
+        std::memcpy(state, kSha512Init, sizeof(state));
+        sha512Finish(state, 0, password, passwordSize, digest);
+        for (int i = 0; i < 8; ++i) {
+            for (int j = 0; j < 8; ++j) {
+                key[i * 8 + j] = static_cast<uint8_t>(digest[i] >> (56 - 8 * j));
+            }
+        }
+    } else {
+        std::memcpy(key, password, passwordSize);
+    }
+
+    // Precompute the state after absorbing key ^ ipad and key ^ opad: every
+    // HMAC below then starts one compression in
+    uint64_t innerPad[8];
+    uint64_t outerPad[8];
+    uint8_t pad[128];
+    uint64_t block[16];
+    std::memcpy(innerPad, kSha512Init, sizeof(innerPad));
+    std::memcpy(outerPad, kSha512Init, sizeof(outerPad));
+    for (int i = 0; i < 128; ++i) {
+        pad[i] = key[i] ^ 0x36;
+    }
+    loadBlock(block, pad);
+    sha512Compress(innerPad, block);
+    for (int i = 0; i < 128; ++i) {
+        pad[i] = key[i] ^ 0x5c;
+    }
+    loadBlock(block, pad);
+    sha512Compress(outerPad, block);
+    std::memset(key, 0, sizeof(key));
+    std::memset(pad, 0, sizeof(pad));
+
+    // A 64-byte message after the pad block fits one padded block:
+    // words 0-7 = message, then 0x80, zero fill and the 1536-bit length
+    uint64_t innerBlock[16] = {};
+    uint64_t outerBlock[16] = {};
+    innerBlock[8] = outerBlock[8] = 0x8000000000000000ULL;
+    innerBlock[15] = outerBlock[15] = (128 + 64) * 8;
+
+    std::vector<uint8_t> saltBlock(salt, salt + saltSize);
+    saltBlock.resize(saltSize + 4);
+
+    for (uint32_t index = 1; outSize > 0; ++index) {
+        saltBlock[saltSize] = static_cast<uint8_t>(index >> 24);
+        saltBlock[saltSize + 1] = static_cast<uint8_t>(index >> 16);
+        saltBlock[saltSize + 2] = static_cast<uint8_t>(index >> 8);
+        saltBlock[saltSize + 3] = static_cast<uint8_t>(index);
+
+        // U1 = HMAC(password, salt || INT(index))
+        uint64_t state[8];
+        std::memcpy(state, innerPad, sizeof(state));
+        sha512Finish(state, 128, saltBlock.data(), saltBlock.size(), innerBlock);
+        std::memcpy(state, outerPad, sizeof(state));
+        sha512Compress(state, innerBlock);
+        std::memcpy(outerBlock, state, 64);
+
+        uint64_t u[8];
+        uint64_t t[8];
+        std::memcpy(u, outerBlock, sizeof(u));
+        std::memcpy(t, u, sizeof(t));
+
+        // Un = HMAC(password, Un-1): two compressions each
+        for (int i = 1; i < iterations; ++i) {
+            std::memcpy(innerBlock, u, sizeof(u));
+            std::memcpy(state, innerPad, sizeof(state));
+            sha512Compress(state, innerBlock);
+            std::memcpy(outerBlock, state, sizeof(state));
+            std::memcpy(state, outerPad, sizeof(state));
+            sha512Compress(state, outerBlock);
+            for (int j = 0; j < 8; ++j) {
+                u[j] = state[j];
+                t[j] ^= u[j];
+            }
+        }
+
+        size_t take = outSize < 64 ? outSize : 64;
+        for (size_t i = 0; i < take; ++i) {
+            out[i] = static_cast<uint8_t>(t[i / 8] >> (56 - 8 * (i % 8)));
+        }
+        out += take;
+        outSize -= take;
+    }
+}
+
+QString normalized(const QString& text)
+{
+    return text.normalized(QString::NormalizationForm_KD);
+}
+
+QStringList splitWords(const QString& mnemonic)
+{
+    static const QRegularExpression whitespace("\\s+");
+    return normalized(mnemonic).split(whitespace, Qt::SkipEmptyParts);
+}
+
+} // namespace
+
+const QStringList& wordlist(Language language)
+{
+    Q_UNUSED(language);
+    static const QStringList english = QString::fromLatin1(kEnglishWords).split(' ');
+    Q_ASSERT(english.size() == WORDLIST_SIZE);
+    return english;
+}
+
+QStringList indexesToWords(const QVector<int>& indexes, Language language)
+{
+    const QStringList& words = wordlist(language);
+    QStringList result;
+    result.reserve(indexes.size());
+    for (int index : indexes) {
+        if (index < 0 || index >= words.size()) {
+            return QStringList();
+        }
+        result.append(words.at(index));
+    }
+    return result;
+}
+
+QString indexesToMnemonic(const QVector<int>& indexes, Language language)
+{
+    return indexesToWords(indexes, language).join(' ');
+}
+
+QVector<int> mnemonicToIndexes(const QString& mnemonic, Language language)
+{
+    const QStringList& words = wordlist(language);
+    const QStringList input = splitWords(mnemonic);
+
+    QVector<int> indexes;
+    indexes.reserve(input.size());
+    for (const QString& word : input) {
+        // The list is sorted: binary search
+        auto it = std::lower_bound(words.begin(), words.end(), word);
+        if (it == words.end() || *it != word) {
+            return QVector<int>();
+        }
+        indexes.append(static_cast<int>(it - words.begin()));
+    }
+    return indexes;
+}
+
+QByteArray mnemonicToEntropy(const QString& mnemonic, QString& errorMsg, Language language)
+{
+    const int wordCount = splitWords(mnemonic).size();
+    if (wordCount < 12 || wordCount > 24 || wordCount % 3 != 0) {
+        errorMsg = QString("Invalid word count: %1 (expected 12, 15, 18, 21 or 24)").arg(wordCount);
+        return QByteArray();
+    }
+
+    QVector<int> indexes = mnemonicToIndexes(mnemonic, language);
+    if (indexes.isEmpty()) {
+        errorMsg = "Mnemonic contains a word that is not in the wordlist";
+        return QByteArray();
+    }
+
+    // 11 bits per word: entropy followed by ENT/32 checksum bits
+    const int totalBits = wordCount * 11;
+    const int checksumBits = totalBits / 33;
+    const int entropyBytes = (totalBits - checksumBits) / 8;
+
+    QByteArray bits((totalBits + 7) / 8, 0);
+    int bit = 0;
+    for (int index : indexes) {
+        for (int i = 10; i >= 0; --i, ++bit) {
+            if (index & (1 << i)) {
+                bits[bit / 8] = static_cast<char>(bits[bit / 8] | (0x80 >> (bit % 8)));
+            }
+        }
+    }
+
+    QByteArray entropy = bits.left(entropyBytes);
+    const uint8_t hashByte = static_cast<uint8_t>(QCryptographicHash::hash(entropy, QCryptographicHash::Sha256)[0]);
+    const uint8_t checksum = static_cast<uint8_t>(bits[entropyBytes]);
+    const uint8_t mask = static_cast<uint8_t>(0xFF << (8 - checksumBits));
+    if ((hashByte & mask) != (checksum & mask)) {
+        errorMsg = "Invalid mnemonic checksum";
+        return QByteArray();
+    }
+
+    return entropy;
+}
+
+bool validateMnemonic(const QString& mnemonic, QString& errorMsg, Language language)
+{
+    return !mnemonicToEntropy(mnemonic, errorMsg, language).isEmpty();
+}
+
+QByteArray mnemonicToSeed(const QString& mnemonic, const QString& passphrase)
+{
+    QByteArray password = normalized(mnemonic).toUtf8();
+    QByteArray salt = "mnemonic" + normalized(passphrase).toUtf8();
+    QByteArray seed = pbkdf2HmacSha512(password, salt, SEED_ITERATIONS, SEED_SIZE);
+    password.fill(0);
+    salt.fill(0);
+    return seed;
+}
+
+QByteArray pbkdf2HmacSha512(const QByteArray& password, const QByteArray& salt,
+                            int iterations, int keyLength)
+{
+    if (iterations < 1 || keyLength < 1) {
+        return QByteArray();
+    }
+
+    QByteArray result(keyLength, 0);
+    pbkdf2HmacSha512Kernel(reinterpret_cast<const uint8_t*>(password.constData()), password.size(),
+                           reinterpret_cast<const uint8_t*>(salt.constData()), salt.size(),
+                           iterations, reinterpret_cast<uint8_t*>(result.data()), result.size());
+    return result;
+}
+
+} // namespace BIP39
+} // namespace Keycard
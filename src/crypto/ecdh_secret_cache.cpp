@@ -0,0 +1,133 @@
+#include "keycard-qt/ecdh_secret_cache.h"
+#include "keycard-qt/metrics.h"
+#include <QDebug>
+#include <QDeadlineTimer>
+#include <QMutexLocker>
+#include <QThreadPool>
+
+namespace Keycard {
+
+EcdhSecretCache::EcdhSecretCache(int capacity)
+    : m_capacity(qMax(1, capacity))
+{
+}
+
+bool EcdhSecretCache::take(const QByteArray& instanceUID, const QByteArray& cardPublicKey,
+                           SecureChannel::EcdhSecret& secret, int waitMs)
+{
+    QMutexLocker locker(&m_mutex);
+
+    QDeadlineTimer deadline(waitMs);
+    auto it = m_entries.find(instanceUID);
+    while (it != m_entries.end() && it->deriving && it->cardPublicKey == cardPublicKey
+           && !deadline.hasExpired()) {
+        m_derived.wait(&m_mutex, deadline);
+        it = m_entries.find(instanceUID);
+    }
+    if (it == m_entries.end()) {
+        Metrics::increment(QStringLiteral("ecdh_cache.miss"));
+        return false;
+    }
+    if (it->cardPublicKey != cardPublicKey) {
+        qDebug() << "EcdhSecretCache: Card public key changed, dropping entry";
+        m_entries.erase(it);
+        Metrics::increment(QStringLiteral("ecdh_cache.invalidated"));
+        Metrics::increment(QStringLiteral("ecdh_cache.miss"));
+        return false;
+    }
+
+    it->lastUsed = ++m_clock;
+    if (!it->secret.isValid()) {
+        // Still being derived, or taken by the previous session
+        Metrics::increment(QStringLiteral("ecdh_cache.miss"));
+        return false;
+    }
+
+    secret = std::move(it->secret);
+    it->secret = SecureChannel::EcdhSecret();
+    Metrics::increment(QStringLiteral("ecdh_cache.hit"));
+    return true;
+}
+
+void EcdhSecretCache::prepare(const QByteArray& instanceUID, const QByteArray& cardPublicKey)
+{
+    {
+        QMutexLocker locker(&m_mutex);
+
+        Entry& entry = m_entries[instanceUID];
+        if (entry.cardPublicKey != cardPublicKey) {
+            entry = Entry();
+            entry.cardPublicKey = cardPublicKey;
+        }
+        entry.lastUsed = ++m_clock;
+        if (entry.deriving || entry.secret.isValid()) {
+            return;
+        }
+        entry.deriving = true;
+        evictLocked();
+    }
+
+    std::weak_ptr<EcdhSecretCache> weakSelf = weak_from_this();
+    QThreadPool::globalInstance()->start([weakSelf, instanceUID, cardPublicKey]() {
+        SecureChannel::EcdhSecret secret = SecureChannel::deriveSecret(cardPublicKey);
+        if (auto self = weakSelf.lock()) {
+            self->storeDerived(instanceUID, cardPublicKey, secret);
+        }
+    });
+}
+
+void EcdhSecretCache::storeDerived(const QByteArray& instanceUID, const QByteArray& cardPublicKey,
+                                   const SecureChannel::EcdhSecret& secret)
+{
+    QMutexLocker locker(&m_mutex);
+    m_derived.wakeAll();
+
+    auto it = m_entries.find(instanceUID);
+    if (it == m_entries.end() || it->cardPublicKey != cardPublicKey) {
+        return;  // Invalidated, or the card reported another key meanwhile
+    }
+    it->deriving = false;
+    if (secret.isValid()) {
+        it->secret = secret;
+    }
+}
+
+bool EcdhSecretCache::isPrepared(const QByteArray& instanceUID, const QByteArray& cardPublicKey) const
+{
+    QMutexLocker locker(&m_mutex);
+    auto it = m_entries.constFind(instanceUID);
+    return it != m_entries.constEnd() && it->cardPublicKey == cardPublicKey && it->secret.isValid();
+}
+
+void EcdhSecretCache::invalidate(const QByteArray& instanceUID)
+{
+    QMutexLocker locker(&m_mutex);
+    m_entries.remove(instanceUID);
+}
+
+void EcdhSecretCache::clear()
+{
+    QMutexLocker locker(&m_mutex);
+    m_entries.clear();
+}
+
+int EcdhSecretCache::size() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_entries.size();
+}
+
+void EcdhSecretCache::evictLocked()
+{
+    while (m_entries.size() > m_capacity) {
+        auto oldest = m_entries.begin();
+        for (auto it = m_entries.begin(); it != m_entries.end(); ++it) {
+            if (it->lastUsed < oldest->lastUsed) {
+                oldest = it;
+            }
+        }
+        m_entries.erase(oldest);
+    }
+}
+
+} // namespace Keycard
@@ -0,0 +1,237 @@
+#include "keycard-qt/identity.h"
+#include "keycard-qt/tlv_utils.h"
+#include <QCryptographicHash>
+#include <QDebug>
+#include <algorithm>
+#include <future>
+#include <thread>
+
+#ifdef KEYCARD_QT_HAS_OPENSSL
+#include <openssl/bn.h>
+#include <openssl/ec.h>
+#include <openssl/ecdsa.h>
+#include <openssl/obj_mac.h>
+#endif
+
+namespace Keycard {
+
+namespace {
+
+constexpr uint8_t TAG_SIGNATURE_TEMPLATE = 0xA0;
+constexpr uint8_t TAG_CERTIFICATE = 0x8A;
+constexpr uint8_t TAG_ECDSA_SIGNATURE = 0x30;
+constexpr int CERTIFICATE_LENGTH = 98;
+constexpr int CHALLENGE_LENGTH = 32;
+
+#ifdef KEYCARD_QT_HAS_OPENSSL
+EC_KEY* parsePublicKey(const QByteArray& publicKey) {
+    EC_KEY* key = EC_KEY_new_by_curve_name(NID_secp256k1);
+    if (key && EC_KEY_oct2key(key, reinterpret_cast<const unsigned char*>(publicKey.constData()),
+                              static_cast<size_t>(publicKey.size()), nullptr) != 1) {
+        EC_KEY_free(key);
+        return nullptr;
+    }
+    return key;
+}
+
+bool verifyDigest(const QByteArray& digest, const ECDSA_SIG* signature, EC_KEY* key) {
+    return ECDSA_do_verify(reinterpret_cast<const unsigned char*>(digest.constData()),
+                           static_cast<int>(digest.size()), signature, key) == 1;
+}
+
+// r || s as in the certificate
+ECDSA_SIG* rawSignature(const QByteArray& signature) {
+    ECDSA_SIG* sig = ECDSA_SIG_new();
+    BIGNUM* r = BN_bin2bn(reinterpret_cast<const unsigned char*>(signature.constData()), 32, nullptr);
+    BIGNUM* s = BN_bin2bn(reinterpret_cast<const unsigned char*>(signature.constData()) + 32, 32, nullptr);
+    if (!sig || !r || !s || ECDSA_SIG_set0(sig, r, s) != 1) {
+        BN_free(r);
+        BN_free(s);
+        ECDSA_SIG_free(sig);
+        return nullptr;
+    }
+    return sig;
+}
+
+ECDSA_SIG* derSignature(const QByteArray& signature) {
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(signature.constData());
+    return d2i_ECDSA_SIG(nullptr, &p, static_cast<long>(signature.size()));
+}
+#endif
+
+} // namespace
+
+IdentityCertificate IdentityCertificate::parse(const QByteArray& response) {
+    QByteArray signatureTemplate = TLV::findTag(response, TAG_SIGNATURE_TEMPLATE);
+    if (signatureTemplate.isEmpty()) {
+        signatureTemplate = response;
+    }
+
+    IdentityCertificate identity;
+    const QByteArray certificate = TLV::findTag(signatureTemplate, TAG_CERTIFICATE);
+    const QByteArray signature = TLV::findTag(signatureTemplate, TAG_ECDSA_SIGNATURE);
+    if (certificate.size() != CERTIFICATE_LENGTH || signature.isEmpty()) {
+        return identity;
+    }
+
+    identity.certificate = certificate;
+    identity.cardPublicKey = certificate.left(33);
+    identity.caSignature = certificate.mid(33, 64);
+    identity.signature = TLV::encode(TAG_ECDSA_SIGNATURE, signature);
+    return identity;
+}
+
+#ifdef KEYCARD_QT_HAS_OPENSSL
+struct IdentityVerifier::CaKey {
+    EC_KEY* key = nullptr;
+
+    ~CaKey() { EC_KEY_free(key); }
+};
+#else
+struct IdentityVerifier::CaKey {};
+#endif
+
+IdentityVerifier::IdentityVerifier(const QList<QByteArray>& caPublicKeys)
+{
+    for (const QByteArray& publicKey : caPublicKeys) {
+        if (!addCaPublicKey(publicKey)) {
+            qWarning() << "IdentityVerifier: Ignoring invalid CA public key" << publicKey.toHex();
+        }
+    }
+}
+
+IdentityVerifier::~IdentityVerifier() = default;
+
+bool IdentityVerifier::isAvailable() {
+#ifdef KEYCARD_QT_HAS_OPENSSL
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool IdentityVerifier::addCaPublicKey(const QByteArray& publicKey) {
+#ifndef KEYCARD_QT_HAS_OPENSSL
+    Q_UNUSED(publicKey);
+    return false;
+#else
+    EC_KEY* key = parsePublicKey(publicKey);
+    if (!key) {
+        return false;
+    }
+    auto caKey = std::make_unique<CaKey>();
+    caKey->key = key;
+    m_caKeys.push_back(std::move(caKey));
+    return true;
+#endif
+}
+
+int IdentityVerifier::caKeyCount() const {
+    return static_cast<int>(m_caKeys.size());
+}
+
+IdentityVerifier::Result IdentityVerifier::verify(const Request& request) {
+    Result result;
+#ifndef KEYCARD_QT_HAS_OPENSSL
+    Q_UNUSED(request);
+    result.status = Status::Unavailable;
+    return result;
+#else
+    const IdentityCertificate identity = IdentityCertificate::parse(request.response);
+    if (request.challenge.size() != CHALLENGE_LENGTH || !identity.isValid()) {
+        return result;
+    }
+
+    EC_KEY* cardKey = parsePublicKey(identity.cardPublicKey);
+    ECDSA_SIG* challengeSignature = derSignature(identity.signature);
+    if (!cardKey || !challengeSignature) {
+        EC_KEY_free(cardKey);
+        ECDSA_SIG_free(challengeSignature);
+        return result;
+    }
+
+    if (!request.instanceUID.isEmpty()) {
+        QMutexLocker locker(&m_cacheMutex);
+        auto it = m_cache.constFind(request.instanceUID);
+        if (it != m_cache.constEnd() && it->certificate == identity.certificate) {
+            result.caIndex = it->caIndex;
+            result.cached = true;
+        }
+    }
+
+    // Certificate: a CA signature over SHA-256 of the card identity key
+    if (!result.cached) {
+        const QByteArray digest = QCryptographicHash::hash(identity.cardPublicKey, QCryptographicHash::Sha256);
+        ECDSA_SIG* caSignature = rawSignature(identity.caSignature);
+        for (size_t i = 0; caSignature && i < m_caKeys.size(); ++i) {
+            if (verifyDigest(digest, caSignature, m_caKeys[i]->key)) {
+                result.caIndex = static_cast<int>(i);
+                break;
+            }
+        }
+        ECDSA_SIG_free(caSignature);
+    }
+
+    if (result.caIndex < 0) {
+        result.status = Status::UntrustedCertificate;
+    } else if (!verifyDigest(request.challenge, challengeSignature, cardKey)) {
+        result.status = Status::InvalidSignature;
+    } else {
+        result.status = Status::Verified;
+        result.cardPublicKey = identity.cardPublicKey;
+    }
+    EC_KEY_free(cardKey);
+    ECDSA_SIG_free(challengeSignature);
+
+    // Only remembered once the card has also proven it holds the key
+    if (result.isVerified() && !result.cached && !request.instanceUID.isEmpty()) {
+        QMutexLocker locker(&m_cacheMutex);
+        m_cache.insert(request.instanceUID, CachedCard{identity.certificate, result.caIndex});
+    }
+    return result;
+#endif
+}
+
+QVector<IdentityVerifier::Result> IdentityVerifier::verifyBatch(const QVector<Request>& requests, int threads) {
+    const int count = static_cast<int>(requests.size());
+    QVector<Result> results(count);
+    if (threads <= 0) {
+        threads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    }
+    threads = std::min(threads, count);
+
+    // Contiguous slices, one worker each; the calling thread takes the first.
+    // Workers write through a raw pointer so the vector is never touched concurrently
+    const int sliceSize = threads > 0 ? (count + threads - 1) / threads : 0;
+    Result* out = results.data();
+    auto verifySlice = [this, &requests, out, count, sliceSize](int slice) {
+        const int end = std::min(count, (slice + 1) * sliceSize);
+        for (int i = slice * sliceSize; i < end; ++i) {
+            out[i] = verify(requests.at(i));
+        }
+    };
+
+    std::vector<std::future<void>> workers;
+    for (int slice = 1; slice < threads; ++slice) {
+        workers.push_back(std::async(std::launch::async, verifySlice, slice));
+    }
+    if (threads > 0) {
+        verifySlice(0);
+    }
+    for (std::future<void>& worker : workers) {
+        worker.wait();
+    }
+    return results;
+}
+
+int IdentityVerifier::cachedCount() const {
+    QMutexLocker locker(&m_cacheMutex);
+    return m_cache.size();
+}
+
+void IdentityVerifier::clearCache() {
+    QMutexLocker locker(&m_cacheMutex);
+    m_cache.clear();
+}
+
+} // namespace Keycard
@@ -0,0 +1,88 @@
+#include "keycard-qt/instrumented_mutex.h"
+#include <QCoreApplication>
+#include <QThread>
+#include <chrono>
+
+namespace Keycard {
+
+#ifdef KEYCARD_QT_LOCK_METRICS
+namespace {
+
+qint64 nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void storeMax(std::atomic<qint64>& target, qint64 value) {
+    qint64 current = target.load(std::memory_order_relaxed);
+    while (value > current && !target.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+    }
+}
+
+bool onMainThread() {
+    const QCoreApplication* app = QCoreApplication::instance();
+    return app && QThread::currentThread() == app->thread();
+}
+
+} // namespace
+#endif
+
+InstrumentedMutex::InstrumentedMutex(const char* name)
+    : m_name(name)
+{
+#ifdef KEYCARD_QT_LOCK_METRICS
+    m_counters = Metrics::lockCounters(name);
+#endif
+}
+
+bool InstrumentedMutex::wait(QWaitCondition& condition, QDeadlineTimer deadline) {
+#ifdef KEYCARD_QT_LOCK_METRICS
+    // Released while waiting: end this hold and start a new one on wake-up
+    const qint64 heldNs = nowNs() - m_lockedAtNs;
+    m_counters->totalHoldNs.fetch_add(heldNs, std::memory_order_relaxed);
+    storeMax(m_counters->maxHoldNs, heldNs);
+
+    const bool woken = condition.wait(&m_mutex, deadline);
+    m_lockedAtNs = nowNs();
+    return woken;
+#else
+    return condition.wait(&m_mutex, deadline);
+#endif
+}
+
+#ifdef KEYCARD_QT_LOCK_METRICS
+void InstrumentedMutex::lockInstrumented() noexcept {
+    // Uncontended acquisitions cost one extra clock read (for the hold time)
+    if (m_mutex.tryLock()) {
+        acquired(0, false);
+        return;
+    }
+    const qint64 start = nowNs();
+    m_mutex.lock();
+    acquired(nowNs() - start, true);
+}
+
+void InstrumentedMutex::unlockInstrumented() noexcept {
+    const qint64 heldNs = nowNs() - m_lockedAtNs;
+    m_mutex.unlock();
+    m_counters->totalHoldNs.fetch_add(heldNs, std::memory_order_relaxed);
+    storeMax(m_counters->maxHoldNs, heldNs);
+}
+
+void InstrumentedMutex::acquired(qint64 waitNs, bool contended) noexcept {
+    m_lockedAtNs = nowNs();
+    m_counters->acquisitions.fetch_add(1, std::memory_order_relaxed);
+    if (!contended) {
+        return;
+    }
+    m_counters->contended.fetch_add(1, std::memory_order_relaxed);
+    m_counters->totalWaitNs.fetch_add(waitNs, std::memory_order_relaxed);
+    storeMax(m_counters->maxWaitNs, waitNs);
+    if (onMainThread()) {
+        m_counters->mainThreadContended.fetch_add(1, std::memory_order_relaxed);
+        m_counters->mainThreadWaitNs.fetch_add(waitNs, std::memory_order_relaxed);
+    }
+}
+#endif
+
+} // namespace Keycard
@@ -45,41 +45,113 @@ uint32_t readLEB128(const QByteArray& data, int& offset) {
     return result;
 }
 
-QByteArray encode(const QString& name, const QStringList& paths, QString& errorMsg) {
-    qDebug() << "Metadata::encode: name:" << name << "paths:" << paths.size();
+// Header byte layout: version in the top 3 bits, name length in the bottom 5
+static constexpr uint8_t METADATA_VERSION = 1;
+static constexpr int MAX_NAME_LENGTH = 20;
+
+// Checked LEB128 read used by the decoder: fails on truncated or >32-bit values
+// instead of silently returning 0 like readLEB128()
+static bool readLEB128Checked(const QByteArray& data, int& offset, uint32_t& value) {
+    value = 0;
+    int shift = 0;
     
-    // Validate name length
-    QByteArray nameBytes = name.toUtf8();
-    if (nameBytes.size() > 20) {
-        errorMsg = "Card name exceeds 20 characters";
-        return QByteArray();
+    while (offset < data.size()) {
+        uint8_t byte = static_cast<uint8_t>(data[offset]);
+        offset++;
+        
+        if (shift == 28 && (byte & 0x70) != 0) {
+            return false;  // Does not fit in 32 bits
+        }
+        value |= static_cast<uint32_t>(byte & 0x7F) << shift;
+        
+        if ((byte & 0x80) == 0) {
+            return true;
+        }
+        
+        shift += 7;
+        if (shift > 28) {
+            return false;
+        }
     }
     
-    // Parse paths to extract last component (matching Go implementation)
-    // All paths must start with PATH_WALLET_ROOT
-    QVector<uint32_t> pathComponents;
+    return false;  // Ran out of data mid-value
+}
+
+// Parse wallet paths to extract their last component (matching Go implementation)
+// All paths must start with PATH_WALLET_ROOT
+static bool parsePathIndexes(const QStringList& paths, QVector<uint32_t>& indexes, QString& errorMsg) {
+    indexes.reserve(indexes.size() + paths.size());
     for (const QString& path : paths) {
         if (!path.startsWith(PATH_WALLET_ROOT)) {
             errorMsg = QString("Path '%1' does not start with wallet root path '%2'")
                       .arg(path, PATH_WALLET_ROOT);
-            return QByteArray();
+            return false;
         }
         
         // Extract last component (after last '/')
         QStringList parts = path.split('/');
         if (parts.isEmpty()) {
             errorMsg = QString("Invalid path format: %1").arg(path);
-            return QByteArray();
+            return false;
         }
         
         bool ok;
         uint32_t component = parts.last().toUInt(&ok);
         if (!ok) {
             errorMsg = QString("Invalid path component: %1").arg(parts.last());
-            return QByteArray();
+            return false;
         }
         
-        pathComponents.append(component);
+        indexes.append(component);
+    }
+    return true;
+}
+
+// Group indexes into sorted, coalesced ranges
+static QVector<PathRange> indexesToRanges(QVector<uint32_t> indexes) {
+    std::sort(indexes.begin(), indexes.end());
+    indexes.erase(std::unique(indexes.begin(), indexes.end()), indexes.end());
+    
+    QVector<PathRange> ranges;
+    for (uint32_t index : indexes) {
+        if (!ranges.isEmpty() && ranges.last().last() + 1 == index) {
+            ranges.last().count++;
+        } else {
+            ranges.append(PathRange{index, 0});
+        }
+    }
+    return ranges;
+}
+
+static PathRange makeRange(uint64_t first, uint64_t last) {
+    return PathRange{static_cast<uint32_t>(first), static_cast<uint32_t>(last - first)};
+}
+
+// Ranges written by other implementations are not guaranteed to be ordered;
+// sort and coalesce them so the linear merge/subtract passes stay valid
+static QVector<PathRange> normalizeRanges(QVector<PathRange> ranges) {
+    bool sorted = std::is_sorted(ranges.begin(), ranges.end(),
+                                 [](const PathRange& a, const PathRange& b) { return a.start < b.start; });
+    if (!sorted) {
+        std::sort(ranges.begin(), ranges.end(),
+                  [](const PathRange& a, const PathRange& b) { return a.start < b.start; });
+    }
+    return mergeRanges(ranges, QVector<PathRange>());
+}
+
+QByteArray encode(const QString& name, const QStringList& paths, QString& errorMsg) {
+    qDebug() << "Metadata::encode: name:" << name << "paths:" << paths.size();
+    
+    // Validate name length
+    QByteArray nameBytes = name.toUtf8();
+    if (nameBytes.size() > MAX_NAME_LENGTH) {
+        errorMsg = "Card name exceeds 20 characters";
+        return QByteArray();
+    }
+    
+    QVector<uint32_t> pathComponents;
+    if (!parsePathIndexes(paths, pathComponents, errorMsg)) {
+        return QByteArray();
     }
     
     // Sort path components (Go keeps them ordered)
@@ -126,6 +198,271 @@ QByteArray encode(const QString& name, const QStringList& paths, QString& errorM
     return metadata;
 }
 
+QByteArray encodeRanges(const QString& name, const QVector<PathRange>& ranges, QString& errorMsg) {
+    QByteArray nameBytes = name.toUtf8();
+    if (nameBytes.size() > MAX_NAME_LENGTH) {
+        errorMsg = "Card name exceeds 20 characters";
+        return QByteArray();
+    }
+    
+    QByteArray metadata;
+    metadata.reserve(1 + nameBytes.size() + ranges.size() * 4);
+    metadata.append(static_cast<char>((METADATA_VERSION << 5) | nameBytes.size()));
+    metadata.append(nameBytes);
+    
+    for (const PathRange& range : ranges) {
+        writeLEB128(metadata, range.start);
+        writeLEB128(metadata, range.count);
+    }
+    
+    return metadata;
+}
+
+bool decode(const QByteArray& data, WalletMetadata& result, QString& errorMsg) {
+    if (data.isEmpty()) {
+        errorMsg = "Metadata is empty";
+        return false;
+    }
+    
+    uint8_t header = static_cast<uint8_t>(data[0]);
+    uint8_t version = header >> 5;
+    int nameLength = header & 0x1F;
+    
+    if (version != METADATA_VERSION) {
+        errorMsg = QString("Unsupported metadata version: %1").arg(version);
+        return false;
+    }
+    
+    if (nameLength > MAX_NAME_LENGTH || 1 + nameLength > data.size()) {
+        errorMsg = QString("Invalid metadata name length: %1").arg(nameLength);
+        return false;
+    }
+    
+    // Validate every pair once so the lazy view can iterate without error checks
+    int offset = 1 + nameLength;
+    while (offset < data.size()) {
+        uint32_t start = 0;
+        uint32_t count = 0;
+        if (!readLEB128Checked(data, offset, start) || !readLEB128Checked(data, offset, count)) {
+            errorMsg = QString("Malformed wallet path range at offset %1").arg(offset);
+            return false;
+        }
+        if (static_cast<uint64_t>(start) + count > UINT32_MAX) {
+            errorMsg = QString("Wallet path range overflows: start=%1 count=%2").arg(start).arg(count);
+            return false;
+        }
+    }
+    
+    result.version = version;
+    result.name = QString::fromUtf8(data.mid(1, nameLength));
+    result.paths = WalletPaths(data.mid(1 + nameLength));
+    return true;
+}
+
+QVector<PathRange> mergeRanges(const QVector<PathRange>& a, const QVector<PathRange>& b) {
+    QVector<PathRange> merged;
+    merged.reserve(a.size() + b.size());
+    
+    int i = 0;
+    int j = 0;
+    while (i < a.size() || j < b.size()) {
+        // Take whichever range starts first
+        const PathRange& next = (j >= b.size() || (i < a.size() && a[i].start <= b[j].start))
+                                ? a[i++] : b[j++];
+        
+        if (!merged.isEmpty() && next.start <= merged.last().last() + 1) {
+            // Overlapping or adjacent: extend the previous range
+            uint64_t last = std::max(merged.last().last(), next.last());
+            merged.last() = makeRange(merged.last().start, last);
+        } else {
+            merged.append(next);
+        }
+    }
+    
+    return merged;
+}
+
+QVector<PathRange> subtractRanges(const QVector<PathRange>& from, const QVector<PathRange>& remove) {
+    QVector<PathRange> result;
+    result.reserve(from.size() + remove.size());
+    
+    int j = 0;
+    for (const PathRange& range : from) {
+        uint64_t first = range.start;
+        const uint64_t last = range.last();
+        
+        // Skip removals entirely before this range
+        while (j < remove.size() && remove[j].last() < first) {
+            j++;
+        }
+        
+        // Cut out every removal overlapping this range
+        int k = j;
+        while (k < remove.size() && remove[k].start <= last && first <= last) {
+            if (remove[k].start > first) {
+                result.append(makeRange(first, remove[k].start - 1));
+            }
+            first = remove[k].last() + 1;
+            if (remove[k].last() > last) {
+                break;  // Removal continues into the next range
+            }
+            k++;
+        }
+        j = k;
+        
+        if (first <= last) {
+            result.append(makeRange(first, last));
+        }
+    }
+    
+    return result;
+}
+
+// Shared decode -> modify -> re-encode path for addPaths/removePaths
+template <typename Op>
+static QByteArray updatePaths(const QByteArray& metadata, const QStringList& paths,
+                              QString& errorMsg, Op op) {
+    WalletMetadata current;
+    if (!metadata.isEmpty() && !decode(metadata, current, errorMsg)) {
+        return QByteArray();
+    }
+    
+    QVector<uint32_t> indexes;
+    if (!parsePathIndexes(paths, indexes, errorMsg)) {
+        return QByteArray();
+    }
+    
+    QVector<PathRange> ranges = op(normalizeRanges(current.paths.ranges()), indexesToRanges(indexes));
+    return encodeRanges(current.name, ranges, errorMsg);
+}
+
+QByteArray addPaths(const QByteArray& metadata, const QStringList& paths, QString& errorMsg) {
+    qDebug() << "Metadata::addPaths: adding" << paths.size() << "paths";
+    return updatePaths(metadata, paths, errorMsg, mergeRanges);
+}
+
+QByteArray removePaths(const QByteArray& metadata, const QStringList& paths, QString& errorMsg) {
+    qDebug() << "Metadata::removePaths: removing" << paths.size() << "paths";
+    return updatePaths(metadata, paths, errorMsg, subtractRanges);
+}
+
+// ============================================================================
+// WalletPaths
+// ============================================================================
+
+WalletPaths::RangeIterator::RangeIterator(const QByteArray& data, int offset)
+    : m_data(data)
+    , m_offset(offset)
+{
+    load();
+}
+
+void WalletPaths::RangeIterator::load() {
+    if (m_offset < 0 || m_offset >= m_data.size()) {
+        // Every end iterator is alike, whatever view it came from
+        m_data = QByteArray();
+        m_offset = -1;
+        return;
+    }
+    
+    // Data was validated by decode(), plain reads are enough here
+    m_next = m_offset;
+    m_current.start = readLEB128(m_data, m_next);
+    m_current.count = readLEB128(m_data, m_next);
+}
+
+WalletPaths::RangeIterator& WalletPaths::RangeIterator::operator++() {
+    m_offset = m_next;
+    load();
+    return *this;
+}
+
+WalletPaths::const_iterator::const_iterator(RangeIterator range)
+    : m_range(range)
+{
+}
+
+WalletPaths::const_iterator& WalletPaths::const_iterator::operator++() {
+    if (m_step < m_range->count) {
+        m_step++;
+    } else {
+        ++m_range;
+        m_step = 0;
+    }
+    return *this;
+}
+
+WalletPaths::WalletPaths(const QByteArray& encodedRanges)
+    : m_data(encodedRanges)
+{
+}
+
+WalletPaths::RangeIterator WalletPaths::rangesBegin() const {
+    return RangeIterator(m_data, 0);
+}
+
+WalletPaths::RangeIterator WalletPaths::rangesEnd() const {
+    return RangeIterator();
+}
+
+WalletPaths::const_iterator WalletPaths::begin() const {
+    return const_iterator(rangesBegin());
+}
+
+WalletPaths::const_iterator WalletPaths::end() const {
+    return const_iterator(rangesEnd());
+}
+
+uint64_t WalletPaths::size() const {
+    uint64_t total = 0;
+    for (auto it = rangesBegin(); it != rangesEnd(); ++it) {
+        total += static_cast<uint64_t>(it->count) + 1;
+    }
+    return total;
+}
+
+int WalletPaths::rangeCount() const {
+    int count = 0;
+    for (auto it = rangesBegin(); it != rangesEnd(); ++it) {
+        count++;
+    }
+    return count;
+}
+
+bool WalletPaths::contains(uint32_t index) const {
+    for (auto it = rangesBegin(); it != rangesEnd(); ++it) {
+        if (it->contains(index)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+QVector<PathRange> WalletPaths::ranges() const {
+    QVector<PathRange> result;
+    for (auto it = rangesBegin(); it != rangesEnd(); ++it) {
+        result.append(*it);
+    }
+    return result;
+}
+
+QStringList WalletPaths::toStringList() const {
+    QStringList result;
+    for (uint32_t index : *this) {
+        result.append(QString("%1/%2").arg(PATH_WALLET_ROOT).arg(index));
+    }
+    return result;
+}
+
+Metadata WalletMetadata::toMetadata() const {
+    Metadata meta;
+    meta.name = name;
+    for (uint32_t index : paths) {
+        meta.paths.append(index);
+    }
+    return meta;
+}
+
 } // namespace MetadataEncoding
 } // namespace Keycard
 
@@ -0,0 +1,106 @@
+#include "keycard-qt/metrics.h"
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+#include <algorithm>
+#include <utility>
+
+namespace Keycard {
+
+namespace {
+
+struct Registry {
+    QMutex mutex;
+    QMap<QString, quint64> counters;
+    QHash<QByteArray, Metrics::LockCounters*> locks;
+};
+
+// Never destroyed: locks may still be taken during static destruction
+Registry& registry() {
+    static Registry* instance = new Registry;
+    return *instance;
+}
+
+} // namespace
+
+void Metrics::increment(const QString& name, quint64 amount) {
+    Registry& r = registry();
+    QMutexLocker locker(&r.mutex);
+    r.counters[name] += amount;
+}
+
+quint64 Metrics::counter(const QString& name) {
+    Registry& r = registry();
+    QMutexLocker locker(&r.mutex);
+    return r.counters.value(name, 0);
+}
+
+QMap<QString, quint64> Metrics::counters() {
+    Registry& r = registry();
+    QMutexLocker locker(&r.mutex);
+    return r.counters;
+}
+
+bool Metrics::lockMetricsEnabled() {
+#ifdef KEYCARD_QT_LOCK_METRICS
+    return true;
+#else
+    return false;
+#endif
+}
+
+Metrics::LockCounters* Metrics::lockCounters(const char* name) {
+    Registry& r = registry();
+    QMutexLocker locker(&r.mutex);
+    const QByteArray key(name);
+    LockCounters*& counters = r.locks[key];
+    if (!counters) {
+        counters = new LockCounters;
+        counters->name = name;
+    }
+    return counters;
+}
+
+QVector<Metrics::LockStats> Metrics::lockStats() {
+    Registry& r = registry();
+    QVector<LockStats> stats;
+    {
+        QMutexLocker locker(&r.mutex);
+        stats.reserve(r.locks.size());
+        for (const LockCounters* counters : std::as_const(r.locks)) {
+            LockStats entry;
+            entry.name = QString::fromLatin1(counters->name);
+            entry.acquisitions = counters->acquisitions.load(std::memory_order_relaxed);
+            entry.contended = counters->contended.load(std::memory_order_relaxed);
+            entry.totalWaitNs = counters->totalWaitNs.load(std::memory_order_relaxed);
+            entry.maxWaitNs = counters->maxWaitNs.load(std::memory_order_relaxed);
+            entry.totalHoldNs = counters->totalHoldNs.load(std::memory_order_relaxed);
+            entry.maxHoldNs = counters->maxHoldNs.load(std::memory_order_relaxed);
+            entry.mainThreadContended = counters->mainThreadContended.load(std::memory_order_relaxed);
+            entry.mainThreadWaitNs = counters->mainThreadWaitNs.load(std::memory_order_relaxed);
+            stats.append(entry);
+        }
+    }
+    std::sort(stats.begin(), stats.end(), [](const LockStats& a, const LockStats& b) {
+        return a.totalWaitNs != b.totalWaitNs ? a.totalWaitNs > b.totalWaitNs : a.name < b.name;
+    });
+    return stats;
+}
+
+void Metrics::reset() {
+    Registry& r = registry();
+    QMutexLocker locker(&r.mutex);
+    r.counters.clear();
+    for (LockCounters* counters : std::as_const(r.locks)) {
+        counters->acquisitions.store(0, std::memory_order_relaxed);
+        counters->contended.store(0, std::memory_order_relaxed);
+        counters->totalWaitNs.store(0, std::memory_order_relaxed);
+        counters->maxWaitNs.store(0, std::memory_order_relaxed);
+        counters->totalHoldNs.store(0, std::memory_order_relaxed);
+        counters->maxHoldNs.store(0, std::memory_order_relaxed);
+        counters->mainThreadContended.store(0, std::memory_order_relaxed);
+        counters->mainThreadWaitNs.store(0, std::memory_order_relaxed);
+    }
+}
+
+} // namespace Keycard
@@ -0,0 +1,395 @@
+#include "keycard-qt/session_planner.h"
+#include <QDebug>
+#include <QStringList>
+#include <QtEndian>
+#include <algorithm>
+#include <map>
+#include <unordered_map>
+
+namespace Keycard {
+
+namespace {
+
+constexpr uint32_t BIP32_HARDENED_BIT = 0x80000000;
+
+enum class DerivationSource { Master, Parent, Current };
+
+// Same syntax as CommandSet's parseDerivationPath(), but strict: any malformed
+// segment makes the whole path unusable for planning
+bool parseSegments(const QString& path, SessionPlanner::KeyPath& out, DerivationSource& source)
+{
+    QString cleanPath = path.trimmed();
+    out.clear();
+
+    if (cleanPath.startsWith("m/")) {
+        source = DerivationSource::Master;
+        cleanPath = cleanPath.mid(2);
+    } else if (cleanPath.startsWith("../")) {
+        source = DerivationSource::Parent;
+        cleanPath = cleanPath.mid(3);
+    } else if (cleanPath.startsWith("./")) {
+        source = DerivationSource::Current;
+        cleanPath = cleanPath.mid(2);
+    } else {
+        source = DerivationSource::Current;
+    }
+
+    if (cleanPath.isEmpty()) {
+        return false;
+    }
+
+    const QStringList segments = cleanPath.split('/');
+    for (const QString& segment : segments) {
+        bool hardened = segment.endsWith("'") || segment.endsWith("h");
+        bool ok = false;
+        uint32_t value = (hardened ? segment.left(segment.length() - 1) : segment).toUInt(&ok);
+        if (!ok || (value & BIP32_HARDENED_BIT)) {
+            return false;
+        }
+        out.append(hardened ? value | BIP32_HARDENED_BIT : value);
+    }
+    return true;
+}
+
+bool isPrefix(const SessionPlanner::KeyPath& prefix, const SessionPlanner::KeyPath& path)
+{
+    return prefix.size() <= path.size() && std::equal(prefix.begin(), prefix.end(), path.begin());
+}
+
+// Index of the first segment the card has to derive, mirroring
+// CommandSet::encodeDerivationPath()
+int derivationStart(const SessionPlanner::KeyPath& path, bool canDeriveFromCurrent,
+                    const SessionPlanner::KeyPath& current, bool currentKnown)
+{
+    if (canDeriveFromCurrent && currentKnown && !current.isEmpty()
+        && current.size() < path.size() && isPrefix(current, path)) {
+        return current.size();
+    }
+    return 0;
+}
+
+void addSteps(DerivationCost& cost, const SessionPlanner::KeyPath& path, int from)
+{
+    cost.derivations++;
+    for (int i = from; i < path.size(); ++i) {
+        if (path[i] & BIP32_HARDENED_BIT) {
+            cost.hardenedSteps++;
+        } else {
+            cost.normalSteps++;
+        }
+    }
+}
+
+/**
+ * Follows the card's current key through a command sequence, the way
+ * CommandSet tracks it at run time
+ */
+struct CurrentKeyTracker {
+    SessionPlanner::KeyPath current;
+    bool known = false;
+
+    void apply(const CardCommand& cmd, DerivationCost& cost)
+    {
+        QString pathString = cmd.derivationPath();
+        if (pathString.isEmpty()) {
+            // Uses the current key or none; key changes (LOAD KEY, REMOVE KEY...)
+            // are not visible from here
+            known = false;
+            return;
+        }
+
+        SessionPlanner::KeyPath path;
+        DerivationSource source;
+        if (!parseSegments(pathString, path, source)) {
+            known = false;
+            return;
+        }
+
+        int from = source == DerivationSource::Master
+            ? derivationStart(path, cmd.canDeriveFromCurrent(), current, known)
+            : 0;
+        addSteps(cost, path, from);
+
+        if (!cmd.changesCurrentPath()) {
+            return;
+        }
+        if (source == DerivationSource::Master) {
+            current = path;
+            known = true;
+        } else if (known && source == DerivationSource::Current) {
+            current += path;
+        } else if (known && !current.isEmpty()) {
+            current.removeLast();
+            current += path;
+        } else {
+            known = false;
+        }
+    }
+};
+
+DerivationCost estimateSequence(const std::vector<CardCommand*>& sequence,
+                                const SessionPlanner::KeyPath& currentPath, bool currentPathKnown)
+{
+    DerivationCost cost;
+    CurrentKeyTracker tracker{currentPath, currentPathKnown};
+    for (const CardCommand* cmd : sequence) {
+        tracker.apply(*cmd, cost);
+    }
+    return cost;
+}
+
+} // namespace
+
+struct SessionPlanner::Item {
+    CardCommand* cmd = nullptr;
+    KeyPath path;
+    int phase = 0;   // Number of makeCurrent commands before it in FIFO order
+};
+
+SessionPlanner::SessionPlanner() = default;
+
+SessionPlanner::SessionPlanner(const Options& options)
+    : m_options(options)
+{
+}
+
+SessionPlan SessionPlanner::plan(CommandQueue& queue, const KeyPath& currentPath, bool currentPathKnown) const
+{
+    SessionPlan result;
+    result.commandCount = static_cast<int>(queue.size());
+
+    std::vector<CardCommand*> fifo;
+    fifo.reserve(queue.size());
+    for (const auto& cmd : queue) {
+        fifo.push_back(cmd.get());
+    }
+    result.fifoCost = estimateSequence(fifo, currentPath, currentPathKnown);
+    result.plannedCost = result.fifoCost;
+
+    std::vector<CardCommand*> planned;
+    std::vector<std::unique_ptr<CardCommand>> insertedCommands;
+    CurrentKeyTracker tracker{currentPath, currentPathKnown};
+    DerivationCost ignored;
+    std::vector<Item> run;
+
+    auto flushRun = [&]() {
+        if (run.empty()) {
+            return;
+        }
+        size_t first = planned.size();
+        planRun(run, tracker.current, tracker.known, planned, insertedCommands);
+        for (size_t i = first; i < planned.size(); ++i) {
+            tracker.apply(*planned[i], ignored);
+        }
+        run.clear();
+    };
+
+    int phase = 0;
+    for (CardCommand* cmd : fifo) {
+        Item item;
+        DerivationSource source;
+        bool plannable = !cmd->keepOrder()
+            && !cmd->derivationPath().isEmpty()
+            && parseSegments(cmd->derivationPath(), item.path, source)
+            && source == DerivationSource::Master;
+
+        if (plannable) {
+            item.cmd = cmd;
+            item.phase = phase;
+            if (cmd->changesCurrentPath()) {
+                phase++;
+            }
+            run.push_back(item);
+            continue;
+        }
+
+        flushRun();
+        phase = 0;
+        planned.push_back(cmd);
+        tracker.apply(*cmd, ignored);
+    }
+    flushRun();
+
+    DerivationCost plannedCost = estimateSequence(planned, currentPath, currentPathKnown);
+    if (plannedCost.steps() >= result.fifoCost.steps()) {
+        return result;
+    }
+
+    // Adopt the plan
+    std::unordered_map<CardCommand*, std::unique_ptr<CardCommand>> owners;
+    for (auto& cmd : queue) {
+        CardCommand* raw = cmd.get();
+        owners.emplace(raw, std::move(cmd));
+    }
+    for (auto& cmd : insertedCommands) {
+        CardCommand* raw = cmd.get();
+        owners.emplace(raw, std::move(cmd));
+    }
+    queue.clear();
+
+    size_t fifoIndex = 0;
+    for (CardCommand* cmd : planned) {
+        auto it = owners.find(cmd);
+        queue.push_back(std::move(it->second));
+        owners.erase(it);
+
+        if (std::find(fifo.begin(), fifo.end(), cmd) == fifo.end()) {
+            continue;
+        }
+        if (fifo[fifoIndex] != cmd) {
+            result.movedCommands++;
+        }
+        fifoIndex++;
+    }
+
+    result.commandCount = static_cast<int>(queue.size());
+    result.insertedDerivations = static_cast<int>(insertedCommands.size());
+    result.plannedCost = plannedCost;
+    return result;
+}
+
+void SessionPlanner::planRun(std::vector<Item>& run, const KeyPath& startPath, bool startKnown,
+                             std::vector<CardCommand*>& out,
+                             std::vector<std::unique_ptr<CardCommand>>& inserted) const
+{
+    // Phase 0 starts from the run's initial key, phase i from the i-th makeCurrent command
+    std::vector<const Item*> anchors;
+    for (const Item& item : run) {
+        if (item.cmd->changesCurrentPath()) {
+            anchors.push_back(&item);
+        }
+    }
+    const int phaseCount = static_cast<int>(anchors.size()) + 1;
+
+    auto phaseStart = [&](int phase, bool& known) -> const KeyPath& {
+        known = phase == 0 ? startKnown : true;
+        return phase == 0 ? startPath : anchors[phase - 1]->path;
+    };
+    auto stepsIn = [&](const Item& item, int phase) {
+        bool known;
+        const KeyPath& current = phaseStart(phase, known);
+        return item.path.size() - derivationStart(item.path, item.cmd->canDeriveFromCurrent(), current, known);
+    };
+
+    // Free commands go to the phase whose key they extend the most
+    std::vector<std::vector<const Item*>> phases(phaseCount);
+    for (const Item& item : run) {
+        if (item.cmd->changesCurrentPath()) {
+            continue;
+        }
+        int best = item.phase;
+        int bestSteps = stepsIn(item, best);
+        for (int phase = 0; phase < phaseCount; ++phase) {
+            int steps = stepsIn(item, phase);
+            if (steps < bestSteps) {
+                best = phase;
+                bestSteps = steps;
+            }
+        }
+        phases[best].push_back(&item);
+    }
+
+    auto byPath = [](const Item* a, const Item* b) {
+        return std::lexicographical_compare(a->path.begin(), a->path.end(), b->path.begin(), b->path.end());
+    };
+
+    for (int phase = 0; phase < phaseCount; ++phase) {
+        if (phase > 0) {
+            out.push_back(anchors[phase - 1]->cmd);
+        }
+
+        std::vector<const Item*>& items = phases[phase];
+        std::stable_sort(items.begin(), items.end(), byPath);
+
+        // Leaving a different current key behind is only invisible if a later
+        // makeCurrent command in this run overrides it
+        bool mayInsert = phase < phaseCount - 1 || m_options.allowCurrentPathChange;
+        if (!mayInsert) {
+            for (const Item* item : items) {
+                out.push_back(item->cmd);
+            }
+            continue;
+        }
+
+        bool known;
+        const KeyPath& current = phaseStart(phase, known);
+
+        std::map<KeyPath, std::vector<const Item*>> groups;
+        for (const Item* item : items) {
+            if (item->cmd->canDeriveFromCurrent() && item->path.size() > 1) {
+                groups[item->path.mid(0, item->path.size() - 1)].push_back(item);
+            }
+        }
+
+        std::vector<const KeyPath*> parents;
+        for (const auto& group : groups) {
+            const KeyPath& parent = group.first;
+            int separateSteps = 0;
+            for (const Item* item : group.second) {
+                separateSteps += stepsIn(*item, phase);
+            }
+            int parentSteps = parent.size() - derivationStart(parent, true, current, known);
+            int groupedSteps = parentSteps + static_cast<int>(group.second.size());
+            if (group.second.size() > 1 && groupedSteps < separateSteps) {
+                parents.push_back(&parent);
+            }
+        }
+
+        // Commands derived from the phase key first, then one block per parent
+        for (const Item* item : items) {
+            bool grouped = item->cmd->canDeriveFromCurrent() && item->path.size() > 1
+                && std::any_of(parents.begin(), parents.end(), [item](const KeyPath* parent) {
+                       return item->path.size() == parent->size() + 1 && isPrefix(*parent, item->path);
+                   });
+            if (!grouped) {
+                out.push_back(item->cmd);
+            }
+        }
+        for (const KeyPath* parent : parents) {
+            inserted.push_back(std::make_unique<DeriveKeyCommand>(formatPath(*parent)));
+            out.push_back(inserted.back().get());
+            for (const Item* item : groups[*parent]) {
+                out.push_back(item->cmd);
+            }
+        }
+    }
+}
+
+DerivationCost SessionPlanner::estimate(const CommandQueue& queue, const KeyPath& currentPath, bool currentPathKnown)
+{
+    std::vector<CardCommand*> sequence;
+    sequence.reserve(queue.size());
+    for (const auto& cmd : queue) {
+        sequence.push_back(cmd.get());
+    }
+    return estimateSequence(sequence, currentPath, currentPathKnown);
+}
+
+bool SessionPlanner::parsePath(const QString& path, KeyPath& out)
+{
+    DerivationSource source;
+    return parseSegments(path, out, source) && source == DerivationSource::Master;
+}
+
+QString SessionPlanner::formatPath(const KeyPath& path)
+{
+    QString result = "m";
+    for (uint32_t segment : path) {
+        result += "/" + QString::number(segment & ~BIP32_HARDENED_BIT);
+        if (segment & BIP32_HARDENED_BIT) {
+            result += "'";
+        }
+    }
+    return result;
+}
+
+SessionPlanner::KeyPath SessionPlanner::decodePath(const QByteArray& encoded)
+{
+    KeyPath path;
+    for (int i = 0; i + 4 <= encoded.size(); i += 4) {
+        path.append(qFromBigEndian<uint32_t>(encoded.constData() + i));
+    }
+    return path;
+}
+
+} // namespace Keycard
@@ -1,113 +1,54 @@
 #include "keycard-qt/tlv_utils.h"
+#include "keycard-core/tlv.h"
 #include <QDebug>
 
 namespace Keycard {
 namespace TLV {
 
+namespace {
+
+Core::ByteView view(const QByteArray& data) {
+    return Core::ByteView(data.constData(), static_cast<size_t>(data.size()));
+}
+
+} // namespace
+
 quint32 parseLength(const QByteArray& data, int& offset) {
-    if (offset >= data.size()) {
+    if (offset < 0 || offset >= data.size()) {
         return 0;
     }
-    
-    uint8_t firstByte = static_cast<uint8_t>(data[offset]);
-    offset++;
-    
-    if ((firstByte & 0x80) == 0) {
-        // Short form: length is in the lower 7 bits
-        return firstByte;
-    }
-    
-    // Long form: lower 7 bits indicate number of length bytes
-    int numLengthBytes = firstByte & 0x7F;
-    if (numLengthBytes > 4 || offset + numLengthBytes > data.size()) {
+
+    size_t position = static_cast<size_t>(offset);
+    uint32_t length = 0;
+    const bool ok = Core::Tlv::parseLength(view(data), position, length);
+    offset = static_cast<int>(position);
+    if (!ok) {
         qWarning() << "TLV::parseLength: Invalid length encoding";
         return 0;
     }
-    
-    quint32 length = 0;
-    for (int i = 0; i < numLengthBytes; i++) {
-        length = (length << 8) | static_cast<uint8_t>(data[offset]);
-        offset++;
-    }
-    
     return length;
 }
 
 QByteArray findTag(const QByteArray& data, uint8_t targetTag) {
-    int offset = 0;
-    
-    while (offset < data.size()) {
-        if (offset >= data.size()) {
-            break;
-        }
-        
-        uint8_t tag = static_cast<uint8_t>(data[offset]);
-        offset++;
-        
-        quint32 length = parseLength(data, offset);
-        if (length == 0 && offset >= data.size()) {
-            break;
-        }
-        
-        // Check if we have enough data
-        if (offset + static_cast<int>(length) > data.size()) {
-            qWarning() << "TLV::findTag: Length exceeds data size. Tag:"
-                      << QString("0x%1").arg(tag, 2, 16, QChar('0'))
-                      << "Length:" << length << "Remaining:" << (data.size() - offset);
-            break;
-        }
-        
-        // Found the target tag
-        if (tag == targetTag) {
-            return data.mid(offset, length);
-        }
-        
-        // Skip to next tag
-        offset += length;
+    const Core::ByteView all = view(data);
+    const Core::ByteView value = Core::Tlv::findTag(all, targetTag);
+    if (value.empty()) {
+        return QByteArray();
     }
-    
-    return QByteArray();
+    return data.mid(static_cast<int>(value.data() - all.data()), static_cast<int>(value.size()));
 }
 
 QByteArray encodeLength(quint32 length) {
-    QByteArray result;
-    
-    if (length < 128) {
-        // Short form (0-127)
-        result.append(static_cast<char>(length));
-    } else {
-        // Long form
-        // Determine number of bytes needed
-        int numBytes = 0;
-        quint32 temp = length;
-        while (temp > 0) {
-            numBytes++;
-            temp >>= 8;
-        }
-        
-        // First byte: 0x80 | numBytes
-        result.append(static_cast<char>(0x80 | numBytes));
-        
-        // Length bytes (big-endian)
-        for (int i = numBytes - 1; i >= 0; i--) {
-            result.append(static_cast<char>((length >> (i * 8)) & 0xFF));
-        }
-    }
-    
-    return result;
+    uint8_t encoded[5];
+    const size_t size = Core::Tlv::encodeLength(length, encoded);
+    return QByteArray(reinterpret_cast<const char*>(encoded), static_cast<int>(size));
 }
 
 QByteArray encode(uint8_t tag, const QByteArray& value) {
-    QByteArray result;
-    result.append(static_cast<char>(tag));
-    result.append(encodeLength(value.size()));
-    result.append(value);
-    return result;
+    Core::Bytes encoded;
+    Core::Tlv::append(encoded, tag, view(value));
+    return QByteArray(reinterpret_cast<const char*>(encoded.data()), static_cast<int>(encoded.size()));
 }
 
 } // namespace TLV
 } // namespace Keycard
-
-
-
-
@@ -0,0 +1,257 @@
+#include "keycard-qt/transport_timeout_policy.h"
+#include "keycard-qt/metrics.h"
+#include "keycard-qt/types.h"
+#include <QDataStream>
+#include <QDebug>
+#include <QFile>
+#include <QSaveFile>
+#include <algorithm>
+#include <cmath>
+
+namespace Keycard {
+
+// File format: magic, version, histogram count, then per histogram its key and
+// the non-empty buckets as (index, count) pairs
+static constexpr quint32 POLICY_FILE_MAGIC = 0x4B435454;  // "KCTT"
+static constexpr quint8 POLICY_FILE_VERSION = 1;
+
+static constexpr double BUCKET_GROWTH = 1.25;
+static constexpr int MAX_BACKOFF_SHIFT = 4;
+
+QHash<quint8, int> TransportTimeoutPolicy::defaultFloors()
+{
+    QHash<quint8, int> floors;
+    floors.insert(APDU::INS_INIT, 60000);
+    floors.insert(APDU::INS_LOAD_KEY, 60000);
+    floors.insert(APDU::INS_GENERATE_KEY, 30000);
+    floors.insert(APDU::INS_GENERATE_MNEMONIC, 10000);
+    floors.insert(APDU::INS_FACTORY_RESET, 30000);
+    return floors;
+}
+
+TransportTimeoutPolicy::TransportTimeoutPolicy(const QString& filePath)
+    : TransportTimeoutPolicy(Options(), filePath)
+{
+}
+
+TransportTimeoutPolicy::TransportTimeoutPolicy(const Options& options, const QString& filePath)
+    : m_filePath(filePath)
+    , m_options(options)
+{
+    if (!m_filePath.isEmpty()) {
+        load();
+    }
+}
+
+TransportTimeoutPolicy::~TransportTimeoutPolicy()
+{
+    save();
+}
+
+int TransportTimeoutPolicy::bucketOf(qint64 elapsedMs)
+{
+    int bucket = 0;
+    double bound = 1.0;
+    while (bucket < BUCKET_COUNT - 1 && elapsedMs > bound) {
+        bound *= BUCKET_GROWTH;
+        ++bucket;
+    }
+    return bucket;
+}
+
+int TransportTimeoutPolicy::bucketUpperBoundMs(int bucket)
+{
+    return static_cast<int>(std::ceil(std::pow(BUCKET_GROWTH, bucket)));
+}
+
+int TransportTimeoutPolicy::percentileMsLocked(const Histogram& histogram) const
+{
+    const double target = m_options.percentile * histogram.total;
+    quint32 seen = 0;
+    for (int bucket = 0; bucket < BUCKET_COUNT; ++bucket) {
+        seen += histogram.counts[bucket];
+        if (seen > 0 && seen >= target) {
+            return bucketUpperBoundMs(bucket);
+        }
+    }
+    return bucketUpperBoundMs(BUCKET_COUNT - 1);
+}
+
+int TransportTimeoutPolicy::timeoutFor(quint16 model, quint8 ins) const
+{
+    QMutexLocker locker(&m_mutex);
+
+    const int floor = std::max(m_options.minimumMs, m_options.floorsMs.value(ins, 0));
+    auto it = m_histograms.constFind(key(model, ins));
+
+    double timeoutMs = std::max(m_options.coldTimeoutMs, floor);
+    if (it != m_histograms.constEnd() && it->total >= m_options.minSamples) {
+        timeoutMs = std::max<double>(floor, percentileMsLocked(*it) * m_options.margin);
+    }
+    if (it != m_histograms.constEnd() && it->consecutiveTimeouts > 0) {
+        timeoutMs *= 1 << std::min(it->consecutiveTimeouts, MAX_BACKOFF_SHIFT);
+    }
+    return static_cast<int>(std::min<double>(timeoutMs, m_options.maximumMs));
+}
+
+void TransportTimeoutPolicy::record(quint16 model, quint8 ins, qint64 elapsedMs)
+{
+    QMutexLocker locker(&m_mutex);
+
+    Histogram& histogram = m_histograms[key(model, ins)];
+    histogram.consecutiveTimeouts = 0;
+    ++histogram.counts[bucketOf(elapsedMs)];
+    ++histogram.total;
+
+    if (histogram.total >= AGING_SAMPLES) {
+        // Halve, rounding up so rare slow exchanges are not forgotten
+        histogram.total = 0;
+        for (quint32& count : histogram.counts) {
+            count = (count + 1) / 2;
+            histogram.total += count;
+        }
+    }
+    m_dirty = true;
+}
+
+void TransportTimeoutPolicy::recordTimeout(quint16 model, quint8 ins)
+{
+    Metrics::increment(QStringLiteral("transport.timeouts"));
+
+    QMutexLocker locker(&m_mutex);
+    Histogram& histogram = m_histograms[key(model, ins)];
+    histogram.consecutiveTimeouts = std::min(histogram.consecutiveTimeouts + 1, MAX_BACKOFF_SHIFT);
+}
+
+quint32 TransportTimeoutPolicy::sampleCount(quint16 model, quint8 ins) const
+{
+    QMutexLocker locker(&m_mutex);
+    auto it = m_histograms.constFind(key(model, ins));
+    return it != m_histograms.constEnd() ? it->total : 0;
+}
+
+void TransportTimeoutPolicy::clear()
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        m_histograms.clear();
+        m_dirty = true;
+    }
+    save();
+}
+
+bool TransportTimeoutPolicy::save()
+{
+    if (m_filePath.isEmpty()) {
+        return true;
+    }
+
+    // One writer at a time, so an older snapshot never replaces a newer one
+    QMutexLocker saveLocker(&m_saveMutex);
+    QByteArray contents;
+    {
+        QMutexLocker locker(&m_mutex);
+        if (!m_dirty) {
+            return true;
+        }
+        contents = serializeLocked();
+        m_dirty = false;
+    }
+
+    QSaveFile file(m_filePath);
+    if (!file.open(QIODevice::WriteOnly) || file.write(contents) != contents.size() || !file.commit()) {
+        qWarning() << "TransportTimeoutPolicy: Failed to write" << m_filePath << ":" << file.errorString();
+        QMutexLocker locker(&m_mutex);
+        m_dirty = true;
+        return false;
+    }
+    return true;
+}
+
+TransportTimeoutPolicy::Options TransportTimeoutPolicy::options() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_options;
+}
+
+void TransportTimeoutPolicy::setOptions(const Options& options)
+{
+    QMutexLocker locker(&m_mutex);
+    m_options = options;
+}
+
+bool TransportTimeoutPolicy::load()
+{
+    QFile file(m_filePath);
+    if (!file.exists()) {
+        return true;
+    }
+    if (!file.open(QIODevice::ReadOnly)) {
+        qWarning() << "TransportTimeoutPolicy: Failed to open" << m_filePath << ":" << file.errorString();
+        return false;
+    }
+
+    QDataStream stream(&file);
+    stream.setByteOrder(QDataStream::BigEndian);
+
+    quint32 magic = 0;
+    quint8 version = 0;
+    quint32 count = 0;
+    stream >> magic >> version >> count;
+    if (magic != POLICY_FILE_MAGIC || version != POLICY_FILE_VERSION) {
+        qWarning() << "TransportTimeoutPolicy: Ignoring file with unknown format:" << m_filePath;
+        return false;
+    }
+
+    QHash<quint32, Histogram> histograms;
+    for (quint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i) {
+        quint32 histogramKey = 0;
+        quint8 buckets = 0;
+        stream >> histogramKey >> buckets;
+
+        Histogram histogram;
+        for (quint8 b = 0; b < buckets && stream.status() == QDataStream::Ok; ++b) {
+            quint8 bucket = 0;
+            quint32 bucketCount = 0;
+            stream >> bucket >> bucketCount;
+            if (bucket < BUCKET_COUNT) {
+                histogram.counts[bucket] = bucketCount;
+                histogram.total += bucketCount;
+            }
+        }
+        histograms.insert(histogramKey, histogram);
+    }
+
+    if (stream.status() != QDataStream::Ok) {
+        qWarning() << "TransportTimeoutPolicy: Truncated file, ignoring:" << m_filePath;
+        return false;
+    }
+
+    QMutexLocker locker(&m_mutex);
+    m_histograms = histograms;
+    qDebug() << "TransportTimeoutPolicy: Loaded" << m_histograms.size() << "histograms from" << m_filePath;
+    return true;
+}
+
+QByteArray TransportTimeoutPolicy::serializeLocked() const
+{
+    QByteArray contents;
+    QDataStream stream(&contents, QIODevice::WriteOnly);
+    stream.setByteOrder(QDataStream::BigEndian);
+    stream << POLICY_FILE_MAGIC << POLICY_FILE_VERSION << static_cast<quint32>(m_histograms.size());
+
+    for (auto it = m_histograms.constBegin(); it != m_histograms.constEnd(); ++it) {
+        const Histogram& histogram = it.value();
+        const quint8 buckets = static_cast<quint8>(
+            std::count_if(histogram.counts.begin(), histogram.counts.end(), [](quint32 c) { return c > 0; }));
+        stream << it.key() << buckets;
+        for (int bucket = 0; bucket < BUCKET_COUNT; ++bucket) {
+            if (histogram.counts[bucket] > 0) {
+                stream << static_cast<quint8>(bucket) << histogram.counts[bucket];
+            }
+        }
+    }
+    return contents;
+}
+
+} // namespace Keycard
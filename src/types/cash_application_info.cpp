@@ -0,0 +1,44 @@
+#include "keycard-qt/types.h"
+#include "keycard-qt/types_parser.h"
+#include "keycard-qt/tlv_utils.h"
+#include <QDebug>
+
+namespace Keycard {
+
+namespace {
+
+// TLV Tags
+constexpr uint8_t TAG_APPLICATION_INFO_TEMPLATE = 0xA4;
+constexpr uint8_t TAG_PUBLIC_KEY = 0x80;
+constexpr uint8_t TAG_VERSION = 0x02;
+constexpr uint8_t TAG_PUBLIC_DATA = 0x82;
+
+} // anonymous namespace
+
+CashApplicationInfo parseCashApplicationInfo(const QByteArray& data)
+{
+    CashApplicationInfo info;
+
+    if (data.isEmpty() || static_cast<uint8_t>(data[0]) != TAG_APPLICATION_INFO_TEMPLATE) {
+        qWarning() << "CashApplicationInfo: Missing template tag:" << data.left(1).toHex();
+        return info;
+    }
+
+    const QByteArray tmpl = TLV::findTag(data, TAG_APPLICATION_INFO_TEMPLATE);
+    info.publicKey = TLV::findTag(tmpl, TAG_PUBLIC_KEY);
+    info.publicData = TLV::findTag(tmpl, TAG_PUBLIC_DATA);
+
+    const QByteArray version = TLV::findTag(tmpl, TAG_VERSION);
+    if (version.size() >= 2) {
+        info.appVersion = static_cast<uint8_t>(version[0]);
+        info.appVersionMinor = static_cast<uint8_t>(version[1]);
+    }
+
+    // Without its key the applet cannot sign anything
+    info.installed = !info.publicKey.isEmpty();
+    qDebug() << "CashApplicationInfo: Public key:" << info.publicKey.toHex()
+             << "version:" << info.appVersion << "." << info.appVersionMinor;
+    return info;
+}
+
+} // namespace Keycard
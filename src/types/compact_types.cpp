@@ -0,0 +1,77 @@
+#include "keycard-qt/compact_types.h"
+#include <QDebug>
+
+namespace Keycard {
+
+CompactApplicationInfo CompactApplicationInfo::fromApplicationInfo(const ApplicationInfo& info)
+{
+    CompactApplicationInfo compact;
+    if (!compact.instanceUID.assign(info.instanceUID)
+        || !compact.secureChannelPublicKey.assign(info.secureChannelPublicKey)
+        || !compact.keyUID.assign(info.keyUID)) {
+        qWarning() << "CompactApplicationInfo: Field exceeds inline capacity, truncated";
+    }
+    compact.appVersion = info.appVersion;
+    compact.appVersionMinor = info.appVersionMinor;
+    compact.availableSlots = info.availableSlots;
+    compact.capabilities = info.capabilities;
+    compact.installed = info.installed;
+    compact.initialized = info.initialized;
+    return compact;
+}
+
+ApplicationInfo CompactApplicationInfo::toApplicationInfo() const
+{
+    ApplicationInfo info;
+    info.instanceUID = instanceUID.toByteArray();
+    info.secureChannelPublicKey = secureChannelPublicKey.toByteArray();
+    info.keyUID = keyUID.toByteArray();
+    info.appVersion = appVersion;
+    info.appVersionMinor = appVersionMinor;
+    info.availableSlots = availableSlots;
+    info.capabilities = capabilities;
+    info.installed = installed;
+    info.initialized = initialized;
+    return info;
+}
+
+CompactApplicationStatus CompactApplicationStatus::fromApplicationStatus(const ApplicationStatus& status)
+{
+    CompactApplicationStatus compact;
+    if (!compact.currentPath.assign(status.currentPath)) {
+        qWarning() << "CompactApplicationStatus: Current path deeper than 10 levels, truncated";
+    }
+    compact.pinRetryCount = status.pinRetryCount;
+    compact.pukRetryCount = status.pukRetryCount;
+    compact.keyInitialized = status.keyInitialized;
+    compact.valid = status.valid;
+    return compact;
+}
+
+ApplicationStatus CompactApplicationStatus::toApplicationStatus() const
+{
+    ApplicationStatus status;
+    status.currentPath = currentPath.toByteArray();
+    status.pinRetryCount = pinRetryCount;
+    status.pukRetryCount = pukRetryCount;
+    status.keyInitialized = keyInitialized;
+    status.valid = valid;
+    return status;
+}
+
+CompactPairingInfo CompactPairingInfo::fromPairingInfo(const PairingInfo& pairing)
+{
+    CompactPairingInfo compact;
+    if (!compact.key.assign(pairing.key)) {
+        qWarning() << "CompactPairingInfo: Pairing key longer than 32 bytes, truncated";
+    }
+    compact.index = pairing.index;
+    return compact;
+}
+
+PairingInfo CompactPairingInfo::toPairingInfo() const
+{
+    return PairingInfo(key.toByteArray(), index);
+}
+
+} // namespace Keycard
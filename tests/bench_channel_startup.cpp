@@ -0,0 +1,127 @@
+/**
+ * Startup benchmark for KeycardChannel backend construction
+ *
+ * Builds the default platform backend (PC/SC on desktop, talking to the real
+ * pcscd) with BackendStartup::Immediate and BackendStartup::Deferred and
+ * reports, per mode, the time the constructing (main) thread spends in
+ * KeycardChannel and the time until backendReady(). For Deferred the main
+ * thread time includes the event loop pass that creates the backend.
+ *
+ *   bench_channel_startup --runs 20
+ *
+ * Not registered with ctest: build with -DBUILD_BENCHMARKS=ON.
+ */
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QLoggingCategory>
+#include <QTimer>
+#include "keycard-qt/keycard_channel.h"
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+using namespace Keycard;
+
+namespace {
+
+struct Sample {
+    qint64 mainThreadNs = 0;
+    qint64 readyNs = -1;  // -1: backendReady() not seen within the timeout
+};
+
+Sample measure(KeycardChannel::BackendStartup startup, int timeoutMs) {
+    Sample sample;
+    QElapsedTimer clock;
+    clock.start();
+
+    auto channel = std::make_unique<KeycardChannel>(startup);
+    sample.mainThreadNs = clock.nsecsElapsed();
+
+    if (startup == KeycardChannel::BackendStartup::Deferred) {
+        // The queued creation: what the application's first event loop pass pays
+        QElapsedTimer pass;
+        pass.start();
+        QCoreApplication::sendPostedEvents(channel.get(), QEvent::MetaCall);
+        sample.mainThreadNs += pass.nsecsElapsed();
+    }
+
+    if (!channel->isBackendReady()) {
+        QEventLoop loop;
+        QObject::connect(channel.get(), &KeycardChannel::backendReady, &loop, &QEventLoop::quit);
+        QTimer::singleShot(timeoutMs, &loop, &QEventLoop::quit);
+        if (!channel->isBackendReady()) {
+            loop.exec();
+        }
+    }
+    if (channel->isBackendReady()) {
+        sample.readyNs = clock.nsecsElapsed();
+    }
+    return sample;
+}
+
+qint64 median(std::vector<qint64> values) {
+    if (values.empty()) {
+        return -1;
+    }
+    std::sort(values.begin(), values.end());
+    return values[values.size() / 2];
+}
+
+void report(const char* mode, const std::vector<Sample>& samples) {
+    std::vector<qint64> mainThread;
+    std::vector<qint64> ready;
+    for (const Sample& sample : samples) {
+        mainThread.push_back(sample.mainThreadNs);
+        if (sample.readyNs >= 0) {
+            ready.push_back(sample.readyNs);
+        }
+    }
+    const qint64 worstMain = *std::max_element(mainThread.begin(), mainThread.end());
+    std::printf("%-10s main thread median %9.1f us  max %9.1f us  ready median %9.1f us  (%zu/%zu ready)\n",
+                mode, median(mainThread) / 1000.0, worstMain / 1000.0, median(ready) / 1000.0,
+                ready.size(), samples.size());
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("KeycardChannel backend startup benchmark"));
+    parser.addHelpOption();
+    const QCommandLineOption runsOption(QStringLiteral("runs"),
+        QStringLiteral("Channels constructed per mode."), QStringLiteral("n"), QStringLiteral("20"));
+    const QCommandLineOption timeoutOption(QStringLiteral("timeout-ms"),
+        QStringLiteral("Wait for backendReady() per run."), QStringLiteral("ms"), QStringLiteral("5000"));
+    parser.addOptions({runsOption, timeoutOption});
+    parser.process(app);
+
+    bool runsOk = false;
+    bool timeoutOk = false;
+    const int runs = parser.value(runsOption).toInt(&runsOk);
+    const int timeoutMs = parser.value(timeoutOption).toInt(&timeoutOk);
+    if (!runsOk || !timeoutOk || runs < 1 || timeoutMs < 0) {
+        std::fprintf(stderr, "Invalid numeric option\n");
+        return 2;
+    }
+
+    // Backend startup logging would be part of what is measured
+    QLoggingCategory::setFilterRules(QStringLiteral("*.debug=false"));
+
+    std::vector<Sample> immediate;
+    std::vector<Sample> deferred;
+    // Alternate the modes so pcscd warm-up does not favour either
+    for (int run = 0; run < runs; ++run) {
+        immediate.push_back(measure(KeycardChannel::BackendStartup::Immediate, timeoutMs));
+        deferred.push_back(measure(KeycardChannel::BackendStartup::Deferred, timeoutMs));
+    }
+
+    report("Immediate", immediate);
+    report("Deferred", deferred);
+    return 0;
+}
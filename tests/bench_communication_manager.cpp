@@ -0,0 +1,412 @@
+/**
+ * Soak and throughput benchmark for CommunicationManager
+ *
+ * Submitter threads drive one manager with a mix of executeCommandSync(),
+ * enqueueCommand() and batch operations against a MockBackend whose transmit
+ * latency is configurable. With --latency-us 0 the figures are the ceiling of
+ * the queue machinery itself, separate from card time.
+ *
+ * For each thread count it reports commands per second, queue wait (enqueue
+ * to execute) p50/p99, the process memory high-water mark and PendingSync
+ * entries left behind. The exit code is non-zero when a command is lost,
+ * fails or leaks its PendingSync entry.
+ *
+ *   bench_communication_manager --threads 1,8,64 --commands 2000000 --latency-us 50
+ *
+ * Not registered with ctest: build with -DBUILD_BENCHMARKS=ON.
+ */
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QLoggingCategory>
+#include <QSemaphore>
+#include <QTimer>
+#include "keycard-qt/communication_manager.h"
+#include "keycard-qt/command_set.h"
+#include "keycard-qt/keycard_channel.h"
+#include "mocks/mock_backend.h"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+
+#ifdef Q_OS_UNIX
+#include <sys/resource.h>
+#endif
+
+using namespace Keycard;
+using namespace Keycard::Test;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Proprietary INS the mock answers after the simulated latency; every other
+// APDU (the SELECT of card initialization) gets an instant answer
+const QByteArray BENCH_APDU = QByteArray::fromHex("80EE0000");
+
+struct Options {
+    std::vector<int> threads;
+    quint64 commands = 1000000;
+    int latencyUs = 0;
+    int syncWeight = 1;
+    int asyncWeight = 1;
+    int batchWeight = 1;
+    int batchSize = 16;
+    int window = 64;        // Async commands in flight per submitter
+    int timeoutMs = 30000;
+};
+
+/**
+ * Log-linear histogram of nanoseconds: 8 buckets per power of two, so a
+ * percentile is within 12.5% of the recorded value
+ */
+class WaitHistogram {
+public:
+    void record(quint64 ns) {
+        ++m_buckets[bucketOf(ns)];
+        ++m_count;
+    }
+
+    quint64 percentile(double p) const {
+        if (m_count == 0) {
+            return 0;
+        }
+        const quint64 target = static_cast<quint64>(p * static_cast<double>(m_count - 1)) + 1;
+        quint64 seen = 0;
+        for (size_t i = 0; i < m_buckets.size(); ++i) {
+            seen += m_buckets[i];
+            if (seen >= target) {
+                return lowerBound(static_cast<int>(i));
+            }
+        }
+        return lowerBound(static_cast<int>(m_buckets.size()) - 1);
+    }
+
+private:
+    static int bucketOf(quint64 v) {
+        if (v < 16) {
+            return static_cast<int>(v);
+        }
+        int msb = 4;
+        while (msb < 63 && (v >> (msb + 1))) {
+            ++msb;
+        }
+        return 16 + (msb - 4) * 8 + static_cast<int>((v >> (msb - 3)) & 7);
+    }
+
+    static quint64 lowerBound(int bucket) {
+        if (bucket < 16) {
+            return static_cast<quint64>(bucket);
+        }
+        const int msb = (bucket - 16) / 8 + 4;
+        const int sub = (bucket - 16) % 8;
+        return static_cast<quint64>(8 + sub) << (msb - 3);
+    }
+
+    std::array<quint64, 16 + 60 * 8> m_buckets{};
+    quint64 m_count = 0;
+};
+
+struct RunState {
+    WaitHistogram waits;                    // Written by the communication thread only
+    std::atomic<quint64> issued{0};
+    std::atomic<quint64> completed{0};      // commandCompleted emissions
+    std::atomic<quint64> failed{0};
+};
+
+/**
+ * Records its queue wait and performs one round trip to the mock card
+ *
+ * An async command releases its submitter's window slot when destroyed,
+ * which CommunicationManager does right after emitting commandCompleted.
+ */
+class BenchCommand : public CardCommand {
+public:
+    BenchCommand(RunState* state, QSemaphore* inFlight)
+        : m_state(state), m_inFlight(inFlight), m_created(Clock::now()) {}
+
+    ~BenchCommand() override {
+        if (m_inFlight) {
+            m_inFlight->release();
+        }
+    }
+
+    CommandResult execute(CommandSet* cmdSet) override {
+        const auto wait = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - m_created);
+        m_state->waits.record(static_cast<quint64>(wait.count()));
+        cmdSet->channel()->transmit(BENCH_APDU);
+        return CommandResult::fromSuccess();
+    }
+
+    QString name() const override { return QStringLiteral("BENCH"); }
+
+private:
+    RunState* m_state;
+    QSemaphore* m_inFlight;
+    Clock::time_point m_created;
+};
+
+long peakRssKb() {
+#if defined(Q_OS_UNIX)
+    struct rusage usage {};
+    getrusage(RUSAGE_SELF, &usage);
+#if defined(Q_OS_MACOS)
+    return static_cast<long>(usage.ru_maxrss / 1024);  // Bytes on macOS
+#else
+    return static_cast<long>(usage.ru_maxrss);
+#endif
+#else
+    return -1;
+#endif
+}
+
+void submit(CommunicationManager* manager, RunState* state, const Options& options, int index, quint64 quota) {
+    std::minstd_rand rng(static_cast<unsigned>(index) + 1);
+    std::uniform_int_distribution<int> pick(0, options.syncWeight + options.asyncWeight + options.batchWeight - 1);
+    QSemaphore inFlight(options.window);
+
+    auto enqueue = [&]() {
+        inFlight.acquire();
+        if (manager->enqueueCommand(std::make_unique<BenchCommand>(state, &inFlight)).isNull()) {
+            state->failed.fetch_add(1, std::memory_order_relaxed);
+        }
+    };
+
+    quint64 issued = 0;
+    while (issued < quota) {
+        const int choice = pick(rng);
+        if (choice < options.syncWeight) {
+            const CommandResult result = manager->executeCommandSync(
+                std::make_unique<BenchCommand>(state, nullptr), options.timeoutMs);
+            if (!result.success) {
+                state->failed.fetch_add(1, std::memory_order_relaxed);
+            }
+            issued += 1;
+        } else if (choice < options.syncWeight + options.asyncWeight) {
+            enqueue();
+            issued += 1;
+        } else {
+            // Batch: keep the channel open, queue a run of commands and wait for them
+            manager->startBatchOperations();
+            for (int i = 0; i < options.batchSize; ++i) {
+                enqueue();
+            }
+            inFlight.acquire(options.window);
+            inFlight.release(options.window);
+            manager->endBatchOperations();
+            issued += static_cast<quint64>(options.batchSize);
+        }
+    }
+
+    // Drain the async commands still in flight
+    inFlight.acquire(options.window);
+    state->issued.fetch_add(issued, std::memory_order_relaxed);
+}
+
+bool runOnce(CommunicationManager* manager, int threads, const Options& options) {
+    RunState state;
+    const QMetaObject::Connection connection = QObject::connect(
+        manager, &CommunicationManager::commandCompleted, manager,
+        [&state](QUuid, CommandResult result) {
+            state.completed.fetch_add(1, std::memory_order_relaxed);
+            if (!result.success) {
+                state.failed.fetch_add(1, std::memory_order_relaxed);
+            }
+        },
+        Qt::DirectConnection);
+
+    const quint64 quota = (options.commands + static_cast<quint64>(threads) - 1) / static_cast<quint64>(threads);
+    const Clock::time_point start = Clock::now();
+
+    std::vector<std::thread> submitters;
+    submitters.reserve(static_cast<size_t>(threads));
+    for (int i = 0; i < threads; ++i) {
+        submitters.emplace_back(submit, manager, &state, std::cref(options), i, quota);
+    }
+    for (std::thread& submitter : submitters) {
+        submitter.join();
+    }
+
+    const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    QObject::disconnect(connection);
+
+    const quint64 issued = state.issued.load();
+    const quint64 completed = state.completed.load();
+    const quint64 lost = completed < issued ? issued - completed : 0;
+    const int pendingSync = manager->testPendingSyncCount();
+
+    std::printf("%7d %10llu %8.2f %10.0f %12.1f %12.1f %12ld %6llu %6llu %8d\n",
+                threads,
+                static_cast<unsigned long long>(issued),
+                seconds,
+                static_cast<double>(issued) / seconds,
+                static_cast<double>(state.waits.percentile(0.50)) / 1000.0,
+                static_cast<double>(state.waits.percentile(0.99)) / 1000.0,
+                peakRssKb(),
+                static_cast<unsigned long long>(state.failed.load()),
+                static_cast<unsigned long long>(lost),
+                pendingSync);
+    std::fflush(stdout);
+
+    return state.failed.load() == 0 && lost == 0 && pendingSync == 0;
+}
+
+int runAll(CommunicationManager* manager, const Options& options) {
+    std::printf("latency %d us, mix sync:async:batch %d:%d:%d, batch %d, window %d\n",
+                options.latencyUs, options.syncWeight, options.asyncWeight, options.batchWeight,
+                options.batchSize, options.window);
+    std::printf("%7s %10s %8s %10s %12s %12s %12s %6s %6s %8s\n",
+                "threads", "commands", "seconds", "cmd/s", "wait_p50_us", "wait_p99_us",
+                "peak_rss_kb", "failed", "lost", "pending");
+
+    bool ok = true;
+    for (int threads : options.threads) {
+        ok = runOnce(manager, threads, options) && ok;
+    }
+    return ok ? 0 : 1;
+}
+
+bool parseOptions(const QCoreApplication& app, Options& options) {
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("CommunicationManager soak and throughput benchmark"));
+    parser.addHelpOption();
+    const QCommandLineOption threadsOption(QStringLiteral("threads"),
+        QStringLiteral("Comma-separated submitter thread counts, 1-64."), QStringLiteral("list"),
+        QStringLiteral("1,2,4,8,16,32,64"));
+    const QCommandLineOption commandsOption(QStringLiteral("commands"),
+        QStringLiteral("Commands per run."), QStringLiteral("n"), QStringLiteral("1000000"));
+    const QCommandLineOption latencyOption(QStringLiteral("latency-us"),
+        QStringLiteral("Simulated card latency per APDU."), QStringLiteral("us"), QStringLiteral("0"));
+    const QCommandLineOption mixOption(QStringLiteral("mix"),
+        QStringLiteral("Weights of sync:async:batch operations."), QStringLiteral("s:a:b"), QStringLiteral("1:1:1"));
+    const QCommandLineOption batchOption(QStringLiteral("batch-size"),
+        QStringLiteral("Commands per batch operation."), QStringLiteral("n"), QStringLiteral("16"));
+    const QCommandLineOption windowOption(QStringLiteral("window"),
+        QStringLiteral("Async commands in flight per submitter."), QStringLiteral("n"), QStringLiteral("64"));
+    parser.addOptions({threadsOption, commandsOption, latencyOption, mixOption, batchOption, windowOption});
+    parser.process(app);
+
+    bool ok = true;
+    for (const QString& value : parser.value(threadsOption).split(QLatin1Char(','), Qt::SkipEmptyParts)) {
+        const int threads = value.toInt(&ok);
+        if (!ok || threads < 1 || threads > 64) {
+            std::fprintf(stderr, "Invalid thread count: %s\n", qPrintable(value));
+            return false;
+        }
+        options.threads.push_back(threads);
+    }
+
+    const QStringList mix = parser.value(mixOption).split(QLatin1Char(':'));
+    if (mix.size() != 3) {
+        std::fprintf(stderr, "Invalid mix: expected sync:async:batch\n");
+        return false;
+    }
+    bool mixOk[3];
+    options.syncWeight = mix[0].toInt(&mixOk[0]);
+    options.asyncWeight = mix[1].toInt(&mixOk[1]);
+    options.batchWeight = mix[2].toInt(&mixOk[2]);
+
+    bool numbersOk[4];
+    options.commands = parser.value(commandsOption).toULongLong(&numbersOk[0]);
+    options.latencyUs = parser.value(latencyOption).toInt(&numbersOk[1]);
+    options.batchSize = parser.value(batchOption).toInt(&numbersOk[2]);
+    options.window = parser.value(windowOption).toInt(&numbersOk[3]);
+
+    if (!mixOk[0] || !mixOk[1] || !mixOk[2] || options.syncWeight < 0 || options.asyncWeight < 0
+        || options.batchWeight < 0 || options.syncWeight + options.asyncWeight + options.batchWeight == 0) {
+        std::fprintf(stderr, "Invalid mix weights\n");
+        return false;
+    }
+    if (!numbersOk[0] || !numbersOk[1] || !numbersOk[2] || !numbersOk[3] || options.commands == 0
+        || options.latencyUs < 0 || options.batchSize < 1 || options.window < options.batchSize) {
+        std::fprintf(stderr, "Invalid numeric option (window must be at least batch-size)\n");
+        return false;
+    }
+    return !options.threads.empty();
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    QCoreApplication app(argc, argv);
+
+    Options options;
+    if (!parseOptions(app, options)) {
+        return 2;
+    }
+
+    // Per-command debug output would be all the benchmark measures
+    QLoggingCategory::setFilterRules(QStringLiteral("*.debug=false"));
+
+    const QByteArray selectResponse = QByteArray::fromHex("8041")
+        + QByteArray::fromHex(
+              "0479BE667EF9DCBBAC55A06295CE870B07029BFCDB2DCE28D959F2815B16F81798"
+              "483ADA7726A3C4655DA4FBFC0E1108A8FD17B448A68554199C47D08FFB10D4B8")
+        + QByteArray::fromHex("9000");
+    const int latencyUs = options.latencyUs;
+
+    auto* mock = new MockBackend();
+    mock->setAutoConnect(false);
+    mock->setRecordTransmits(false);
+    mock->setResponseHandler([selectResponse, latencyUs](const QByteArray& apdu) {
+        if (apdu != BENCH_APDU) {
+            return selectResponse;
+        }
+        if (latencyUs > 0) {
+            std::this_thread::sleep_for(std::chrono::microseconds(latencyUs));
+        }
+        return QByteArray::fromHex("9000");
+    });
+
+    auto cmdSet = std::make_shared<CommandSet>(std::make_shared<KeycardChannel>(mock), nullptr, nullptr);
+    CommunicationManager manager;
+    if (!manager.init(cmdSet)) {
+        std::fprintf(stderr, "CommunicationManager::init() failed\n");
+        return 1;
+    }
+
+    int exitCode = 0;
+    std::thread driver;
+
+    // Runs are driven from a plain thread; the main thread keeps serving the
+    // CommandSet's queued detection calls
+    QObject::connect(&manager, &CommunicationManager::cardInitialized, &app,
+                     [&](const CardInitializationResult& result) {
+        if (driver.joinable()) {
+            return;
+        }
+        if (!result.success) {
+            std::fprintf(stderr, "Card initialization failed: %s\n", qPrintable(result.error));
+            app.exit(1);
+            return;
+        }
+        driver = std::thread([&]() {
+            exitCode = runAll(&manager, options);
+            QMetaObject::invokeMethod(&app, &QCoreApplication::quit, Qt::QueuedConnection);
+        });
+    }, Qt::QueuedConnection);
+
+    QTimer::singleShot(0, &app, [&]() {
+        manager.startDetection();
+        mock->simulateCardInserted();
+    });
+    QTimer::singleShot(5000, &app, [&]() {
+        if (!driver.joinable()) {
+            std::fprintf(stderr, "Timed out waiting for card initialization\n");
+            app.exit(1);
+        }
+    });
+
+    int appResult = app.exec();
+    if (driver.joinable()) {
+        driver.join();
+        appResult = exitCode;
+    }
+    manager.stop();
+    return appResult;
+}
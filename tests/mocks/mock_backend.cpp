@@ -114,12 +114,22 @@ bool MockBackend::isConnected() const
     return m_connected;
 }
 
+bool MockBackend::setTransmitTimeout(int timeoutMs)
+{
+    m_transmitTimeout.store(timeoutMs);
+    return m_enforceTimeout;
+}
+
 QByteArray MockBackend::transmit(const QByteArray& apdu)
 {
     // Thread-safe lock if enabled
     QMutexLocker locker(m_threadSafe ? &m_mutex : nullptr);
 
     // Simulate transmit delay for testing timeouts
+    if (m_enforceTimeout && m_transmitTimeout.load() > 0 && m_transmitDelay > m_transmitTimeout.load()) {
+        QThread::msleep(m_transmitTimeout.load());
+        throw std::runtime_error("Transmit failed: timeout");
+    }
     if (m_transmitDelay > 0) {
         QThread::msleep(m_transmitDelay);
     }
@@ -142,14 +152,21 @@ QByteArray MockBackend::transmit(const QByteArray& apdu)
     }
 
     // Track transmitted APDU
-    m_transmittedApdus.append(apdu);
+    if (m_recordTransmits) {
+        m_transmittedApdus.append(apdu);
+    }
 
     // Get response from queue or use default
     QByteArray response;
     if (!m_responseQueue.isEmpty()) {
         response = m_responseQueue.dequeue();
     } else {
-        response = m_defaultResponse;
+        if (m_responseHandler) {
+            response = m_responseHandler(apdu);
+        }
+        if (response.isEmpty()) {
+            response = m_defaultResponse;
+        }
     }
 
     if (m_logApdu) {
@@ -213,6 +230,14 @@ void MockBackend::setNextTransmitThrows(const QString& errorMessage)
     m_nextThrowMessage = errorMessage;
 }
 
+void MockBackend::setReady(bool startupDone)
+{
+    if (!m_ready.exchange(startupDone) && startupDone) {
+        qDebug() << "[MockBackend] Startup complete";
+        emit ready();
+    }
+}
+
 void MockBackend::setState(ChannelState state)
 {
     m_state = state;
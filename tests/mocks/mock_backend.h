@@ -8,6 +8,8 @@
 #include <QTimer>
 #include <QQueue>
 #include <QMutex>
+#include <atomic>
+#include <functional>
 
 namespace Keycard {
 namespace Test {
@@ -47,10 +49,12 @@ public:
     void disconnect() override;
     bool isConnected() const override;
     QByteArray transmit(const QByteArray& apdu) override;
+    bool setTransmitTimeout(int timeoutMs) override;
     QString backendName() const override { return "Mock Backend"; }
     void setState(ChannelState state) override;
     ChannelState state() const override { return m_state; }
     void forceScan() override;
+    bool isReady() const override { return m_ready.load(); }
 
     // ========================================================================
     // Configuration Methods
@@ -88,12 +92,32 @@ public:
      */
     void setDefaultResponse(const QByteArray& response);
 
+    /**
+     * @brief Compute responses from the transmitted APDU
+     * @param handler Called when the queue is empty; an empty return value
+     *                falls back to the default response
+     *
+     * Lets tests answer commands whose expected response depends on data
+     * sent by the host (e.g. the PAIR cryptogram over a random challenge).
+     */
+    void setResponseHandler(std::function<QByteArray(const QByteArray& apdu)> handler) {
+        m_responseHandler = std::move(handler);
+    }
+
     /**
      * @brief Enable/disable logging of transmitted APDUs
      * @param log If true, logs all APDUs via qDebug()
      */
     void setLogApdu(bool log) { m_logApdu = log; }
 
+    /**
+     * @brief Enable/disable recording of transmitted APDUs
+     * @param record If false, getTransmittedApdus() stays empty
+     *
+     * Soak runs send millions of APDUs; recording them would dominate memory.
+     */
+    void setRecordTransmits(bool record) { m_recordTransmits = record; }
+
     // ========================================================================
     // Simulation Control
     // ========================================================================
@@ -126,6 +150,12 @@ public:
      */
     void setNextTransmitThrows(const QString& errorMessage);
 
+    /**
+     * @brief Simulate a backend still doing its startup (isReady() false)
+     * @param startupDone true emits ready() if the backend was not ready
+     */
+    void setReady(bool startupDone);
+
     // ========================================================================
     // Inspection Methods (for test assertions)
     // ========================================================================
@@ -178,6 +208,18 @@ public:
      */
     void setTransmitDelay(int delayMs) { m_transmitDelay = delayMs; }
 
+    /**
+     * @brief Enforce the timeout set by KeycardChannel, like the Qt NFC backend
+     * @param enforce If true, a transmit delay longer than the timeout ends
+     *                in a "Transmit failed: timeout" exception at the timeout
+     */
+    void setEnforceTransmitTimeout(bool enforce) { m_enforceTimeout = enforce; }
+
+    /**
+     * @brief Last timeout set by KeycardChannel (0 if none)
+     */
+    int getTransmitTimeout() const { return m_transmitTimeout.load(); }
+
     /**
      * @brief Get current transmit delay
      */
@@ -226,6 +268,7 @@ private:
     // Response queue
     QQueue<QByteArray> m_responseQueue;
     QByteArray m_defaultResponse;
+    std::function<QByteArray(const QByteArray&)> m_responseHandler;
 
     // Tracking
     QList<QByteArray> m_transmittedApdus;
@@ -238,8 +281,12 @@ private:
 
     // Threading enhancements
     int m_transmitDelay = 0;
+    bool m_enforceTimeout = false;
+    std::atomic_int m_transmitTimeout{0};
     int m_insertionDelay = 0;
     bool m_threadSafe = false;
+    bool m_recordTransmits = true;
+    std::atomic_bool m_ready{true};
     mutable QMutex m_mutex;
 
     // Statistics
@@ -0,0 +1,257 @@
+/**
+ * Tests for host-side BIP32 derivation and AccountDiscovery
+ *
+ * Account keys are m/44'/60'/n' of the mnemonic
+ * "abandon abandon ... about" (no passphrase).
+ */
+
+#include <QTest>
+#include <QSet>
+#include <QSignalSpy>
+#include <QMutex>
+#include "keycard-qt/account_discovery.h"
+#include "keycard-qt/card_command.h"
+#include "keycard-qt/command_set.h"
+#include "keycard-qt/keycard_channel.h"
+#include "keycard-qt/tlv_utils.h"
+#include "mocks/mock_backend.h"
+#include <atomic>
+#include <memory>
+
+using namespace Keycard;
+using namespace Keycard::Test;
+
+namespace {
+
+// Local stand-in for an indexer
+class SetOracle : public AddressUsageOracle {
+public:
+    explicit SetOracle(const QSet<QString>& used) : m_used(used) {}
+
+    QVector<bool> isUsed(const QStringList& addresses) override {
+        calls++;
+        if (fail) {
+            return QVector<bool>();
+        }
+        QVector<bool> flags;
+        for (const QString& address : addresses) {
+            flags.append(m_used.contains(address));
+        }
+        return flags;
+    }
+
+    std::atomic<int> calls{0};
+    std::atomic<bool> fail{false};
+
+private:
+    QSet<QString> m_used;
+};
+
+BIP32::ExtendedPublicKey accountKey(int account) {
+    BIP32::ExtendedPublicKey key;
+    if (account == 0) {
+        key.publicKey = QByteArray::fromHex(
+            "04eae4b876a8696134b868f88cc2f51f715f2dbedb7446b8e6edf3d4541c4eb67b"
+            "61ed8eb62af1d433cd11b4f59923ac1f87f328c5673396ee55acc6195d92b320");
+        key.chainCode = QByteArray::fromHex("d882718b7a42806803eeb17f7483f20620611adb88fc943c898dc5aba94c2819");
+    } else {
+        key.publicKey = QByteArray::fromHex(
+            "044a5c12f50d63206e2827317c57d01eb4176896931d53ea2a33ef65a4323048ea"
+            "621329da92e324bf67e4c85e85ddb15d456b34836e73a223fe9ba0791a9bb4c2");
+        key.chainCode = QByteArray::fromHex("10b33a7331205d4a61fa270f97d00bb3009eabc598bdad20601652fbb8096856");
+    }
+    return key;
+}
+
+const QString ACCOUNT0_RECEIVE0 = "0x9858effd232b4033e47d90003d41ec34ecaeda94";
+const QString ACCOUNT0_RECEIVE2 = "0xb6716976a3ebe8d39aceb04372f22ff8e6802d7a";
+const QString ACCOUNT0_CHANGE1 = "0x26db4d065800bd118928848e69a1cbf956cff1d0";
+const QString ACCOUNT1_RECEIVE1 = "0x61c1a3dd47433e58033cc812e520c0ffd9007198";
+
+} // namespace
+
+class TestAccountDiscovery : public QObject {
+    Q_OBJECT
+
+private:
+    static DiscoveryResult runDiscovery(AccountDiscovery& discovery, const QVector<BIP32::ExtendedPublicKey>& keys) {
+        QSignalSpy spy(&discovery, &AccountDiscovery::finished);
+        if (!discovery.discover(keys) || !spy.wait(5000)) {
+            return DiscoveryResult();
+        }
+        return spy.takeFirst().at(0).value<DiscoveryResult>();
+    }
+
+private slots:
+    void init() {
+        if (!BIP32::isAvailable()) {
+            QSKIP("Built without OpenSSL");
+        }
+    }
+
+    void testDeriveChildMatchesReference() {
+        BIP32::ExtendedPublicKey receive = BIP32::deriveChild(accountKey(0), 0);
+        QVERIFY(receive.isValid());
+
+        BIP32::ExtendedPublicKey first = BIP32::deriveChild(receive, 0);
+        QCOMPARE(first.publicKey.toHex(), QByteArray(
+            "0437b0bb7a8288d38ed49a524b5dc98cff3eb5ca824c9f9dc0dfdb3d9cd600f299"
+            "a6179912b7451c09896c4098eca7ce6b2e58330672795e847c4d6af44e024230"));
+        QCOMPARE(BIP32::ethereumAddress(first.publicKey), ACCOUNT0_RECEIVE0);
+        QCOMPARE(BIP32::ethereumAddress(BIP32::deriveChild(receive, 2).publicKey), ACCOUNT0_RECEIVE2);
+    }
+
+    void testDeriveChildRejectsHardenedAndInvalid() {
+        QVERIFY(!BIP32::deriveChild(accountKey(0), BIP32::HARDENED).isValid());
+        QVERIFY(!BIP32::deriveChild(BIP32::ExtendedPublicKey(), 0).isValid());
+        QVERIFY(BIP32::ethereumAddress(QByteArray(33, 0x02)).isEmpty());
+    }
+
+    void testCompressPublicKey() {
+        QByteArray compressed = BIP32::compressPublicKey(accountKey(0).publicKey);
+        QCOMPARE(compressed.size(), 33);
+        QCOMPARE(static_cast<uint8_t>(compressed[0]), uint8_t(0x02));  // Y ends in 0x20 (even)
+        QCOMPARE(compressed.mid(1), accountKey(0).publicKey.mid(1, 32));
+    }
+
+    void testFromExportedKey() {
+        const BIP32::ExtendedPublicKey key = accountKey(0);
+        QByteArray keyData = TLV::encode(0xA1, TLV::encode(0x80, key.publicKey) + TLV::encode(0x82, key.chainCode));
+
+        BIP32::ExtendedPublicKey parsed = BIP32::fromExportedKey(keyData);
+        QCOMPARE(parsed.publicKey, key.publicKey);
+        QCOMPARE(parsed.chainCode, key.chainCode);
+
+        // Public key only (P2ExportKeyPublicOnly) is not enough
+        QVERIFY(!BIP32::fromExportedKey(TLV::encode(0xA1, TLV::encode(0x80, key.publicKey))).isValid());
+    }
+
+    void testGapLimitDiscovery() {
+        auto oracle = std::make_shared<SetOracle>(QSet<QString>{ ACCOUNT0_RECEIVE0, ACCOUNT0_RECEIVE2, ACCOUNT0_CHANGE1 });
+        AccountDiscovery::Options options;
+        options.gapLimit = 5;
+        AccountDiscovery discovery(oracle, options);
+
+        QStringList order;
+        connect(&discovery, &AccountDiscovery::addressFound, this,
+                [&order](const DiscoveredAddress& address) { order << address.address; });
+        connect(&discovery, &AccountDiscovery::finished, this,
+                [&order](const DiscoveryResult&) { order << "finished"; });
+
+        DiscoveryResult result = runDiscovery(discovery, { accountKey(0) });
+        QVERIFY2(result.success, qPrintable(result.error));
+
+        QCOMPARE(result.used.size(), 3);
+        QCOMPARE(result.used[0].path, QString("m/44'/60'/0'/0/0"));
+        QCOMPARE(result.used[1].path, QString("m/44'/60'/0'/0/2"));
+        QCOMPARE(result.used[1].address, ACCOUNT0_RECEIVE2);
+        QCOMPARE(result.used[2].path, QString("m/44'/60'/0'/1/1"));
+        QCOMPARE(result.used[2].change, 1);
+
+        // Each chain stops after two batches of 5: index 9 is 7 (receive) / 8 (change) past the last use
+        QCOMPARE(result.addressesChecked, 20);
+        QVERIFY(result.moreAccounts);  // The only scanned account is used
+
+        // Used addresses are delivered before the run completes
+        QCOMPARE(order.size(), 4);
+        QCOMPARE(order.last(), QString("finished"));
+    }
+
+    void testAccountsScannedInParallel() {
+        auto oracle = std::make_shared<SetOracle>(QSet<QString>{ ACCOUNT0_RECEIVE0, ACCOUNT1_RECEIVE1 });
+        AccountDiscovery::Options options;
+        options.accounts = 2;
+        options.gapLimit = 3;
+        options.scanChange = false;
+        AccountDiscovery discovery(oracle, options);
+        QCOMPARE(discovery.accountPaths(), QStringList({ "m/44'/60'/0'", "m/44'/60'/1'" }));
+
+        QSignalSpy chains(&discovery, &AccountDiscovery::chainFinished);
+        DiscoveryResult result = runDiscovery(discovery, { accountKey(0), accountKey(1) });
+        QVERIFY2(result.success, qPrintable(result.error));
+
+        QCOMPARE(chains.count(), 2);
+        QCOMPARE(result.accountsScanned, 2);
+        QCOMPARE(result.usedAccounts(), 2);
+        QCOMPARE(result.used.size(), 2);
+        QCOMPARE(result.used[1].path, QString("m/44'/60'/1'/0/1"));
+    }
+
+    void testUnusedWalletStopsAtGapLimit() {
+        auto oracle = std::make_shared<SetOracle>(QSet<QString>());
+        AccountDiscovery::Options options;
+        options.gapLimit = 20;
+        AccountDiscovery discovery(oracle, options);
+
+        DiscoveryResult result = runDiscovery(discovery, { accountKey(0) });
+        QVERIFY(result.success);
+        QVERIFY(result.used.isEmpty());
+        QVERIFY(!result.moreAccounts);
+        QCOMPARE(result.addressesChecked, 40);
+        QCOMPARE(oracle->calls.load(), 2);  // One batch per chain
+    }
+
+    void testOracleFailure() {
+        auto oracle = std::make_shared<SetOracle>(QSet<QString>());
+        oracle->fail = true;
+        AccountDiscovery discovery(oracle);
+
+        DiscoveryResult result = runDiscovery(discovery, { accountKey(0) });
+        QVERIFY(!result.success);
+        QVERIFY(result.error.contains("lookup failed"));
+        QVERIFY(!discovery.isRunning());
+    }
+
+    void testRejectsInvalidKeysAndConcurrentRuns() {
+        AccountDiscovery discovery(std::make_shared<SetOracle>(QSet<QString>()));
+        QVERIFY(!discovery.discover({}));
+        QVERIFY(!discovery.discover({ BIP32::ExtendedPublicKey() }));
+
+        QSignalSpy spy(&discovery, &AccountDiscovery::finished);
+        QVERIFY(discovery.discover({ accountKey(0) }));
+        QVERIFY(!discovery.discover({ accountKey(0) }));
+        QVERIFY(spy.wait(5000));
+    }
+
+    void testCancel() {
+        AccountDiscovery discovery(std::make_shared<SetOracle>(QSet<QString>()));
+        QSignalSpy spy(&discovery, &AccountDiscovery::finished);
+
+        QVERIFY(discovery.discover({ accountKey(0) }));
+        discovery.cancel();
+
+        QCOMPARE(spy.count(), 1);
+        QCOMPARE(spy.at(0).at(0).value<DiscoveryResult>().error, QString("Discovery cancelled"));
+        QVERIFY(!discovery.isRunning());
+
+        // Results still queued by the workers are dropped
+        discovery.waitForWorkers();
+        QTest::qWait(50);
+        QCOMPARE(spy.count(), 1);
+    }
+
+    void testExportCommandUsesExtendedPublicExport() {
+        auto* mock = new MockBackend();
+        mock->setAutoConnect(true);
+        auto channel = std::make_shared<KeycardChannel>(mock);
+        mock->simulateCardInserted();
+        CommandSet cmdSet(channel, nullptr, nullptr);
+        cmdSet.testInjectSecureChannelState(PairingInfo(QByteArray(32, 0xAB), 1),
+                                            QByteArray(16, 0x00), QByteArray(16, 0xEE), QByteArray(16, 0xDD));
+
+        ExportExtendedPublicKeysCommand cmd({ "m/44'/60'/0'", "m/44'/60'/1'" });
+        QCOMPARE(cmd.name(), QString("EXPORT_EXTENDED_PUBLIC_KEYS"));
+        QVERIFY(cmd.derivationPath().isEmpty());
+
+        mock->queueResponse(QByteArray::fromHex("6985"));
+        QVERIFY(!cmd.execute(&cmdSet).success);
+
+        QList<QByteArray> apdus = mock->getTransmittedApdus();
+        QVERIFY(!apdus.isEmpty());
+        QCOMPARE(static_cast<uint8_t>(apdus.first()[1]), APDU::INS_EXPORT_KEY);
+        QCOMPARE(static_cast<uint8_t>(apdus.first()[3]), APDU::P2ExportKeyExtendedPublic);
+    }
+};
+
+QTEST_MAIN(TestAccountDiscovery)
+#include "test_account_discovery.moc"
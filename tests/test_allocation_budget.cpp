@@ -0,0 +1,248 @@
+/**
+ * Heap allocation budgets for hot paths
+ *
+ * Allocations are counted with the malloc interposer in
+ * utils/allocation_counter (glibc only: elsewhere the tests skip). OpenSSL's
+ * own allocations are not counted, so budgets hold across OpenSSL versions.
+ *
+ * A test fails when a change adds allocations to a budgeted path. To change
+ * a budget, update it here in the same commit as the code change that
+ * justifies it; every test prints what it measured.
+ *
+ * Debug output is filtered: what the message handler allocates depends on the
+ * environment. Building the messages (QDebug) is still counted.
+ */
+
+#include <QTest>
+#include <QLoggingCategory>
+#include <QSignalSpy>
+#include "keycard-qt/apdu/command.h"
+#include "keycard-qt/channel_interface.h"
+#include "keycard-qt/command_set.h"
+#include "keycard-qt/communication_executor.h"
+#include "keycard-qt/communication_manager.h"
+#include "keycard-qt/keycard_channel.h"
+#include "keycard-qt/secure_channel.h"
+#include "keycard-core/secure_session.h"
+#include "mocks/mock_backend.h"
+#include "utils/allocation_counter.h"
+#include <algorithm>
+#include <memory>
+
+using namespace Keycard;
+using namespace Keycard::Test;
+
+namespace {
+
+// SecureChannel::send() of a 20-byte command answered with 2 bytes of data:
+//   SecureSession::wrap      4  (ciphertext, MAC blocks, IV || ciphertext, APDU)
+//   secure APDU QByteArray   1
+//   SecureSession::unwrap    2  (MAC blocks, plaintext)
+//   plaintext QByteArray     1
+//   response data            1
+const quint64 SEND_ALLOCATIONS = 9;
+const quint64 SEND_BYTES = 512;
+
+// processQueue() for a command that does no card I/O. Mostly the four debug
+// messages of a processed command; the rest is the next processQueue() event
+// and the result cache bookkeeping.
+const quint64 PROCESS_QUEUE_ALLOCATIONS = 160;
+const quint64 PROCESS_QUEUE_BYTES = 8192;
+
+Core::ByteView view(const QByteArray& data) {
+    return Core::ByteView(data.constData(), static_cast<size_t>(data.size()));
+}
+
+QByteArray toByteArray(Core::ByteView bytes) {
+    return QByteArray(reinterpret_cast<const char*>(bytes.data()), static_cast<int>(bytes.size()));
+}
+
+/**
+ * Card side of the secure channel (see test_keycard_core.cpp), with its own
+ * work kept out of the count
+ */
+class CardChannel : public IChannel {
+public:
+    Core::SecureSession card;
+
+    QByteArray transmit(const QByteArray& apdu) override {
+        AllocationPause pause;
+
+        const Core::ByteView raw = view(apdu);
+        const Core::ByteView data = raw.sub(5, raw[4]);
+        Core::SecureSession::Block meta{};
+        std::copy_n(raw.begin(), 4, meta.begin());
+        meta[4] = raw[4];
+
+        Core::SecureSession::Block commandMac;
+        card.mac(meta, data.sub(16), commandMac);
+        card.setIv(commandMac);
+
+        Core::Bytes encrypted;
+        card.encrypt(view(QByteArray::fromHex("01029000")), encrypted);
+        Core::SecureSession::Block responseMeta{};
+        responseMeta[0] = static_cast<uint8_t>(16 + encrypted.size());
+        Core::SecureSession::Block responseMac;
+        card.mac(responseMeta, encrypted, responseMac);
+        card.setIv(responseMac);
+
+        return toByteArray(responseMac) + toByteArray(encrypted) + QByteArray::fromHex("9000");
+    }
+
+    bool isConnected() const override { return true; }
+};
+
+class NoOpCommand : public CardCommand {
+public:
+    CommandResult execute(CommandSet*) override { return CommandResult::fromSuccess(); }
+    QString name() const override { return QStringLiteral("NO_OP"); }
+};
+
+QByteArray preInitializedSelectResponse() {
+    return QByteArray::fromHex("8041")
+         + QByteArray::fromHex(
+               "0479BE667EF9DCBBAC55A06295CE870B07029BFCDB2DCE28D959F2815B16F81798"
+               "483ADA7726A3C4655DA4FBFC0E1108A8FD17B448A68554199C47D08FFB10D4B8")
+         + QByteArray::fromHex("9000");
+}
+
+QByteArray report(const char* path, const AllocationCounter& counter) {
+    return QByteArray(path) + ": " + QByteArray::number(counter.count()) + " allocations, "
+         + QByteArray::number(counter.bytes()) + " bytes";
+}
+
+} // namespace
+
+class TestAllocationBudget : public QObject {
+    Q_OBJECT
+
+private slots:
+    void initTestCase() {
+        if (!AllocationCounter::isAvailable()) {
+            QSKIP("Allocation counting needs glibc (and no AddressSanitizer)");
+        }
+        QLoggingCategory::setFilterRules(QStringLiteral("default.debug=false"));
+    }
+
+    void cleanupTestCase() {
+        QLoggingCategory::setFilterRules(QString());
+    }
+
+    void testCounter() {
+        AllocationCounter counter;
+        QByteArray counted(64, 'a');
+        {
+            AllocationPause pause;
+            QByteArray ignored(64, 'b');
+        }
+        counter.stop();
+        QByteArray after(64, 'c');
+
+        QCOMPARE(counter.count(), quint64(1));
+        QVERIFY(counter.bytes() >= 64);
+    }
+
+    void testSecureChannelSend() {
+        if (!Core::SecureSession::isAvailable() || !AllocationCounter::excludesOpenSsl()) {
+            QSKIP("Needs OpenSSL, with its allocations kept out of the count");
+        }
+
+        const QByteArray iv(16, 0x11);
+        const QByteArray encKey(32, 0x22);
+        const QByteArray macKey(32, 0x33);
+        CardChannel cardChannel;
+        cardChannel.card.open(view(iv), view(encKey), view(macKey));
+        SecureChannel channel(&cardChannel);
+        channel.init(iv, encKey, macKey);
+
+        APDU::Command command(0x80, 0xF2, 0x00, 0x00);
+        command.setData(QByteArray(20, 0x01));
+
+        // First sends size the session's scratch buffer
+        for (int i = 0; i < 3; ++i) {
+            QVERIFY(channel.send(command).isOK());
+        }
+
+        for (int i = 0; i < 5; ++i) {
+            AllocationCounter counter;
+            const APDU::Response response = channel.send(command);
+            counter.stop();
+
+            QVERIFY(response.isOK());
+            qInfo() << report("SecureChannel::send()", counter).constData();
+            QVERIFY2(counter.count() <= SEND_ALLOCATIONS, report("SecureChannel::send()", counter).constData());
+            QVERIFY2(counter.bytes() <= SEND_BYTES, report("SecureChannel::send()", counter).constData());
+        }
+    }
+
+    void testCommandLifetime() {
+        // First commands take blocks from a new slab
+        for (int i = 0; i < 3; ++i) {
+            std::make_unique<GetStatusCommand>();
+        }
+
+        for (int i = 0; i < 5; ++i) {
+            AllocationCounter counter;
+            {
+                auto command = std::make_unique<GetStatusCommand>();
+                QVERIFY(!command->token().isNull());
+            }
+            counter.stop();
+
+            qInfo() << report("GetStatusCommand create/token/destroy", counter).constData();
+            QVERIFY2(counter.count() == 0, report("GetStatusCommand create/token/destroy", counter).constData());
+        }
+    }
+
+    void testProcessQueue() {
+        auto* mock = new MockBackend();
+        mock->setAutoConnect(false);
+        mock->setRecordTransmits(false);
+        mock->setResponseHandler([](const QByteArray&) { return preInitializedSelectResponse(); });
+        auto cmdSet = std::make_shared<CommandSet>(std::make_shared<KeycardChannel>(mock), nullptr, nullptr);
+
+        // Event-loop executor: processQueue() runs on this thread, where it is counted
+        CommunicationManager manager;
+        manager.setExecutor(std::make_shared<EventLoopExecutor>());
+        QVERIFY(manager.init(cmdSet));
+        manager.startDetection();
+
+        QSignalSpy initialized(&manager, &CommunicationManager::cardInitialized);
+        mock->simulateCardInserted();
+        QVERIFY(QTest::qWaitFor([&initialized]() { return initialized.count() > 0; }, 3000));
+
+        // Keeps detection running while the queue is empty between commands
+        manager.startBatchOperations();
+
+        QVector<quint64> counts;
+        for (int i = 0; i < 8; ++i) {
+            manager.enqueueCommand(std::make_unique<NoOpCommand>());
+
+            AllocationCounter counter;
+            manager.testProcessQueue();
+            counter.stop();
+
+            // Runs the processQueue() events posted above, uncounted
+            QCoreApplication::processEvents();
+
+            if (i < 3) {
+                continue;  // Warm-up
+            }
+            counts.append(counter.count());
+            qInfo() << report("CommunicationManager::processQueue()", counter).constData();
+            QVERIFY2(counter.count() <= PROCESS_QUEUE_ALLOCATIONS,
+                     report("CommunicationManager::processQueue()", counter).constData());
+            QVERIFY2(counter.bytes() <= PROCESS_QUEUE_BYTES,
+                     report("CommunicationManager::processQueue()", counter).constData());
+        }
+
+        // Steady state: the cost of a command does not depend on how many ran before
+        QCOMPARE(*std::min_element(counts.begin(), counts.end()), *std::max_element(counts.begin(), counts.end()));
+
+        manager.endBatchOperations();
+        manager.stop();
+    }
+};
+
+QTEST_MAIN(TestAllocationBudget)
+#include "test_allocation_budget.moc"
@@ -0,0 +1,322 @@
+/**
+ * APDU round-trip budgets for high-level CommandSet flows
+ *
+ * NFC latency scales almost linearly with the number of round trips, so each
+ * flow declares the exact APDU sequence it is allowed to send. A flow fails
+ * when it sends more APDUs than budgeted, and the failure message shows the
+ * expected and actual sequences as a diff so the extra command is obvious.
+ *
+ * To change a budget, update the expected sequence here in the same commit
+ * as the code change that justifies it.
+ */
+
+#include <QTest>
+#include <QCryptographicHash>
+#include <QMessageAuthenticationCode>
+#include <QStringList>
+#include <QVector>
+#include "keycard-qt/command_set.h"
+#include "keycard-qt/keycard_channel.h"
+#include "mocks/mock_backend.h"
+#include <memory>
+
+using namespace Keycard;
+using namespace Keycard::Test;
+
+// Same derivation as the static helper in command_set.cpp (see test_pbkdf2.cpp)
+static QByteArray derivePairingToken(const QString& password)
+{
+    QByteArray salt = "Keycard Pairing Password Salt";
+    QByteArray passwordBytes = password.toUtf8();
+    QByteArray blockData = salt + QByteArray::fromHex("00000001");
+
+    QByteArray U = QMessageAuthenticationCode::hash(blockData, passwordBytes, QCryptographicHash::Sha256);
+    QByteArray T = U;
+    for (int i = 1; i < 50000; ++i) {
+        U = QMessageAuthenticationCode::hash(U, passwordBytes, QCryptographicHash::Sha256);
+        for (int j = 0; j < U.size(); ++j) {
+            T[j] = T[j] ^ U[j];
+        }
+    }
+    return T;
+}
+
+static QString insName(uint8_t ins)
+{
+    switch (ins) {
+    case APDU::INS_SELECT: return "SELECT";
+    case APDU::INS_INIT: return "INIT";
+    case APDU::INS_PAIR: return "PAIR";
+    case APDU::INS_UNPAIR: return "UNPAIR";
+    case APDU::INS_IDENTIFY: return "IDENTIFY";
+    case APDU::INS_OPEN_SECURE_CHANNEL: return "OPEN_SECURE_CHANNEL";
+    case APDU::INS_MUTUALLY_AUTHENTICATE: return "MUTUALLY_AUTHENTICATE";
+    case APDU::INS_GET_STATUS: return "GET_STATUS";
+    case APDU::INS_VERIFY_PIN: return "VERIFY_PIN";
+    case APDU::INS_CHANGE_PIN: return "CHANGE_PIN";
+    case APDU::INS_UNBLOCK_PIN: return "UNBLOCK_PIN";
+    case APDU::INS_LOAD_KEY: return "LOAD_KEY";
+    case APDU::INS_DERIVE_KEY: return "DERIVE_KEY";
+    case APDU::INS_GENERATE_MNEMONIC: return "GENERATE_MNEMONIC";
+    case APDU::INS_REMOVE_KEY: return "REMOVE_KEY";
+    case APDU::INS_GENERATE_KEY: return "GENERATE_KEY";
+    case APDU::INS_SIGN: return "SIGN";
+    case APDU::INS_SET_PINLESS_PATH: return "SET_PINLESS_PATH";
+    case APDU::INS_EXPORT_KEY: return "EXPORT_KEY";
+    case APDU::INS_GET_DATA: return "GET_DATA";
+    case APDU::INS_STORE_DATA: return "STORE_DATA";
+    case APDU::INS_FACTORY_RESET: return "FACTORY_RESET";
+    default: return QString("INS_%1").arg(ins, 2, 16, QChar('0')).toUpper();
+    }
+}
+
+/**
+ * @brief Line diff of two APDU sequences (LCS alignment)
+ *
+ * Unchanged commands are prefixed with two spaces, missing ones with "- "
+ * and unexpected ones with "+ ".
+ */
+static QStringList sequenceDiff(const QStringList& expected, const QStringList& actual)
+{
+    const int n = expected.size();
+    const int m = actual.size();
+    QVector<QVector<int>> lcs(n + 1, QVector<int>(m + 1, 0));
+    for (int i = n - 1; i >= 0; --i) {
+        for (int j = m - 1; j >= 0; --j) {
+            lcs[i][j] = expected[i] == actual[j]
+                ? lcs[i + 1][j + 1] + 1
+                : qMax(lcs[i + 1][j], lcs[i][j + 1]);
+        }
+    }
+
+    QStringList lines;
+    int i = 0;
+    int j = 0;
+    while (i < n || j < m) {
+        if (i < n && j < m && expected[i] == actual[j]) {
+            lines << "  " + expected[i++];
+            j++;
+        } else if (j < m && (i == n || lcs[i][j + 1] >= lcs[i + 1][j])) {
+            lines << "+ " + actual[j++];
+        } else {
+            lines << "- " + expected[i++];
+        }
+    }
+    return lines;
+}
+
+class TestApduBudget : public QObject {
+    Q_OBJECT
+
+private:
+    std::shared_ptr<KeycardChannel> m_channel;
+    MockBackend* m_mock = nullptr;
+
+    void createMockChannel() {
+        m_mock = new MockBackend();
+        m_mock->setAutoConnect(true);
+        m_channel = std::make_shared<KeycardChannel>(m_mock);
+        m_mock->simulateCardInserted();
+    }
+
+    static void injectSecureChannel(CommandSet& cmdSet) {
+        cmdSet.testInjectSecureChannelState(PairingInfo(QByteArray(32, 0xAB), 1),
+                                            QByteArray(16, 0x00),
+                                            QByteArray(16, 0xEE),
+                                            QByteArray(16, 0xDD));
+    }
+
+    // secp256k1 generator point: a valid card key, so ECDH succeeds
+    static QByteArray cardPublicKey() {
+        return QByteArray::fromHex(
+            "0479BE667EF9DCBBAC55A06295CE870B07029BFCDB2DCE28D959F2815B16F81798"
+            "483ADA7726A3C4655DA4FBFC0E1108A8FD17B448A68554199C47D08FFB10D4B8");
+    }
+
+    static QByteArray preInitializedSelectResponse() {
+        return QByteArray::fromHex("8041") + cardPublicKey() + QByteArray::fromHex("9000");
+    }
+
+    static QByteArray initializedSelectResponse() {
+        QByteArray body = QByteArray::fromHex("8F10") + QByteArray(16, 0x11)
+                        + QByteArray::fromHex("8041") + cardPublicKey()
+                        + QByteArray::fromHex("8E20") + QByteArray(32, 0x22);
+        QByteArray response = QByteArray::fromHex("A4");
+        response.append(static_cast<char>(body.size()));
+        response.append(body);
+        return response + QByteArray::fromHex("9000");
+    }
+
+    QStringList transmittedSequence() const {
+        QStringList sequence;
+        for (const QByteArray& apdu : m_mock->getTransmittedApdus()) {
+            sequence << (apdu.size() > 1 ? insName(static_cast<uint8_t>(apdu[1])) : QString("<short>"));
+        }
+        return sequence;
+    }
+
+    /**
+     * @brief Compare the APDUs sent since the mock was created with a flow budget
+     *
+     * Fails if more APDUs were sent than expected. A reordered sequence within
+     * budget is reported but does not fail.
+     */
+    void checkBudget(const char* flow, const QList<uint8_t>& budget) {
+        QStringList expected;
+        for (uint8_t ins : budget) {
+            expected << insName(ins);
+        }
+        QStringList actual = transmittedSequence();
+
+        if (actual == expected) {
+            return;
+        }
+
+        QString report = QString("Flow '%1': expected %2 APDU(s), sent %3\n%4")
+            .arg(flow)
+            .arg(expected.size())
+            .arg(actual.size())
+            .arg(sequenceDiff(expected, actual).join('\n'));
+
+        if (actual.size() > expected.size()) {
+            QFAIL(qPrintable("APDU budget exceeded. " + report));
+        }
+        qWarning().noquote() << "APDU sequence changed within budget." << report;
+    }
+
+private slots:
+    void init() {
+        createMockChannel();
+    }
+
+    void cleanup() {
+        m_channel.reset();
+        m_mock = nullptr;
+    }
+
+    void testSequenceDiff() {
+        QStringList expected{"SELECT", "PAIR", "PAIR"};
+        QStringList actual{"SELECT", "SELECT", "PAIR", "PAIR"};
+        QCOMPARE(sequenceDiff(expected, actual),
+                 QStringList({"  SELECT", "+ SELECT", "  PAIR", "  PAIR"}));
+        QCOMPARE(sequenceDiff(expected, QStringList{"SELECT", "PAIR"}),
+                 QStringList({"  SELECT", "  PAIR", "- PAIR"}));
+    }
+
+    void testTapToReadyPreInitialized() {
+        CommandSet cmdSet(m_channel, nullptr, nullptr);
+        m_mock->queueResponse(preInitializedSelectResponse());
+
+        QVERIFY(cmdSet.select(true).installed);
+        QVERIFY(cmdSet.ensurePairing());
+
+        checkBudget("tap-to-ready (pre-initialized)", {APDU::INS_SELECT});
+    }
+
+    void testTapToReadyWithSession() {
+        // Re-tap of a known card whose secure channel is still valid. Opening
+        // a new session adds OPEN_SECURE_CHANNEL + MUTUALLY_AUTHENTICATE, which
+        // the mock cannot answer without a card-side ECDH implementation.
+        CommandSet cmdSet(m_channel, nullptr, nullptr);
+        m_mock->queueResponse(initializedSelectResponse());
+        QVERIFY(cmdSet.select(true).initialized);
+        injectSecureChannel(cmdSet);
+
+        QVERIFY(cmdSet.ensureSecureChannel());
+        cmdSet.applicationStatus();
+
+        checkBudget("tap-to-ready (session)", {APDU::INS_SELECT, APDU::INS_GET_STATUS});
+    }
+
+    void testVerifyPIN() {
+        CommandSet cmdSet(m_channel, nullptr, nullptr);
+        injectSecureChannel(cmdSet);
+
+        QVERIFY(cmdSet.verifyPIN("123456"));
+
+        checkBudget("verify PIN", {APDU::INS_VERIFY_PIN});
+    }
+
+    void testSign() {
+        CommandSet cmdSet(m_channel, nullptr, nullptr);
+        injectSecureChannel(cmdSet);
+
+        cmdSet.sign(QByteArray(32, 0x01));
+
+        checkBudget("sign", {APDU::INS_SIGN});
+    }
+
+    void testSignWithPath() {
+        CommandSet cmdSet(m_channel, nullptr, nullptr);
+        injectSecureChannel(cmdSet);
+
+        cmdSet.signWithPath(QByteArray(32, 0x01), "m/44'/60'/0'/0/0", false);
+
+        checkBudget("sign with path", {APDU::INS_SIGN});
+    }
+
+    void testExportKey() {
+        CommandSet cmdSet(m_channel, nullptr, nullptr);
+        injectSecureChannel(cmdSet);
+
+        cmdSet.exportKey(true, false, "m/44'/60'/0'/0/0", APDU::P2ExportKeyPublicOnly);
+
+        checkBudget("export key", {APDU::INS_EXPORT_KEY});
+    }
+
+    void testInit() {
+        CommandSet cmdSet(m_channel, nullptr, nullptr);
+        m_mock->queueResponse(preInitializedSelectResponse());
+        m_mock->queueResponse(QByteArray::fromHex("9000"));
+        m_mock->queueResponse(initializedSelectResponse());
+
+        if (!cmdSet.init(Secrets("123456", "123456789012", "KeycardTest"))) {
+            if (cmdSet.lastError().contains("encrypt")) {
+                QSKIP("INIT encryption unavailable (built without OpenSSL)");
+            }
+            QFAIL(qPrintable(cmdSet.lastError()));
+        }
+
+        checkBudget("init", {APDU::INS_SELECT, APDU::INS_INIT, APDU::INS_SELECT});
+    }
+
+    void testPair() {
+        const QString password = "KeycardTest";
+        const QByteArray token = derivePairingToken(password);
+
+        // Answer PAIR like the applet: step 1 proves knowledge of the token
+        // over the host challenge, step 2 returns slot index and salt
+        m_mock->setResponseHandler([token](const QByteArray& apdu) -> QByteArray {
+            if (apdu.size() < 5 || static_cast<uint8_t>(apdu[1]) != APDU::INS_PAIR) {
+                return QByteArray();
+            }
+            if (static_cast<uint8_t>(apdu[2]) == APDU::P1PairFirstStep) {
+                QByteArray challenge = apdu.mid(5, 32);
+                QByteArray cryptogram = QCryptographicHash::hash(token + challenge, QCryptographicHash::Sha256);
+                return cryptogram + QByteArray(32, 0x33) + QByteArray::fromHex("9000");
+            }
+            return QByteArray::fromHex("01") + QByteArray(32, 0x44) + QByteArray::fromHex("9000");
+        });
+
+        CommandSet cmdSet(m_channel, nullptr, nullptr);
+        m_mock->queueResponse(initializedSelectResponse());
+
+        QVERIFY(cmdSet.pair(password).isValid());
+
+        checkBudget("pair", {APDU::INS_SELECT, APDU::INS_PAIR, APDU::INS_PAIR});
+    }
+
+    void testFactoryReset() {
+        CommandSet cmdSet(m_channel, nullptr, nullptr);
+        m_mock->queueResponse(initializedSelectResponse());
+        m_mock->queueResponse(QByteArray::fromHex("9000"));
+        m_mock->queueResponse(preInitializedSelectResponse());
+
+        QVERIFY(cmdSet.factoryReset());
+
+        checkBudget("factory reset", {APDU::INS_SELECT, APDU::INS_FACTORY_RESET, APDU::INS_SELECT});
+    }
+};
+
+QTEST_MAIN(TestApduBudget)
+#include "test_apdu_budget.moc"
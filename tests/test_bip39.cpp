@@ -0,0 +1,184 @@
+/**
+ * Tests for the BIP39 module and LoadMnemonicCommand
+ *
+ * Vectors from the reference implementation (trezor/python-mnemonic,
+ * passphrase "TREZOR").
+ */
+
+#include <QTest>
+#include "keycard-qt/bip39.h"
+#include "keycard-qt/card_command.h"
+#include "keycard-qt/command_set.h"
+#include "keycard-qt/keycard_channel.h"
+#include "mocks/mock_backend.h"
+#include <memory>
+
+using namespace Keycard;
+using namespace Keycard::Test;
+
+class TestBIP39 : public QObject {
+    Q_OBJECT
+
+private:
+    static QString repeat(const QString& word, int count, const QString& last) {
+        QStringList words;
+        for (int i = 0; i < count; ++i) {
+            words << word;
+        }
+        words << last;
+        return words.join(' ');
+    }
+
+    static QString entropyToMnemonicHex(const QString& mnemonic) {
+        QString error;
+        return QString::fromLatin1(BIP39::mnemonicToEntropy(mnemonic, error).toHex());
+    }
+
+private slots:
+    void testWordlist() {
+        const QStringList& words = BIP39::wordlist();
+        QCOMPARE(words.size(), BIP39::WORDLIST_SIZE);
+        QCOMPARE(words.first(), QString("abandon"));
+        QCOMPARE(words.at(1019), QString("legal"));
+        QCOMPARE(words.last(), QString("zoo"));
+    }
+
+    void testIndexesToWords() {
+        QCOMPARE(BIP39::indexesToMnemonic({0, 1, 2047}), QString("abandon ability zoo"));
+        QVERIFY(BIP39::indexesToWords({0, 2048}).isEmpty());
+        QVERIFY(BIP39::indexesToWords({-1}).isEmpty());
+
+        QCOMPARE(BIP39::mnemonicToIndexes("  abandon\tability\nzoo "), QVector<int>({0, 1, 2047}));
+        QVERIFY(BIP39::mnemonicToIndexes("abandon abilityx").isEmpty());
+    }
+
+    void testEntropyVectors_data() {
+        QTest::addColumn<QString>("entropy");
+        QTest::addColumn<QString>("mnemonic");
+
+        QTest::newRow("128-bit zero") << QString(32, '0') << repeat("abandon", 11, "about");
+        QTest::newRow("128-bit 7f") << QString("7f").repeated(16)
+            << "legal winner thank year wave sausage worth useful legal winner thank yellow";
+        QTest::newRow("128-bit ff") << QString("ff").repeated(16) << repeat("zoo", 11, "wrong");
+        QTest::newRow("192-bit zero") << QString(48, '0') << repeat("abandon", 17, "agent");
+        QTest::newRow("256-bit ff") << QString("ff").repeated(32) << repeat("zoo", 23, "vote");
+        QTest::newRow("192-bit") << "6610b25967cdcca9d59875f5cb50b0ea75433311869e930b"
+            << "gravity machine north sort system female filter attitude volume fold club stay "
+               "feature office ecology stable narrow fog";
+        QTest::newRow("256-bit") << "f585c11aec520db57dd353c69554b21a89b20fb0650966fa0a9d6f74fd989d8f"
+            << "void come effort suffer camp survey warrior heavy shoot primary clutch crush open "
+               "amazing screen patrol group space point ten exist slush involve unfold";
+    }
+
+    void testEntropyVectors() {
+        QFETCH(QString, entropy);
+        QFETCH(QString, mnemonic);
+
+        QString error;
+        QVERIFY2(BIP39::validateMnemonic(mnemonic, error), qPrintable(error));
+        QCOMPARE(entropyToMnemonicHex(mnemonic), entropy);
+    }
+
+    void testInvalidMnemonics() {
+        QString error;
+
+        // Valid words, wrong checksum
+        QVERIFY(!BIP39::validateMnemonic(repeat("abandon", 11, "abandon"), error));
+        QVERIFY(error.contains("checksum"));
+
+        QVERIFY(!BIP39::validateMnemonic(repeat("abandon", 10, "about"), error));
+        QVERIFY(error.contains("word count"));
+
+        QVERIFY(!BIP39::validateMnemonic(repeat("abandon", 11, "bitcoin"), error));
+        QVERIFY(error.contains("wordlist"));
+    }
+
+    void testSeedVectors_data() {
+        QTest::addColumn<QString>("mnemonic");
+        QTest::addColumn<QString>("passphrase");
+        QTest::addColumn<QString>("seed");
+
+        QTest::newRow("12 words") << repeat("abandon", 11, "about") << "TREZOR"
+            << "c55257c360c07c72029aebc1b53c05ed0362ada38ead3e3e9efa3708e53495531f09a6987599d18264c1e1c92f2cf141630c7a3c4ab7c81b2f001698e7463b04";
+        QTest::newRow("12 words 7f") << "legal winner thank year wave sausage worth useful legal winner thank yellow" << "TREZOR"
+            << "2e8905819b8723fe2c1d161860e5ee1830318dbf49a83bd451cfb8440c28bd6fa457fe1296106559a3c80937a1c1069be3a3a5bd381ee6260e8d9739fce1f607";
+        QTest::newRow("24 words") << "void come effort suffer camp survey warrior heavy shoot primary clutch crush open "
+                                     "amazing screen patrol group space point ten exist slush involve unfold" << "TREZOR"
+            << "01f5bced59dec48e362f2c45b5de68b9fd6c92c6634f44d6d40aab69056506f0e35524a518034ddc1192e1dacd32c1ed3eaa3c3b131c88ed8e7e54c49a5d0998";
+        QTest::newRow("no passphrase") << repeat("abandon", 11, "about") << ""
+            << "5eb00bbddcf069084889a8ab9155568165f5c453ccb85e70811aaed6f6da5fc19a5ac40b389cd370d086206dec8aa6c43daea6690f20ad3d8d48b2d2ce9e38e4";
+    }
+
+    void testSeedVectors() {
+        QFETCH(QString, mnemonic);
+        QFETCH(QString, passphrase);
+        QFETCH(QString, seed);
+
+        QByteArray derived = BIP39::mnemonicToSeed(mnemonic, passphrase);
+        QCOMPARE(derived.size(), BIP39::SEED_SIZE);
+        QCOMPARE(QString::fromLatin1(derived.toHex()), seed);
+    }
+
+    void testPassphraseIsNfkdNormalized() {
+        const QString mnemonic = repeat("abandon", 11, "about");
+        const QString composed = QString("caf") + QChar(0x00E9);
+        const QString decomposed = QString("cafe") + QChar(0x0301);
+
+        QByteArray seed = BIP39::mnemonicToSeed(mnemonic, composed);
+        QCOMPARE(BIP39::mnemonicToSeed(mnemonic, decomposed), seed);
+        QCOMPARE(seed.toHex(), QByteArray("af8bbd2566df7b69d926f2b09dfdbd75db6c994a3399b2cc65f928d63e3fd4e6"
+                                          "1218ee0d15f8c810be4d45e66d47b43c15a5cc753976b1666912377ff7ae9818"));
+    }
+
+    void testPbkdf2LongKeyAndMultipleBlocks() {
+        // Password longer than the SHA-512 block and output longer than one digest
+        QByteArray derived = BIP39::pbkdf2HmacSha512(QByteArray(200, 'x'), QByteArray(250, 's'), 3, 150);
+        QCOMPARE(derived.toHex().left(64), QByteArray("09e27a18f517e8cfb62168362d41310ea3031e017510b9cff21a419bb9e40de3"));
+        QCOMPARE(derived.size(), 150);
+        QVERIFY(BIP39::pbkdf2HmacSha512("key", "salt", 0, 64).isEmpty());
+    }
+
+    void testLoadMnemonicCommand() {
+        LoadMnemonicCommand cmd(repeat("abandon", 11, "about"));
+        QCOMPARE(cmd.name(), QString("LOAD_MNEMONIC"));
+        QVERIFY(!cmd.canRunDuringInit());
+        QCOMPARE(cmd.timeoutMs(), 60000);
+    }
+
+    void testLoadMnemonicCommandRejectsBadChecksumWithoutCardIo() {
+        auto* mock = new MockBackend();
+        mock->setAutoConnect(true);
+        auto channel = std::make_shared<KeycardChannel>(mock);
+        CommandSet cmdSet(channel, nullptr, nullptr);
+
+        LoadMnemonicCommand cmd(repeat("abandon", 11, "abandon"));
+        CommandResult result = cmd.execute(&cmdSet);
+
+        QVERIFY(!result.success);
+        QVERIFY(result.error.contains("checksum"));
+        QCOMPARE(mock->getTransmitCount(), 0);
+    }
+
+    void testLoadMnemonicCommandSendsLoadKey() {
+        auto* mock = new MockBackend();
+        mock->setAutoConnect(true);
+        auto channel = std::make_shared<KeycardChannel>(mock);
+        mock->simulateCardInserted();
+        CommandSet cmdSet(channel, nullptr, nullptr);
+        cmdSet.testInjectSecureChannelState(PairingInfo(QByteArray(32, 0xAB), 1),
+                                            QByteArray(16, 0x00), QByteArray(16, 0xEE), QByteArray(16, 0xDD));
+
+        LoadMnemonicCommand cmd(repeat("abandon", 11, "about"), "TREZOR");
+        mock->queueResponse(QByteArray::fromHex("9000"));
+        cmd.execute(&cmdSet);
+
+        // LOAD KEY with P1 = BIP39 seed (payload is encrypted)
+        QList<QByteArray> apdus = mock->getTransmittedApdus();
+        QVERIFY(!apdus.isEmpty());
+        QCOMPARE(static_cast<uint8_t>(apdus.last()[1]), APDU::INS_LOAD_KEY);
+        QCOMPARE(static_cast<uint8_t>(apdus.last()[2]), APDU::P1LoadKeySeed);
+    }
+};
+
+QTEST_MAIN(TestBIP39)
+#include "test_bip39.moc"
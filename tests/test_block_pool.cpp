@@ -0,0 +1,82 @@
+/**
+ * Tests for BlockPool and PoolAllocator
+ */
+
+#include <QTest>
+#include <QThread>
+#include "keycard-qt/block_pool.h"
+#include "keycard-qt/card_command.h"
+#include <cstring>
+#include <memory>
+#include <vector>
+
+using namespace Keycard;
+
+class TestBlockPool : public QObject {
+    Q_OBJECT
+
+private slots:
+    void testReleasedBlockIsReused() {
+        void* first = BlockPool::allocate(100);
+        BlockPool::deallocate(first, 100);
+
+        // Same size class (128 bytes): the block just released comes back
+        const BlockPool::Stats before = BlockPool::stats();
+        void* second = BlockPool::allocate(120);
+        QVERIFY(second == first);
+        QCOMPARE(BlockPool::stats().reused, before.reused + 1);
+        BlockPool::deallocate(second, 120);
+    }
+
+    void testBlocksDoNotOverlap() {
+        std::vector<char*> blocks;
+        for (int i = 0; i < 100; ++i) {
+            char* block = static_cast<char*>(BlockPool::allocate(64));
+            std::memset(block, i, 64);
+            blocks.push_back(block);
+        }
+        for (int i = 0; i < 100; ++i) {
+            QCOMPARE(blocks[i][0], static_cast<char>(i));
+            QCOMPARE(blocks[i][63], static_cast<char>(i));
+            BlockPool::deallocate(blocks[i], 64);
+        }
+    }
+
+    void testLargeRequestsBypassPool() {
+        const BlockPool::Stats before = BlockPool::stats();
+        void* block = BlockPool::allocate(BlockPool::MAX_BLOCK_SIZE + 1);
+        QVERIFY(block);
+        BlockPool::deallocate(block, BlockPool::MAX_BLOCK_SIZE + 1);
+        QCOMPARE(BlockPool::stats().allocations, before.allocations);
+    }
+
+    void testCommandsAreFreedOnAnotherThread() {
+        // Created here, destroyed on a worker, as with the communication thread
+        std::vector<std::unique_ptr<CardCommand>> commands;
+        for (int i = 0; i < 200; ++i) {
+            commands.push_back(std::make_unique<SignCommand>(QByteArray(32, 0x01), QStringLiteral("m/44'/60'/0'/0/0")));
+        }
+        QThread* worker = QThread::create([&commands]() { commands.clear(); });
+        worker->start();
+        QVERIFY(worker->wait(5000));
+        delete worker;
+
+        const BlockPool::Stats before = BlockPool::stats();
+        for (int i = 0; i < 200; ++i) {
+            commands.push_back(std::make_unique<SignCommand>(QByteArray(32, 0x01)));
+        }
+        QCOMPARE(BlockPool::stats().slabs, before.slabs);
+        commands.clear();
+    }
+
+    void testPoolAllocatorWithSharedPtr() {
+        auto value = std::allocate_shared<QByteArray>(PoolAllocator<QByteArray>(), 16, 'x');
+        QCOMPARE(*value, QByteArray(16, 'x'));
+        std::weak_ptr<QByteArray> weak = value;
+        value.reset();
+        QVERIFY(weak.expired());
+    }
+};
+
+QTEST_MAIN(TestBlockPool)
+#include "test_block_pool.moc"
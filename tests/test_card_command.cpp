@@ -1,7 +1,9 @@
 #include <QTest>
 #include "keycard-qt/card_command.h"
+#include "keycard-qt/card_info_cache.h"
 #include "keycard-qt/command_set.h"
 #include "keycard-qt/keycard_channel.h"
+#include "keycard-qt/metadata_utils.h"
 #include "mocks/mock_backend.h"
 #include <memory>
 
@@ -265,6 +267,43 @@ private slots:
         QVERIFY(!cmd.canRunDuringInit());
     }
     
+    void testMetadataRoundTrip() {
+        // The card info cache answers GET DATA with what STORE DATA wrote
+        auto cache = std::make_shared<CardInfoCache>();
+        m_cmdSet->setCardInfoCache(cache);
+        QByteArray body = QByteArray::fromHex("8F10") + QByteArray(16, 0x11)
+                        + QByteArray::fromHex("8041") + QByteArray(65, 0x04)
+                        + QByteArray::fromHex("8E20") + QByteArray(32, 0x22);
+        QByteArray select = QByteArray::fromHex("A4");
+        select.append(static_cast<char>(body.size()));
+        m_mock->queueResponse(select + body + QByteArray::fromHex("9000"));
+        QVERIFY(m_cmdSet->select(true).initialized);
+        m_cmdSet->testInjectSecureChannelState(PairingInfo(QByteArray(32, 0xAB), 1),
+                                               QByteArray(16, 0x00),
+                                               QByteArray(16, 0xEE),
+                                               QByteArray(16, 0xDD));
+        
+        QStringList paths;
+        paths << "m/44'/60'/0'/0/2" << "m/44'/60'/0'/0/0" << "m/44'/60'/0'/0/1"
+              << "m/44'/60'/0'/0/1" << "m/44'/60'/0'/0/7";
+        m_mock->queueResponse(QByteArray::fromHex("9000"));
+        QVERIFY(StoreMetadataCommand("Card", paths).execute(m_cmdSet.get()).success);
+        
+        CommandResult result = GetMetadataCommand().execute(m_cmdSet.get());
+        QVERIFY(result.success);
+        QVariantMap map = result.data.toMap();
+        // Ranges 0..2 and 7
+        QCOMPARE(map["tlvData"].toByteArray(), QByteArray::fromHex("244361726400020700"));
+        QCOMPARE(map["name"].toString(), QString("Card"));
+        QCOMPARE(map["version"].toInt(), 1);
+        QCOMPARE(map["paths"].toStringList(),
+                 QStringList({"m/44'/60'/0'/0/0", "m/44'/60'/0'/0/1", "m/44'/60'/0'/0/2", "m/44'/60'/0'/0/7"}));
+        
+        auto metadata = map["metadata"].value<MetadataEncoding::WalletMetadata>();
+        QCOMPARE(metadata.paths.rangeCount(), 2);
+        QVERIFY(metadata.paths.contains(7));
+    }
+    
     // ========================================================================
     // SignCommand Tests
     // ========================================================================
@@ -341,7 +380,30 @@ private slots:
         
         QCOMPARE(token1, token2);  // Same command should return same token
     }
-    
+
+    void testCommandIdsAreMonotonic() {
+        SelectCommand cmd1;
+        GetStatusCommand cmd2;
+
+        QVERIFY(cmd1.id() > 0);
+        QVERIFY(cmd2.id() > cmd1.id());
+        QCOMPARE(CardCommand::idFromToken(cmd1.token()), cmd1.id());
+        QCOMPARE(CardCommand::idFromToken(cmd2.token()), cmd2.id());
+    }
+
+    void testTokenIdRoundTrip() {
+        const quint64 ids[] = {1, 0xF, 0x10, 0xFFFF, 0x123456789ABCDEF0ULL, ~quint64(0)};
+        for (quint64 id : ids) {
+            QUuid token = CardCommand::tokenFromId(id);
+            QCOMPARE(token.variant(), QUuid::DCE);
+            QCOMPARE(CardCommand::idFromToken(token), id);
+        }
+
+        // Not a command token
+        QCOMPARE(CardCommand::idFromToken(QUuid::createUuid()), quint64(0));
+        QCOMPARE(CardCommand::idFromToken(QUuid()), quint64(0));
+    }
+
     // ========================================================================
     // Timeout Configuration Tests
     // ========================================================================
@@ -0,0 +1,242 @@
+/**
+ * Unit tests for CardInfoCache and its CommandSet integration
+ */
+
+#include <QTest>
+#include <QTemporaryDir>
+#include <QFile>
+#include "keycard-qt/card_info_cache.h"
+#include "keycard-qt/command_set.h"
+#include "keycard-qt/keycard_channel.h"
+#include "mocks/mock_backend.h"
+#include <memory>
+
+using namespace Keycard;
+using namespace Keycard::Test;
+
+class TestCardInfoCache : public QObject {
+    Q_OBJECT
+
+private:
+    static ApplicationInfo makeInfo(char instanceByte, char keyByte) {
+        ApplicationInfo info;
+        info.installed = true;
+        info.initialized = true;
+        info.instanceUID = QByteArray(16, instanceByte);
+        info.keyUID = QByteArray(32, keyByte);
+        info.secureChannelPublicKey = QByteArray(65, 0x04);
+        info.appVersion = 3;
+        info.appVersionMinor = 1;
+        info.availableSlots = 4;
+        info.capabilities = 0x1F;
+        return info;
+    }
+
+    // SELECT response for an initialized card (A4 template)
+    static QByteArray selectResponse(char instanceByte, char keyByte) {
+        QByteArray body = QByteArray::fromHex("8F10") + QByteArray(16, instanceByte)
+                        + QByteArray::fromHex("8041") + QByteArray(65, 0x04)
+                        + QByteArray::fromHex("8E20") + QByteArray(32, keyByte);
+        QByteArray response = QByteArray::fromHex("A4");
+        response.append(static_cast<char>(body.size()));
+        response.append(body);
+        return response + QByteArray::fromHex("9000");
+    }
+
+    std::shared_ptr<KeycardChannel> createMockChannel() {
+        auto* mock = new MockBackend();
+        mock->setAutoConnect(true);
+        auto channel = std::make_shared<KeycardChannel>(mock);
+        mock->simulateCardInserted();
+        return channel;
+    }
+
+    static void injectSecureChannel(CommandSet& cmdSet) {
+        cmdSet.testInjectSecureChannelState(PairingInfo(QByteArray(32, 0xAB), 1),
+                                            QByteArray(16, 0x00),
+                                            QByteArray(16, 0xEE),
+                                            QByteArray(16, 0xDD));
+    }
+
+private slots:
+    void testResponseHashIsStable() {
+        QByteArray data = QByteArray::fromHex("a40102");
+        QCOMPARE(CardInfoCache::responseHash(data), CardInfoCache::responseHash(data));
+        QVERIFY(CardInfoCache::responseHash(data) != CardInfoCache::responseHash(QByteArray::fromHex("a40103")));
+        // FNV-1a 64 of empty input is the offset basis
+        QCOMPARE(CardInfoCache::responseHash(QByteArray()), Q_UINT64_C(0xcbf29ce484222325));
+    }
+
+    void testMetadataRequiresKnownCard() {
+        CardInfoCache cache;
+        ApplicationInfo info = makeInfo(0x01, 0x02);
+
+        // Unknown card: nothing is cached
+        cache.storeMetadata(info.instanceUID, info.keyUID, "meta");
+        QByteArray metadata;
+        QVERIFY(!cache.metadata(info.instanceUID, info.keyUID, metadata));
+
+        QVERIFY(!cache.updateApplicationInfo(info, 42));
+        cache.storeMetadata(info.instanceUID, info.keyUID, "meta");
+        QVERIFY(cache.metadata(info.instanceUID, info.keyUID, metadata));
+        QCOMPARE(metadata, QByteArray("meta"));
+
+        // Different key UID must miss
+        QVERIFY(!cache.metadata(info.instanceUID, QByteArray(32, 0x03), metadata));
+    }
+
+    void testSelectHashChangeDropsMetadata() {
+        CardInfoCache cache;
+        ApplicationInfo info = makeInfo(0x01, 0x02);
+
+        cache.updateApplicationInfo(info, 42);
+        cache.storeMetadata(info.instanceUID, info.keyUID, "meta");
+
+        // Same response: still fresh
+        QVERIFY(cache.updateApplicationInfo(info, 42));
+        QByteArray metadata;
+        QVERIFY(cache.metadata(info.instanceUID, info.keyUID, metadata));
+
+        // Card answered differently: entry refreshed, metadata dropped
+        QVERIFY(!cache.updateApplicationInfo(info, 43));
+        QVERIFY(!cache.metadata(info.instanceUID, info.keyUID, metadata));
+        QCOMPARE(cache.applicationInfo(info.instanceUID).keyUID, info.keyUID);
+    }
+
+    void testInvalidate() {
+        CardInfoCache cache;
+        ApplicationInfo a = makeInfo(0x01, 0x02);
+        ApplicationInfo b = makeInfo(0x05, 0x06);
+        cache.updateApplicationInfo(a, 1);
+        cache.updateApplicationInfo(b, 2);
+        QCOMPARE(cache.size(), 2);
+
+        cache.invalidate(a.instanceUID);
+        QCOMPARE(cache.size(), 1);
+        QVERIFY(cache.applicationInfo(a.instanceUID).instanceUID.isEmpty());
+        QCOMPARE(cache.applicationInfo(b.instanceUID).instanceUID, b.instanceUID);
+    }
+
+    void testPreInitializedCardIsNotCached() {
+        CardInfoCache cache;
+        ApplicationInfo info;
+        info.installed = true;
+        QVERIFY(!cache.updateApplicationInfo(info, 1));
+        QCOMPARE(cache.size(), 0);
+    }
+
+    void testPersistence() {
+        QTemporaryDir dir;
+        QVERIFY(dir.isValid());
+        QString path = dir.filePath("card_info.bin");
+        ApplicationInfo info = makeInfo(0x01, 0x02);
+
+        {
+            CardInfoCache cache(path);
+            cache.updateApplicationInfo(info, 42);
+            cache.storeMetadata(info.instanceUID, info.keyUID, QByteArray::fromHex("2400"));
+        }
+
+        CardInfoCache reloaded(path);
+        QCOMPARE(reloaded.size(), 1);
+        ApplicationInfo cached = reloaded.applicationInfo(info.instanceUID);
+        QCOMPARE(cached.keyUID, info.keyUID);
+        QCOMPARE(cached.secureChannelPublicKey, info.secureChannelPublicKey);
+        QCOMPARE(cached.appVersion, info.appVersion);
+        QCOMPARE(cached.appVersionMinor, info.appVersionMinor);
+        QCOMPARE(cached.availableSlots, info.availableSlots);
+        QCOMPARE(cached.capabilities, info.capabilities);
+        QVERIFY(cached.initialized);
+
+        QByteArray metadata;
+        QVERIFY(reloaded.metadata(info.instanceUID, info.keyUID, metadata));
+        QCOMPARE(metadata, QByteArray::fromHex("2400"));
+        QVERIFY(reloaded.updateApplicationInfo(info, 42));
+    }
+
+    void testCorruptFileIsIgnored() {
+        QTemporaryDir dir;
+        QString path = dir.filePath("card_info.bin");
+        QFile file(path);
+        QVERIFY(file.open(QIODevice::WriteOnly));
+        file.write("garbage");
+        file.close();
+
+        CardInfoCache cache(path);
+        QCOMPARE(cache.size(), 0);
+    }
+
+    void testCommandSetWriteThroughAndReadThrough() {
+        auto channel = createMockChannel();
+        auto* mock = qobject_cast<MockBackend*>(channel->backend());
+        auto cache = std::make_shared<CardInfoCache>();
+
+        CommandSet cmdSet(channel, nullptr, nullptr);
+        cmdSet.setCardInfoCache(cache);
+
+        mock->queueResponse(selectResponse(0x11, 0x22));
+        QVERIFY(cmdSet.select(true).initialized);
+        injectSecureChannel(cmdSet);
+
+        QByteArray metadata = QByteArray::fromHex("2443617264000a");
+        mock->queueResponse(QByteArray::fromHex("9000"));
+        QVERIFY(cmdSet.storeData(APDU::P1StoreDataPublic, metadata));
+
+        // GET DATA is now served without touching the card
+        int transmitsBefore = mock->getTransmitCount();
+        QCOMPARE(cmdSet.getData(APDU::P1StoreDataPublic), metadata);
+        QCOMPARE(mock->getTransmitCount(), transmitsBefore);
+
+        // Other data types always go to the card
+        mock->queueResponse(QByteArray::fromHex("9000"));
+        cmdSet.getData(APDU::P1StoreDataNDEF);
+        QCOMPARE(mock->getTransmitCount(), transmitsBefore + 1);
+    }
+
+    void testCommandSetRemoveKeyInvalidates() {
+        auto channel = createMockChannel();
+        auto* mock = qobject_cast<MockBackend*>(channel->backend());
+        auto cache = std::make_shared<CardInfoCache>();
+
+        CommandSet cmdSet(channel, nullptr, nullptr);
+        cmdSet.setCardInfoCache(cache);
+
+        mock->queueResponse(selectResponse(0x11, 0x22));
+        cmdSet.select(true);
+        injectSecureChannel(cmdSet);
+
+        mock->queueResponse(QByteArray::fromHex("9000"));
+        cmdSet.storeData(APDU::P1StoreDataPublic, QByteArray::fromHex("20"));
+        QCOMPARE(cache->size(), 1);
+
+        mock->queueResponse(QByteArray::fromHex("9000"));
+        QVERIFY(cmdSet.removeKey());
+        QCOMPARE(cache->size(), 0);
+    }
+
+    void testCommandSetReselectWithNewKeyMisses() {
+        auto channel = createMockChannel();
+        auto* mock = qobject_cast<MockBackend*>(channel->backend());
+        auto cache = std::make_shared<CardInfoCache>();
+
+        CommandSet cmdSet(channel, nullptr, nullptr);
+        cmdSet.setCardInfoCache(cache);
+
+        mock->queueResponse(selectResponse(0x11, 0x22));
+        cmdSet.select(true);
+        injectSecureChannel(cmdSet);
+        mock->queueResponse(QByteArray::fromHex("9000"));
+        cmdSet.storeData(APDU::P1StoreDataPublic, QByteArray::fromHex("20"));
+
+        // Keys were changed elsewhere: the SELECT response differs
+        mock->queueResponse(selectResponse(0x11, 0x33));
+        cmdSet.select(true);
+
+        QByteArray metadata;
+        QVERIFY(!cache->metadata(QByteArray(16, 0x11), QByteArray(32, 0x33), metadata));
+        QVERIFY(!cache->metadata(QByteArray(16, 0x11), QByteArray(32, 0x22), metadata));
+    }
+};
+
+QTEST_MAIN(TestCardInfoCache)
+#include "test_card_info_cache.moc"
@@ -0,0 +1,204 @@
+/**
+ * Tests for CashCommandSet and the CommunicationManager payment fast path
+ */
+
+#include <QTest>
+#include <QSignalSpy>
+#include "keycard-qt/cash_command_set.h"
+#include "keycard-qt/card_command.h"
+#include "keycard-qt/command_set.h"
+#include "keycard-qt/communication_manager.h"
+#include "keycard-qt/keycard_channel.h"
+#include "keycard-qt/types_parser.h"
+#include "keycard-qt/globalplatform/gp_constants.h"
+#include "mocks/mock_backend.h"
+#include <memory>
+
+using namespace Keycard;
+using namespace Keycard::Test;
+
+namespace {
+
+const QByteArray CASH_PUBLIC_KEY = QByteArray::fromHex(
+    "0479BE667EF9DCBBAC55A06295CE870B07029BFCDB2DCE28D959F2815B16F81798"
+    "483ADA7726A3C4655DA4FBFC0E1108A8FD17B448A68554199C47D08FFB10D4B8");
+const QByteArray CASH_PUBLIC_DATA = QByteArray::fromHex("CAFE");
+const QByteArray HASH(32, 0x42);
+
+QByteArray cashSelectResponse() {
+    QByteArray body = QByteArray::fromHex("8041") + CASH_PUBLIC_KEY
+                    + QByteArray::fromHex("02020301")
+                    + QByteArray::fromHex("8202") + CASH_PUBLIC_DATA;
+    QByteArray response = QByteArray::fromHex("A4");
+    response.append(static_cast<char>(body.size()));
+    response.append(body);
+    return response + QByteArray::fromHex("9000");
+}
+
+QByteArray signResponse() {
+    return QByteArray::fromHex("A04B8041") + CASH_PUBLIC_KEY
+         + QByteArray::fromHex("3004020101020101") + QByteArray::fromHex("9000");
+}
+
+QByteArray preInitializedSelectResponse() {
+    return QByteArray::fromHex("8041") + CASH_PUBLIC_KEY + QByteArray::fromHex("9000");
+}
+
+// Cash applet answers for its AID and SIGN, a pre-initialized Keycard for the rest
+QByteArray cardResponse(const QByteArray& apdu) {
+    if (static_cast<uint8_t>(apdu[1]) == APDU::INS_SELECT) {
+        return apdu.mid(5, 9) == GlobalPlatform::CASH_INSTANCE_AID()
+             ? cashSelectResponse() : preInitializedSelectResponse();
+    }
+    if (static_cast<uint8_t>(apdu[1]) == APDU::INS_SIGN) {
+        return signResponse();
+    }
+    return QByteArray::fromHex("6D00");
+}
+
+} // namespace
+
+class TestCashCommandSet : public QObject {
+    Q_OBJECT
+
+private:
+    MockBackend* m_mock = nullptr;
+    std::shared_ptr<KeycardChannel> m_channel;
+
+private slots:
+    void init() {
+        m_mock = new MockBackend();
+        m_mock->setAutoConnect(false);
+        m_mock->setResponseHandler(cardResponse);
+        m_channel = std::make_shared<KeycardChannel>(m_mock);
+    }
+
+    void cleanup() {
+        m_channel.reset();
+        m_mock = nullptr;
+    }
+
+    void testParseCashApplicationInfo() {
+        const QByteArray response = cashSelectResponse();
+        CashApplicationInfo info = parseCashApplicationInfo(response.left(response.size() - 2));
+        QVERIFY(info.installed);
+        QCOMPARE(info.publicKey, CASH_PUBLIC_KEY);
+        QCOMPARE(info.publicData, CASH_PUBLIC_DATA);
+        QCOMPARE(info.appVersion, uint8_t(3));
+        QCOMPARE(info.appVersionMinor, uint8_t(1));
+
+        QVERIFY(!parseCashApplicationInfo(QByteArray()).installed);
+        QVERIFY(!parseCashApplicationInfo(QByteArray::fromHex("8041") + CASH_PUBLIC_KEY).installed);
+    }
+
+    void testSelectAndSign() {
+        m_mock->simulateCardInserted();
+        CashCommandSet cash(m_channel.get());
+
+        CashApplicationInfo info = cash.select();
+        QVERIFY(info.installed);
+        QCOMPARE(cash.applicationInfo().publicKey, CASH_PUBLIC_KEY);
+
+        QByteArray signature = cash.sign(HASH);
+        QCOMPARE(signature, signResponse().chopped(2));
+
+        const QList<QByteArray> apdus = m_mock->getTransmittedApdus();
+        QCOMPARE(apdus.size(), 2);
+        QCOMPARE(apdus[0], QByteArray::fromHex("00A4040009") + GlobalPlatform::CASH_INSTANCE_AID()
+                           + QByteArray::fromHex("00"));
+        QCOMPARE(apdus[1].left(5), QByteArray::fromHex("80C0000020"));
+        QCOMPARE(apdus[1].mid(5, 32), HASH);
+    }
+
+    void testSignRejectsBadHash() {
+        m_mock->simulateCardInserted();
+        CashCommandSet cash(m_channel.get());
+
+        QVERIFY(cash.sign(QByteArray(31, 0x01)).isEmpty());
+        QVERIFY(!cash.lastError().isEmpty());
+        QCOMPARE(m_mock->getTransmitCount(), 0);
+    }
+
+    void testSelectFailsWithoutApplet() {
+        m_mock->setResponseHandler([](const QByteArray&) { return QByteArray::fromHex("6A82"); });
+        m_mock->simulateCardInserted();
+        CashCommandSet cash(m_channel.get());
+
+        QVERIFY(!cash.select().installed);
+        QVERIFY(cash.lastError().contains("6a82"));
+    }
+
+    void testPaymentTapIsTwoApdus() {
+        auto cmdSet = std::make_shared<CommandSet>(m_channel, nullptr, nullptr);
+        CommunicationManager manager;
+        QVERIFY(manager.init(cmdSet));
+        QSignalSpy initialized(&manager, &CommunicationManager::cardInitialized);
+        QSignalSpy completed(&manager, &CommunicationManager::commandCompleted);
+
+        // Payment queued first, then the card is tapped
+        QUuid token = manager.enqueueCommand(std::make_unique<CashSignCommand>(HASH));
+        m_mock->simulateCardInserted();
+        QVERIFY(completed.wait(3000));
+
+        QCOMPARE(completed.first().at(0).toUuid(), token);
+        CommandResult result = completed.first().at(1).value<CommandResult>();
+        QVERIFY(result.success);
+        QCOMPARE(result.data.toMap().value("publicKey").toByteArray(), CASH_PUBLIC_KEY);
+        QCOMPARE(result.data.toMap().value("tlvResponse").toByteArray(), signResponse().chopped(2));
+
+        QCOMPARE(m_mock->getTransmitCount(), 2);
+        QCOMPARE(initialized.count(), 0);
+
+        // A Keycard command after the payment gets the skipped sequence first
+        QVERIFY(manager.executeCommandSync(std::make_unique<SelectCommand>(true), 3000).success);
+        QCOMPARE(initialized.count(), 1);
+        QCOMPARE(m_mock->getTransmitCount(), 4);
+        QCOMPARE(m_mock->getTransmittedApdus().at(2).mid(5, 9), QByteArray::fromHex("A00000080400010101"));
+
+        manager.stop();
+    }
+
+    void testCardSwappedAtPaymentTapDropsCachedResults() {
+        auto cmdSet = std::make_shared<CommandSet>(m_channel, nullptr, nullptr);
+        CommunicationManager manager;
+        QVERIFY(manager.init(cmdSet));
+        QSignalSpy initialized(&manager, &CommunicationManager::cardInitialized);
+        QSignalSpy completed(&manager, &CommunicationManager::commandCompleted);
+
+        // Keycard session with the first card, which leaves a cached result
+        manager.startDetection();
+        m_mock->setCardUid(QStringLiteral("CARD-A"));
+        m_mock->simulateCardInserted();
+        QVERIFY(QTest::qWaitFor([&initialized]() { return initialized.count() > 0; }, 3000));
+        QVariantMap metadata;
+        metadata["tlvData"] = QByteArray::fromHex("2400");
+        manager.testInjectPrefetchedResult(QStringLiteral("GET_METADATA"), CommandResult::fromSuccess(metadata));
+        m_mock->simulateCardRemoved();
+        QVERIFY(QTest::qWaitFor([&manager]() {
+            return manager.state() == CommunicationManager::State::Idle;
+        }, 3000));
+
+        // Another card pays: its tap skips the SELECT of the Keycard applet
+        manager.enqueueCommand(std::make_unique<CashSignCommand>(HASH));
+        m_mock->setCardUid(QStringLiteral("CARD-B"));
+        m_mock->simulateCardInserted();
+        QVERIFY(completed.wait(3000));
+        QVERIFY(completed.first().at(1).value<CommandResult>().success);
+        QCOMPARE(initialized.count(), 1);
+
+        QVERIFY(!manager.hasPrefetchedResult(QStringLiteral("GET_METADATA")));
+        QVERIFY(manager.compactApplicationInfo().toApplicationInfo().secureChannelPublicKey.isEmpty());
+
+        // Read from the card in the reader, after its own initialization
+        const int transmitsBefore = m_mock->getTransmitCount();
+        CommandResult result = manager.executeCommandSync(std::make_unique<GetMetadataCommand>(), 3000);
+        QVERIFY(result.data.toMap().value("tlvData").toByteArray() != QByteArray::fromHex("2400"));
+        QVERIFY(m_mock->getTransmitCount() > transmitsBefore);
+        QCOMPARE(initialized.count(), 2);
+
+        manager.stop();
+    }
+};
+
+QTEST_MAIN(TestCashCommandSet)
+#include "test_cash_command_set.moc"
@@ -0,0 +1,205 @@
+/**
+ * Tests for CommunicationManager executors and stop() latency
+ */
+
+#include <QTest>
+#include <QSignalSpy>
+#include <QElapsedTimer>
+#include <QPointer>
+#include <QSet>
+#include "keycard-qt/communication_manager.h"
+#include "keycard-qt/communication_executor.h"
+#include "keycard-qt/command_set.h"
+#include "keycard-qt/keycard_channel.h"
+#include "mocks/mock_backend.h"
+#include <memory>
+#include <vector>
+
+using namespace Keycard;
+using namespace Keycard::Test;
+
+class TestCommunicationManagerExecutor : public QObject {
+    Q_OBJECT
+
+private:
+    static QByteArray preInitializedSelectResponse() {
+        return QByteArray::fromHex("8041")
+             + QByteArray::fromHex(
+                   "0479BE667EF9DCBBAC55A06295CE870B07029BFCDB2DCE28D959F2815B16F81798"
+                   "483ADA7726A3C4655DA4FBFC0E1108A8FD17B448A68554199C47D08FFB10D4B8")
+             + QByteArray::fromHex("9000");
+    }
+
+    // One reader: mock backend, CommandSet and manager
+    struct Session {
+        MockBackend* mock = nullptr;
+        std::shared_ptr<CommandSet> cmdSet;
+        std::unique_ptr<CommunicationManager> manager;
+
+        explicit Session(std::shared_ptr<CommunicationExecutor> executor = nullptr) {
+            mock = new MockBackend();
+            mock->setAutoConnect(false);
+            mock->setResponseHandler([](const QByteArray&) { return preInitializedSelectResponse(); });
+            cmdSet = std::make_shared<CommandSet>(std::make_shared<KeycardChannel>(mock), nullptr, nullptr);
+            manager = std::make_unique<CommunicationManager>();
+            if (executor) {
+                manager->setExecutor(executor);
+            }
+        }
+
+        ~Session() {
+            manager->stop();
+        }
+
+        bool tapCard() {
+            QSignalSpy spy(manager.get(), &CommunicationManager::cardInitialized);
+            mock->simulateCardInserted();
+            if (!QTest::qWaitFor([&spy]() { return spy.count() > 0; }, 3000)) {
+                return false;
+            }
+            return spy.takeFirst().at(0).value<CardInitializationResult>().success;
+        }
+    };
+
+    static QThread* mainThread() {
+        return QCoreApplication::instance()->thread();
+    }
+
+private slots:
+    void testDefaultExecutorIsDedicated() {
+        Session session;
+        QCOMPARE(session.manager->executor()->name(), QString("dedicated"));
+
+        QVERIFY(session.manager->init(session.cmdSet));
+        QThread* ioThread = session.manager->thread();
+        QVERIFY(ioThread != mainThread());
+
+        session.manager->stop();
+        QCOMPARE(session.manager->thread(), mainThread());
+
+        // Re-initializing acquires a fresh thread and works as before
+        QVERIFY(session.manager->init(session.cmdSet));
+        session.manager->startDetection();
+        QVERIFY(session.tapCard());
+        QVERIFY(session.manager->executeCommandSync(std::make_unique<SelectCommand>(true), 2000).success);
+    }
+
+    void testSharedExecutorBalancesManagers() {
+        auto executor = std::make_shared<SharedThreadExecutor>(2);
+        {
+            std::vector<std::unique_ptr<Session>> sessions;
+            QSet<QThread*> threads;
+            for (int i = 0; i < 4; ++i) {
+                sessions.push_back(std::make_unique<Session>(executor));
+                QVERIFY(sessions.back()->manager->init(sessions.back()->cmdSet));
+                threads.insert(sessions.back()->manager->thread());
+            }
+
+            QCOMPARE(threads.size(), 2);
+            QVERIFY(!threads.contains(mainThread()));
+            QCOMPARE(executor->managerCount(), 4);
+
+            // Managers sharing a thread still serve their own card
+            for (auto& session : sessions) {
+                session->manager->startDetection();
+                QVERIFY(session->tapCard());
+                QVERIFY(session->manager->executeCommandSync(std::make_unique<SelectCommand>(true), 2000).success);
+            }
+
+            // Stopping one manager leaves the shared thread running for the others
+            sessions.front()->manager->stop();
+            QCOMPARE(executor->managerCount(), 3);
+            QVERIFY(sessions.back()->manager->executeCommandSync(std::make_unique<SelectCommand>(true), 2000).success);
+        }
+        QCOMPARE(executor->managerCount(), 0);
+    }
+
+    void testEventLoopExecutorRunsOnHostThread() {
+        Session session(std::make_shared<EventLoopExecutor>());
+        QVERIFY(session.manager->init(session.cmdSet));
+        QCOMPARE(session.manager->thread(), mainThread());
+
+        session.manager->startDetection();
+        QVERIFY(session.tapCard());
+
+        // Waits by processing this thread's events, which runs the queue
+        CommandResult result = session.manager->executeCommandSync(std::make_unique<SelectCommand>(true), 2000);
+        QVERIFY(result.success);
+
+        session.manager->stop();
+        QCOMPARE(session.manager->thread(), mainThread());
+    }
+
+    void testStopReleasesPendingSyncCaller() {
+        Session session;
+        QVERIFY(session.manager->init(session.cmdSet));
+
+        // No card: the command waits until stop()
+        CommandResult result;
+        CommunicationManager* manager = session.manager.get();
+        QThread* caller = QThread::create([manager, &result]() {
+            result = manager->executeCommandSync(std::make_unique<SelectCommand>(true), 30000);
+        });
+        caller->start();
+        QTest::qWait(100);
+
+        QElapsedTimer timer;
+        timer.start();
+        session.manager->stop();
+        qint64 stopMs = timer.elapsed();
+
+        QVERIFY(caller->wait(2000));
+        delete caller;
+
+        QVERIFY(!result.success);
+        QCOMPARE(result.error, QString("CommunicationManager stopped"));
+        QVERIFY2(stopMs < 1000, qPrintable(QString("stop() took %1 ms").arg(stopMs)));
+    }
+
+    void testStartupAndShutdownLatency() {
+        const int cycles = 20;
+        auto shared = std::make_shared<SharedThreadExecutor>(1);
+        auto dedicated = std::make_shared<DedicatedThreadExecutor>();
+
+        struct Case { const char* name; std::shared_ptr<CommunicationExecutor> executor; };
+        const Case cases[] = {
+            { "dedicated", dedicated },
+            { "shared", shared },
+            { "event-loop", std::make_shared<EventLoopExecutor>() },
+        };
+
+        for (const Case& c : cases) {
+            Session session(c.executor);
+            qint64 initNs = 0;
+            qint64 stopNs = 0;
+
+            for (int i = 0; i < cycles; ++i) {
+                QElapsedTimer timer;
+                timer.start();
+                QVERIFY(session.manager->init(session.cmdSet));
+                session.manager->startDetection();
+                initNs += timer.nsecsElapsed();
+
+                QPointer<QThread> ioThread = session.manager->thread();
+                timer.restart();
+                session.manager->stop();
+                stopNs += timer.nsecsElapsed();
+
+                // Back on the caller's thread with the I/O thread released
+                QCOMPARE(session.manager->thread(), QThread::currentThread());
+                if (c.executor == dedicated) {
+                    QVERIFY(ioThread.isNull());
+                }
+                QCOMPARE(shared->managerCount(), 0);
+            }
+
+            double initMs = initNs / 1e6 / cycles;
+            double stopMs = stopNs / 1e6 / cycles;
+            qInfo().noquote() << QString("%1 executor: init %2 ms, stop %3 ms (mean of %4)")
+                                     .arg(c.name).arg(initMs, 0, 'f', 3).arg(stopMs, 0, 'f', 3).arg(cycles);
+        }
+    }
+};
+
+QTEST_MAIN(TestCommunicationManagerExecutor)
+#include "test_communication_manager_executor.moc"
@@ -0,0 +1,238 @@
+/**
+ * Tests for CommunicationManager speculative prefetch and result cache
+ */
+
+#include <QTest>
+#include <QSignalSpy>
+#include "keycard-qt/communication_manager.h"
+#include "keycard-qt/command_set.h"
+#include "keycard-qt/keycard_channel.h"
+#include "keycard-qt/card_command.h"
+#include "keycard-qt/pairing_storage.h"
+#include "mocks/mock_backend.h"
+#include <memory>
+
+using namespace Keycard;
+using namespace Keycard::Test;
+
+class TestCommunicationManagerPrefetch : public QObject {
+    Q_OBJECT
+
+private:
+    // Every card is already paired, so initialization goes straight to
+    // OPEN SECURE CHANNEL
+    class StaticPairingStorage : public IPairingStorage {
+    public:
+        PairingInfo load(const QString&) override { return PairingInfo(QByteArray(32, 0xAB), 1); }
+        bool save(const QString&, const PairingInfo&) override { return true; }
+        bool remove(const QString&) override { return true; }
+    };
+
+    // secp256k1 generator point: a valid card key, so ECDH succeeds
+    static QByteArray cardPublicKey() {
+        return QByteArray::fromHex(
+            "0479BE667EF9DCBBAC55A06295CE870B07029BFCDB2DCE28D959F2815B16F81798"
+            "483ADA7726A3C4655DA4FBFC0E1108A8FD17B448A68554199C47D08FFB10D4B8");
+    }
+
+    static QByteArray initializedSelectResponse() {
+        QByteArray body = QByteArray::fromHex("8F10") + QByteArray(16, 0x11)
+                        + QByteArray::fromHex("8041") + cardPublicKey()
+                        + QByteArray::fromHex("8E20") + QByteArray(32, 0x22);
+        QByteArray response = QByteArray::fromHex("A4");
+        response.append(static_cast<char>(body.size()));
+        response.append(body);
+        return response + QByteArray::fromHex("9000");
+    }
+
+    int countIns(uint8_t ins) const {
+        int count = 0;
+        for (const QByteArray& apdu : m_mock->getTransmittedApdus()) {
+            if (apdu.size() > 1 && static_cast<uint8_t>(apdu[1]) == ins) {
+                count++;
+            }
+        }
+        return count;
+    }
+
+    /**
+     * @brief Tap an initialized card and wait until the manager is Ready
+     *
+     * MUTUALLY AUTHENTICATE and GET STATUS are answered by the default 9000.
+     * Returns false when the secure channel could not be opened (no OpenSSL).
+     */
+    bool tapInitializedCard() {
+        QSignalSpy spy(m_commMgr.get(), &CommunicationManager::cardInitialized);
+
+        m_mock->queueResponse(initializedSelectResponse());
+        m_mock->queueResponse(QByteArray(48, 0x5A) + QByteArray::fromHex("9000"));  // salt + IV
+        m_mock->simulateCardInserted();
+
+        if (!QTest::qWaitFor([&]() { return spy.count() > 0; }, 3000)) {
+            return false;
+        }
+        if (!spy.takeFirst().at(0).value<CardInitializationResult>().success) {
+            return false;
+        }
+        return QTest::qWaitFor([&]() {
+            return m_commMgr->state() == CommunicationManager::State::Ready;
+        }, 2000);
+    }
+
+    std::shared_ptr<CommandSet> m_cmdSet;
+    std::unique_ptr<CommunicationManager> m_commMgr;
+    MockBackend* m_mock = nullptr;
+
+private slots:
+    void init() {
+        m_mock = new MockBackend();
+        m_mock->setAutoConnect(false);
+        auto channel = std::make_shared<KeycardChannel>(m_mock);
+        m_cmdSet = std::make_shared<CommandSet>(channel, std::make_shared<StaticPairingStorage>(), nullptr);
+        m_commMgr = std::make_unique<CommunicationManager>();
+        m_commMgr->init(m_cmdSet);
+        m_commMgr->startDetection();
+    }
+
+    void cleanup() {
+        if (m_commMgr) {
+            m_commMgr->stop();
+            m_commMgr.reset();
+        }
+        m_cmdSet.reset();
+        m_mock = nullptr;
+    }
+
+    void testResultCacheKeys() {
+        QCOMPARE(GetMetadataCommand().resultCacheKey(), QString("GET_METADATA"));
+        QVERIFY(!ExportKeyExtendedCommand(true, false, "m/44'/60'/0'/0").resultCacheKey().isEmpty());
+        // Changing the current path is a side effect
+        QVERIFY(ExportKeyExtendedCommand(true, true, "m/44'/60'/0'/0").resultCacheKey().isEmpty());
+        QVERIFY(VerifyPINCommand("123456").resultCacheKey().isEmpty());
+    }
+
+    void testPrefetchDisabledByDefault() {
+        QVERIFY(!m_commMgr->prefetchPolicy().isEnabled());
+
+        if (!tapInitializedCard()) {
+            QSKIP("Secure channel unavailable (built without OpenSSL)");
+        }
+        QTest::qWait(200);
+
+        QCOMPARE(countIns(APDU::INS_GET_DATA), 0);
+        QCOMPARE(countIns(APDU::INS_EXPORT_KEY), 0);
+    }
+
+    void testPrefetchRunsOncePerIdleGap() {
+        CommunicationManager::PrefetchPolicy policy;
+        policy.metadata = true;
+        policy.exportPaths << "m/44'/60'/0'/0";
+        m_commMgr->setPrefetchPolicy(policy);
+
+        if (!tapInitializedCard()) {
+            QSKIP("Secure channel unavailable (built without OpenSSL)");
+        }
+
+        QTRY_COMPARE_WITH_TIMEOUT(countIns(APDU::INS_GET_DATA), 1, 2000);
+        QTRY_COMPARE_WITH_TIMEOUT(countIns(APDU::INS_EXPORT_KEY), 1, 2000);
+
+        // Neither returned data: nothing cached, and no retry until the next gap
+        QTest::qWait(200);
+        QCOMPARE(countIns(APDU::INS_GET_DATA), 1);
+        QCOMPARE(countIns(APDU::INS_EXPORT_KEY), 1);
+        QVERIFY(!m_commMgr->hasPrefetchedResult("GET_METADATA"));
+    }
+
+    void testCachedResultServedWithoutCardIo() {
+        if (!tapInitializedCard()) {
+            QSKIP("Secure channel unavailable (built without OpenSSL)");
+        }
+
+        QVariantMap metadata;
+        metadata["tlvData"] = QByteArray::fromHex("2400");
+        m_commMgr->testInjectPrefetchedResult("GET_METADATA", CommandResult::fromSuccess(metadata));
+
+        int transmitsBefore = m_mock->getTransmitCount();
+        CommandResult result = m_commMgr->executeCommandSync(std::make_unique<GetMetadataCommand>(), 1000);
+
+        QVERIFY(result.success);
+        QCOMPARE(result.data.toMap()["tlvData"].toByteArray(), QByteArray::fromHex("2400"));
+        QCOMPARE(m_mock->getTransmitCount(), transmitsBefore);
+    }
+
+    void testAsyncCachedResultKeepsToken() {
+        if (!tapInitializedCard()) {
+            QSKIP("Secure channel unavailable (built without OpenSSL)");
+        }
+
+        m_commMgr->testInjectPrefetchedResult("GET_METADATA", CommandResult::fromSuccess(QVariantMap()));
+        QSignalSpy spy(m_commMgr.get(), &CommunicationManager::commandCompleted);
+
+        QUuid token = m_commMgr->enqueueCommand(std::make_unique<GetMetadataCommand>());
+
+        QTRY_VERIFY_WITH_TIMEOUT(spy.count() > 0, 1000);
+        QCOMPARE(spy.at(0).at(0).value<QUuid>(), token);
+    }
+
+    void testStateChangingCommandDropsMetadata() {
+        if (!tapInitializedCard()) {
+            QSKIP("Secure channel unavailable (built without OpenSSL)");
+        }
+
+        QString exportKey = ExportKeyExtendedCommand(true, false, "m/44'/60'/0'/0").resultCacheKey();
+        m_commMgr->testInjectPrefetchedResult("GET_METADATA", CommandResult::fromSuccess(QVariantMap()));
+        m_commMgr->testInjectPrefetchedResult(exportKey, CommandResult::fromSuccess(QVariantMap()));
+
+        CommandResult result = m_commMgr->executeCommandSync(std::make_unique<VerifyPINCommand>("123456"), 2000);
+        QVERIFY(result.success);
+
+        // Metadata may have been rewritten; the key UID did not change
+        QVERIFY(!m_commMgr->hasPrefetchedResult("GET_METADATA"));
+        QVERIFY(m_commMgr->hasPrefetchedResult(exportKey));
+    }
+
+    void testKeyChangeDropsCachedExports() {
+        if (!tapInitializedCard()) {
+            QSKIP("Secure channel unavailable (built without OpenSSL)");
+        }
+
+        const QString path = "m/44'/60'/0'/0";
+        QVariantMap exported;
+        exported["publicKey"] = QByteArray(65, 0x04);
+        m_commMgr->testInjectPrefetchedResult(ExportKeyExtendedCommand(true, false, path).resultCacheKey(),
+                                              CommandResult::fromSuccess(exported));
+
+        int transmitsBefore = m_mock->getTransmitCount();
+        CommandResult result = m_commMgr->executeCommandSync(
+            std::make_unique<ExportKeyExtendedCommand>(true, false, path), 1000);
+        QCOMPARE(result.data, QVariant(exported));
+        QCOMPARE(m_mock->getTransmitCount(), transmitsBefore);
+
+        // Same card, same session, another key (the mock's bare 9000 reports an empty key UID)
+        m_commMgr->executeCommandSync(std::make_unique<LoadSeedCommand>(QByteArray(64, 0x01)), 2000);
+        QCOMPARE(countIns(APDU::INS_LOAD_KEY), 1);
+        QVERIFY(!m_commMgr->hasPrefetchedResult(ExportKeyExtendedCommand(true, false, path).resultCacheKey()));
+
+        transmitsBefore = m_mock->getTransmitCount();
+        m_commMgr->executeCommandSync(std::make_unique<ExportKeyExtendedCommand>(true, false, path), 1000);
+        QVERIFY(m_mock->getTransmitCount() > transmitsBefore);
+    }
+
+    void testDirectStoreDataDropsMetadata() {
+        if (!tapInitializedCard()) {
+            QSKIP("Secure channel unavailable (built without OpenSSL)");
+        }
+
+        m_commMgr->testInjectPrefetchedResult("GET_METADATA", CommandResult::fromSuccess(QVariantMap()));
+
+        // Other slots do not hold the metadata
+        m_commMgr->storeDataToCard(APDU::P1StoreDataNDEF, QByteArray::fromHex("0000"));
+        QVERIFY(m_commMgr->hasPrefetchedResult("GET_METADATA"));
+
+        m_commMgr->storeDataToCard(APDU::P1StoreDataPublic, QByteArray::fromHex("2400"));
+        QVERIFY(!m_commMgr->hasPrefetchedResult("GET_METADATA"));
+    }
+};
+
+QTEST_MAIN(TestCommunicationManagerPrefetch)
+#include "test_communication_manager_prefetch.moc"
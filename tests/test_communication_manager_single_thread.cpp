@@ -0,0 +1,123 @@
+/**
+ * Tests for CommunicationManager single I/O thread ownership mode
+ */
+
+#include <QTest>
+#include <QSignalSpy>
+#include "keycard-qt/communication_manager.h"
+#include "keycard-qt/command_set.h"
+#include "keycard-qt/keycard_channel.h"
+#include "mocks/mock_backend.h"
+#include <atomic>
+#include <memory>
+
+using namespace Keycard;
+using namespace Keycard::Test;
+
+class TestCommunicationManagerSingleThread : public QObject {
+    Q_OBJECT
+
+private:
+    static QByteArray preInitializedSelectResponse() {
+        return QByteArray::fromHex("8041")
+             + QByteArray::fromHex(
+                   "0479BE667EF9DCBBAC55A06295CE870B07029BFCDB2DCE28D959F2815B16F81798"
+                   "483ADA7726A3C4655DA4FBFC0E1108A8FD17B448A68554199C47D08FFB10D4B8")
+             + QByteArray::fromHex("9000");
+    }
+
+    // The mock lives on the I/O thread: drive it from there
+    void insertCard() {
+        MockBackend* mock = m_mock;
+        QMetaObject::invokeMethod(mock, [mock]() {
+            mock->simulateCardInserted();
+        }, Qt::BlockingQueuedConnection);
+    }
+
+    std::shared_ptr<CommandSet> m_cmdSet;
+    std::unique_ptr<CommunicationManager> m_commMgr;
+    MockBackend* m_mock = nullptr;
+
+private slots:
+    void init() {
+        m_mock = new MockBackend();
+        m_mock->setAutoConnect(false);
+        auto channel = std::make_shared<KeycardChannel>(m_mock);
+        m_cmdSet = std::make_shared<CommandSet>(channel, nullptr, nullptr);
+        m_commMgr = std::make_unique<CommunicationManager>();
+    }
+
+    void cleanup() {
+        if (m_commMgr) {
+            m_commMgr->stop();
+            m_commMgr.reset();
+        }
+        m_cmdSet.reset();
+        m_mock = nullptr;
+    }
+
+    void testDefaultKeepsCommandSetOnMainThread() {
+        QVERIFY(m_commMgr->init(m_cmdSet));
+
+        QCOMPARE(m_commMgr->threadOwnership(), CommunicationManager::ThreadOwnership::SplitThreads);
+        QCOMPARE(m_cmdSet->thread(), QCoreApplication::instance()->thread());
+    }
+
+    void testCardObjectsMoveToIoThread() {
+        QVERIFY(m_commMgr->init(m_cmdSet, CommunicationManager::ThreadOwnership::SingleIoThread));
+
+        QCOMPARE(m_commMgr->threadOwnership(), CommunicationManager::ThreadOwnership::SingleIoThread);
+        QThread* ioThread = m_commMgr->thread();
+        QVERIFY(ioThread != QCoreApplication::instance()->thread());
+        QCOMPARE(m_cmdSet->thread(), ioThread);
+        QCOMPARE(m_cmdSet->channel()->thread(), ioThread);
+        QCOMPARE(m_mock->thread(), ioThread);
+
+        // stop() hands them back
+        m_commMgr->stop();
+        QCOMPARE(m_cmdSet->thread(), QCoreApplication::instance()->thread());
+        QCOMPARE(m_mock->thread(), QCoreApplication::instance()->thread());
+    }
+
+    void testApdusAndDetectionStayOnIoThread() {
+        std::atomic<QThread*> transmitThread{nullptr};
+        m_mock->setResponseHandler([&transmitThread](const QByteArray&) {
+            transmitThread = QThread::currentThread();
+            return preInitializedSelectResponse();
+        });
+
+        QVERIFY(m_commMgr->init(m_cmdSet, CommunicationManager::ThreadOwnership::SingleIoThread));
+        QSignalSpy initSpy(m_commMgr.get(), &CommunicationManager::cardInitialized);
+        m_commMgr->startDetection();
+
+        insertCard();
+
+        QTRY_VERIFY_WITH_TIMEOUT(initSpy.count() > 0, 3000);
+        QVERIFY(initSpy.takeFirst().at(0).value<CardInitializationResult>().success);
+
+        // A command issued from the main thread still runs on the I/O thread,
+        // and its result comes back here
+        QSignalSpy completedSpy(m_commMgr.get(), &CommunicationManager::commandCompleted);
+        CommandResult result = m_commMgr->executeCommandSync(std::make_unique<SelectCommand>(true), 2000);
+        QVERIFY(result.success);
+        QCOMPARE(transmitThread.load(), m_commMgr->thread());
+        QVERIFY(completedSpy.count() > 0);
+    }
+
+    void testFallsBackWhenCommandSetHasParent() {
+        QObject owner;
+        auto channel = std::make_shared<KeycardChannel>(new MockBackend());
+        auto cmdSet = std::make_shared<CommandSet>(channel, nullptr, nullptr, &owner);
+
+        CommunicationManager manager;
+        QVERIFY(manager.init(cmdSet, CommunicationManager::ThreadOwnership::SingleIoThread));
+        QCOMPARE(manager.threadOwnership(), CommunicationManager::ThreadOwnership::SplitThreads);
+        QCOMPARE(cmdSet->thread(), QCoreApplication::instance()->thread());
+
+        manager.stop();
+        cmdSet.reset();
+    }
+};
+
+QTEST_MAIN(TestCommunicationManagerSingleThread)
+#include "test_communication_manager_single_thread.moc"
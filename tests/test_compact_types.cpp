@@ -0,0 +1,162 @@
+/**
+ * Unit tests for compact (trivially copyable) card types and SeqLock
+ */
+
+#include <QTest>
+#include "keycard-qt/compact_types.h"
+#include "keycard-qt/seqlock.h"
+#include <atomic>
+#include <thread>
+#include <vector>
+
+using namespace Keycard;
+
+class TestCompactTypes : public QObject {
+    Q_OBJECT
+
+private slots:
+    void testTriviallyCopyable() {
+        QVERIFY(std::is_trivially_copyable<CompactApplicationInfo>::value);
+        QVERIFY(std::is_trivially_copyable<CompactApplicationStatus>::value);
+        QVERIFY(std::is_trivially_copyable<CompactPairingInfo>::value);
+    }
+
+    void testApplicationInfoRoundTrip() {
+        ApplicationInfo info;
+        info.instanceUID = QByteArray(16, 0x11);
+        info.secureChannelPublicKey = QByteArray(65, 0x04);
+        info.keyUID = QByteArray(32, 0x22);
+        info.appVersion = 3;
+        info.appVersionMinor = 1;
+        info.availableSlots = 5;
+        info.capabilities = 0x1F;
+        info.installed = true;
+        info.initialized = true;
+
+        CompactApplicationInfo compact = CompactApplicationInfo::fromApplicationInfo(info);
+        QCOMPARE(compact.instanceUID.view(), info.instanceUID);
+        QVERIFY(compact.hasCapability(Capability::FactoryReset));
+
+        ApplicationInfo restored = compact.toApplicationInfo();
+        QCOMPARE(restored.instanceUID, info.instanceUID);
+        QCOMPARE(restored.secureChannelPublicKey, info.secureChannelPublicKey);
+        QCOMPARE(restored.keyUID, info.keyUID);
+        QCOMPARE(restored.appVersion, info.appVersion);
+        QCOMPARE(restored.appVersionMinor, info.appVersionMinor);
+        QCOMPARE(restored.availableSlots, info.availableSlots);
+        QCOMPARE(restored.capabilities, info.capabilities);
+        QCOMPARE(restored.installed, info.installed);
+        QCOMPARE(restored.initialized, info.initialized);
+    }
+
+    void testDefaultsMatchQtTypes() {
+        ApplicationInfo info = CompactApplicationInfo().toApplicationInfo();
+        ApplicationInfo reference;
+        QCOMPARE(info.capabilities, reference.capabilities);
+        QVERIFY(info.instanceUID.isEmpty());
+        QVERIFY(!info.installed);
+
+        QVERIFY(!CompactPairingInfo().isValid());
+        QCOMPARE(CompactPairingInfo().toPairingInfo().index, PairingInfo().index);
+    }
+
+    void testApplicationStatusRoundTrip() {
+        ApplicationStatus status;
+        status.pinRetryCount = 3;
+        status.pukRetryCount = 5;
+        status.keyInitialized = true;
+        status.valid = true;
+        status.currentPath = QByteArray::fromHex("8000002c8000003c800000000000000000000000");
+
+        ApplicationStatus restored = CompactApplicationStatus::fromApplicationStatus(status).toApplicationStatus();
+        QCOMPARE(restored.pinRetryCount, status.pinRetryCount);
+        QCOMPARE(restored.pukRetryCount, status.pukRetryCount);
+        QCOMPARE(restored.keyInitialized, status.keyInitialized);
+        QCOMPARE(restored.valid, status.valid);
+        QCOMPARE(restored.currentPath, status.currentPath);
+    }
+
+    void testPairingInfoRoundTrip() {
+        PairingInfo pairing(QByteArray(32, 0x5A), 2);
+        CompactPairingInfo compact = CompactPairingInfo::fromPairingInfo(pairing);
+        QVERIFY(compact.isValid());
+
+        PairingInfo restored = compact.toPairingInfo();
+        QCOMPARE(restored.key, pairing.key);
+        QCOMPARE(restored.index, pairing.index);
+    }
+
+    void testInlineBytesTruncation() {
+        InlineBytes<4> bytes;
+        QVERIFY(bytes.isEmpty());
+        QVERIFY(bytes.assign(QByteArray::fromHex("0102")));
+        QCOMPARE(bytes.size(), 2);
+        QVERIFY(!bytes.assign(QByteArray::fromHex("0102030405")));
+        QCOMPARE(bytes.toByteArray(), QByteArray::fromHex("01020304"));
+
+        // Shorter assignment must not leave stale bytes behind
+        QVERIFY(bytes.assign(QByteArray::fromHex("09")));
+        InlineBytes<4> other;
+        other.assign(QByteArray::fromHex("09"));
+        QVERIFY(bytes == other);
+    }
+
+    void testSeqLockSingleThread() {
+        SeqLock<CompactPairingInfo> lock;
+        QVERIFY(!lock.load().isValid());
+        QCOMPARE(lock.version(), static_cast<uint64_t>(0));
+
+        lock.store(CompactPairingInfo::fromPairingInfo(PairingInfo(QByteArray(32, 0x01), 1)));
+        QCOMPARE(lock.load().index, 1);
+        QCOMPARE(lock.version(), static_cast<uint64_t>(1));
+    }
+
+    void testSeqLockConcurrentReadsAreConsistent() {
+        // Writer publishes values whose fields all derive from one counter;
+        // readers must never observe a mix of two writes.
+        SeqLock<CompactApplicationInfo> lock;
+        std::atomic<bool> done{false};
+        std::atomic<int> torn{0};
+
+        std::thread writer([&]() {
+            for (int n = 0; n < 20000; ++n) {
+                char marker = static_cast<char>(n & 0x7F);
+                ApplicationInfo info;
+                info.instanceUID = QByteArray(16, marker);
+                info.keyUID = QByteArray(32, marker);
+                info.appVersion = static_cast<uint8_t>(marker);
+                lock.store(CompactApplicationInfo::fromApplicationInfo(info));
+            }
+            done = true;
+        });
+
+        std::vector<std::thread> readers;
+        for (int r = 0; r < 4; ++r) {
+            readers.emplace_back([&]() {
+                while (!done) {
+                    CompactApplicationInfo info = lock.load();
+                    if (info.instanceUID.isEmpty()) {
+                        continue;
+                    }
+                    uint8_t marker = info.instanceUID.bytes[0];
+                    if (info.instanceUID.bytes[15] != marker
+                        || info.keyUID.bytes[31] != marker
+                        || info.appVersion != marker) {
+                        torn++;
+                    }
+                }
+            });
+        }
+
+        writer.join();
+        for (auto& reader : readers) {
+            reader.join();
+        }
+
+        QCOMPARE(torn.load(), 0);
+        QCOMPARE(lock.version(), static_cast<uint64_t>(20000));
+    }
+};
+
+QTEST_MAIN(TestCompactTypes)
+#include "test_compact_types.moc"
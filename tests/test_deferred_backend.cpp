@@ -0,0 +1,136 @@
+/**
+ * Tests for deferred backend construction (KeycardChannel::BackendFactory)
+ */
+
+#include <QTest>
+#include <QSignalSpy>
+#include "keycard-qt/keycard_channel.h"
+#include "keycard-qt/command_set.h"
+#include "keycard-qt/communication_manager.h"
+#include "keycard-qt/card_command.h"
+#include "mocks/mock_backend.h"
+#include <memory>
+
+using namespace Keycard;
+using namespace Keycard::Test;
+
+class TestDeferredBackend : public QObject {
+    Q_OBJECT
+
+private:
+    MockBackend* m_mock = nullptr;
+    int m_factoryCalls = 0;
+
+    std::shared_ptr<KeycardChannel> createDeferredChannel(bool backendReady = true) {
+        return std::make_shared<KeycardChannel>(KeycardChannel::BackendFactory([this, backendReady]() {
+            ++m_factoryCalls;
+            m_mock = new MockBackend();
+            m_mock->setAutoConnect(false);
+            m_mock->setReady(backendReady);
+            return m_mock;
+        }));
+    }
+
+private slots:
+    void init() {
+        m_mock = nullptr;
+        m_factoryCalls = 0;
+    }
+
+    void testFactoryRunsOnFirstEventLoopPass() {
+        auto channel = createDeferredChannel();
+        QSignalSpy ready(channel.get(), &KeycardChannel::backendReady);
+
+        QCOMPARE(m_factoryCalls, 0);
+        QVERIFY(!channel->backend());
+        QVERIFY(!channel->isBackendReady());
+        QVERIFY(!channel->isConnected());
+
+        QTRY_COMPARE_WITH_TIMEOUT(ready.count(), 1, 2000);
+        QCOMPARE(m_factoryCalls, 1);
+        QCOMPARE(channel->backend(), m_mock);
+        QCOMPARE(m_mock->parent(), channel.get());
+        QVERIFY(channel->isBackendReady());
+    }
+
+    void testInjectedBackendIsReadyImmediately() {
+        auto channel = std::make_shared<KeycardChannel>(new MockBackend());
+        QVERIFY(channel->isBackendReady());
+    }
+
+    void testRequestsBeforeCreationAreApplied() {
+        auto channel = createDeferredChannel();
+        channel->setState(ChannelState::WaitingForCard);
+        channel->startDetection();
+        QCOMPARE(channel->state(), ChannelState::WaitingForCard);
+
+        QTRY_VERIFY_WITH_TIMEOUT(channel->isBackendReady(), 2000);
+        QVERIFY(m_mock->isDetecting());
+        QCOMPARE(m_mock->state(), ChannelState::WaitingForCard);
+        // The mock inserts its card when a card is awaited
+        QVERIFY(channel->isTargetPresent());
+    }
+
+    void testStopDetectionCancelsRequest() {
+        auto channel = createDeferredChannel();
+        channel->startDetection();
+        channel->stopDetection();
+
+        QTRY_VERIFY_WITH_TIMEOUT(channel->isBackendReady(), 2000);
+        QVERIFY(!m_mock->isDetecting());
+    }
+
+    void testBackendStartupCompletesLater() {
+        auto channel = createDeferredChannel(false);
+        QSignalSpy ready(channel.get(), &KeycardChannel::backendReady);
+
+        QTRY_VERIFY_WITH_TIMEOUT(channel->backend(), 2000);
+        QVERIFY(!channel->isBackendReady());
+        QVERIFY(!channel->isConnected());
+        QCOMPARE(ready.count(), 0);
+
+        m_mock->setReady(true);
+        QCOMPARE(ready.count(), 1);
+        QVERIFY(channel->isBackendReady());
+    }
+
+    void testWaitForTargetCreatesBackend() {
+        auto channel = createDeferredChannel();
+        const KeycardChannel::PresenceMark mark = channel->presenceMark();
+
+        // The queued creation cannot run while waitForTarget() blocks
+        KeycardChannel::WaitResult result = channel->waitForTarget(mark, 50);
+
+        QCOMPARE(m_factoryCalls, 1);
+        QVERIFY(channel->isBackendReady());
+        QCOMPARE(result, KeycardChannel::WaitResult::Timeout);
+
+        // The queued call finds the backend already there
+        QTest::qWait(10);
+        QCOMPARE(m_factoryCalls, 1);
+    }
+
+    void testCommandQueuedUntilBackendAndCard() {
+        auto channel = createDeferredChannel();
+        auto cmdSet = std::make_shared<CommandSet>(channel, nullptr, nullptr);
+        CommunicationManager commMgr;
+        QVERIFY(commMgr.init(cmdSet));
+        QSignalSpy completed(&commMgr, &CommunicationManager::commandCompleted);
+
+        // Submitted before the backend exists
+        commMgr.startDetection();
+        commMgr.enqueueCommand(std::make_unique<SelectCommand>());
+        QTRY_VERIFY_WITH_TIMEOUT(channel->isBackendReady(), 2000);
+        QCOMPARE(completed.count(), 0);
+
+        m_mock->queueResponse(QByteArray::fromHex("8041") + QByteArray(65, 0x04) + QByteArray::fromHex("9000"));
+        m_mock->queueResponse(QByteArray::fromHex("8041") + QByteArray(65, 0x04) + QByteArray::fromHex("9000"));
+        m_mock->simulateCardInserted();
+
+        QTRY_VERIFY_WITH_TIMEOUT(completed.count() > 0, 5000);
+        commMgr.stop();
+    }
+};
+
+QTEST_MAIN(TestDeferredBackend)
+#include "test_deferred_backend.moc"
@@ -0,0 +1,118 @@
+/**
+ * Tests for EcdhSecretCache (its use by CommandSet is in test_lazy_ecdh)
+ */
+
+#include <QTest>
+#include "keycard-qt/ecdh_secret_cache.h"
+#include "keycard-qt/metrics.h"
+#include <memory>
+
+using namespace Keycard;
+
+namespace {
+
+// secp256k1 generator point, so ECDH succeeds
+const QByteArray CARD_KEY = QByteArray::fromHex(
+    "0479BE667EF9DCBBAC55A06295CE870B07029BFCDB2DCE28D959F2815B16F81798"
+    "483ADA7726A3C4655DA4FBFC0E1108A8FD17B448A68554199C47D08FFB10D4B8");
+
+// 2G, a different valid key
+const QByteArray OTHER_CARD_KEY = QByteArray::fromHex(
+    "04C6047F9441ED7D6D3045406E95C07CD85C778E4B8CEF3CA7ABAC09B95C709EE5"
+    "1AE168FEA63DC339A3C58419466CEAEEF7F632653266D0E1236431A950CFE52A");
+
+const QByteArray INSTANCE_UID(16, 0x11);
+
+} // namespace
+
+class TestEcdhSecretCache : public QObject {
+    Q_OBJECT
+
+private slots:
+    void initTestCase() {
+        if (!SecureChannel::deriveSecret(CARD_KEY).isValid()) {
+            QSKIP("Built without OpenSSL");
+        }
+    }
+
+    void init() {
+        Metrics::reset();
+    }
+
+    void testDeriveSecret() {
+        const SecureChannel::EcdhSecret first = SecureChannel::deriveSecret(CARD_KEY);
+        const SecureChannel::EcdhSecret second = SecureChannel::deriveSecret(CARD_KEY);
+
+        QCOMPARE(first.cardPublicKey, CARD_KEY);
+        QCOMPARE(first.publicKey.size(), 65);
+        QCOMPARE(first.secret.size(), 32);
+        // A fresh ephemeral key every time
+        QVERIFY(first.publicKey != second.publicKey);
+        QVERIFY(first.secret != second.secret);
+
+        QVERIFY(!SecureChannel::deriveSecret(QByteArray(65, 0x04)).isValid());
+    }
+
+    void testPreparedSecretIsTakenOnce() {
+        auto cache = std::make_shared<EcdhSecretCache>();
+        SecureChannel::EcdhSecret secret;
+        QVERIFY(!cache->take(INSTANCE_UID, CARD_KEY, secret));
+
+        cache->prepare(INSTANCE_UID, CARD_KEY);
+        QTRY_VERIFY_WITH_TIMEOUT(cache->isPrepared(INSTANCE_UID, CARD_KEY), 5000);
+
+        QVERIFY(cache->take(INSTANCE_UID, CARD_KEY, secret));
+        QVERIFY(secret.isValid());
+        QCOMPARE(secret.cardPublicKey, CARD_KEY);
+        QVERIFY(!cache->take(INSTANCE_UID, CARD_KEY, secret));
+        QCOMPARE(Metrics::counter("ecdh_cache.hit"), quint64(1));
+        QCOMPARE(Metrics::counter("ecdh_cache.miss"), quint64(2));
+    }
+
+    void testTakeWaitsForRunningDerivation() {
+        auto cache = std::make_shared<EcdhSecretCache>();
+        cache->prepare(INSTANCE_UID, CARD_KEY);
+
+        SecureChannel::EcdhSecret secret;
+        QVERIFY(cache->take(INSTANCE_UID, CARD_KEY, secret, 5000));
+        QVERIFY(secret.isValid());
+    }
+
+    void testChangedKeyInvalidatesEntry() {
+        auto cache = std::make_shared<EcdhSecretCache>();
+        cache->prepare(INSTANCE_UID, CARD_KEY);
+        QTRY_VERIFY_WITH_TIMEOUT(cache->isPrepared(INSTANCE_UID, CARD_KEY), 5000);
+
+        SecureChannel::EcdhSecret secret;
+        QVERIFY(!cache->take(INSTANCE_UID, OTHER_CARD_KEY, secret));
+        QCOMPARE(cache->size(), 0);
+        QCOMPARE(Metrics::counter("ecdh_cache.invalidated"), quint64(1));
+
+        // A derivation for the old key does not land on the new one
+        cache->prepare(INSTANCE_UID, CARD_KEY);
+        cache->prepare(INSTANCE_UID, OTHER_CARD_KEY);
+        QTRY_VERIFY_WITH_TIMEOUT(cache->isPrepared(INSTANCE_UID, OTHER_CARD_KEY), 5000);
+        QVERIFY(cache->take(INSTANCE_UID, OTHER_CARD_KEY, secret));
+        QCOMPARE(secret.cardPublicKey, OTHER_CARD_KEY);
+    }
+
+    void testLeastRecentlyUsedCardIsEvicted() {
+        auto cache = std::make_shared<EcdhSecretCache>(2);
+        const QByteArray first(16, 0x01);
+        const QByteArray second(16, 0x02);
+        const QByteArray third(16, 0x03);
+
+        cache->prepare(first, CARD_KEY);
+        cache->prepare(second, CARD_KEY);
+        SecureChannel::EcdhSecret secret;
+        cache->take(first, CARD_KEY, secret);  // Seen again: second is now the oldest
+        cache->prepare(third, CARD_KEY);
+
+        QCOMPARE(cache->size(), 2);
+        QTRY_VERIFY_WITH_TIMEOUT(cache->isPrepared(third, CARD_KEY), 5000);
+        QVERIFY(!cache->isPrepared(second, CARD_KEY));
+    }
+};
+
+QTEST_MAIN(TestEcdhSecretCache)
+#include "test_ecdh_secret_cache.moc"
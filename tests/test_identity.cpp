@@ -0,0 +1,176 @@
+/**
+ * Tests for IDENTIFY response parsing and IdentityVerifier
+ *
+ * Vectors were generated with a reference secp256k1 implementation: a test
+ * CA signed SHA-256 of two card identity keys, and each card signed its
+ * challenge.
+ */
+
+#include <QTest>
+#include "keycard-qt/identity.h"
+
+using namespace Keycard;
+
+namespace {
+
+const QByteArray CA_KEY = QByteArray::fromHex(
+    "03f177426fbef7322cd0a509178205c30b5a328c9ac48b4d3c3ca5d52d741f5ca2");
+const QByteArray CA_KEY_UNCOMPRESSED = QByteArray::fromHex(
+    "04f177426fbef7322cd0a509178205c30b5a328c9ac48b4d3c3ca5d52d741f5ca2"
+    "376cf48d7e4ebbc1f8cdf52d4fce961c7f265e86e1bcdaae0a6e8d0ea55793af");
+const QByteArray OTHER_CA_KEY = QByteArray::fromHex(
+    "039a1402bb92908fe5d537fc85be2f0551fd51e2cbee33cd1b426803c82ddc1995");
+
+const QByteArray CARD1_KEY = QByteArray::fromHex(
+    "03c1dd9cafddedf7140284ba8d55eec73cfa193f2831c476435f51ae2bb4de853b");
+const QByteArray CARD1_CHALLENGE = QByteArray::fromHex(
+    "f9d05e0e8bf7ff2b9b816f9b6981f687fcbeb005b964ca628fd50a81f1b6bd09");
+const QByteArray CARD1_RESPONSE = QByteArray::fromHex(
+    "a081aa8a6203c1dd9cafddedf7140284ba8d55eec73cfa193f2831c476435f51ae2bb4de853be281538c"
+    "d5b21d27061ef7d1c09a56dff9a4040ba3263c7d016a2730cc1174d27feaed9dad8a85a11e8f022f6e2d"
+    "aaac70a80b1cfd667aaeac40e5e26ef4c2f1003044022043240334bc39aac30b63faaac584d78652a202"
+    "0dc8cdf81632fa4ac487c48dec022041dfadb5e38360b5f9c40e2918f90e8ba4b433ea144e85141ec429"
+    "5526051672");
+
+const QByteArray CARD2_CHALLENGE = QByteArray::fromHex(
+    "3a9db74d83525ce2d4e810430a00f623e7d79b57061cc561a7852d95847688ce");
+const QByteArray CARD2_RESPONSE = QByteArray::fromHex(
+    "a081aa8a62020eb97d08c51d259d17c629b13405ad9a4dda7a2a297b6c74838f556357dbf1cb32d9ba6b"
+    "13916b4f956532652b2f35fa68d7ed88fe9b5f4c1f07e63cd04899501f2f993cf0c6b187906dcdcd1d61"
+    "f61d71cf276fd548b2c5daf3ab08185d1ece0130440220180a51f1b9d69dde1887d79eb473ae57dfae1a"
+    "2bc88b019f3b3b39627a54d2ba0220110717c871a448deef74bb56321c6c8795311d8d63e9d6f1c90c26"
+    "c9209a6a9a");
+
+IdentityVerifier::Request request(const QByteArray& uid, const QByteArray& challenge, const QByteArray& response) {
+    IdentityVerifier::Request r;
+    r.instanceUID = uid;
+    r.challenge = challenge;
+    r.response = response;
+    return r;
+}
+
+} // namespace
+
+class TestIdentity : public QObject {
+    Q_OBJECT
+
+private slots:
+    void testParse() {
+        const IdentityCertificate identity = IdentityCertificate::parse(CARD1_RESPONSE);
+        QVERIFY(identity.isValid());
+        QCOMPARE(identity.certificate.size(), 98);
+        QCOMPARE(identity.cardPublicKey, CARD1_KEY);
+        QCOMPARE(identity.caSignature.size(), 64);
+        QCOMPARE(static_cast<uint8_t>(identity.signature[0]), static_cast<uint8_t>(0x30));
+
+        QVERIFY(!IdentityCertificate::parse(QByteArray()).isValid());
+        QVERIFY(!IdentityCertificate::parse(CARD1_RESPONSE.left(60)).isValid());
+    }
+
+    void testVerify() {
+        if (!IdentityVerifier::isAvailable()) {
+            QSKIP("Built without OpenSSL");
+        }
+
+        IdentityVerifier verifier({OTHER_CA_KEY, CA_KEY_UNCOMPRESSED});
+        QCOMPARE(verifier.caKeyCount(), 2);
+
+        const IdentityVerifier::Result result = verifier.verify(request("card-1", CARD1_CHALLENGE, CARD1_RESPONSE));
+        QVERIFY(result.isVerified());
+        QCOMPARE(result.caIndex, 1);
+        QCOMPARE(result.cardPublicKey, CARD1_KEY);
+        QVERIFY(!result.cached);
+    }
+
+    void testRejects() {
+        if (!IdentityVerifier::isAvailable()) {
+            QSKIP("Built without OpenSSL");
+        }
+
+        IdentityVerifier untrusted({OTHER_CA_KEY});
+        QCOMPARE(untrusted.verify(request("card-1", CARD1_CHALLENGE, CARD1_RESPONSE)).status,
+                 IdentityVerifier::Status::UntrustedCertificate);
+
+        IdentityVerifier verifier({CA_KEY});
+        // Card 1's signature presented for card 2's challenge: a replay
+        QCOMPARE(verifier.verify(request("card-1", CARD2_CHALLENGE, CARD1_RESPONSE)).status,
+                 IdentityVerifier::Status::InvalidSignature);
+        QCOMPARE(verifier.verify(request("card-1", CARD1_CHALLENGE.left(16), CARD1_RESPONSE)).status,
+                 IdentityVerifier::Status::Malformed);
+        QCOMPARE(verifier.verify(request("card-1", CARD1_CHALLENGE, QByteArray::fromHex("6985"))).status,
+                 IdentityVerifier::Status::Malformed);
+
+        // Failures are not remembered
+        QCOMPARE(verifier.cachedCount(), 0);
+
+        QVERIFY(!verifier.addCaPublicKey(QByteArray(33, 0x02)));
+    }
+
+    void testCache() {
+        if (!IdentityVerifier::isAvailable()) {
+            QSKIP("Built without OpenSSL");
+        }
+
+        IdentityVerifier verifier({CA_KEY});
+        QVERIFY(!verifier.verify(request("card-1", CARD1_CHALLENGE, CARD1_RESPONSE)).cached);
+        QCOMPARE(verifier.cachedCount(), 1);
+
+        const IdentityVerifier::Result repeat = verifier.verify(request("card-1", CARD1_CHALLENGE, CARD1_RESPONSE));
+        QVERIFY(repeat.isVerified());
+        QVERIFY(repeat.cached);
+        QCOMPARE(repeat.caIndex, 0);
+
+        // A cached card still has to sign the challenge
+        QCOMPARE(verifier.verify(request("card-1", CARD2_CHALLENGE, CARD1_RESPONSE)).status,
+                 IdentityVerifier::Status::InvalidSignature);
+
+        // Another certificate under a known UID is checked in full
+        const IdentityVerifier::Result swapped = verifier.verify(request("card-1", CARD2_CHALLENGE, CARD2_RESPONSE));
+        QVERIFY(swapped.isVerified());
+        QVERIFY(!swapped.cached);
+
+        verifier.clearCache();
+        QCOMPARE(verifier.cachedCount(), 0);
+    }
+
+    void testBatch() {
+        if (!IdentityVerifier::isAvailable()) {
+            QSKIP("Built without OpenSSL");
+        }
+
+        IdentityVerifier verifier({CA_KEY});
+        QVector<IdentityVerifier::Request> requests;
+        for (int i = 0; i < 64; ++i) {
+            const QByteArray uid = QByteArray::number(i);
+            if (i % 8 == 7) {
+                requests.append(request(uid, CARD2_CHALLENGE, CARD1_RESPONSE));
+            } else if (i % 2) {
+                requests.append(request(uid, CARD2_CHALLENGE, CARD2_RESPONSE));
+            } else {
+                requests.append(request(uid, CARD1_CHALLENGE, CARD1_RESPONSE));
+            }
+        }
+
+        const QVector<IdentityVerifier::Result> results = verifier.verifyBatch(requests, 4);
+        QCOMPARE(results.size(), requests.size());
+        for (int i = 0; i < results.size(); ++i) {
+            if (i % 8 == 7) {
+                QCOMPARE(results[i].status, IdentityVerifier::Status::InvalidSignature);
+            } else {
+                QVERIFY(results[i].isVerified());
+            }
+        }
+        QCOMPARE(verifier.cachedCount(), 56);
+
+        // Second pass over the same cards: every certificate check is skipped
+        const QVector<IdentityVerifier::Result> again = verifier.verifyBatch(requests);
+        for (int i = 0; i < again.size(); ++i) {
+            QCOMPARE(again[i].cached, i % 8 != 7);
+        }
+
+        QVERIFY(verifier.verifyBatch({}).isEmpty());
+    }
+};
+
+QTEST_MAIN(TestIdentity)
+#include "test_identity.moc"
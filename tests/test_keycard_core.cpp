@@ -0,0 +1,271 @@
+/**
+ * Tests for keycard-core, the Qt-free protocol engine, and for the Qt
+ * classes that now delegate to it
+ *
+ * The secure channel tests play the card with a second Core::SecureSession
+ * holding the same keys, so SecureChannel is checked end to end without a
+ * real card. SCP02 vectors were computed with the openssl command line tool.
+ */
+
+#include <QTest>
+#include "keycard-qt/apdu/command.h"
+#include "keycard-qt/apdu/response.h"
+#include "keycard-qt/channel_interface.h"
+#include "keycard-qt/globalplatform/gp_crypto.h"
+#include "keycard-qt/secure_channel.h"
+#include "keycard-qt/tlv_utils.h"
+#include "keycard-core/apdu.h"
+#include "keycard-core/derivation_path.h"
+#include "keycard-core/scp02_crypto.h"
+#include "keycard-core/secure_session.h"
+#include "keycard-core/tlv.h"
+#include <algorithm>
+#include <stdexcept>
+
+using namespace Keycard;
+
+namespace {
+
+Core::ByteView view(const QByteArray& data) {
+    return Core::ByteView(data.constData(), static_cast<size_t>(data.size()));
+}
+
+QByteArray toByteArray(Core::ByteView bytes) {
+    return QByteArray(reinterpret_cast<const char*>(bytes.data()), static_cast<int>(bytes.size()));
+}
+
+/**
+ * Card side of the secure channel: checks the command MAC, decrypts the
+ * data and answers with an encrypted, MACed response
+ */
+class CardChannel : public IChannel {
+public:
+    Core::SecureSession card;
+    QByteArray lastPlainData;
+    QByteArray reply = QByteArray::fromHex("01029000");
+    bool failTransmit = false;
+    bool corruptMac = false;
+
+    QByteArray transmit(const QByteArray& apdu) override {
+        if (failTransmit) {
+            throw std::runtime_error("Card removed");
+        }
+
+        const Core::ByteView raw = view(apdu);
+        const Core::ByteView data = raw.sub(5, raw[4]);
+        Core::SecureSession::Block meta{};
+        std::copy_n(raw.begin(), 4, meta.begin());
+        meta[4] = raw[4];
+
+        Core::SecureSession::Block commandMac;
+        if (!card.mac(meta, data.sub(16), commandMac) || Core::ByteView(commandMac) != data.first(16)) {
+            return QByteArray::fromHex("6982");
+        }
+        Core::Bytes plain;
+        card.decrypt(data.sub(16), plain);
+        lastPlainData = toByteArray(plain);
+        card.setIv(commandMac);
+
+        Core::Bytes encrypted;
+        card.encrypt(view(reply), encrypted);
+        Core::SecureSession::Block responseMeta{};
+        responseMeta[0] = static_cast<uint8_t>(16 + encrypted.size());
+        Core::SecureSession::Block responseMac;
+        card.mac(responseMeta, encrypted, responseMac);
+        card.setIv(responseMac);
+
+        QByteArray response = toByteArray(responseMac) + toByteArray(encrypted) + QByteArray::fromHex("9000");
+        if (corruptMac) {
+            response[0] = static_cast<char>(response[0] ^ 0x01);
+        }
+        return response;
+    }
+
+    bool isConnected() const override { return true; }
+};
+
+} // namespace
+
+class TestKeycardCore : public QObject {
+    Q_OBJECT
+
+private:
+    const QByteArray m_iv = QByteArray(16, 0x11);
+    const QByteArray m_encKey = QByteArray(32, 0x22);
+    const QByteArray m_macKey = QByteArray(32, 0x33);
+
+private slots:
+    void testApduSerialization() {
+        // Header only, Le only (Lc 0 still written, as before), empty data and data + Le
+        APDU::Command select(0x00, 0xA4, 0x04, 0x00);
+        QCOMPARE(select.serialize(), QByteArray::fromHex("00a40400"));
+
+        APDU::Command withLe(0x80, 0xF2, 0x00, 0x00);
+        withLe.setLe(0);
+        QCOMPARE(withLe.serialize(), QByteArray::fromHex("80f200000000"));
+
+        APDU::Command emptyData(0x80, 0x50, 0x00, 0x00);
+        emptyData.setData(QByteArray());
+        QCOMPARE(emptyData.serialize(), QByteArray::fromHex("8050000000"));
+
+        APDU::Command full(0x80, 0x20, 0x00, 0x00);
+        full.setData(QByteArray("123456"));
+        full.setLe(0);
+        QCOMPARE(full.serialize(), QByteArray::fromHex("8020000006313233343536") + QByteArray(1, 0));
+
+        Core::Bytes direct;
+        Core::Apdu::CommandFields fields;
+        fields.cla = 0x80;
+        fields.ins = 0x20;
+        fields.data = Core::ByteView("123456", 6);
+        fields.hasData = true;
+        Core::Apdu::serialize(fields, direct);
+        QCOMPARE(toByteArray(direct), QByteArray::fromHex("8020000006313233343536"));
+    }
+
+    void testResponseParsing() {
+        const QByteArray raw = QByteArray::fromHex("aabb9000");
+        const Core::Apdu::ResponseView parsed = Core::Apdu::parseResponse(view(raw));
+        QVERIFY(parsed.isOK());
+        QCOMPARE(toByteArray(parsed.data), QByteArray::fromHex("aabb"));
+
+        QCOMPARE(Core::Apdu::parseResponse(Core::ByteView()).sw, Core::Apdu::ResponseView::SW_UNKNOWN);
+        QCOMPARE(Core::Apdu::remainingAttempts(0x63C2), 2);
+
+        // The Qt messages keep their formatting on top of the core table
+        QCOMPARE(APDU::Response(QByteArray::fromHex("63c2")).errorMessage(),
+                 QStringLiteral("Wrong PIN/PUK. Remaining attempts: 2"));
+        QCOMPARE(APDU::Response(QByteArray::fromHex("9000")).errorMessage(),
+                 QString::fromLatin1(Core::Apdu::statusMessage(0x9000)));
+    }
+
+    void testTlv() {
+        const QByteArray value(200, 0x01);
+        const QByteArray encoded = TLV::encode(0x80, value);
+        QCOMPARE(encoded.left(3), QByteArray::fromHex("8081c8"));
+        QCOMPARE(TLV::findTag(encoded, 0x80), value);
+
+        const QByteArray nested = QByteArray::fromHex("8f0101") + encoded;
+        QCOMPARE(toByteArray(Core::Tlv::findTag(view(nested), 0x80)), value);
+        QVERIFY(Core::Tlv::findTag(view(nested), 0x81).empty());
+
+        // Truncated value: not returned
+        QVERIFY(TLV::findTag(QByteArray::fromHex("80050102"), 0x80).isEmpty());
+
+        size_t offset = 0;
+        uint32_t length = 0;
+        QVERIFY(!Core::Tlv::parseLength(view(QByteArray::fromHex("8501020304")), offset, length));
+    }
+
+    void testDerivationPath() {
+        Core::DerivationPath path = Core::DerivationPath::parse(" m/44'/60'/0'/0/1 ");
+        QCOMPARE(path.start, Core::DerivationPath::Start::Master);
+        Core::Bytes encoded;
+        path.encode(encoded);
+        QCOMPARE(toByteArray(encoded), QByteArray::fromHex("8000002c8000003c800000000000000000000001"));
+
+        path = Core::DerivationPath::parse("../0h/x/2");
+        QCOMPARE(path.start, Core::DerivationPath::Start::Parent);
+        QCOMPARE(path.components.size(), size_t(2));
+        QCOMPARE(path.components[0], Core::DerivationPath::HARDENED);
+        QCOMPARE(path.components[1], 2u);
+
+        QCOMPARE(Core::DerivationPath::parse("0/1").start, Core::DerivationPath::Start::Current);
+    }
+
+    void testSecureChannelRoundTrip() {
+        if (!Core::SecureSession::isAvailable()) {
+            QSKIP("Built without OpenSSL");
+        }
+
+        CardChannel cardChannel;
+        cardChannel.card.open(view(m_iv), view(m_encKey), view(m_macKey));
+        SecureChannel channel(&cardChannel);
+        channel.init(m_iv, m_encKey, m_macKey);
+
+        for (int i = 0; i < 3; ++i) {
+            APDU::Command command(0x80, 0xF2, 0x00, 0x00);
+            command.setData(QByteArray(i * 20, static_cast<char>(i)));
+            const APDU::Response response = channel.send(command);
+            QCOMPARE(cardChannel.lastPlainData, command.data());
+            QVERIFY(response.isOK());
+            QCOMPARE(response.data(), QByteArray::fromHex("0102"));
+        }
+    }
+
+    void testTransmitFailureRestoresIv() {
+        if (!Core::SecureSession::isAvailable()) {
+            QSKIP("Built without OpenSSL");
+        }
+
+        CardChannel cardChannel;
+        cardChannel.card.open(view(m_iv), view(m_encKey), view(m_macKey));
+        SecureChannel channel(&cardChannel);
+        channel.init(m_iv, m_encKey, m_macKey);
+
+        APDU::Command command(0x80, 0xF2, 0x00, 0x00);
+        cardChannel.failTransmit = true;
+        QVERIFY_EXCEPTION_THROWN(channel.send(command), std::runtime_error);
+
+        // The card never saw the command: both sides are still in step
+        cardChannel.failTransmit = false;
+        QVERIFY(channel.send(command).isOK());
+    }
+
+    void testMacMismatchThrows() {
+        if (!Core::SecureSession::isAvailable()) {
+            QSKIP("Built without OpenSSL");
+        }
+
+        CardChannel cardChannel;
+        cardChannel.card.open(view(m_iv), view(m_encKey), view(m_macKey));
+        cardChannel.corruptMac = true;
+        SecureChannel channel(&cardChannel);
+        channel.init(m_iv, m_encKey, m_macKey);
+
+        APDU::Command command(0x80, 0xF2, 0x00, 0x00);
+        QVERIFY_EXCEPTION_THROWN(channel.send(command), std::runtime_error);
+    }
+
+    void testUnwrapPassesErrorsThrough() {
+        Core::SecureSession session;
+        session.open(view(m_iv), view(m_encKey), view(m_macKey));
+        Core::Bytes out;
+        QCOMPARE(session.unwrap(view(QByteArray::fromHex("6982")), out),
+                 Core::SecureSession::UnwrapStatus::Plain);
+        QCOMPARE(session.unwrap(view(QByteArray::fromHex("0102039000")), out),
+                 Core::SecureSession::UnwrapStatus::TooShort);
+    }
+
+    void testScp02Vectors() {
+        if (!Core::SecureSession::isAvailable()) {
+            QSKIP("Built without OpenSSL");
+        }
+
+        const QByteArray key = QByteArray::fromHex("404142434445464748494a4b4c4d4e4f");
+
+        Core::Bytes derived;
+        QVERIFY(Core::Scp02::deriveKey(view(key), view(QByteArray::fromHex("0001")),
+                                       view(QByteArray::fromHex("0182")), derived));
+        QCOMPARE(toByteArray(derived), QByteArray::fromHex("25c9794a1205ff244f5fa0378d2f8d59"));
+        QCOMPARE(GlobalPlatform::Crypto::deriveKey(key, QByteArray::fromHex("0001"),
+                                                   GlobalPlatform::Crypto::DERIVATION_PURPOSE_ENC()),
+                 toByteArray(derived));
+
+        // Retail MAC over 20 bytes: one single-DES block, then 3DES on the last
+        Core::Scp02::Block mac;
+        const QByteArray data(20, static_cast<char>(0xAA));
+        QVERIFY(Core::Scp02::retailMac(view(key), view(data), Core::Scp02::Block{}, mac));
+        QCOMPARE(toByteArray(mac), QByteArray::fromHex("bc90ced4f89165c3"));
+        QCOMPARE(GlobalPlatform::Crypto::macFull3DES(key, data, QByteArray(8, 0)), toByteArray(mac));
+
+        Core::Bytes encrypted;
+        Core::Bytes decrypted;
+        QVERIFY(Core::Scp02::encrypt(view(key), Core::Scp02::Block{}, view(data), encrypted));
+        QVERIFY(Core::Scp02::decrypt(view(key), Core::Scp02::Block{}, encrypted, decrypted));
+        QCOMPARE(toByteArray(decrypted), data);
+    }
+};
+
+QTEST_MAIN(TestKeycardCore)
+#include "test_keycard_core.moc"
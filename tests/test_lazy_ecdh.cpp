@@ -0,0 +1,191 @@
+/**
+ * Tests for deferred ECDH in CommandSet: select() leaves the secret to the
+ * first openSecureChannel()/init()
+ *
+ * The mock card answers OPEN SECURE CHANNEL with a salt and IV and everything
+ * else with 9000, which is all the host side checks.
+ */
+
+#include <QTest>
+#include "keycard-qt/command_set.h"
+#include "keycard-qt/keycard_channel.h"
+#include "keycard-qt/metrics.h"
+#include "mocks/mock_backend.h"
+#include <memory>
+
+using namespace Keycard;
+using namespace Keycard::Test;
+
+namespace {
+
+// secp256k1 generator point, so ECDH succeeds
+const QByteArray CARD_KEY = QByteArray::fromHex(
+    "0479BE667EF9DCBBAC55A06295CE870B07029BFCDB2DCE28D959F2815B16F81798"
+    "483ADA7726A3C4655DA4FBFC0E1108A8FD17B448A68554199C47D08FFB10D4B8");
+
+// 2G, a different valid key
+const QByteArray OTHER_CARD_KEY = QByteArray::fromHex(
+    "04C6047F9441ED7D6D3045406E95C07CD85C778E4B8CEF3CA7ABAC09B95C709EE5"
+    "1AE168FEA63DC339A3C58419466CEAEEF7F632653266D0E1236431A950CFE52A");
+
+const QByteArray INSTANCE_UID(16, 0x11);
+
+QByteArray initializedSelectResponse(const QByteArray& cardPublicKey) {
+    QByteArray body = QByteArray::fromHex("8F10") + INSTANCE_UID
+                    + QByteArray::fromHex("8041") + cardPublicKey
+                    + QByteArray::fromHex("8E20") + QByteArray(32, 0x22);
+    QByteArray response = QByteArray::fromHex("A4");
+    response.append(static_cast<char>(body.size()));
+    response.append(body);
+    return response + QByteArray::fromHex("9000");
+}
+
+QByteArray preInitializedSelectResponse(const QByteArray& cardPublicKey) {
+    return QByteArray::fromHex("8041") + cardPublicKey + QByteArray::fromHex("9000");
+}
+
+} // namespace
+
+class TestLazyEcdh : public QObject {
+    Q_OBJECT
+
+private:
+    MockBackend* m_mock = nullptr;
+    std::shared_ptr<KeycardChannel> m_channel;
+    std::unique_ptr<CommandSet> m_cmdSet;
+    const PairingInfo m_pairing{QByteArray(32, 0xAB), 1};
+
+    // Data of every OPEN SECURE CHANNEL sent: our ephemeral public key
+    QList<QByteArray> ephemeralKeysSent() const {
+        QList<QByteArray> keys;
+        for (const QByteArray& apdu : m_mock->getTransmittedApdus()) {
+            if (static_cast<uint8_t>(apdu[1]) == APDU::INS_OPEN_SECURE_CHANNEL) {
+                keys << apdu.mid(5, 65);
+            }
+        }
+        return keys;
+    }
+
+    int ecdhWork() const {
+        return static_cast<int>(Metrics::counter("ecdh_cache.hit") + Metrics::counter("ecdh_cache.miss"));
+    }
+
+private slots:
+    void initTestCase() {
+        if (!SecureChannel::deriveSecret(CARD_KEY).isValid()) {
+            QSKIP("Built without OpenSSL");
+        }
+    }
+
+    void init() {
+        Metrics::reset();
+        m_mock = new MockBackend();
+        m_mock->setAutoConnect(true);
+        m_mock->setResponseHandler([](const QByteArray& apdu) -> QByteArray {
+            if (static_cast<uint8_t>(apdu[1]) == APDU::INS_OPEN_SECURE_CHANNEL) {
+                return QByteArray(48, 0x33) + QByteArray::fromHex("9000");
+            }
+            return QByteArray::fromHex("9000");
+        });
+        m_channel = std::make_shared<KeycardChannel>(m_mock);
+        m_mock->simulateCardInserted();
+        m_cmdSet = std::make_unique<CommandSet>(m_channel, nullptr, nullptr);
+        // Each test starts from a card never seen before
+        m_cmdSet->setEcdhSecretCache(std::make_shared<EcdhSecretCache>());
+    }
+
+    void cleanup() {
+        m_cmdSet.reset();
+        m_channel.reset();
+        m_mock = nullptr;
+    }
+
+    void testPlainFlowSkipsEcdh() {
+        m_mock->queueResponse(initializedSelectResponse(CARD_KEY));
+        QVERIFY(m_cmdSet->select(true).initialized);
+        m_cmdSet->identify();
+
+        QCOMPARE(ecdhWork(), 0);
+        QCOMPARE(m_cmdSet->ecdhSecretCache()->size(), 0);
+    }
+
+    void testOpenSecureChannelDerivesOncePerSelect() {
+        m_mock->queueResponse(initializedSelectResponse(CARD_KEY));
+        QVERIFY(m_cmdSet->select(true).initialized);
+
+        QVERIFY(m_cmdSet->openSecureChannel(m_pairing));
+        QVERIFY(m_cmdSet->openSecureChannel(m_pairing));
+        QCOMPARE(ecdhWork(), 1);
+
+        // A new SELECT means a new exchange
+        m_mock->queueResponse(initializedSelectResponse(CARD_KEY));
+        QVERIFY(m_cmdSet->select(true).initialized);
+        QVERIFY(m_cmdSet->openSecureChannel(m_pairing));
+
+        const QList<QByteArray> keys = ephemeralKeysSent();
+        QCOMPARE(keys.size(), 3);
+        QCOMPARE(keys[0], keys[1]);
+        QVERIFY(keys[2] != keys[0]);
+        QCOMPARE(static_cast<uint8_t>(keys[2][0]), uint8_t(0x04));
+    }
+
+    void testReturningCardUsesPreparedSecret() {
+        m_mock->queueResponse(initializedSelectResponse(CARD_KEY));
+        m_cmdSet->select(true);
+        QVERIFY(m_cmdSet->openSecureChannel(m_pairing));
+        QCOMPARE(Metrics::counter("ecdh_cache.hit"), quint64(0));
+
+        // The next session's secret was derived in the background
+        QTRY_VERIFY_WITH_TIMEOUT(m_cmdSet->ecdhSecretCache()->isPrepared(INSTANCE_UID, CARD_KEY), 5000);
+        m_mock->queueResponse(initializedSelectResponse(CARD_KEY));
+        m_cmdSet->select(true);
+        QVERIFY(m_cmdSet->openSecureChannel(m_pairing));
+        QCOMPARE(Metrics::counter("ecdh_cache.hit"), quint64(1));
+
+        // Re-installed applet: the prepared secret is not used
+        QTRY_VERIFY_WITH_TIMEOUT(m_cmdSet->ecdhSecretCache()->isPrepared(INSTANCE_UID, CARD_KEY), 5000);
+        m_mock->queueResponse(initializedSelectResponse(OTHER_CARD_KEY));
+        m_cmdSet->select(true);
+        QVERIFY(m_cmdSet->openSecureChannel(m_pairing));
+        QCOMPARE(Metrics::counter("ecdh_cache.hit"), quint64(1));
+        QCOMPARE(Metrics::counter("ecdh_cache.invalidated"), quint64(1));
+    }
+
+    void testPrecomputeAfterSelect() {
+        m_cmdSet->setEcdhPrecompute(true);
+        m_mock->queueResponse(initializedSelectResponse(CARD_KEY));
+        m_cmdSet->select(true);
+
+        // Started by select(), picked up (or waited for) by the secure flow
+        QVERIFY(m_cmdSet->openSecureChannel(m_pairing));
+        QCOMPARE(Metrics::counter("ecdh_cache.hit"), quint64(1));
+    }
+
+    void testPrecomputeForInit() {
+        m_cmdSet->setEcdhPrecompute(true);
+        m_mock->queueResponse(preInitializedSelectResponse(CARD_KEY));
+        QVERIFY(!m_cmdSet->select(true).initialized);
+
+        // INIT, then the SELECT of the now initialized card
+        m_mock->queueResponse(QByteArray::fromHex("9000"));
+        m_mock->queueResponse(initializedSelectResponse(CARD_KEY));
+        QVERIFY(m_cmdSet->init(Secrets("123456", "123456789012", "KeycardTest")));
+
+        QCOMPARE(Metrics::counter("ecdh_cache.hit"), quint64(1));
+        QCOMPARE(static_cast<uint8_t>(m_mock->getTransmittedApdus().at(1)[1]), APDU::INS_INIT);
+    }
+
+    void testNoCacheDerivesInPlace() {
+        m_cmdSet->setEcdhSecretCache(nullptr);
+        m_cmdSet->setEcdhPrecompute(true);
+        m_mock->queueResponse(initializedSelectResponse(CARD_KEY));
+        m_cmdSet->select(true);
+
+        QVERIFY(m_cmdSet->openSecureChannel(m_pairing));
+        QCOMPARE(ephemeralKeysSent().size(), 1);
+        QCOMPARE(ecdhWork(), 0);
+    }
+};
+
+QTEST_MAIN(TestLazyEcdh)
+#include "test_lazy_ecdh.moc"
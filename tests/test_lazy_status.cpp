@@ -0,0 +1,215 @@
+/**
+ * Tests for lazily refreshed application status
+ *
+ * Counts APDUs per flow to make sure GET STATUS is only sent when the cached
+ * status is actually stale.
+ */
+
+#include <QTest>
+#include "keycard-qt/command_set.h"
+#include "keycard-qt/keycard_channel.h"
+#include "mocks/mock_backend.h"
+#include <memory>
+
+using namespace Keycard;
+using namespace Keycard::Test;
+
+class TestLazyStatus : public QObject {
+    Q_OBJECT
+
+private:
+    std::shared_ptr<KeycardChannel> createMockChannel() {
+        auto* mock = new MockBackend();
+        mock->setAutoConnect(true);
+        auto channel = std::make_shared<KeycardChannel>(mock);
+        mock->simulateCardInserted();
+        return channel;
+    }
+
+    static void injectSecureChannel(CommandSet& cmdSet) {
+        cmdSet.testInjectSecureChannelState(PairingInfo(QByteArray(32, 0xAB), 1),
+                                            QByteArray(16, 0x00),
+                                            QByteArray(16, 0xEE),
+                                            QByteArray(16, 0xDD));
+    }
+
+    static ApplicationStatus freshStatus(uint8_t pinRetries, uint8_t pukRetries) {
+        ApplicationStatus status;
+        status.pinRetryCount = pinRetries;
+        status.pukRetryCount = pukRetries;
+        status.keyInitialized = true;
+        status.valid = true;
+        return status;
+    }
+
+    static int countIns(MockBackend* mock, uint8_t ins) {
+        int count = 0;
+        for (const QByteArray& apdu : mock->getTransmittedApdus()) {
+            if (apdu.size() > 1 && static_cast<uint8_t>(apdu[1]) == ins) {
+                count++;
+            }
+        }
+        return count;
+    }
+
+private slots:
+    void testVerifyPINSendsSingleApdu() {
+        auto channel = createMockChannel();
+        auto* mock = qobject_cast<MockBackend*>(channel->backend());
+        CommandSet cmdSet(channel, nullptr, nullptr);
+        injectSecureChannel(cmdSet);
+
+        mock->queueResponse(QByteArray::fromHex("9000"));
+        QVERIFY(cmdSet.verifyPIN("123456"));
+
+        // Previously VERIFY PIN + GET STATUS
+        QCOMPARE(mock->getTransmitCount(), 1);
+        QCOMPARE(countIns(mock, APDU::INS_GET_STATUS), 0);
+    }
+
+    void testWrongPINUsesStatusWord() {
+        auto channel = createMockChannel();
+        auto* mock = qobject_cast<MockBackend*>(channel->backend());
+        CommandSet cmdSet(channel, nullptr, nullptr);
+        injectSecureChannel(cmdSet);
+        cmdSet.testInjectCachedStatus(freshStatus(3, 5));
+
+        mock->queueResponse(QByteArray::fromHex("63C2"));
+        QVERIFY(!cmdSet.verifyPIN("000000"));
+
+        QCOMPARE(mock->getTransmitCount(), 1);
+        QCOMPARE(cmdSet.remainingPINAttempts(), 2);
+        QVERIFY(!cmdSet.isStatusStale());
+
+        // Status stays fresh and reflects the SW, no card access needed
+        QCOMPARE(cmdSet.applicationStatus().pinRetryCount, static_cast<uint8_t>(2));
+        QCOMPARE(mock->getTransmitCount(), 1);
+    }
+
+    void testSuccessfulVerifyMarksStatusStale() {
+        auto channel = createMockChannel();
+        auto* mock = qobject_cast<MockBackend*>(channel->backend());
+        CommandSet cmdSet(channel, nullptr, nullptr);
+        injectSecureChannel(cmdSet);
+        cmdSet.testInjectCachedStatus(freshStatus(1, 5));
+
+        // The counter is refilled to a limit only GET STATUS reports
+        mock->queueResponse(QByteArray::fromHex("9000"));
+        QVERIFY(cmdSet.verifyPIN("123456"));
+        QVERIFY(cmdSet.isStatusStale());
+        QCOMPARE(mock->getTransmitCount(), 1);
+        QCOMPARE(countIns(mock, APDU::INS_GET_STATUS), 0);
+    }
+
+    void testSuccessfulUnblockMarksStatusStale() {
+        auto channel = createMockChannel();
+        auto* mock = qobject_cast<MockBackend*>(channel->backend());
+        CommandSet cmdSet(channel, nullptr, nullptr);
+        injectSecureChannel(cmdSet);
+        cmdSet.testInjectCachedStatus(freshStatus(0, 4));
+
+        mock->queueResponse(QByteArray::fromHex("63C3"));
+        QVERIFY(!cmdSet.unblockPIN("000000000000", "654321"));
+        QCOMPARE(cmdSet.cachedApplicationStatus().pukRetryCount, static_cast<uint8_t>(3));
+        QVERIFY(!cmdSet.isStatusStale());
+
+        mock->queueResponse(QByteArray::fromHex("9000"));
+        QVERIFY(cmdSet.unblockPIN("123456789012", "654321"));
+        QVERIFY(cmdSet.isStatusStale());
+        QCOMPARE(mock->getTransmitCount(), 2);
+    }
+
+    void testSelectMarksStatusStale() {
+        auto channel = createMockChannel();
+        auto* mock = qobject_cast<MockBackend*>(channel->backend());
+        CommandSet cmdSet(channel, nullptr, nullptr);
+        cmdSet.testInjectCachedStatus(freshStatus(3, 5));
+
+        // A re-tap may follow PIN attempts made elsewhere
+        mock->queueResponse(QByteArray::fromHex("9000"));
+        cmdSet.select(true);
+        QVERIFY(cmdSet.isStatusStale());
+        QCOMPARE(countIns(mock, APDU::INS_SELECT), 1);
+    }
+
+    void testStatusFetchedOnFirstAccess() {
+        auto channel = createMockChannel();
+        auto* mock = qobject_cast<MockBackend*>(channel->backend());
+        CommandSet cmdSet(channel, nullptr, nullptr);
+        injectSecureChannel(cmdSet);
+
+        QVERIFY(cmdSet.isStatusStale());
+        cmdSet.applicationStatus();
+        QCOMPARE(countIns(mock, APDU::INS_GET_STATUS), 1);
+    }
+
+    void testFreshStatusServedWithoutApdu() {
+        auto channel = createMockChannel();
+        auto* mock = qobject_cast<MockBackend*>(channel->backend());
+        CommandSet cmdSet(channel, nullptr, nullptr);
+        injectSecureChannel(cmdSet);
+        cmdSet.testInjectCachedStatus(freshStatus(3, 5));
+
+        for (int i = 0; i < 3; ++i) {
+            QVERIFY(cmdSet.applicationStatus().keyInitialized);
+        }
+        QCOMPARE(mock->getTransmitCount(), 0);
+    }
+
+    void testStateChangesInvalidate() {
+        auto channel = createMockChannel();
+        auto* mock = qobject_cast<MockBackend*>(channel->backend());
+        CommandSet cmdSet(channel, nullptr, nullptr);
+        injectSecureChannel(cmdSet);
+
+        // Current path changes
+        cmdSet.testInjectCachedStatus(freshStatus(3, 5));
+        mock->queueResponse(QByteArray::fromHex("9000"));
+        QVERIFY(cmdSet.deriveKey("m/44'/60'/0'/0/0"));
+        QVERIFY(cmdSet.isStatusStale());
+
+        // Key removed
+        cmdSet.testInjectCachedStatus(freshStatus(3, 5));
+        mock->queueResponse(QByteArray::fromHex("9000"));
+        QVERIFY(cmdSet.removeKey());
+        QVERIFY(cmdSet.isStatusStale());
+
+        // Signing without makeCurrent leaves the path alone
+        cmdSet.testInjectCachedStatus(freshStatus(3, 5));
+        mock->queueResponse(QByteArray::fromHex("9000"));
+        cmdSet.signWithPath(QByteArray(32, 0x01), "m/44'/60'/0'/0/1", false);
+        QVERIFY(!cmdSet.isStatusStale());
+
+        int before = countIns(mock, APDU::INS_GET_STATUS);
+        cmdSet.testInjectCachedStatus(freshStatus(3, 5));
+        mock->queueResponse(QByteArray::fromHex("9000"));
+        cmdSet.signWithPath(QByteArray(32, 0x01), "m/44'/60'/0'/0/1", true);
+        QVERIFY(cmdSet.isStatusStale());
+        cmdSet.applicationStatus();
+        QCOMPARE(countIns(mock, APDU::INS_GET_STATUS), before + 1);
+    }
+
+    void testVerifyAndSignFlow() {
+        auto channel = createMockChannel();
+        auto* mock = qobject_cast<MockBackend*>(channel->backend());
+        CommandSet cmdSet(channel, nullptr, nullptr);
+        injectSecureChannel(cmdSet);
+        cmdSet.testInjectCachedStatus(freshStatus(3, 5));
+
+        mock->queueResponse(QByteArray::fromHex("9000"));
+        QVERIFY(cmdSet.verifyPIN("123456"));
+        mock->queueResponse(QByteArray::fromHex("9000"));
+        cmdSet.sign(QByteArray(32, 0x01));
+
+        // VERIFY PIN + SIGN, previously VERIFY PIN + GET STATUS + SIGN
+        QCOMPARE(mock->getTransmitCount(), 2);
+        QCOMPARE(countIns(mock, APDU::INS_GET_STATUS), 0);
+
+        // The refilled counter is read once, when it is actually needed
+        cmdSet.applicationStatus();
+        QCOMPARE(countIns(mock, APDU::INS_GET_STATUS), 1);
+    }
+};
+
+QTEST_MAIN(TestLazyStatus)
+#include "test_lazy_status.moc"
@@ -0,0 +1,208 @@
+/**
+ * Unit tests for metadata encoding/decoding (MetadataEncoding)
+ */
+
+#include <QTest>
+#include <QDebug>
+#include "keycard-qt/metadata_utils.h"
+
+using namespace Keycard::MetadataEncoding;
+
+static QString walletPath(uint32_t index) {
+    return QString("m/44'/60'/0'/0/%1").arg(index);
+}
+
+class TestMetadataUtils : public QObject {
+    Q_OBJECT
+
+private slots:
+    void testDecodeRoundTrip() {
+        QString error;
+        QStringList paths = {walletPath(0), walletPath(1), walletPath(2), walletPath(5), walletPath(200)};
+        QByteArray encoded = encode("My Card", paths, error);
+        QVERIFY(!encoded.isEmpty());
+
+        WalletMetadata meta;
+        QVERIFY(decode(encoded, meta, error));
+        QCOMPARE(meta.version, static_cast<uint8_t>(1));
+        QCOMPARE(meta.name, QString("My Card"));
+        QCOMPARE(meta.paths.rangeCount(), 3);
+        QCOMPARE(meta.paths.size(), static_cast<uint64_t>(5));
+        QCOMPARE(meta.paths.toStringList(), paths);
+    }
+
+    void testLazyIteration() {
+        // 0x20 header (no name), range start=10 count=2, range start=300 count=0
+        QByteArray encoded = QByteArray::fromHex("200a02ac0200");
+
+        WalletMetadata meta;
+        QString error;
+        QVERIFY(decode(encoded, meta, error));
+
+        QVector<uint32_t> indexes;
+        for (uint32_t index : meta.paths) {
+            indexes.append(index);
+        }
+        QCOMPARE(indexes, QVector<uint32_t>({10, 11, 12, 300}));
+
+        QVERIFY(meta.paths.contains(11));
+        QVERIFY(meta.paths.contains(300));
+        QVERIFY(!meta.paths.contains(13));
+    }
+
+    void testIteratorsOutliveView() {
+        // Range start=10 count=1, range start=300 count=0
+        const QByteArray encoded = QByteArray::fromHex("0a01ac0200");
+
+        WalletPaths::RangeIterator range = WalletPaths(encoded).rangesBegin();
+        WalletPaths::const_iterator index = WalletPaths(encoded).begin();
+
+        QVERIFY(*range == (PathRange{10, 1}));
+        ++range;
+        QVERIFY(*range == (PathRange{300, 0}));
+        ++range;
+        QVERIFY(range == WalletPaths().rangesEnd());
+
+        QVector<uint32_t> indexes;
+        for (; index != WalletPaths().end(); ++index) {
+            indexes.append(*index);
+        }
+        QCOMPARE(indexes, QVector<uint32_t>({10, 11, 300}));
+    }
+
+    void testIteratorsOfDifferentViewsDiffer() {
+        const WalletPaths first(QByteArray::fromHex("0a00"));
+        const WalletPaths second(QByteArray::fromHex("0a00"));
+        const WalletPaths copy = first;
+
+        // Same offset, different bytes
+        QVERIFY(first.rangesBegin() != second.rangesBegin());
+        QVERIFY(first.begin() != second.begin());
+        QVERIFY(first.rangesBegin() == copy.rangesBegin());
+        QVERIFY(first.rangesEnd() == second.rangesEnd());
+    }
+
+    void testLargeRangeIsNotExpanded() {
+        QVector<PathRange> ranges = {PathRange{0, 1000000}};
+        QString error;
+        QByteArray encoded = encodeRanges("big", ranges, error);
+
+        WalletMetadata meta;
+        QVERIFY(decode(encoded, meta, error));
+        QCOMPARE(meta.paths.size(), static_cast<uint64_t>(1000001));
+        QCOMPARE(meta.paths.rangeCount(), 1);
+        QVERIFY(meta.paths.contains(999999));
+    }
+
+    void testDecodeEmptyPaths() {
+        WalletMetadata meta;
+        QString error;
+        QVERIFY(decode(QByteArray::fromHex("20"), meta, error));
+        QVERIFY(meta.name.isEmpty());
+        QVERIFY(meta.paths.isEmpty());
+        QVERIFY(meta.paths.begin() == meta.paths.end());
+        QCOMPARE(meta.paths.size(), static_cast<uint64_t>(0));
+    }
+
+    void testDecodeErrors() {
+        WalletMetadata meta;
+        QString error;
+
+        QVERIFY(!decode(QByteArray(), meta, error));
+        // Version 2
+        QVERIFY(!decode(QByteArray::fromHex("40"), meta, error));
+        // Name length larger than data
+        QVERIFY(!decode(QByteArray::fromHex("2541"), meta, error));
+        // Truncated LEB128 value
+        QVERIFY(!decode(QByteArray::fromHex("2080"), meta, error));
+        // Start without count
+        QVERIFY(!decode(QByteArray::fromHex("2005"), meta, error));
+        QVERIFY(!error.isEmpty());
+    }
+
+    void testToMetadata() {
+        QString error;
+        QByteArray encoded = encode("Wallet", {walletPath(3), walletPath(4)}, error);
+
+        WalletMetadata meta;
+        QVERIFY(decode(encoded, meta, error));
+        Keycard::Metadata legacy = meta.toMetadata();
+        QCOMPARE(legacy.name, QString("Wallet"));
+        QCOMPARE(legacy.paths, QVector<uint32_t>({3, 4}));
+    }
+
+    void testAddPathsMergesRanges() {
+        QString error;
+        QByteArray encoded = encode("Card", {walletPath(0), walletPath(1), walletPath(2), walletPath(5), walletPath(200)}, error);
+
+        // 3 and 4 bridge the first two ranges, 201 extends the last one, 1 is a duplicate
+        QByteArray updated = addPaths(encoded, {walletPath(3), walletPath(4), walletPath(201), walletPath(1)}, error);
+        QVERIFY(!updated.isEmpty());
+
+        WalletMetadata meta;
+        QVERIFY(decode(updated, meta, error));
+        QCOMPARE(meta.name, QString("Card"));
+        QCOMPARE(meta.paths.ranges(), QVector<PathRange>({PathRange{0, 5}, PathRange{200, 1}}));
+    }
+
+    void testAddPathsToEmptyMetadata() {
+        QString error;
+        QByteArray updated = addPaths(QByteArray(), {walletPath(7)}, error);
+
+        WalletMetadata meta;
+        QVERIFY(decode(updated, meta, error));
+        QVERIFY(meta.name.isEmpty());
+        QCOMPARE(meta.paths.ranges(), QVector<PathRange>({PathRange{7, 0}}));
+    }
+
+    void testRemovePathsSplitsRanges() {
+        QString error;
+        QByteArray encoded = encodeRanges("Card", {PathRange{0, 5}, PathRange{200, 1}}, error);
+
+        // 999 is not stored and must be ignored
+        QByteArray updated = removePaths(encoded, {walletPath(0), walletPath(3), walletPath(201), walletPath(999)}, error);
+        QVERIFY(!updated.isEmpty());
+
+        WalletMetadata meta;
+        QVERIFY(decode(updated, meta, error));
+        QCOMPARE(meta.paths.ranges(),
+                 QVector<PathRange>({PathRange{1, 1}, PathRange{4, 1}, PathRange{200, 0}}));
+    }
+
+    void testUpdateRejectsInvalidPath() {
+        QString error;
+        QByteArray encoded = encode("Card", {walletPath(0)}, error);
+
+        QVERIFY(addPaths(encoded, {"m/44'/60'/1'/0/0"}, error).isEmpty());
+        QVERIFY(!error.isEmpty());
+
+        error.clear();
+        QVERIFY(removePaths(encoded, {"m/44'/60'/0'/0/abc"}, error).isEmpty());
+        QVERIFY(!error.isEmpty());
+    }
+
+    void testUnsortedRangesAreNormalized() {
+        // Ranges written out of order by another implementation: 10..11, then 0..0
+        QByteArray encoded = QByteArray::fromHex("200a010000");
+
+        QString error;
+        QByteArray updated = addPaths(encoded, {walletPath(1)}, error);
+
+        WalletMetadata meta;
+        QVERIFY(decode(updated, meta, error));
+        QCOMPARE(meta.paths.ranges(), QVector<PathRange>({PathRange{0, 1}, PathRange{10, 1}}));
+    }
+
+    void testRangeOperations() {
+        QVector<PathRange> merged = mergeRanges({PathRange{0, 2}, PathRange{10, 0}},
+                                                {PathRange{3, 1}, PathRange{8, 5}});
+        QCOMPARE(merged, QVector<PathRange>({PathRange{0, 4}, PathRange{8, 5}}));
+
+        // A single removal spanning two ranges
+        QVector<PathRange> remaining = subtractRanges({PathRange{0, 9}, PathRange{20, 9}}, {PathRange{5, 20}});
+        QCOMPARE(remaining, QVector<PathRange>({PathRange{0, 4}, PathRange{26, 3}}));
+    }
+};
+
+QTEST_MAIN(TestMetadataUtils)
+#include "test_metadata_utils.moc"
@@ -0,0 +1,119 @@
+/**
+ * Tests for Metrics counters and InstrumentedMutex
+ *
+ * Lock statistics are only collected with -DKEYCARD_LOCK_METRICS=ON; in
+ * other builds the mutex is checked for plain QMutex behaviour.
+ */
+
+#include <QTest>
+#include <QThread>
+#include <QSemaphore>
+#include "keycard-qt/instrumented_mutex.h"
+#include "keycard-qt/metrics.h"
+
+using namespace Keycard;
+
+namespace {
+
+Metrics::LockStats statsFor(const QString& name) {
+    for (const Metrics::LockStats& stats : Metrics::lockStats()) {
+        if (stats.name == name) {
+            return stats;
+        }
+    }
+    return Metrics::LockStats();
+}
+
+} // namespace
+
+class TestMetrics : public QObject {
+    Q_OBJECT
+
+private slots:
+    void init() {
+        Metrics::reset();
+    }
+
+    void testCounters() {
+        QCOMPARE(Metrics::counter("test.events"), quint64(0));
+        Metrics::increment("test.events");
+        Metrics::increment("test.events", 4);
+        QCOMPARE(Metrics::counter("test.events"), quint64(5));
+        QCOMPARE(Metrics::counters().value("test.events"), quint64(5));
+
+        Metrics::reset();
+        QCOMPARE(Metrics::counter("test.events"), quint64(0));
+        QVERIFY(!Metrics::counters().contains("test.events"));
+    }
+
+    void testMutexWithLockerAndCondition() {
+        InstrumentedMutex mutex("TestMetrics::condition");
+        QWaitCondition condition;
+        bool ready = false;
+
+        QThread* worker = QThread::create([&]() {
+            QMutexLocker locker(&mutex);
+            ready = true;
+            condition.wakeAll();
+        });
+
+        {
+            QMutexLocker locker(&mutex);
+            worker->start();
+            while (!ready) {
+                QVERIFY(mutex.wait(condition, QDeadlineTimer(2000)));
+            }
+        }
+        QVERIFY(worker->wait(2000));
+        delete worker;
+
+        QVERIFY(mutex.tryLock());
+        mutex.unlock();
+        QCOMPARE(QString(mutex.name()), QString("TestMetrics::condition"));
+    }
+
+    void testContentionIsRecorded() {
+        if (!Metrics::lockMetricsEnabled()) {
+            QVERIFY(Metrics::lockStats().isEmpty());
+            QSKIP("Built without KEYCARD_LOCK_METRICS");
+        }
+
+        InstrumentedMutex mutex("TestMetrics::contended");
+        QSemaphore locked;
+
+        // Worker holds the lock for ~50 ms; the main thread waits for it
+        QThread* worker = QThread::create([&]() {
+            QMutexLocker locker(&mutex);
+            locked.release();
+            QThread::msleep(50);
+        });
+        worker->start();
+        locked.acquire();
+        {
+            QMutexLocker locker(&mutex);
+        }
+        QVERIFY(worker->wait(2000));
+        delete worker;
+
+        const Metrics::LockStats stats = statsFor("TestMetrics::contended");
+        QCOMPARE(stats.acquisitions, quint64(2));
+        QCOMPARE(stats.contended, quint64(1));
+        QCOMPARE(stats.mainThreadContended, quint64(1));
+        QVERIFY(stats.maxWaitNs > 10 * 1000 * 1000);
+        QCOMPARE(stats.mainThreadWaitNs, stats.totalWaitNs);
+        QVERIFY(stats.maxHoldNs >= 40 * 1000 * 1000);
+        QVERIFY(stats.totalHoldNs >= stats.maxHoldNs);
+
+        // Instances with the same name share their statistics
+        InstrumentedMutex other("TestMetrics::contended");
+        other.lock();
+        other.unlock();
+        QCOMPARE(statsFor("TestMetrics::contended").acquisitions, quint64(3));
+
+        Metrics::reset();
+        QCOMPARE(statsFor("TestMetrics::contended").acquisitions, quint64(0));
+    }
+};
+
+QTEST_MAIN(TestMetrics)
+#include "test_metrics.moc"
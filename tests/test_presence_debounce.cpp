@@ -0,0 +1,185 @@
+/**
+ * Tests for the KeycardChannel presence debouncer (flapping contacts and NFC links)
+ */
+
+#include <QTest>
+#include <QSignalSpy>
+#include <QThread>
+#include "keycard-qt/keycard_channel.h"
+#include "keycard-qt/command_set.h"
+#include "keycard-qt/metrics.h"
+#include "mocks/mock_backend.h"
+#include <memory>
+
+using namespace Keycard;
+using namespace Keycard::Test;
+
+class TestPresenceDebounce : public QObject {
+    Q_OBJECT
+
+private:
+    MockBackend* m_mock = nullptr;
+    std::shared_ptr<KeycardChannel> m_channel;
+
+    void configure(int lossGraceMs, int settleMs) {
+        KeycardChannel::DebounceConfig config;
+        config.lossGraceMs = lossGraceMs;
+        config.settleMs = settleMs;
+        m_channel->setDebounceConfig(config);
+    }
+
+private slots:
+    void init() {
+        Metrics::reset();
+        m_mock = new MockBackend();
+        m_mock->setAutoConnect(false);
+        m_channel = std::make_shared<KeycardChannel>(m_mock);
+    }
+
+    void cleanup() {
+        m_channel.reset();
+        m_mock = nullptr;
+    }
+
+    void testDisabledByDefault() {
+        QSignalSpy lost(m_channel.get(), &KeycardChannel::targetLost);
+        m_mock->simulateCardInserted();
+        m_mock->simulateCardRemoved();
+
+        QCOMPARE(lost.count(), 1);
+        QVERIFY(!m_channel->isTargetPresent());
+        QVERIFY(m_channel->targetUid().isEmpty());
+    }
+
+    void testLossReportedAfterGracePeriod() {
+        configure(100, 0);
+        QSignalSpy lost(m_channel.get(), &KeycardChannel::targetLost);
+        m_mock->simulateCardInserted();
+        m_mock->simulateCardRemoved();
+
+        QCOMPARE(lost.count(), 0);
+        QVERIFY(m_channel->isTargetPresent());
+        QTRY_COMPARE_WITH_TIMEOUT(lost.count(), 1, 2000);
+        QVERIFY(!m_channel->isTargetPresent());
+    }
+
+    void testFlapWithSurvivingSessionIsHidden() {
+        configure(200, 0);
+        m_channel->setSessionProbe([]() { return true; });
+        QSignalSpy detected(m_channel.get(), &KeycardChannel::targetDetected);
+        QSignalSpy lost(m_channel.get(), &KeycardChannel::targetLost);
+
+        m_mock->simulateCardInserted();
+        KeycardChannel::PresenceMark mark = m_channel->presenceMark();
+        m_mock->simulateCardRemoved();
+        m_mock->simulateCardInserted();
+        QTest::qWait(300);
+
+        QCOMPARE(detected.count(), 1);
+        QCOMPARE(lost.count(), 0);
+        // Waiters still see the card coming back
+        QVERIFY(m_channel->presenceMark().detections > mark.detections);
+        QVERIFY(m_channel->isTargetPresent());
+        QCOMPARE(Metrics::counter("presence.flaps"), quint64(1));
+        QCOMPARE(Metrics::counter("presence.reinit_suppressed"), quint64(1));
+    }
+
+    void testFlapWithLostSessionIsReportedOnce() {
+        configure(200, 0);
+        m_channel->setSessionProbe([]() { return false; });
+        QSignalSpy detected(m_channel.get(), &KeycardChannel::targetDetected);
+        QSignalSpy lost(m_channel.get(), &KeycardChannel::targetLost);
+
+        m_mock->simulateCardInserted();
+        m_mock->simulateCardRemoved();
+        m_mock->simulateCardInserted();
+
+        QCOMPARE(lost.count(), 1);
+        QCOMPARE(detected.count(), 2);
+        QCOMPARE(Metrics::counter("presence.reinit_suppressed"), quint64(0));
+    }
+
+    void testOtherCardEndsGracePeriod() {
+        configure(1000, 0);
+        QSignalSpy detected(m_channel.get(), &KeycardChannel::targetDetected);
+        QSignalSpy lost(m_channel.get(), &KeycardChannel::targetLost);
+
+        m_mock->simulateCardInserted();
+        m_mock->simulateCardRemoved();
+        m_mock->setCardUid("OTHER-CARD");
+        m_mock->simulateCardInserted();
+
+        QCOMPARE(lost.count(), 1);
+        QCOMPARE(detected.count(), 2);
+        QCOMPARE(detected.last().first().toString(), QString("OTHER-CARD"));
+        QCOMPARE(Metrics::counter("presence.flaps"), quint64(0));
+    }
+
+    void testReturningCardSettlesBeforeReport() {
+        configure(0, 100);
+        QSignalSpy detected(m_channel.get(), &KeycardChannel::targetDetected);
+
+        m_mock->simulateCardInserted();
+        m_mock->simulateCardRemoved();
+
+        // Back and gone again before settling: not reported
+        m_mock->simulateCardInserted();
+        QCOMPARE(detected.count(), 1);
+        m_mock->simulateCardRemoved();
+        QTest::qWait(150);
+        QCOMPARE(detected.count(), 1);
+        QCOMPARE(Metrics::counter("presence.detection_suppressed"), quint64(1));
+
+        // Back for good
+        m_mock->simulateCardInserted();
+        QCOMPARE(detected.count(), 1);
+        QTRY_COMPARE_WITH_TIMEOUT(detected.count(), 2, 2000);
+        QCOMPARE(Metrics::counter("presence.flaps"), quint64(2));
+    }
+
+    void testWaitForTargetDeliversSettledCard() {
+        configure(0, 50);
+        m_mock->simulateCardInserted();
+        m_mock->simulateCardRemoved();
+
+        // Returns while this thread is blocked, where no timer fires
+        KeycardChannel::PresenceMark mark = m_channel->presenceMark();
+        MockBackend* mock = m_mock;
+        QThread* worker = QThread::create([mock]() {
+            QThread::msleep(20);
+            mock->simulateCardInserted();
+        });
+        worker->start();
+
+        KeycardChannel::WaitResult result = m_channel->waitForTarget(mark, 2000);
+        worker->wait();
+        delete worker;
+
+        QCOMPARE(result, KeycardChannel::WaitResult::Detected);
+        QCOMPARE(m_channel->targetUid(), QString("MOCK-CARD-UID-12345678"));
+    }
+
+    void testCommandSetProbesSecureChannel() {
+        configure(200, 0);
+        CommandSet cmdSet(m_channel, nullptr, nullptr);
+        m_mock->simulateCardInserted();
+        cmdSet.testInjectSecureChannelState(PairingInfo(QByteArray(32, 0xAB), 1),
+                                            QByteArray(16, 0x00),
+                                            QByteArray(16, 0xEE),
+                                            QByteArray(16, 0xDD));
+        QSignalSpy cardLost(&cmdSet, &CommandSet::cardLost);
+        const int sent = m_mock->getTransmitCount();
+
+        // The card answers GET STATUS in the session: nothing to re-initialize
+        m_mock->simulateCardRemoved();
+        m_mock->simulateCardInserted();
+
+        QCOMPARE(m_mock->getTransmitCount(), sent + 1);
+        QCOMPARE(static_cast<uint8_t>(m_mock->getLastTransmittedApdu()[1]), APDU::INS_GET_STATUS);
+        QCOMPARE(cardLost.count(), 0);
+        QCOMPARE(Metrics::counter("presence.reinit_suppressed"), quint64(1));
+    }
+};
+
+QTEST_MAIN(TestPresenceDebounce)
+#include "test_presence_debounce.moc"
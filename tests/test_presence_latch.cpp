@@ -0,0 +1,153 @@
+/**
+ * Tests for the KeycardChannel presence latch and event-loop-free waitForCard
+ */
+
+#include <QTest>
+#include <QSignalSpy>
+#include <QElapsedTimer>
+#include <QThread>
+#include "keycard-qt/keycard_channel.h"
+#include "keycard-qt/command_set.h"
+#include "mocks/mock_backend.h"
+#include <atomic>
+#include <functional>
+#include <memory>
+
+using namespace Keycard;
+using namespace Keycard::Test;
+
+class TestPresenceLatch : public QObject {
+    Q_OBJECT
+
+private:
+    // Emit from a thread of its own, like the PC/SC detection thread
+    static QThread* runLater(int delayMs, std::function<void()> fn) {
+        QThread* worker = QThread::create([delayMs, fn]() {
+            QThread::msleep(delayMs);
+            fn();
+        });
+        worker->start();
+        return worker;
+    }
+
+    MockBackend* m_mock = nullptr;
+    std::shared_ptr<KeycardChannel> m_channel;
+
+private slots:
+    void init() {
+        m_mock = new MockBackend();
+        m_mock->setAutoConnect(false);
+        m_channel = std::make_shared<KeycardChannel>(m_mock);
+    }
+
+    void cleanup() {
+        m_channel.reset();
+        m_mock = nullptr;
+    }
+
+    void testDetectionFromWorkerThreadWakesWaiter() {
+        QSignalSpy spy(m_channel.get(), &KeycardChannel::targetDetected);
+        KeycardChannel::PresenceMark mark = m_channel->presenceMark();
+
+        MockBackend* mock = m_mock;
+        QThread* worker = runLater(50, [mock]() { mock->simulateCardInserted(); });
+
+        QElapsedTimer timer;
+        timer.start();
+        KeycardChannel::WaitResult result = m_channel->waitForTarget(mark, 5000);
+        qint64 elapsed = timer.elapsed();
+
+        worker->wait();
+        delete worker;
+
+        QCOMPARE(result, KeycardChannel::WaitResult::Detected);
+        QVERIFY(elapsed < 2000);
+        // Delivered on this thread before the wait returned
+        QCOMPARE(spy.count(), 1);
+        QVERIFY(m_channel->isTargetPresent());
+    }
+
+    void testErrorWakesWaiter() {
+        QSignalSpy spy(m_channel.get(), &KeycardChannel::error);
+        KeycardChannel::PresenceMark mark = m_channel->presenceMark();
+
+        MockBackend* mock = m_mock;
+        QThread* worker = runLater(50, [mock]() { mock->simulateError("Reader unplugged"); });
+
+        KeycardChannel::WaitResult result = m_channel->waitForTarget(mark, 5000);
+
+        worker->wait();
+        delete worker;
+
+        QCOMPARE(result, KeycardChannel::WaitResult::Error);
+        QCOMPARE(spy.count(), 1);
+        QVERIFY(!m_channel->isTargetPresent());
+    }
+
+    void testTimeout() {
+        QElapsedTimer timer;
+        timer.start();
+        KeycardChannel::WaitResult result = m_channel->waitForTarget(m_channel->presenceMark(), 100);
+
+        QCOMPARE(result, KeycardChannel::WaitResult::Timeout);
+        QVERIFY(timer.elapsed() >= 90);
+    }
+
+    void testEventsBeforeMarkAreIgnored() {
+        m_mock->simulateCardInserted();
+        m_mock->simulateCardRemoved();
+        QVERIFY(!m_channel->isTargetPresent());
+
+        QCOMPARE(m_channel->waitForTarget(m_channel->presenceMark(), 50),
+                 KeycardChannel::WaitResult::Timeout);
+    }
+
+    void testConnectedCardReturnsImmediately() {
+        m_mock->simulateCardInserted();
+        QVERIFY(m_channel->isTargetPresent());
+
+        QCOMPARE(m_channel->waitForTarget(m_channel->presenceMark(), 0),
+                 KeycardChannel::WaitResult::Detected);
+    }
+
+    void testCanWaitForTarget() {
+        // The mock emits on the caller's thread: only other threads may block
+        QVERIFY(!m_channel->canWaitForTarget());
+
+        std::atomic<bool> fromWorker{false};
+        KeycardChannel* channel = m_channel.get();
+        QThread* worker = QThread::create([channel, &fromWorker]() {
+            fromWorker = channel->canWaitForTarget();
+        });
+        worker->start();
+        worker->wait();
+        delete worker;
+
+        QVERIFY(fromWorker.load());
+    }
+
+    void testWaitForCardFromWorkerUsesLatch() {
+        CommandSet cmdSet(m_channel, nullptr, nullptr);
+
+        // setState(WaitingForCard) is queued to this thread, where the mock
+        // inserts the card; the worker is woken by the latch
+        std::atomic<bool> done{false};
+        std::atomic<bool> detected{false};
+        CommandSet* cmdSetPtr = &cmdSet;
+        QThread* worker = QThread::create([cmdSetPtr, &done, &detected]() {
+            detected = cmdSetPtr->waitForCard(3000);
+            done = true;
+        });
+        worker->start();
+
+        QVERIFY(QTest::qWaitFor([&done]() { return done.load(); }, 5000));
+        worker->wait();
+        delete worker;
+
+        QVERIFY(detected.load());
+        QCOMPARE(m_mock->state(), ChannelState::WaitingForCard);
+    }
+};
+
+QTEST_MAIN(TestPresenceLatch)
+#include "test_presence_latch.moc"
@@ -0,0 +1,328 @@
+/**
+ * Tests for in-session secure channel recovery (CommandSet::resyncSecureChannel)
+ *
+ * The mock card answers secure commands in plain text (passed through by
+ * SecureChannel), OPEN SECURE CHANNEL with a salt and IV, and MUTUALLY
+ * AUTHENTICATE with 9000, which is all the host side checks. Scripted
+ * answers can also be encrypted under the injected session keys, as the
+ * applet's own replies are (see test_allocation_budget.cpp).
+ */
+
+#include <QTest>
+#include "keycard-qt/command_set.h"
+#include "keycard-qt/keycard_channel.h"
+#include "keycard-qt/metrics.h"
+#include "keycard-qt/secure_channel.h"
+#include "keycard-core/secure_session.h"
+#include "mocks/mock_backend.h"
+#include <algorithm>
+#include <memory>
+
+using namespace Keycard;
+using namespace Keycard::Test;
+
+namespace {
+
+QByteArray initializedSelectResponse() {
+    // secp256k1 generator point as the card key, so ECDH succeeds
+    const QByteArray cardPublicKey = QByteArray::fromHex(
+        "0479BE667EF9DCBBAC55A06295CE870B07029BFCDB2DCE28D959F2815B16F81798"
+        "483ADA7726A3C4655DA4FBFC0E1108A8FD17B448A68554199C47D08FFB10D4B8");
+    QByteArray body = QByteArray::fromHex("8F10") + QByteArray(16, 0x11)
+                    + QByteArray::fromHex("8041") + cardPublicKey
+                    + QByteArray::fromHex("8E20") + QByteArray(32, 0x22);
+    QByteArray response = QByteArray::fromHex("A4");
+    response.append(static_cast<char>(body.size()));
+    response.append(body);
+    return response + QByteArray::fromHex("9000");
+}
+
+// A protected response whose MAC cannot match the host's IV
+QByteArray desyncedResponse() {
+    return QByteArray(32, 0x55) + QByteArray::fromHex("9000");
+}
+
+const QByteArray SESSION_IV(16, 0x00);
+const QByteArray SESSION_ENC_KEY(16, 0xEE);
+const QByteArray SESSION_MAC_KEY(16, 0xDD);
+
+// Marks a scripted answer to be encrypted by the card
+const QByteArray ENCRYPTED_PREFIX = QByteArrayLiteral("encrypted:");
+
+Core::ByteView view(const QByteArray& data) {
+    return Core::ByteView(data.constData(), static_cast<size_t>(data.size()));
+}
+
+QByteArray toByteArray(Core::ByteView bytes) {
+    return QByteArray(reinterpret_cast<const char*>(bytes.data()), static_cast<int>(bytes.size()));
+}
+
+// The card's answer to a secure command: plaintext ([data][SW]) encrypted and
+// MACed under the session keys, wrapped in an outer 9000
+QByteArray encryptedResponse(const QByteArray& apdu, const QByteArray& plaintext) {
+    Core::SecureSession card;
+    card.open(view(SESSION_IV), view(SESSION_ENC_KEY), view(SESSION_MAC_KEY));
+
+    const Core::ByteView raw = view(apdu);
+    const Core::ByteView data = raw.sub(5, raw[4]);
+    Core::SecureSession::Block meta{};
+    std::copy_n(raw.begin(), 4, meta.begin());
+    meta[4] = raw[4];
+    Core::SecureSession::Block commandMac;
+    card.mac(meta, data.sub(16), commandMac);
+    card.setIv(commandMac);
+
+    Core::Bytes encrypted;
+    card.encrypt(view(plaintext), encrypted);
+    Core::SecureSession::Block responseMeta{};
+    responseMeta[0] = static_cast<uint8_t>(16 + encrypted.size());
+    Core::SecureSession::Block responseMac;
+    card.mac(responseMeta, encrypted, responseMac);
+
+    return toByteArray(responseMac) + toByteArray(encrypted) + QByteArray::fromHex("9000");
+}
+
+} // namespace
+
+class TestSecureChannelResync : public QObject {
+    Q_OBJECT
+
+private:
+    std::shared_ptr<KeycardChannel> m_channel;
+    std::unique_ptr<CommandSet> m_cmdSet;
+    MockBackend* m_mock = nullptr;
+
+    // Per-INS queue of scripted answers; anything else gets the defaults below
+    QMap<uint8_t, QList<QByteArray>> m_script;
+    QByteArray m_openSecureChannelResponse;
+    int m_sentMark = 0;
+
+    void markSent() {
+        m_sentMark = m_mock->getTransmittedApdus().size();
+    }
+
+    // Instructions sent since the last markSent()
+    QList<uint8_t> sentInstructions() const {
+        QList<uint8_t> sent;
+        for (const QByteArray& apdu : m_mock->getTransmittedApdus().mid(m_sentMark)) {
+            sent << static_cast<uint8_t>(apdu[1]);
+        }
+        return sent;
+    }
+
+private slots:
+    void init() {
+        Metrics::reset();
+        m_script.clear();
+        m_openSecureChannelResponse = QByteArray(48, 0x33) + QByteArray::fromHex("9000");
+
+        m_mock = new MockBackend();
+        m_mock->setAutoConnect(true);
+        m_mock->setResponseHandler([this](const QByteArray& apdu) -> QByteArray {
+            const uint8_t ins = static_cast<uint8_t>(apdu[1]);
+            if (!m_script.value(ins).isEmpty()) {
+                const QByteArray answer = m_script[ins].takeFirst();
+                if (answer.startsWith(ENCRYPTED_PREFIX)) {
+                    return encryptedResponse(apdu, answer.mid(ENCRYPTED_PREFIX.size()));
+                }
+                return answer;
+            }
+            if (ins == APDU::INS_OPEN_SECURE_CHANNEL) {
+                return m_openSecureChannelResponse;
+            }
+            return QByteArray::fromHex("9000");
+        });
+        m_channel = std::make_shared<KeycardChannel>(m_mock);
+        m_mock->simulateCardInserted();
+
+        m_cmdSet = std::make_unique<CommandSet>(m_channel, nullptr, nullptr);
+        m_mock->queueResponse(initializedSelectResponse());
+        QVERIFY(m_cmdSet->select(true).initialized);
+        m_cmdSet->testInjectSecureChannelState(PairingInfo(QByteArray(32, 0xAB), 1),
+                                               SESSION_IV, SESSION_ENC_KEY, SESSION_MAC_KEY);
+        markSent();
+    }
+
+    void cleanup() {
+        m_cmdSet.reset();
+        m_channel.reset();
+        m_mock = nullptr;
+    }
+
+    void testSw6985ReplaysIdempotentCommand() {
+        m_script[APDU::INS_GET_STATUS] = {QByteArray::fromHex("6985")};
+
+        m_cmdSet->getStatus();
+
+        QCOMPARE(sentInstructions(), QList<uint8_t>({APDU::INS_GET_STATUS,
+                                                     APDU::INS_OPEN_SECURE_CHANNEL,
+                                                     APDU::INS_MUTUALLY_AUTHENTICATE,
+                                                     APDU::INS_GET_STATUS}));
+        QCOMPARE(Metrics::counter("secure_channel.resync"), quint64(1));
+        QCOMPARE(Metrics::counter("secure_channel.resync_replayed"), quint64(1));
+    }
+
+    void testMacMismatchReplaysIdempotentCommand() {
+        m_script[APDU::INS_GET_STATUS] = {desyncedResponse()};
+
+        // Recovered in place: nothing is thrown to the caller
+        m_cmdSet->getStatus();
+
+        QCOMPARE(sentInstructions(), QList<uint8_t>({APDU::INS_GET_STATUS,
+                                                     APDU::INS_OPEN_SECURE_CHANNEL,
+                                                     APDU::INS_MUTUALLY_AUTHENTICATE,
+                                                     APDU::INS_GET_STATUS}));
+        QCOMPARE(Metrics::counter("secure_channel.resync"), quint64(1));
+    }
+
+    void testCachedPinIsVerifiedAgain() {
+        QVERIFY(m_cmdSet->verifyPIN("123456"));
+        markSent();
+        m_script[APDU::INS_EXPORT_KEY] = {desyncedResponse()};
+
+        m_cmdSet->exportKey(true, false, "m/44'/60'/0'/0/0", APDU::P2ExportKeyPublicOnly);
+
+        QCOMPARE(sentInstructions(), QList<uint8_t>({APDU::INS_EXPORT_KEY,
+                                                     APDU::INS_OPEN_SECURE_CHANNEL,
+                                                     APDU::INS_MUTUALLY_AUTHENTICATE,
+                                                     APDU::INS_VERIFY_PIN,
+                                                     APDU::INS_EXPORT_KEY}));
+    }
+
+    void testNonIdempotentCommandIsNotReplayed() {
+        m_script[APDU::INS_CHANGE_PIN] = {desyncedResponse()};
+
+        QVERIFY(!m_cmdSet->changePIN("654321"));
+
+        QCOMPARE(sentInstructions(), QList<uint8_t>({APDU::INS_CHANGE_PIN,
+                                                     APDU::INS_OPEN_SECURE_CHANNEL,
+                                                     APDU::INS_MUTUALLY_AUTHENTICATE}));
+        QCOMPARE(Metrics::counter("secure_channel.resync"), quint64(1));
+        QCOMPARE(Metrics::counter("secure_channel.resync_replayed"), quint64(0));
+
+        // The channel is usable again for the next command
+        markSent();
+        QVERIFY(m_cmdSet->changePIN("654321"));
+        QCOMPARE(sentInstructions(), QList<uint8_t>({APDU::INS_CHANGE_PIN}));
+    }
+
+    void testOnlyDerivationsFromMasterAreReplayed() {
+        const QList<uint8_t> notReplayed = {APDU::INS_OPEN_SECURE_CHANNEL, APDU::INS_MUTUALLY_AUTHENTICATE};
+
+        // DERIVE KEY always moves the current key
+        QVERIFY(m_cmdSet->deriveKey("m/44'/60'/0'"));
+        QVERIFY(m_cmdSet->isCurrentKeyPathKnown());
+        markSent();
+        m_script[APDU::INS_DERIVE_KEY] = {desyncedResponse()};
+        QVERIFY(!m_cmdSet->deriveKey("m/44'/60'/0'/0"));
+        QCOMPARE(sentInstructions(), QList<uint8_t>({APDU::INS_DERIVE_KEY}) + notReplayed);
+        QVERIFY(!m_cmdSet->isCurrentKeyPathKnown());
+
+        // Derived from the current key
+        QVERIFY(m_cmdSet->deriveKey("m/44'/60'/0'"));
+        markSent();
+        m_script[APDU::INS_EXPORT_KEY] = {desyncedResponse()};
+        QVERIFY(m_cmdSet->exportKey(true, false, "./0", APDU::P2ExportKeyPublicOnly).isEmpty());
+        QCOMPARE(sentInstructions(), QList<uint8_t>({APDU::INS_EXPORT_KEY}) + notReplayed);
+        QVERIFY(!m_cmdSet->isCurrentKeyPathKnown());
+
+        // Made current
+        markSent();
+        m_script[APDU::INS_SIGN] = {desyncedResponse()};
+        m_cmdSet->signWithPath(QByteArray(32, 0x01), "m/44'/60'/0'/0/0", true);
+        QCOMPARE(sentInstructions(), QList<uint8_t>({APDU::INS_SIGN}) + notReplayed);
+        QCOMPARE(Metrics::counter("secure_channel.resync_replayed"), quint64(0));
+
+        // From the master key, current key untouched: replayed
+        markSent();
+        m_script[APDU::INS_SIGN] = {desyncedResponse()};
+        m_cmdSet->signWithPath(QByteArray(32, 0x01), "m/44'/60'/0'/0/0", false);
+        QCOMPARE(sentInstructions(), QList<uint8_t>({APDU::INS_SIGN}) + notReplayed
+                                     + QList<uint8_t>({APDU::INS_SIGN}));
+        QCOMPARE(Metrics::counter("secure_channel.resync_replayed"), quint64(1));
+    }
+
+    void testEncryptedSw6985IsNotADesync() {
+        if (!Core::SecureSession::isAvailable()) {
+            QSKIP("Needs OpenSSL to encrypt the card's answers");
+        }
+
+        // The applet refusing through the open session: "PIN not verified"
+        m_script[APDU::INS_CHANGE_PIN] = {ENCRYPTED_PREFIX + QByteArray::fromHex("6985")};
+        QVERIFY(!m_cmdSet->changePIN("654321"));
+        QVERIFY(m_cmdSet->lastError() != "Secure channel resynchronized, command not replayed");
+
+        // "No key loaded" for an idempotent command: not replayed either
+        m_script[APDU::INS_SIGN] = {ENCRYPTED_PREFIX + QByteArray::fromHex("6985")};
+        QVERIFY(m_cmdSet->sign(QByteArray(32, 0x01)).isEmpty());
+
+        QCOMPARE(sentInstructions(), QList<uint8_t>({APDU::INS_CHANGE_PIN, APDU::INS_SIGN}));
+        QCOMPARE(Metrics::counter("secure_channel.resync"), quint64(0));
+        QCOMPARE(Metrics::counter("secure_channel.resync_failed"), quint64(0));
+    }
+
+    void testTimedOutCommandIsNotReplayed() {
+        TransportTimeoutPolicy::Options options;
+        options.coldTimeoutMs = 50;
+        options.minimumMs = 50;
+        m_channel->setTimeoutPolicy(std::make_shared<TransportTimeoutPolicy>(options));
+        m_mock->setEnforceTransmitTimeout(true);
+
+        // The card may have counted the attempt: no IV restore, no replay
+        m_mock->setTransmitDelay(5000);
+        QVERIFY(!m_cmdSet->verifyPIN("123456"));
+        QCOMPARE(Metrics::counter("secure_channel.timeout_not_replayed"), quint64(1));
+        QVERIFY(m_cmdSet->isStatusStale());
+
+        // The next command opens a new session first
+        m_mock->setTransmitDelay(0);
+        QVERIFY(m_cmdSet->changePIN("654321"));
+        QCOMPARE(sentInstructions(), QList<uint8_t>({APDU::INS_OPEN_SECURE_CHANNEL,
+                                                     APDU::INS_MUTUALLY_AUTHENTICATE,
+                                                     APDU::INS_CHANGE_PIN}));
+    }
+
+    void testTimedOutIdempotentCommandIsRethrown() {
+        TransportTimeoutPolicy::Options options;
+        options.coldTimeoutMs = 50;
+        options.minimumMs = 50;
+        m_channel->setTimeoutPolicy(std::make_shared<TransportTimeoutPolicy>(options));
+        m_mock->setEnforceTransmitTimeout(true);
+
+        // Left to CommunicationManager, which re-queues it
+        m_mock->setTransmitDelay(5000);
+        bool timedOut = false;
+        try {
+            m_cmdSet->getStatus();
+        } catch (const TransportTimeoutError&) {
+            timedOut = true;
+        }
+        QVERIFY(timedOut);
+        QCOMPARE(Metrics::counter("secure_channel.timeout_not_replayed"), quint64(0));
+
+        m_mock->setTransmitDelay(0);
+        m_cmdSet->getStatus();
+        QCOMPARE(sentInstructions(), QList<uint8_t>({APDU::INS_OPEN_SECURE_CHANNEL,
+                                                     APDU::INS_MUTUALLY_AUTHENTICATE,
+                                                     APDU::INS_GET_STATUS}));
+    }
+
+    void testFailedResyncReportsMacError() {
+        m_script[APDU::INS_GET_STATUS] = {desyncedResponse()};
+        m_openSecureChannelResponse = QByteArray::fromHex("6A80");
+
+        bool thrown = false;
+        try {
+            m_cmdSet->getStatus();
+        } catch (const SecureChannelMacError&) {
+            thrown = true;
+        }
+
+        QVERIFY(thrown);
+        QCOMPARE(Metrics::counter("secure_channel.resync"), quint64(0));
+        QCOMPARE(Metrics::counter("secure_channel.resync_failed"), quint64(1));
+    }
+};
+
+QTEST_MAIN(TestSecureChannelResync)
+#include "test_secure_channel_resync.moc"
@@ -0,0 +1,198 @@
+/**
+ * Tests for SessionPlanner and derivation from the current key
+ */
+
+#include <QTest>
+#include "keycard-qt/session_planner.h"
+#include "keycard-qt/command_set.h"
+#include "keycard-qt/keycard_channel.h"
+#include "mocks/mock_backend.h"
+#include <memory>
+
+using namespace Keycard;
+using namespace Keycard::Test;
+
+class TestSessionPlanner : public QObject {
+    Q_OBJECT
+
+private:
+    static std::unique_ptr<CardCommand> exportKey(const QString& path, bool makeCurrent = false) {
+        return std::make_unique<ExportKeyExtendedCommand>(true, makeCurrent, path);
+    }
+
+    static QStringList describe(const SessionPlanner::CommandQueue& queue) {
+        QStringList result;
+        for (const auto& cmd : queue) {
+            result << cmd->name() + " " + cmd->derivationPath();
+        }
+        return result;
+    }
+
+    static uint8_t lastP1Of(MockBackend* mock, uint8_t ins) {
+        uint8_t p1 = 0xFF;
+        for (const QByteArray& apdu : mock->getTransmittedApdus()) {
+            if (apdu.size() > 2 && static_cast<uint8_t>(apdu[1]) == ins) {
+                p1 = static_cast<uint8_t>(apdu[2]);
+            }
+        }
+        return p1;
+    }
+
+private slots:
+    void testPathParsing() {
+        SessionPlanner::KeyPath path;
+        QVERIFY(SessionPlanner::parsePath("m/44'/60'/0'/0/5", path));
+        QCOMPARE(path.size(), 5);
+        QCOMPARE(path[0], 0x8000002Cu);
+        QCOMPARE(path[4], 5u);
+        QCOMPARE(SessionPlanner::formatPath(path), QString("m/44'/60'/0'/0/5"));
+
+        QCOMPARE(SessionPlanner::decodePath(QByteArray::fromHex("8000002C00000005")),
+                 SessionPlanner::KeyPath({0x8000002Cu, 5u}));
+
+        QVERIFY(!SessionPlanner::parsePath("../0/1", path));
+        QVERIFY(!SessionPlanner::parsePath("m/44'/x", path));
+    }
+
+    void testEstimateCountsHardenedSteps() {
+        SessionPlanner::CommandQueue queue;
+        queue.push_back(exportKey("m/44'/60'/0'/0/0"));
+        queue.push_back(std::make_unique<SignCommand>(QByteArray(32, 0x01), "m/43'/60'/1581'"));
+
+        DerivationCost cost = SessionPlanner::estimate(queue, {}, false);
+        QCOMPARE(cost.derivations, 2);
+        QCOMPARE(cost.hardenedSteps, 6);
+        QCOMPARE(cost.normalSteps, 2);
+    }
+
+    void testFreeCommandsFollowMakeCurrent() {
+        SessionPlanner::CommandQueue queue;
+        queue.push_back(exportKey("m/44'/60'/0'/0/2"));
+        queue.push_back(exportKey("m/44'/60'/0'/0/0"));
+        queue.push_back(std::make_unique<DeriveKeyCommand>("m/44'/60'/0'/0"));
+        queue.push_back(exportKey("m/44'/60'/0'/0/1"));
+
+        SessionPlan plan = SessionPlanner().plan(queue, {}, false);
+
+        QCOMPARE(describe(queue), QStringList({
+            "DERIVE_KEY m/44'/60'/0'/0",
+            "EXPORT_KEY_EXTENDED m/44'/60'/0'/0/0",
+            "EXPORT_KEY_EXTENDED m/44'/60'/0'/0/1",
+            "EXPORT_KEY_EXTENDED m/44'/60'/0'/0/2",
+        }));
+        QCOMPARE(plan.insertedDerivations, 0);
+        QCOMPARE(plan.fifoCost.steps(), 4 + 5 + 5 + 1);
+        QCOMPARE(plan.plannedCost.steps(), 4 + 1 + 1 + 1);
+        QCOMPARE(plan.plannedCost.hardenedSteps, 3);
+    }
+
+    void testSignAlwaysDerivesFromMaster() {
+        SessionPlanner::CommandQueue queue;
+        queue.push_back(std::make_unique<SignCommand>(QByteArray(32, 0x01), "m/44'/60'/0'/0/0"));
+        queue.push_back(std::make_unique<DeriveKeyCommand>("m/44'/60'/0'/0"));
+
+        SessionPlan plan = SessionPlanner().plan(queue, {}, false);
+
+        QVERIFY(!plan.isChanged());
+        QCOMPARE(queue.front()->name(), QString("SIGN"));
+    }
+
+    void testParentDerivationNeedsOptIn() {
+        SessionPlanner::CommandQueue queue;
+        for (int i = 0; i < 4; ++i) {
+            queue.push_back(exportKey(QString("m/44'/60'/0'/0/%1").arg(i)));
+        }
+
+        // Would leave the card on m/44'/60'/0'/0 instead of its previous key
+        SessionPlan plan = SessionPlanner().plan(queue, {}, false);
+        QVERIFY(!plan.isChanged());
+        QCOMPARE(plan.plannedCost.steps(), plan.fifoCost.steps());
+        QCOMPARE(queue.size(), size_t(4));
+
+        SessionPlanner::Options options;
+        options.allowCurrentPathChange = true;
+        plan = SessionPlanner(options).plan(queue, {}, false);
+
+        QCOMPARE(plan.insertedDerivations, 1);
+        QCOMPARE(queue.size(), size_t(5));
+        QCOMPARE(queue.front()->name(), QString("DERIVE_KEY"));
+        QCOMPARE(plan.fifoCost.steps(), 20);
+        QCOMPARE(plan.plannedCost.steps(), 4 + 4);
+
+        // Planning again finds nothing left to gain
+        plan = SessionPlanner(options).plan(queue, {}, false);
+        QVERIFY(!plan.isChanged());
+    }
+
+    void testBarriersAreNotCrossed() {
+        SessionPlanner::CommandQueue queue;
+        queue.push_back(exportKey("m/44'/60'/0'/0/1"));
+        queue.push_back(std::make_unique<VerifyPINCommand>("123456"));
+        queue.push_back(std::make_unique<DeriveKeyCommand>("m/44'/60'/0'/0"));
+        auto pinned = exportKey("m/44'/60'/0'/0/3");
+        pinned->setKeepOrder(true);
+        queue.push_back(std::move(pinned));
+        queue.push_back(exportKey("m/44'/60'/0'/0/2"));
+
+        QStringList before = describe(queue);
+        SessionPlan plan = SessionPlanner().plan(queue, {}, false);
+
+        QVERIFY(!plan.isChanged());
+        QCOMPARE(describe(queue), before);
+    }
+
+    void testKnownCurrentKeyIsUsed() {
+        SessionPlanner::KeyPath current;
+        QVERIFY(SessionPlanner::parsePath("m/44'/60'/0'/0", current));
+
+        SessionPlanner::CommandQueue queue;
+        queue.push_back(exportKey("m/44'/60'/0'/0/0"));
+
+        QCOMPARE(SessionPlanner::estimate(queue, current, true).steps(), 1);
+        QCOMPARE(SessionPlanner::estimate(queue, current, false).steps(), 5);
+    }
+
+    void testCommandSetDerivesFromKnownCurrentKey() {
+        auto* mock = new MockBackend();
+        mock->setAutoConnect(true);
+        auto channel = std::make_shared<KeycardChannel>(mock);
+        mock->simulateCardInserted();
+        CommandSet cmdSet(channel, nullptr, nullptr);
+        cmdSet.testInjectSecureChannelState(PairingInfo(QByteArray(32, 0xAB), 1),
+                                            QByteArray(16, 0x00), QByteArray(16, 0xEE), QByteArray(16, 0xDD));
+
+        QVERIFY(!cmdSet.isCurrentKeyPathKnown());
+        mock->queueResponse(QByteArray::fromHex("9000"));
+        QVERIFY(cmdSet.deriveKey("m/44'/60'/0'/0"));
+        QVERIFY(cmdSet.isCurrentKeyPathKnown());
+        QCOMPARE(SessionPlanner::formatPath(SessionPlanner::decodePath(cmdSet.currentKeyPath())),
+                 QString("m/44'/60'/0'/0"));
+
+        // Off unless session planning is: from master
+        mock->queueResponse(QByteArray::fromHex("9000"));
+        cmdSet.exportKey(true, false, "m/44'/60'/0'/0/7", 0x01);
+        QCOMPARE(lastP1Of(mock, APDU::INS_EXPORT_KEY),
+                 static_cast<uint8_t>(APDU::P1ExportKeyDerive | APDU::P1DeriveKeyFromMaster));
+        cmdSet.setDeriveFromCurrent(true);
+
+        // P1 = derive | source: below the current key, so derived from it
+        mock->queueResponse(QByteArray::fromHex("9000"));
+        cmdSet.exportKey(true, false, "m/44'/60'/0'/0/7", 0x01);
+        QCOMPARE(lastP1Of(mock, APDU::INS_EXPORT_KEY),
+                 static_cast<uint8_t>(APDU::P1ExportKeyDerive | APDU::P1DeriveKeyFromCurrent));
+
+        // Elsewhere in the tree: from master
+        mock->queueResponse(QByteArray::fromHex("9000"));
+        cmdSet.exportKey(true, false, "m/44'/60'/1'/0/0", 0x01);
+        QCOMPARE(lastP1Of(mock, APDU::INS_EXPORT_KEY),
+                 static_cast<uint8_t>(APDU::P1ExportKeyDerive | APDU::P1DeriveKeyFromMaster));
+
+        // Key removal resets the card's current key
+        mock->queueResponse(QByteArray::fromHex("9000"));
+        QVERIFY(cmdSet.removeKey());
+        QVERIFY(!cmdSet.isCurrentKeyPathKnown());
+    }
+};
+
+QTEST_MAIN(TestSessionPlanner)
+#include "test_session_planner.moc"
@@ -0,0 +1,213 @@
+/**
+ * Tests for TransportTimeoutPolicy and its use by KeycardChannel
+ */
+
+#include <QTest>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QTemporaryDir>
+#include "keycard-qt/keycard_channel.h"
+#include "keycard-qt/metrics.h"
+#include "keycard-qt/transport_timeout_policy.h"
+#include "keycard-qt/types.h"
+#include "mocks/mock_backend.h"
+
+using namespace Keycard;
+using namespace Keycard::Test;
+
+namespace {
+
+const quint16 MODEL_3_1 = TransportTimeoutPolicy::cardModel(3, 1);
+const quint16 MODEL_3_2 = TransportTimeoutPolicy::cardModel(3, 2);
+
+void recordMany(TransportTimeoutPolicy& policy, quint16 model, quint8 ins, qint64 elapsedMs, int count) {
+    for (int i = 0; i < count; ++i) {
+        policy.record(model, ins, elapsedMs);
+    }
+}
+
+TransportTimeoutPolicy::Options fastOptions() {
+    TransportTimeoutPolicy::Options options;
+    options.minimumMs = 50;
+    options.minSamples = 4;
+    return options;
+}
+
+} // namespace
+
+class TestTransportTimeouts : public QObject {
+    Q_OBJECT
+
+private slots:
+    void testColdTimeoutAndFloors() {
+        TransportTimeoutPolicy policy;
+        const TransportTimeoutPolicy::Options options = policy.options();
+
+        QCOMPARE(policy.timeoutFor(MODEL_3_1, APDU::INS_GET_STATUS), options.coldTimeoutMs);
+        QCOMPARE(policy.timeoutFor(MODEL_3_1, APDU::INS_LOAD_KEY), options.floorsMs.value(APDU::INS_LOAD_KEY));
+        QVERIFY(policy.timeoutFor(MODEL_3_1, APDU::INS_INIT) > options.coldTimeoutMs);
+    }
+
+    void testLearnsFromLatency() {
+        TransportTimeoutPolicy policy(fastOptions());
+
+        // Too few samples: still cold
+        recordMany(policy, MODEL_3_1, APDU::INS_SIGN, 40, 3);
+        QCOMPARE(policy.timeoutFor(MODEL_3_1, APDU::INS_SIGN), policy.options().coldTimeoutMs);
+
+        recordMany(policy, MODEL_3_1, APDU::INS_SIGN, 40, 97);
+        const int timeout = policy.timeoutFor(MODEL_3_1, APDU::INS_SIGN);
+        QVERIFY2(timeout >= 120 && timeout <= 160, QByteArray::number(timeout).constData());
+
+        // A different card model or instruction learns separately
+        QCOMPARE(policy.timeoutFor(MODEL_3_2, APDU::INS_SIGN), policy.options().coldTimeoutMs);
+        QCOMPARE(policy.timeoutFor(MODEL_3_1, APDU::INS_EXPORT_KEY), policy.options().coldTimeoutMs);
+    }
+
+    void testHighPercentileDominates() {
+        TransportTimeoutPolicy policy(fastOptions());
+
+        recordMany(policy, MODEL_3_1, APDU::INS_SIGN, 40, 95);
+        recordMany(policy, MODEL_3_1, APDU::INS_SIGN, 400, 5);
+
+        // p99 lands among the slow exchanges
+        QVERIFY(policy.timeoutFor(MODEL_3_1, APDU::INS_SIGN) >= 1200);
+    }
+
+    void testFloorHoldsForSlowOperations() {
+        TransportTimeoutPolicy policy(fastOptions());
+
+        recordMany(policy, MODEL_3_1, APDU::INS_LOAD_KEY, 10, 50);
+        QCOMPARE(policy.timeoutFor(MODEL_3_1, APDU::INS_LOAD_KEY),
+                 policy.options().floorsMs.value(APDU::INS_LOAD_KEY));
+    }
+
+    void testTimeoutBacksOffUntilSuccess() {
+        TransportTimeoutPolicy policy(fastOptions());
+        recordMany(policy, MODEL_3_1, APDU::INS_SIGN, 40, 20);
+        const int learned = policy.timeoutFor(MODEL_3_1, APDU::INS_SIGN);
+        const quint64 timeoutsBefore = Metrics::counter(QStringLiteral("transport.timeouts"));
+
+        policy.recordTimeout(MODEL_3_1, APDU::INS_SIGN);
+        QCOMPARE(policy.timeoutFor(MODEL_3_1, APDU::INS_SIGN), learned * 2);
+        policy.recordTimeout(MODEL_3_1, APDU::INS_SIGN);
+        QCOMPARE(policy.timeoutFor(MODEL_3_1, APDU::INS_SIGN), learned * 4);
+        QCOMPARE(Metrics::counter(QStringLiteral("transport.timeouts")), timeoutsBefore + 2);
+
+        policy.record(MODEL_3_1, APDU::INS_SIGN, 40);
+        QCOMPARE(policy.timeoutFor(MODEL_3_1, APDU::INS_SIGN), learned);
+    }
+
+    void testOldSamplesAge() {
+        TransportTimeoutPolicy policy(fastOptions());
+        recordMany(policy, MODEL_3_1, APDU::INS_SIGN, 40, TransportTimeoutPolicy::AGING_SAMPLES);
+        QVERIFY(policy.sampleCount(MODEL_3_1, APDU::INS_SIGN) <= TransportTimeoutPolicy::AGING_SAMPLES / 2 + 1);
+    }
+
+    void testPersistence() {
+        QTemporaryDir dir;
+        QVERIFY(dir.isValid());
+        const QString path = dir.filePath(QStringLiteral("timeouts.bin"));
+
+        int learned = 0;
+        {
+            TransportTimeoutPolicy policy(fastOptions(), path);
+            recordMany(policy, MODEL_3_1, APDU::INS_SIGN, 40, 10);
+            recordMany(policy, MODEL_3_1, APDU::INS_SIGN, 400, 1);
+            learned = policy.timeoutFor(MODEL_3_1, APDU::INS_SIGN);
+            // Written on destruction
+        }
+
+        TransportTimeoutPolicy reloaded(fastOptions(), path);
+        QCOMPARE(reloaded.sampleCount(MODEL_3_1, APDU::INS_SIGN), quint32(11));
+        QCOMPARE(reloaded.timeoutFor(MODEL_3_1, APDU::INS_SIGN), learned);
+    }
+
+    void testSavedOffTheRecordPath() {
+        QTemporaryDir dir;
+        QVERIFY(dir.isValid());
+        const QString path = dir.filePath(QStringLiteral("timeouts.bin"));
+
+        TransportTimeoutPolicy policy(fastOptions(), path);
+        recordMany(policy, MODEL_3_1, APDU::INS_SIGN, 40, 200);
+        QVERIFY(!QFile::exists(path));
+
+        QVERIFY(policy.save());
+        QVERIFY(QFile::exists(path));
+        TransportTimeoutPolicy reloaded(fastOptions(), path);
+        QCOMPARE(reloaded.sampleCount(MODEL_3_1, APDU::INS_SIGN), quint32(200));
+    }
+
+    void testChannelRecordsPerCardModel() {
+        auto* mock = new MockBackend();
+        mock->setAutoConnect(false);
+        KeycardChannel channel(mock);
+        auto policy = std::make_shared<TransportTimeoutPolicy>(fastOptions());
+        channel.setTimeoutPolicy(policy);
+        mock->simulateCardInserted();
+
+        const QByteArray getStatus = QByteArray::fromHex("80F2000000");
+        channel.transmit(getStatus);
+        channel.setCardModel(3, 1);
+        channel.transmit(getStatus);
+        channel.transmit(getStatus);
+
+        QCOMPARE(policy->sampleCount(TransportTimeoutPolicy::UNKNOWN_MODEL, APDU::INS_GET_STATUS), quint32(1));
+        QCOMPARE(policy->sampleCount(MODEL_3_1, APDU::INS_GET_STATUS), quint32(2));
+        QCOMPARE(mock->getTransmitTimeout(), policy->timeoutFor(MODEL_3_1, APDU::INS_GET_STATUS));
+    }
+
+    void testChannelFailsFastOnHungExchange() {
+        auto* mock = new MockBackend();
+        mock->setAutoConnect(false);
+        mock->setEnforceTransmitTimeout(true);
+        KeycardChannel channel(mock);
+        auto policy = std::make_shared<TransportTimeoutPolicy>(fastOptions());
+        channel.setTimeoutPolicy(policy);
+        channel.setCardModel(3, 1);
+        mock->simulateCardInserted();
+
+        // Usually answers within 10 ms, so the learned timeout is the 50 ms minimum
+        recordMany(*policy, MODEL_3_1, APDU::INS_GET_STATUS, 10, 20);
+        QCOMPARE(policy->timeoutFor(MODEL_3_1, APDU::INS_GET_STATUS), 50);
+
+        mock->setTransmitDelay(5000);
+        QElapsedTimer elapsed;
+        elapsed.start();
+        bool timedOut = false;
+        try {
+            channel.transmit(QByteArray::fromHex("80F2000000"));
+        } catch (const TransportTimeoutError&) {
+            timedOut = true;
+        }
+        QVERIFY(timedOut);
+        QVERIFY(elapsed.elapsed() < 1000);
+
+        // The next attempt gets twice as long
+        QCOMPARE(policy->timeoutFor(MODEL_3_1, APDU::INS_GET_STATUS), 100);
+    }
+
+    void testOtherFailuresAreNotTimeouts() {
+        auto* mock = new MockBackend();
+        mock->setAutoConnect(false);
+        mock->setEnforceTransmitTimeout(true);
+        KeycardChannel channel(mock);
+        mock->simulateCardInserted();
+
+        mock->setNextTransmitThrows(QStringLiteral("Tag lost during transmission"));
+        bool timedOut = false;
+        bool failed = false;
+        try {
+            channel.transmit(QByteArray::fromHex("80F2000000"));
+        } catch (const TransportTimeoutError&) {
+            timedOut = true;
+        } catch (const std::runtime_error&) {
+            failed = true;
+        }
+        QVERIFY(failed);
+        QVERIFY(!timedOut);
+    }
+};
+
+QTEST_MAIN(TestTransportTimeouts)
+#include "test_transport_timeouts.moc"
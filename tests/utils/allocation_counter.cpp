@@ -0,0 +1,164 @@
+// Copyright (C) 2025 Status Research & Development GmbH
+// SPDX-License-Identifier: MIT
+
+#include "allocation_counter.h"
+#include <cstddef>
+#include <cstdlib>
+
+#ifdef KEYCARD_TEST_HAS_OPENSSL
+#include <openssl/crypto.h>
+#endif
+
+#if defined(__has_feature)
+#if __has_feature(address_sanitizer)
+#define KEYCARD_TEST_ASAN
+#endif
+#endif
+#if defined(__SANITIZE_ADDRESS__)
+#define KEYCARD_TEST_ASAN
+#endif
+
+#if defined(__GLIBC__) && !defined(KEYCARD_TEST_ASAN)
+#define KEYCARD_TEST_COUNT_ALLOCATIONS
+#endif
+
+namespace {
+
+// Plain thread-locals in the executable: static TLS, so reading them from
+// inside malloc never allocates
+struct ThreadCounters {
+    int active;     // Live AllocationCounters
+    int paused;     // Live AllocationPauses
+    quint64 count;
+    quint64 bytes;
+};
+
+thread_local ThreadCounters t_counters = {0, 0, 0, 0};
+
+inline void record(std::size_t size) {
+    ThreadCounters& counters = t_counters;
+    if (counters.active > 0 && counters.paused == 0) {
+        ++counters.count;
+        counters.bytes += size;
+    }
+}
+
+} // namespace
+
+#ifdef KEYCARD_TEST_COUNT_ALLOCATIONS
+
+extern "C" {
+
+void* __libc_malloc(std::size_t size);
+void* __libc_calloc(std::size_t count, std::size_t size);
+void* __libc_realloc(void* ptr, std::size_t size);
+void __libc_free(void* ptr);
+
+// Definitions in the executable take precedence over libc's for every
+// library, Qt and libstdc++ (operator new) included
+void* malloc(std::size_t size) noexcept {
+    record(size);
+    return __libc_malloc(size);
+}
+
+void* calloc(std::size_t count, std::size_t size) noexcept {
+    record(count * size);
+    return __libc_calloc(count, size);
+}
+
+void* realloc(void* ptr, std::size_t size) noexcept {
+    record(size);
+    return __libc_realloc(ptr, size);
+}
+
+} // extern "C"
+
+#ifdef KEYCARD_TEST_HAS_OPENSSL
+namespace {
+
+void* opensslMalloc(std::size_t size, const char*, int) {
+    return __libc_malloc(size);
+}
+
+void* opensslRealloc(void* ptr, std::size_t size, const char*, int) {
+    return __libc_realloc(ptr, size);
+}
+
+void opensslFree(void* ptr, const char*, int) {
+    __libc_free(ptr);
+}
+
+// Must run before OpenSSL allocates anything, hence static initialization
+const bool s_opensslExcluded = CRYPTO_set_mem_functions(opensslMalloc, opensslRealloc, opensslFree) == 1;
+
+} // namespace
+#endif
+
+#endif // KEYCARD_TEST_COUNT_ALLOCATIONS
+
+namespace Keycard {
+namespace Test {
+
+AllocationCounter::AllocationCounter()
+    : m_startCount(t_counters.count)
+    , m_startBytes(t_counters.bytes)
+{
+    ++t_counters.active;
+}
+
+AllocationCounter::~AllocationCounter()
+{
+    stop();
+}
+
+void AllocationCounter::stop()
+{
+    if (!m_running) {
+        return;
+    }
+    m_count = t_counters.count - m_startCount;
+    m_bytes = t_counters.bytes - m_startBytes;
+    --t_counters.active;
+    m_running = false;
+}
+
+quint64 AllocationCounter::count() const
+{
+    return m_running ? t_counters.count - m_startCount : m_count;
+}
+
+quint64 AllocationCounter::bytes() const
+{
+    return m_running ? t_counters.bytes - m_startBytes : m_bytes;
+}
+
+bool AllocationCounter::isAvailable()
+{
+#ifdef KEYCARD_TEST_COUNT_ALLOCATIONS
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool AllocationCounter::excludesOpenSsl()
+{
+#if defined(KEYCARD_TEST_COUNT_ALLOCATIONS) && defined(KEYCARD_TEST_HAS_OPENSSL)
+    return s_opensslExcluded;
+#else
+    return false;
+#endif
+}
+
+AllocationPause::AllocationPause()
+{
+    ++t_counters.paused;
+}
+
+AllocationPause::~AllocationPause()
+{
+    --t_counters.paused;
+}
+
+} // namespace Test
+} // namespace Keycard
@@ -0,0 +1,84 @@
+// Copyright (C) 2025 Status Research & Development GmbH
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <QtGlobal>
+
+namespace Keycard {
+namespace Test {
+
+/**
+ * @brief Counts heap allocations made by the calling thread
+ *
+ * Linked into a test executable, allocation_counter.cpp interposes malloc,
+ * calloc and realloc (glibc only), so operator new as well as QByteArray and
+ * QString storage are seen. OpenSSL's allocations are routed around the
+ * counter: budgets then do not change with the OpenSSL version.
+ *
+ * Counting starts at construction and covers the creating thread only, minus
+ * AllocationPause scopes. Counters may be nested.
+ *
+ * Example:
+ * @code
+ * AllocationCounter counter;
+ * channel.send(command);
+ * counter.stop();
+ * QVERIFY(counter.count() <= 9);
+ * @endcode
+ */
+class AllocationCounter
+{
+public:
+    AllocationCounter();
+    ~AllocationCounter();
+
+    AllocationCounter(const AllocationCounter&) = delete;
+    AllocationCounter& operator=(const AllocationCounter&) = delete;
+
+    /**
+     * @brief Stop counting; count() and bytes() keep their values
+     */
+    void stop();
+
+    quint64 count() const;
+    quint64 bytes() const;  ///< Bytes requested (not freed) while counting
+
+    /**
+     * @brief Is malloc interposed in this build?
+     *
+     * False on non-glibc platforms and under AddressSanitizer.
+     */
+    static bool isAvailable();
+
+    /**
+     * @brief Are OpenSSL's allocations kept out of the count?
+     */
+    static bool excludesOpenSsl();
+
+private:
+    bool m_running = true;
+    quint64 m_startCount = 0;
+    quint64 m_startBytes = 0;
+    quint64 m_count = 0;
+    quint64 m_bytes = 0;
+};
+
+/**
+ * @brief Suspends counting on the calling thread for its lifetime
+ *
+ * For work a test does inside a measured call that is not part of the code
+ * under test, e.g. a fake card computing its response.
+ */
+class AllocationPause
+{
+public:
+    AllocationPause();
+    ~AllocationPause();
+
+    AllocationPause(const AllocationPause&) = delete;
+    AllocationPause& operator=(const AllocationPause&) = delete;
+};
+
+} // namespace Test
+} // namespace Keycard